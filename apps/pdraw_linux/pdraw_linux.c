@@ -240,6 +240,7 @@ int main(int argc, char *argv[])
     int mouseDownX = 0, mouseDownY = 0;
     struct vmeta_euler mouseDownHeadOrientation;
     uint64_t lastRenderTime = 0;
+    int forceRedraw = 1;
 #endif /* BUILD_SDL2 */
 
     welcome();
@@ -581,7 +582,11 @@ int main(int argc, char *argv[])
                     break;
                 case SDL_WINDOWEVENT:
                 {
-                    if (event.window.event == SDL_WINDOWEVENT_RESIZED)
+                    if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                    {
+                        forceRedraw = 1;
+                    }
+                    else if (event.window.event == SDL_WINDOWEVENT_RESIZED)
                     {
                         int ret;
                         app->windowWidth = event.window.data1;
@@ -813,19 +818,31 @@ int main(int argc, char *argv[])
             }
         }
 
+        int rendered = 1;
         if (app->pdraw)
         {
-            int ret = pdraw_render_video(app->pdraw, 0, 0, 0, 0, lastRenderTime);
+            int ret = pdraw_render_video_if_needed(app->pdraw, 0, 0, 0, 0, lastRenderTime, forceRedraw);
             if (ret < 0)
             {
-                ULOGE("pdraw_render() failed (%d)", ret);
+                ULOGE("pdraw_render_video_if_needed() failed (%d)", ret);
                 failed = 1;
             }
+            rendered = (ret != 0);
         }
 
-        SDL_GL_SwapWindow(app->window);
-        clock_gettime(CLOCK_MONOTONIC, &t1);
-        lastRenderTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+        if (rendered)
+        {
+            /* Only swap when the frame changed; the swap interval no
+             * longer paces the loop otherwise */
+            SDL_GL_SwapWindow(app->window);
+            forceRedraw = 0;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            lastRenderTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+        }
+        else
+        {
+            usleep(PDRAW_RENDER_IDLE_SLEEP);
+        }
 #else /* BUILD_SDL2 */
         sleep(1);
 #endif /* BUILD_SDL2 */
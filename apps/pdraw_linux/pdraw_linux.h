@@ -69,6 +69,8 @@
 
 #define PDRAW_CAMERA_ORIENTATION_MIN_INTERVAL 25000
 
+#define PDRAW_RENDER_IDLE_SLEEP 2000
+
 
 struct arcmd_reader_data;
 
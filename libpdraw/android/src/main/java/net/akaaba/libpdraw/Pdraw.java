@@ -56,6 +56,10 @@ public class Pdraw {
         PDRAW_COLOR_FORMAT_UNKNOWN,
         PDRAW_COLOR_FORMAT_YUV420PLANAR,
         PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR,
+        PDRAW_COLOR_FORMAT_RGB24,
+        PDRAW_COLOR_FORMAT_BGRA,
+        PDRAW_COLOR_FORMAT_GRAY8,
+        PDRAW_COLOR_FORMAT_RGBA,
     }
 
     static {
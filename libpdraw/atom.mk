@@ -20,7 +20,9 @@ LOCAL_SRC_FILES := \
 	src/pdraw_metadata_session.cpp \
 	src/pdraw_metadata_videoframe.cpp \
 	src/pdraw_avcdecoder.cpp \
-	src/pdraw_gles2_hud.cpp \
+	src/pdraw_hud.cpp \
+	src/pdraw_gles2_hud_batch.cpp \
+	src/pdraw_hud_canvas_software.cpp \
 	src/pdraw_gles2_video.cpp \
 	src/pdraw_gles2_hmd.cpp \
 	src/pdraw_gles2_hmd_shaders.cpp \
@@ -36,10 +38,19 @@ LOCAL_SRC_FILES := \
 	src/pdraw_gles2_hmd_cockpitglasses2_texcoords_red.cpp \
 	src/pdraw_gles2_hmd_cockpitglasses2_texcoords_green.cpp \
 	src/pdraw_gles2_hmd_cockpitglasses2_texcoords_blue.cpp \
+	src/pdraw_gles2_readback.cpp \
 	src/pdraw_renderer.cpp \
 	src/pdraw_renderer_gles2.cpp \
 	src/pdraw_renderer_videocoreegl.cpp \
-	src/pdraw_filter_videoframe.cpp
+	src/pdraw_renderer_software.cpp \
+	src/pdraw_frame_scheduler.cpp \
+	src/pdraw_filter_videoframe.cpp \
+	src/pdraw_worker_pool.cpp \
+	src/pdraw_colorconv.cpp \
+	src/pdraw_scaler.cpp \
+	src/pdraw_frame_export.cpp \
+	src/pdraw_frame_batch.cpp \
+	src/pdraw_frame_buffer_pool.cpp
 LOCAL_EXPORT_CXXFLAGS := -std=c++0x
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
 LOCAL_LIBRARIES := \
@@ -101,6 +112,75 @@ endif
 include $(BUILD_LIBRARY)
 
 
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := libpdraw-shm-reader
+LOCAL_DESCRIPTION := PDrAW shared memory video frame ring reader
+LOCAL_CATEGORY_PATH := libs
+LOCAL_SRC_FILES := src/pdraw_shm_reader.c
+LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/include
+LOCAL_LIBRARIES := \
+	libulog \
+	libpomp \
+	libvideo-metadata
+
+include $(BUILD_LIBRARY)
+
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := pdraw-colorconv-bench
+LOCAL_DESCRIPTION := PDrAW color conversion benchmark
+LOCAL_CATEGORY_PATH := multimedia
+LOCAL_SRC_FILES := tools/pdraw_colorconv_bench.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/src
+LOCAL_LIBRARIES := libpdraw libulog
+
+include $(BUILD_EXECUTABLE)
+
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := pdraw-ttff-bench
+LOCAL_DESCRIPTION := PDrAW cold/warm time to first frame benchmark
+LOCAL_CATEGORY_PATH := multimedia
+LOCAL_SRC_FILES := tools/pdraw_ttff_bench.cpp
+LOCAL_LIBRARIES := libpdraw
+
+include $(BUILD_EXECUTABLE)
+
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := pdraw-frame-scheduler-test
+LOCAL_DESCRIPTION := PDrAW frame scheduler unit test
+LOCAL_CATEGORY_PATH := multimedia
+LOCAL_SRC_FILES := \
+	tests/pdraw_frame_scheduler_test.cpp \
+	src/pdraw_frame_scheduler.cpp
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/src
+LOCAL_LIBRARIES := \
+	libulog \
+	libpomp \
+	libvideo-buffers \
+	libvideo-metadata
+
+include $(BUILD_EXECUTABLE)
+
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := pdraw-frame-ref-test
+LOCAL_DESCRIPTION := PDrAW producer frame reference accounting test
+LOCAL_CATEGORY_PATH := multimedia
+LOCAL_SRC_FILES := tests/pdraw_frame_ref_test.cpp
+LOCAL_LIBRARIES := libpdraw
+
+include $(BUILD_EXECUTABLE)
+
+
 ifneq ("$(shell which python-config)","")
 ifneq ("$(shell which swig)","")
 
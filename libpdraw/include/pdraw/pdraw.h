@@ -238,6 +238,23 @@ int pdraw_start_video_renderer_egl(
 	struct egl_display *eglDisplay);
 
 
+int pdraw_start_software_video_renderer(
+	struct pdraw *pdraw,
+	unsigned int width,
+	unsigned int height,
+	int enableHud);
+
+
+int pdraw_start_offscreen_video_renderer(
+	struct pdraw *pdraw,
+	unsigned int width,
+	unsigned int height,
+	enum pdraw_color_format format,
+	int enableHud,
+	pdraw_offscreen_frame_callback_t cb,
+	void *userPtr);
+
+
 int pdraw_stop_video_renderer(
 	struct pdraw *pdraw);
 
@@ -251,6 +268,26 @@ int pdraw_render_video(
 	uint64_t timestamp);
 
 
+int pdraw_render_video_if_needed(
+	struct pdraw *pdraw,
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	uint64_t timestamp,
+	int forceRedraw);
+
+
+int pdraw_render_video_to_buffer(
+	struct pdraw *pdraw,
+	uint8_t *buffer,
+	size_t size,
+	unsigned int stride,
+	enum pdraw_color_format format,
+	uint64_t timestamp,
+	int forceRedraw);
+
+
 enum pdraw_session_type pdraw_get_session_type(
 	struct pdraw *pdraw);
 
@@ -490,6 +527,15 @@ void *pdraw_add_video_frame_filter_callback(
 	void *userPtr);
 
 
+/* Consecutive frames can be passed to the callback concurrently and
+ * out of order */
+void *pdraw_add_parallel_video_frame_filter_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	pdraw_video_frame_filter_callback_t cb,
+	void *userPtr);
+
+
 int pdraw_remove_video_frame_filter_callback(
 	struct pdraw *pdraw,
 	unsigned int mediaId,
@@ -502,6 +548,13 @@ void *pdraw_add_video_frame_producer(
 	int frameByFrame);
 
 
+/* The frames are copied out of the decoder buffers */
+void *pdraw_add_video_frame_copy_producer(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	int frameByFrame);
+
+
 int pdraw_remove_video_frame_producer(
 	struct pdraw *pdraw,
 	void *producerCtx);
@@ -514,6 +567,149 @@ int pdraw_get_producer_last_frame(
 	int timeout);
 
 
+int pdraw_get_producer_last_frame_ref(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	struct pdraw_video_frame *frame,
+	void **frameRef,
+	int timeout);
+
+
+int pdraw_release_producer_frame(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	void *frameRef);
+
+
+int pdraw_get_producer_event_fd(
+	struct pdraw *pdraw,
+	void *producerCtx);
+
+
+void *pdraw_add_video_frame_export(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	unsigned int slotCount,
+	size_t slotSize);
+
+
+int pdraw_remove_video_frame_export(
+	struct pdraw *pdraw,
+	void *exportCtx);
+
+
+int pdraw_get_video_frame_export_fd(
+	struct pdraw *pdraw,
+	void *exportCtx);
+
+
+int pdraw_send_video_frame_export_fd(
+	struct pdraw *pdraw,
+	void *exportCtx,
+	int sock);
+
+
+void *pdraw_add_video_frame_metadata_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	pdraw_video_frame_metadata_callback_t cb,
+	void *userPtr,
+	enum pdraw_video_frame_metadata_source source);
+
+
+int pdraw_remove_video_frame_metadata_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	void *metadataCtx);
+
+
+void *pdraw_add_video_frame_batch_producer(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	const struct pdraw_video_frame_batch_settings *settings,
+	pdraw_video_frame_batch_callback_t cb,
+	void *userPtr);
+
+
+int pdraw_remove_video_frame_batch_producer(
+	struct pdraw *pdraw,
+	void *batchCtx);
+
+
+int pdraw_get_video_frame_batch_settings(
+	struct pdraw *pdraw,
+	void *batchCtx,
+	struct pdraw_video_frame_batch_settings *settings);
+
+
+int pdraw_get_producer_ring_settings(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy *policy,
+	unsigned int *depth);
+
+
+int pdraw_set_producer_ring_settings(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy policy,
+	unsigned int depth);
+
+
+int pdraw_get_producer_stats(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	struct pdraw_video_frame_producer_stats *stats);
+
+
+int pdraw_get_video_frame_filter_stats(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	struct pdraw_video_frame_filter_stats *stats);
+
+
+int pdraw_get_video_frame_filter_output_format(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	enum pdraw_color_format *format);
+
+
+int pdraw_set_video_frame_filter_output_format(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	enum pdraw_color_format format);
+
+
+int pdraw_get_video_frame_filter_scaling(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	struct pdraw_video_frame_filter_scaling *scaling);
+
+
+int pdraw_set_video_frame_filter_scaling(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	const struct pdraw_video_frame_filter_scaling *scaling);
+
+
+int pdraw_get_video_decoder_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_decoder_stats *stats);
+
+
+int pdraw_get_video_decoder_output_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_decoder_output_stats *stats);
+
+
+int pdraw_get_video_renderer_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_renderer_stats *stats);
+
+
 float pdraw_get_controller_radar_angle_setting(
 	struct pdraw *pdraw);
 
@@ -553,6 +749,52 @@ int pdraw_set_hmd_distorsion_correction_settings(
 	float panH,
 	float panV);
 
+int pdraw_get_decoder_drop_settings(
+	struct pdraw *pdraw,
+	enum pdraw_decoder_drop_policy *policy,
+	unsigned int *maxBacklog);
+
+int pdraw_set_decoder_drop_settings(
+	struct pdraw *pdraw,
+	enum pdraw_decoder_drop_policy policy,
+	unsigned int maxBacklog);
+
+int pdraw_get_warm_pool_setting(
+	struct pdraw *pdraw);
+
+int pdraw_set_warm_pool_setting(
+	struct pdraw *pdraw,
+	int enable);
+
+int pdraw_get_decoder_output_settings(
+	struct pdraw *pdraw,
+	unsigned int *sinkMaxFrames,
+	unsigned int *leakTimeout);
+
+int pdraw_set_decoder_output_settings(
+	struct pdraw *pdraw,
+	unsigned int sinkMaxFrames,
+	unsigned int leakTimeout);
+
+enum pdraw_video_renderer_layout pdraw_get_video_renderer_layout_setting(
+	struct pdraw *pdraw);
+
+int pdraw_set_video_renderer_layout_setting(
+	struct pdraw *pdraw,
+	enum pdraw_video_renderer_layout layout);
+
+int pdraw_get_hmd_resolution_settings(
+	struct pdraw *pdraw,
+	float *minScale,
+	float *maxScale,
+	unsigned int *targetFrameTime);
+
+int pdraw_set_hmd_resolution_settings(
+	struct pdraw *pdraw,
+	float minScale,
+	float maxScale,
+	unsigned int targetFrameTime);
+
 int pdraw_set_jni_env
 	(struct pdraw *pdraw,
 	 void *jniEnv);
@@ -171,6 +171,36 @@ public:
 		bool enableHeadtracking,
 		struct egl_display *eglDisplay = NULL) = 0;
 
+	/**
+	 * Start a renderer drawing the video and the HUD on the CPU into
+	 * the buffers given to renderVideoToBuffer(), for hosts without
+	 * a GPU; HMD distortion correction and headtracking are not
+	 * supported
+	 */
+	virtual int startSoftwareVideoRenderer(
+		unsigned int width,
+		unsigned int height,
+		bool enableHud) = 0;
+
+	/**
+	 * Start a GL renderer drawing into an offscreen target of the
+	 * given size instead of the window; each frame rendered by
+	 * renderVideo() or renderVideoIfNeeded() is delivered to the
+	 * callback on the rendering thread in RGBA or NV12
+	 * (PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR, width multiple of 4 and
+	 * even height) a few frames later, so that the rendering never
+	 * waits for the GPU; the pending frames are delivered by
+	 * stopVideoRenderer(). A GL context (e.g. an EGL pbuffer) must be
+	 * current, no window is needed.
+	 */
+	virtual int startOffscreenVideoRenderer(
+		unsigned int width,
+		unsigned int height,
+		enum pdraw_color_format format,
+		bool enableHud,
+		pdraw_offscreen_frame_callback_t cb,
+		void *userPtr) = 0;
+
 	virtual int stopVideoRenderer(
 		void) = 0;
 
@@ -181,6 +211,35 @@ public:
 		unsigned int renderHeight,
 		uint64_t timestamp) = 0;
 
+	/**
+	 * Same as renderVideo() but the rendering is skipped when
+	 * nothing changed since the last rendered frame (no new frame,
+	 * metadata, headtracking or viewport change) unless forceRedraw
+	 * is true; returns 1 if the frame was rendered (the caller must
+	 * then swap buffers), 0 if it was skipped, or a negative errno
+	 */
+	virtual int renderVideoIfNeeded(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		uint64_t timestamp,
+		bool forceRedraw = false) = 0;
+
+	/**
+	 * Render with the software renderer into a packed RGBA or BGRA
+	 * buffer of the renderer size (stride 0: tightly packed); same
+	 * return values as renderVideoIfNeeded(), the buffer content is
+	 * kept when the rendering is skipped
+	 */
+	virtual int renderVideoToBuffer(
+		uint8_t *buffer,
+		size_t size,
+		unsigned int stride,
+		enum pdraw_color_format format,
+		uint64_t timestamp,
+		bool forceRedraw = false) = 0;
+
 	virtual enum pdraw_session_type getSessionType(
 		void) = 0;
 
@@ -317,27 +376,45 @@ public:
 		unsigned int index,
 		struct pdraw_media_info *info) = 0;
 
+	/**
+	 * Video frame filter: add a callback on a video media
+	 *
+	 * Filters run on a worker pool shared by all the sessions. Frames
+	 * are passed to the callback in order, one at a time, unless
+	 * parallel is true: consecutive frames can then be processed
+	 * concurrently and out of order.
+	 */
 	virtual void *addVideoFrameFilterCallback(
 		unsigned int mediaId,
 		pdraw_video_frame_filter_callback_t cb,
-		void *userPtr) = 0;
+		void *userPtr,
+		bool parallel = false) = 0;
 
 	virtual int removeVideoFrameFilterCallback(
 		unsigned int mediaId,
 		void *filterCtx) = 0;
 
+	/**
+	 * Video frame producer: add a producer on a video media
+	 *
+	 * By default frames are not copied: getProducerLastFrame() returns
+	 * a frame that stays valid until the next call. When copy is true,
+	 * frames are copied into a producer-owned buffer (legacy mode).
+	 */
 	virtual void *addVideoFrameProducer(
 		unsigned int mediaId,
-		bool frameByFrame = false) = 0;
+		bool frameByFrame = false,
+		bool copy = false) = 0;
 
 	virtual int removeVideoFrameProducer(
 		void *producerCtx) = 0;
 
 	/**
-	 * Video frame producer: get the last frame
+	 * Video frame producer: get the next frame from the ring (the
+	 * latest frame with the default latest-only policy)
 	 *
-	 * timeout : time in microseconds to wait for a frame
-	 *  0: don't wait
+	 * timeout : time in microseconds to wait for a frame (monotonic)
+	 *  0: don't wait, returns -ENOENT if no frame is pending
 	 * -1: wait forever
 	 * >0: wait time
 	 */
@@ -346,6 +423,184 @@ public:
 		struct pdraw_video_frame *frame,
 		int timeout = 0) = 0;
 
+	/**
+	 * Video frame producer: get a reference on the last frame
+	 *
+	 * The frame planes point to the decoder output buffer (no copy)
+	 * or to the producer frame copy (copy mode) and stay valid until
+	 * releaseProducerFrame() is called with the returned frameRef;
+	 * without copy the frame counts as held by the producer in the
+	 * decoder output settings and statistics until it is released
+	 */
+	virtual int getProducerLastFrameRef(
+		void *producerCtx,
+		struct pdraw_video_frame *frame,
+		void **frameRef,
+		int timeout = 0) = 0;
+
+	virtual int releaseProducerFrame(
+		void *producerCtx,
+		void *frameRef) = 0;
+
+	/**
+	 * Video frame producer: file descriptor readable while frames
+	 * are pending, to watch with poll/epoll or a pomp loop and then
+	 * fetch frames with a null timeout; the fd is owned by the
+	 * producer and closed on removeVideoFrameProducer()
+	 */
+	virtual int getProducerEventFd(
+		void *producerCtx) = 0;
+
+	/**
+	 * Video frame export: publish the decoded frames of a video media
+	 * to a shared memory ring readable from other processes (see
+	 * pdraw_shm.h for the reader API)
+	 *
+	 * slotCount: number of frames in the ring (0: default)
+	 * slotSize: maximum frame size in bytes (0: YUV420 frame at the
+	 * media resolution)
+	 *
+	 * The export context is a video frame filter context: the output
+	 * format and scaling functions apply to it.
+	 */
+	virtual void *addVideoFrameExport(
+		unsigned int mediaId,
+		unsigned int slotCount = 0,
+		size_t slotSize = 0) = 0;
+
+	virtual int removeVideoFrameExport(
+		void *exportCtx) = 0;
+
+	/* Shared memory fd of the ring, owned by the export */
+	virtual int getVideoFrameExportFd(
+		void *exportCtx) = 0;
+
+	/* Send the shared memory fd on a connected Unix socket */
+	virtual int sendVideoFrameExportFd(
+		void *exportCtx,
+		int sock) = 0;
+
+	/**
+	 * Video frame metadata subscription: the callback is called
+	 * for each frame with its timestamps and metadata only, without
+	 * any pixel data handling
+	 *
+	 * source: decoded frames or demuxed access units (the latter
+	 * also reports frames that are not decoded)
+	 *
+	 * The callback is called synchronously from the decoder or the
+	 * demuxer thread: it must return quickly and must not call any
+	 * PDrAW function.
+	 */
+	virtual void *addVideoFrameMetadataCallback(
+		unsigned int mediaId,
+		pdraw_video_frame_metadata_callback_t cb,
+		void *userPtr,
+		enum pdraw_video_frame_metadata_source source =
+			PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER) = 0;
+
+	virtual int removeVideoFrameMetadataCallback(
+		unsigned int mediaId,
+		void *metadataCtx) = 0;
+
+	/**
+	 * Video frame batch producer: frames are delivered by batches of
+	 * up to settings->batchSize frames, as frame copies or as a
+	 * contiguous uint8 tensor (NULL settings: 8 frame copies per
+	 * batch, no maximum wait time)
+	 *
+	 * The callback is called from a thread dedicated to the producer;
+	 * the batch storage is reused and is only valid during the call.
+	 * Tensor layouts set the frame output format to RGB24.
+	 *
+	 * The batch context is a video frame filter context: the output
+	 * format and scaling functions apply to it (e.g. to resize the
+	 * frames to the model input).
+	 */
+	virtual void *addVideoFrameBatchProducer(
+		unsigned int mediaId,
+		const struct pdraw_video_frame_batch_settings *settings,
+		pdraw_video_frame_batch_callback_t cb,
+		void *userPtr) = 0;
+
+	virtual int removeVideoFrameBatchProducer(
+		void *batchCtx) = 0;
+
+	virtual int getVideoFrameBatchSettings(
+		void *batchCtx,
+		struct pdraw_video_frame_batch_settings *settings) = 0;
+
+	/**
+	 * Video frame producer: frame ring settings
+	 *
+	 * Frames waiting to be fetched are kept in a ring of up to depth
+	 * frames (1 to PDRAW_VIDEO_FRAME_PRODUCER_MAX_DEPTH); the policy
+	 * selects what happens when the ring is full. Frames are returned
+	 * oldest first. Default is latest-only.
+	 */
+	virtual int getProducerRingSettings(
+		void *producerCtx,
+		enum pdraw_video_frame_producer_policy *policy,
+		unsigned int *depth) = 0;
+
+	virtual int setProducerRingSettings(
+		void *producerCtx,
+		enum pdraw_video_frame_producer_policy policy,
+		unsigned int depth) = 0;
+
+	virtual int getProducerStats(
+		void *producerCtx,
+		struct pdraw_video_frame_producer_stats *stats) = 0;
+
+	/**
+	 * Video frame filter or producer: processing time statistics
+	 */
+	virtual int getVideoFrameFilterStats(
+		void *filterCtx,
+		struct pdraw_video_frame_filter_stats *stats) = 0;
+
+	/**
+	 * Video frame filter or producer: output color format, frames
+	 * are converted from the decoder format (producers must be in
+	 * copy mode); PDRAW_COLOR_FORMAT_UNKNOWN keeps the decoder format
+	 */
+	virtual int getVideoFrameFilterOutputFormat(
+		void *filterCtx,
+		enum pdraw_color_format *format) = 0;
+
+	virtual int setVideoFrameFilterOutputFormat(
+		void *filterCtx,
+		enum pdraw_color_format format) = 0;
+
+	/**
+	 * Video frame filter or producer: crop region and output scales
+	 * computed from the decoded frame (producers must be in copy
+	 * mode); a NULL scaling disables it
+	 */
+	virtual int getVideoFrameFilterScaling(
+		void *filterCtx,
+		struct pdraw_video_frame_filter_scaling *scaling) = 0;
+
+	virtual int setVideoFrameFilterScaling(
+		void *filterCtx,
+		const struct pdraw_video_frame_filter_scaling *scaling) = 0;
+
+	virtual int getVideoDecoderStats(
+		unsigned int mediaId,
+		struct pdraw_video_decoder_stats *stats) = 0;
+
+	virtual int getVideoDecoderOutputStats(
+		unsigned int mediaId,
+		struct pdraw_video_decoder_output_stats *stats) = 0;
+
+	/**
+	 * Frame pacing statistics of a media displayed by the video
+	 * renderer (GL renderers only)
+	 */
+	virtual int getVideoRendererStats(
+		unsigned int mediaId,
+		struct pdraw_video_renderer_stats *stats) = 0;
+
 	virtual float getControllerRadarAngleSetting(
 		void) = 0;
 	virtual void setControllerRadarAngleSetting(
@@ -373,6 +628,78 @@ public:
 		float panH,
 		float panV) = 0;
 
+	/**
+	 * Decoder frame drop settings
+	 *
+	 * policy: frame drop policy applied when the decoder falls behind
+	 * maxBacklog: maximum decoder backlog in microseconds (time between
+	 * the decoder input and output of a frame) before frames are dropped
+	 */
+	virtual void getDecoderDropSettings(
+		enum pdraw_decoder_drop_policy *policy,
+		unsigned int *maxBacklog) = 0;
+	virtual void setDecoderDropSettings(
+		enum pdraw_decoder_drop_policy policy,
+		unsigned int maxBacklog) = 0;
+
+	/**
+	 * Warm pool setting
+	 *
+	 * When enabled, the decoders of a closed session are kept and
+	 * reused by the next open on the same instance instead of being
+	 * destroyed and created again
+	 */
+	virtual bool getWarmPoolSetting(
+		void) = 0;
+	virtual void setWarmPoolSetting(
+		bool enable) = 0;
+
+	/**
+	 * Decoder output settings
+	 *
+	 * sinkMaxFrames: maximum number of decoded frames a consumer
+	 * (renderer or video frame filter) can hold before new frames are
+	 * dropped for this consumer (0: unlimited)
+	 * leakTimeout: time in microseconds after which a frame held by a
+	 * consumer is reported as a possible leak (0: disabled)
+	 */
+	virtual void getDecoderOutputSettings(
+		unsigned int *sinkMaxFrames,
+		unsigned int *leakTimeout) = 0;
+	virtual void setDecoderOutputSettings(
+		unsigned int sinkMaxFrames,
+		unsigned int leakTimeout) = 0;
+
+	/**
+	 * Video renderer layout setting
+	 *
+	 * Arrangement of the video medias of the session when the
+	 * renderer displays more than one; applied on the next render
+	 */
+	virtual enum pdraw_video_renderer_layout getVideoRendererLayoutSetting(
+		void) = 0;
+	virtual void setVideoRendererLayoutSetting(
+		enum pdraw_video_renderer_layout layout) = 0;
+
+	/**
+	 * HMD resolution settings
+	 *
+	 * With HMD distortion correction, the eye buffer resolution is
+	 * scaled dynamically to keep the render time within the target.
+	 * minScale, maxScale: bounds of the scale applied to both
+	 * dimensions of the eye buffer (0..1]
+	 * targetFrameTime: render time target in microseconds
+	 * (0: display refresh period)
+	 */
+	virtual int getHmdResolutionSettings(
+		float *minScale,
+		float *maxScale,
+		unsigned int *targetFrameTime) = 0;
+	virtual int setHmdResolutionSettings(
+		float minScale,
+		float maxScale,
+		unsigned int targetFrameTime) = 0;
+
 	virtual void setJniEnv(
 		void *jniEnv) = 0;
 };
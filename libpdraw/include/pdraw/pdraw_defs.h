@@ -75,6 +75,75 @@ enum pdraw_color_format {
 	PDRAW_COLOR_FORMAT_UNKNOWN = 0,
 	PDRAW_COLOR_FORMAT_YUV420PLANAR,
 	PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR,
+	/* Packed 8-bit R, G, B */
+	PDRAW_COLOR_FORMAT_RGB24,
+	/* Packed 8-bit B, G, R, A (opaque alpha) */
+	PDRAW_COLOR_FORMAT_BGRA,
+	/* 8-bit luminance only */
+	PDRAW_COLOR_FORMAT_GRAY8,
+	/* Packed 8-bit R, G, B, A (opaque alpha) */
+	PDRAW_COLOR_FORMAT_RGBA,
+};
+
+
+enum pdraw_decoder_drop_policy {
+	/* Decode every frame */
+	PDRAW_DECODER_DROP_POLICY_NONE = 0,
+	/* Drop non-reference frames when the decoder falls behind */
+	PDRAW_DECODER_DROP_POLICY_NON_REF,
+	/* Drop non-reference frames first, then skip to the next IDR frame
+	 * when the decoder is still behind or a reference frame is corrupted */
+	PDRAW_DECODER_DROP_POLICY_SKIP_TO_IDR,
+};
+
+
+enum pdraw_video_renderer_layout {
+	/* Medias in a grid of equal tiles, in media order from the top left */
+	PDRAW_VIDEO_RENDERER_LAYOUT_GRID = 0,
+	/* First media fullscreen, the others as thumbnails from the bottom
+	 * right corner */
+	PDRAW_VIDEO_RENDERER_LAYOUT_PIP,
+};
+
+
+enum pdraw_video_frame_producer_policy {
+	/* Keep only the latest frame (the depth is ignored) */
+	PDRAW_VIDEO_FRAME_PRODUCER_POLICY_LATEST_ONLY = 0,
+	/* Queue up to depth frames, drop the oldest one when full */
+	PDRAW_VIDEO_FRAME_PRODUCER_POLICY_DROP_OLDEST,
+	/* Queue up to depth frames, block the producer when full */
+	PDRAW_VIDEO_FRAME_PRODUCER_POLICY_BLOCK,
+};
+
+
+#define PDRAW_VIDEO_FRAME_PRODUCER_MAX_DEPTH (32)
+
+
+enum pdraw_scaling_method {
+	/* Area average, best for large downscaling ratios */
+	PDRAW_SCALING_METHOD_BOX = 0,
+	/* Bilinear interpolation */
+	PDRAW_SCALING_METHOD_BILINEAR,
+};
+
+
+#define PDRAW_VIDEO_FRAME_MAX_SCALES (4)
+
+
+struct pdraw_video_frame_filter_scaling {
+	/* Crop region in decoded frame pixels, applied before scaling
+	 * (offsets are rounded down to even values); a null width or
+	 * height means the full frame */
+	unsigned int cropX;
+	unsigned int cropY;
+	unsigned int cropWidth;
+	unsigned int cropHeight;
+	enum pdraw_scaling_method method;
+	/* Output sizes; the first one is the frame itself, all of them
+	 * are in pdraw_video_frame.scale[]; 0: crop only */
+	unsigned int scaleCount;
+	unsigned int scaleWidth[PDRAW_VIDEO_FRAME_MAX_SCALES];
+	unsigned int scaleHeight[PDRAW_VIDEO_FRAME_MAX_SCALES];
 };
 
 
@@ -114,6 +183,14 @@ struct pdraw_media_info {
 };
 
 
+struct pdraw_video_frame_scale {
+	const uint8_t *plane[3];
+	unsigned int stride[3];
+	unsigned int width;
+	unsigned int height;
+};
+
+
 struct pdraw_video_frame {
 	enum pdraw_color_format colorFormat;
 	const uint8_t *plane[3];
@@ -132,6 +209,161 @@ struct pdraw_video_frame {
 	struct vmeta_frame_v2 metadata;
 	const uint8_t *userData;
 	unsigned int userDataSize;
+	/* Cropped and scaled outputs when enabled on the filter, in the
+	 * frame color format; scale[0] is the same as the frame planes */
+	unsigned int scaleCount;
+	struct pdraw_video_frame_scale scale[PDRAW_VIDEO_FRAME_MAX_SCALES];
+	/* 1 on the first frame delivered after a change of the decoded
+	 * frame dimensions or color format */
+	int formatChanged;
+	/* Frame number in the producer or filter, incremented for each
+	 * frame output by the decoder to it; a gap means dropped frames */
+	uint64_t sequenceNumber;
+};
+
+
+struct pdraw_video_decoder_stats {
+	/* Frames received from the demuxer */
+	uint64_t inputFrameCount;
+	/* Frames output by the decoder */
+	uint64_t outputFrameCount;
+	/* Non-reference frames dropped because of the decoder backlog */
+	uint64_t droppedNonRefFrameCount;
+	/* Frames dropped while waiting for the next IDR frame */
+	uint64_t droppedSkipToIdrFrameCount;
+	/* Skip to next IDR decisions because of the decoder backlog */
+	uint64_t skipToIdrBacklogCount;
+	/* Skip to next IDR decisions because of a corrupted reference frame */
+	uint64_t skipToIdrErrorCount;
+	/* Skip to next IDR aborted because no IDR frame was received in time */
+	uint64_t skipToIdrTimeoutCount;
+	/* Decoder backlog in us: output time - input time of the last
+	 * output frame, or age of the oldest frame still in the decoder
+	 * when a frame is received (0 if the decoder is empty) */
+	uint64_t backlog;
+	/* Maximum measured decoder backlog in us */
+	uint64_t maxBacklog;
+	/* Decoder reconfigurations on SPS/PPS change */
+	uint64_t reconfigureCount;
+	/* Duration of the last reconfiguration in us */
+	uint64_t reconfigureTime;
+	/* Maximum duration of a reconfiguration in us */
+	uint64_t maxReconfigureTime;
+	/* Time between the session open and the first output frame in us */
+	uint64_t timeToFirstFrame;
+	/* 1 if the decoder was reused from the warm pool, 0 otherwise */
+	uint64_t warmStart;
+};
+
+
+#define PDRAW_VIDEO_DECODER_MAX_SINKS (8)
+
+
+struct pdraw_video_decoder_sink_stats {
+	/* Frames pushed to the sink */
+	uint64_t pushedFrameCount;
+	/* Frames released by the sink */
+	uint64_t releasedFrameCount;
+	/* Frames not pushed because the sink already held too many frames */
+	uint64_t droppedFrameCount;
+	/* Frames currently held by the sink (queued or in use) */
+	uint64_t heldFrameCount;
+	/* Maximum number of frames held at the same time */
+	uint64_t maxHeldFrameCount;
+	/* Mean time between the decoder output and the release in us */
+	uint64_t meanHoldTime;
+	/* Maximum time between the decoder output and the release in us */
+	uint64_t maxHoldTime;
+	/* Frames held longer than the leak timeout */
+	uint64_t leakCount;
+};
+
+
+struct pdraw_video_decoder_output_stats {
+	/* Maximum number of frames held per sink (0: unlimited) */
+	unsigned int sinkMaxFrames;
+	/* Frames currently held by all sinks */
+	unsigned int heldFrameCount;
+	/* Number of valid entries in sink */
+	unsigned int sinkCount;
+	/* Per sink statistics, in the order the sinks were added
+	 * (the renderer, if any, then the video frame filters) */
+	struct pdraw_video_decoder_sink_stats sink[
+		PDRAW_VIDEO_DECODER_MAX_SINKS];
+};
+
+
+struct pdraw_video_frame_producer_stats {
+	/* Frames received from the decoder */
+	uint64_t receivedFrameCount;
+	/* Frames returned to the application */
+	uint64_t deliveredFrameCount;
+	/* Frames dropped because the ring was full */
+	uint64_t droppedFrameCount;
+	/* Frames currently waiting in the ring */
+	uint64_t pendingFrameCount;
+	/* Maximum number of frames waiting in the ring at the same time */
+	uint64_t maxPendingFrameCount;
+	/* Time the producer was blocked on a full ring in us */
+	uint64_t blockedTime;
+};
+
+
+#define PDRAW_VIDEO_FRAME_FILTER_HISTOGRAM_BUCKETS (16)
+
+
+struct pdraw_video_frame_filter_stats {
+	/* Frames processed by the filter */
+	uint64_t processedFrameCount;
+	/* Mean frame processing time in us (the callback duration for
+	 * callback filters, the copy or queuing for producers) */
+	uint64_t meanProcessTime;
+	/* Maximum frame processing time in us */
+	uint64_t maxProcessTime;
+	/* Processing time histogram: bucket 0 counts times under 1us,
+	 * bucket i counts times in [2^(i-1), 2^i) us and the last bucket
+	 * counts all longer times */
+	uint64_t processTimeHistogram[
+		PDRAW_VIDEO_FRAME_FILTER_HISTOGRAM_BUCKETS];
+	/* Changes of the decoded frame dimensions or color format */
+	uint64_t formatChangeCount;
+	/* Frame buffers allocated (buffer pool misses) */
+	uint64_t bufferAllocCount;
+};
+
+
+struct pdraw_video_renderer_stats {
+	/* Frames received from the decoder */
+	uint64_t receivedFrameCount;
+	/* Frames displayed */
+	uint64_t displayedFrameCount;
+	/* Frames replaced by a more recent frame before being displayed */
+	uint64_t droppedFrameCount;
+	/* Frames displayed after their presentation time */
+	uint64_t lateFrameCount;
+	/* Renders where the next frame was held because it was early */
+	uint64_t heldFrameCount;
+	/* Mean difference in us between the display interval and the
+	 * presentation interval of consecutive displayed frames */
+	uint64_t meanJudder;
+	/* Maximum difference in us between the display interval and the
+	 * presentation interval of consecutive displayed frames */
+	uint64_t maxJudder;
+	/* Delay in us added to the frame timestamps to absorb the
+	 * network and decoding jitter */
+	uint64_t playoutDelay;
+	/* Display refresh period in us estimated from the render
+	 * timestamps (0: unknown, the late frames and the judder are then
+	 * not measured) */
+	uint64_t displayPeriod;
+	/* Mean time in us spent rendering a frame, on the GPU when
+	 * GL_EXT_disjoint_timer_query is available, otherwise on the CPU
+	 * excluding the frame dequeuing and the readback */
+	uint64_t renderTime;
+	/* Scale applied to both dimensions of the HMD eye buffer to
+	 * keep the render time within the target (1.0 without HMD
+	 * distortion correction) */
+	float hmdResolutionScale;
 };
 
 
@@ -141,4 +373,99 @@ typedef void (*pdraw_video_frame_filter_callback_t)(
 	void *userPtr);
 
 
+enum pdraw_video_frame_metadata_source {
+	/* Frames output by the decoder (decoded frames only) */
+	PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER = 0,
+	/* Access units output by the demuxer, before decoding */
+	PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER,
+};
+
+
+struct pdraw_video_frame_metadata {
+	int isComplete;
+	int hasErrors;
+	int isRef;
+	int isIdr;
+	/* Frame dimensions (decoder source only, 0 otherwise) */
+	unsigned int width;
+	unsigned int height;
+	uint64_t auNtpTimestamp;
+	uint64_t auNtpTimestampRaw;
+	uint64_t auNtpTimestampLocal;
+	uint64_t demuxOutputTimestamp;
+	/* Decoder output time (decoder source only, 0 otherwise) */
+	uint64_t decoderOutputTimestamp;
+	int hasMetadata;
+	struct vmeta_frame_v2 metadata;
+	/* Frame sequence number for the subscription */
+	uint64_t sequenceNumber;
+};
+
+
+typedef void (*pdraw_video_frame_metadata_callback_t)(
+	void *metadataCtx,
+	const struct pdraw_video_frame_metadata *meta,
+	void *userPtr);
+
+
+#define PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE (64)
+
+
+enum pdraw_video_frame_batch_layout {
+	/* Frame copies only */
+	PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES = 0,
+	/* Contiguous uint8 tensor, batch x height x width x channels */
+	PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NHWC,
+	/* Contiguous uint8 tensor, batch x channels x height x width */
+	PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NCHW,
+};
+
+
+struct pdraw_video_frame_batch_settings {
+	/* Frames per batch (1 to PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE) */
+	unsigned int batchSize;
+	/* Maximum time to wait for a full batch after its first frame
+	 * in us; a partial batch is delivered when it expires
+	 * (0: always wait for a full batch) */
+	unsigned int maxWaitTime;
+	enum pdraw_video_frame_batch_layout layout;
+};
+
+
+struct pdraw_video_frame_batch {
+	/* Number of frames in the batch (up to the batch size) */
+	unsigned int frameCount;
+	/* Frames of the batch; with a tensor layout, the frame planes
+	 * are NULL and the pixels are in the tensor */
+	const struct pdraw_video_frame *frames;
+	/* Tensor layout only: frameCount tensor entries of
+	 * channels x height x width bytes */
+	enum pdraw_video_frame_batch_layout layout;
+	const uint8_t *tensor;
+	size_t tensorSize;
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+	/* Frames dropped since the batch producer creation because no
+	 * batch storage was available */
+	uint64_t droppedFrameCount;
+	/* Batch sequence number */
+	uint64_t sequenceNumber;
+};
+
+
+typedef void (*pdraw_video_frame_batch_callback_t)(
+	void *batchCtx,
+	const struct pdraw_video_frame_batch *batch,
+	void *userPtr);
+
+
+/* Frame rendered by the offscreen renderer, in RGBA or NV12
+ * (PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR); the planes are only valid
+ * during the callback */
+typedef void (*pdraw_offscreen_frame_callback_t)(
+	const struct pdraw_video_frame *frame,
+	void *userPtr);
+
+
 #endif /* !_PDRAW_DEFS_H_ */
@@ -0,0 +1,186 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Shared memory frame ring
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_SHM_H_
+#define _PDRAW_SHM_H_
+
+#ifdef __cplusplus
+extern "C"  {
+#endif /* __cplusplus */
+
+#include <inttypes.h>
+#include "pdraw_defs.h"
+
+
+/**
+ * Frames exported by a video frame export (see
+ * pdraw_add_video_frame_export()) are written to a ring of slots in
+ * a sealed memfd shared memory; readers map the same memory and
+ * access the frames in place.
+ *
+ * Each slot is protected by a sequence counter: it is odd while the
+ * writer updates the slot. A reader must check with
+ * pdraw_shm_reader_release_frame() that the slot was not overwritten
+ * while it was using the frame, otherwise the data must be discarded.
+ * The ring should have enough slots for the reader processing time.
+ */
+
+
+#define PDRAW_SHM_MAGIC (0x53524450) /* "PDRS" */
+#define PDRAW_SHM_VERSION (1)
+#define PDRAW_SHM_DEFAULT_SLOT_COUNT (4)
+#define PDRAW_SHM_MAX_SLOT_COUNT (16)
+#define PDRAW_SHM_ALIGN (64)
+
+
+struct pdraw_shm_frame {
+	uint32_t colorFormat;
+	/* Offsets from the slot data */
+	uint32_t planeOffset[3];
+	uint32_t stride[3];
+	uint32_t width;
+	uint32_t height;
+	uint32_t sarWidth;
+	uint32_t sarHeight;
+	uint32_t isComplete;
+	uint32_t hasErrors;
+	uint32_t isRef;
+	uint32_t hasMetadata;
+	uint32_t userDataOffset;
+	uint32_t userDataSize;
+	uint64_t sequenceNumber;
+	uint64_t auNtpTimestamp;
+	uint64_t auNtpTimestampRaw;
+	uint64_t auNtpTimestampLocal;
+	struct vmeta_frame_v2 metadata;
+};
+
+
+struct pdraw_shm_slot {
+	/* Sequence counter, odd while the slot is written */
+	uint64_t seq;
+	/* Publish index of the frame in the slot */
+	uint64_t index;
+	struct pdraw_shm_frame frame;
+};
+
+
+struct pdraw_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	/* sizeof(struct pdraw_shm_frame), checks the ABI */
+	uint32_t frameStructSize;
+	uint32_t slotCount;
+	/* Offset of the first slot in the shared memory */
+	uint64_t slotOffset;
+	/* Size of a slot including its header */
+	uint64_t slotSize;
+	/* Offset and size of the frame data in a slot */
+	uint64_t slotDataOffset;
+	uint64_t slotDataSize;
+	/* Published frames count; the last frame is in slot
+	 * (publishCount - 1) % slotCount */
+	uint64_t publishCount;
+	/* Futex word, incremented on each publish */
+	uint32_t futex;
+	/* Set when the writer stops exporting */
+	uint32_t writerClosed;
+};
+
+
+/* Reference on a frame being read */
+struct pdraw_shm_frame_ref {
+	uint32_t slot;
+	uint64_t seq;
+};
+
+
+/* Reader, see pdraw_shm_reader_new() */
+struct pdraw_shm_reader;
+
+
+/**
+ * Receive the shared memory fd sent by the writer with
+ * pdraw_send_video_frame_export_fd() on a Unix socket
+ */
+int pdraw_shm_reader_recv_fd(
+	int sock,
+	int *fd);
+
+
+/* Map the ring; the reader takes ownership of the fd */
+int pdraw_shm_reader_new(
+	int fd,
+	struct pdraw_shm_reader **ret_obj);
+
+
+int pdraw_shm_reader_destroy(
+	struct pdraw_shm_reader *reader);
+
+
+/**
+ * Wait for a frame newer than the last one returned
+ *
+ * timeout : time in microseconds to wait for a frame (monotonic)
+ *  0: don't wait
+ * -1: wait forever
+ * >0: wait time
+ *
+ * Returns -ETIMEDOUT on timeout, -EPIPE when the writer is closed
+ */
+int pdraw_shm_reader_wait(
+	struct pdraw_shm_reader *reader,
+	int timeout);
+
+
+/**
+ * Get the last published frame; the frame planes and user data point
+ * to the shared memory and stay mapped until the reader is destroyed
+ */
+int pdraw_shm_reader_get_frame(
+	struct pdraw_shm_reader *reader,
+	struct pdraw_video_frame *frame,
+	struct pdraw_shm_frame_ref *ref);
+
+
+/**
+ * End the access to a frame; returns -EAGAIN if the slot has been
+ * overwritten meanwhile, in which case any result computed from the
+ * frame must be discarded
+ */
+int pdraw_shm_reader_release_frame(
+	struct pdraw_shm_reader *reader,
+	const struct pdraw_shm_frame_ref *ref);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* !_PDRAW_SHM_H_ */
@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+#
+# Frame rate reachable from Python with the producer frame access modes
+#
+# usage: bench.py <url> [duration_s] [copy]
+#
+# Each mode runs for the given duration and touches the luma plane of every
+# frame: 'view' uses zero-copy numpy views held by a frame reference,
+# 'numpy copy' copies the luma plane into a new array. A Python thread
+# counts loop iterations meanwhile to show that the GIL is released while
+# waiting for frames.
+
+from __future__ import print_function
+
+import numpy as np
+import os
+import sys
+import threading
+import time
+
+# import pdraw_python with right path
+try:
+    l = os.environ['LD_LIBRARY_PATH']
+    path = l.split(":")[1] + "/python"
+    sys.path.insert(0, path)
+    import libpdraw_python as pdraw
+except:
+    print("launch me with native_wrapper please")
+    sys.exit(-1)
+
+
+class Spinner(threading.Thread):
+    def __init__(self):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.count = 0
+        self.running = True
+
+    def run(self):
+        while self.running:
+            self.count += 1
+
+
+def run(mypdraw, prod, duration, mode):
+    spinner = Spinner()
+    spinner.start()
+    n = 0
+    acc = 0
+    start = time.time()
+    while time.time() - start < duration:
+        if mode == "view":
+            ref = mypdraw.getProducerLastFrameRef(prod, 100000)
+            if ref is None:
+                continue
+            y = ref.plane(0)
+            acc += int(y[::16, ::16].sum())
+            del y
+            ref.release()
+        else:
+            frame = mypdraw.getProducerLastFrame(prod, 100000)
+            if frame is None:
+                continue
+            y = np.array(frame.plane(0))
+            acc += int(y[::16, ::16].sum())
+        n += 1
+    elapsed = time.time() - start
+    spinner.running = False
+    spinner.join()
+    print("%-10s: %6.1f frames/s, python thread: %.2fM iterations/s" %
+          (mode, n / elapsed, spinner.count / elapsed / 1e6))
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: %s <url> [duration_s] [copy]" % sys.argv[0])
+        sys.exit(-1)
+    url = sys.argv[1]
+    duration = float(sys.argv[2]) if len(sys.argv) > 2 else 10.
+    copy = len(sys.argv) > 3 and sys.argv[3] == "copy"
+
+    mypdraw = pdraw.createPdraw()
+    mypdraw.setSelfSerialNumber("00000000")
+    mypdraw.open(url)
+
+    prod = mypdraw.addVideoFrameProducer(0, False, copy)
+    mypdraw.play()
+
+    for mode in ("view", "numpy copy"):
+        run(mypdraw, prod, duration, mode)
+
+    mypdraw.close()
+    mypdraw.removeVideoFrameProducer(prod)
+
+
+if __name__ == "__main__":
+    main()
@@ -31,6 +31,8 @@
 %{
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
+#include <errno.h>
+#include <map>
 %}
 
 %init %{
@@ -39,23 +41,207 @@ import_array();
 
 %inline {
 
-/* conversion to numpy array */
+/* conversion to numpy array; the array keeps a reference on base (if not
+ * NULL) so that the plane data outlives the array */
 
-PyObject* plane2numpyArray(const uint8_t* plane, int w, int h)
+PyObject* plane2numpyArray(const uint8_t* plane, int w, int h, int c,
+    int stride, PyObject *base)
 {
-    int type = NPY_UINT8;
-    npy_intp dim[3] = { h, w, 1 };
-    PyObject *ret = PyArray_SimpleNewFromData(3, dim, type, (void*)plane);
+    npy_intp dim[3] = { h, w, c };
+    npy_intp strides[3] = { stride, c, 1 };
+    int flags = NPY_ARRAY_ALIGNED;
+    if (base == NULL)
+        flags |= NPY_ARRAY_WRITEABLE;
+    PyObject *ret = PyArray_New(&PyArray_Type, 3, dim, NPY_UINT8, strides,
+        (void*)plane, 0, flags, NULL);
+    if ((ret != NULL) && (base != NULL)) {
+        Py_INCREF(base);
+        if (PyArray_SetBaseObject((PyArrayObject*)ret, base) < 0) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+    }
     return ret;
 }
 
 }
 
+%{
+/* plane dimensions in pixels and channels; returns false if there is no
+ * such plane */
+static bool planeGeometry(const pdraw_video_frame *frame, size_t i,
+    int *w, int *h, int *c)
+{
+    size_t planeNb = 1;
+    *w = frame->width;
+    *h = frame->height;
+    *c = 1;
+    switch (frame->colorFormat) {
+    case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+        planeNb = 3;
+        break;
+    case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+        planeNb = 2;
+        if (i > 0)
+            *c = 2;
+        break;
+    case PDRAW_COLOR_FORMAT_RGB24:
+        *c = 3;
+        break;
+    case PDRAW_COLOR_FORMAT_BGRA:
+    case PDRAW_COLOR_FORMAT_RGBA:
+        *c = 4;
+        break;
+    default:
+        break;
+    }
+    if ((i >= planeNb) || (frame->plane[i] == NULL))
+        return false;
+    if (i > 0) {
+        *w = (*w + 1) / 2;
+        *h = (*h + 1) / 2;
+    }
+    return true;
+}
+
+/*
+ * Frame reference: the frame stays valid until the reference and all the
+ * plane arrays obtained from it are released; the reference also keeps
+ * the Python pdraw object and the producer alive
+ */
+struct VideoFrameRefHolder {
+    Pdraw::IPdraw *pdraw;
+    PyObject *owner;
+    void *producerCtx;
+    void *frameRef;
+};
+
+/* Producers with frame references alive; a producer removed meanwhile
+ * is only removed on the last release (only accessed with the GIL) */
+struct VideoFrameProducerRefs {
+    unsigned int count;
+    bool removePending;
+};
+
+static std::map<void *, VideoFrameProducerRefs> producerRefs;
+
+static void producerRefTake(void *producerCtx)
+{
+    VideoFrameProducerRefs &refs = producerRefs[producerCtx];
+    refs.count++;
+}
+
+static void producerRefRelease(Pdraw::IPdraw *pdraw, void *producerCtx)
+{
+    std::map<void *, VideoFrameProducerRefs>::iterator p =
+        producerRefs.find(producerCtx);
+    if (p == producerRefs.end())
+        return;
+    if (--p->second.count > 0)
+        return;
+    bool removePending = p->second.removePending;
+    producerRefs.erase(p);
+    if (removePending)
+        pdraw->removeVideoFrameProducer(producerCtx);
+}
+
+static void videoFrameRefRelease(PyObject *capsule)
+{
+    VideoFrameRefHolder *holder = (VideoFrameRefHolder *)
+        PyCapsule_GetPointer(capsule, "pdraw_video_frame_ref");
+    if (holder == NULL)
+        return;
+    holder->pdraw->releaseProducerFrame(holder->producerCtx, holder->frameRef);
+    producerRefRelease(holder->pdraw, holder->producerCtx);
+    /* last, as it may delete the pdraw instance */
+    Py_XDECREF(holder->owner);
+    delete holder;
+}
+%}
+
+%ignore VideoFrameRef::VideoFrameRef;
+
+%inline {
+
+class VideoFrameRef {
+public:
+    VideoFrameRef(Pdraw::IPdraw *pdraw, void *producerCtx, void *frameRef,
+        const pdraw_video_frame *frame)
+    {
+        VideoFrameRefHolder *holder = new VideoFrameRefHolder;
+        holder->pdraw = pdraw;
+        holder->owner = NULL;
+        holder->producerCtx = producerCtx;
+        holder->frameRef = frameRef;
+        this->frame = *frame;
+        producerRefTake(producerCtx);
+        mCapsule = PyCapsule_New(holder, "pdraw_video_frame_ref",
+            &videoFrameRefRelease);
+        if (mCapsule == NULL) {
+            pdraw->releaseProducerFrame(producerCtx, frameRef);
+            producerRefRelease(pdraw, producerCtx);
+            delete holder;
+        }
+    }
+
+    ~VideoFrameRef()
+    {
+        Py_XDECREF(mCapsule);
+    }
+
+    /* read-only numpy view on a plane, no copy */
+    PyObject* plane(size_t i)
+    {
+        int w, h, c;
+        if ((mCapsule == NULL) || (!planeGeometry(&frame, i, &w, &h, &c)))
+            Py_RETURN_NONE;
+        return plane2numpyArray(frame.plane[i], w, h, c, frame.stride[i],
+            mCapsule);
+    }
+
+    /* keep the Python pdraw object alive with the frame */
+    void _setOwner(PyObject *owner)
+    {
+        VideoFrameRefHolder *holder = (mCapsule != NULL) ?
+            (VideoFrameRefHolder *)PyCapsule_GetPointer(
+            mCapsule, "pdraw_video_frame_ref") : NULL;
+        if ((holder == NULL) || (holder->owner != NULL))
+            return;
+        Py_INCREF(owner);
+        holder->owner = owner;
+    }
+
+    /* drop this object's reference; existing plane arrays stay valid */
+    void release()
+    {
+        Py_CLEAR(mCapsule);
+    }
+
+    pdraw_video_frame frame;
+
+private:
+    PyObject *mCapsule;
+};
+
+}
+
 %newobject pdraw_video_frame;
 %newobject pdraw_media_info;
+%newobject Pdraw::IPdraw::getProducerLastFrameRef;
 
 %typemap(newfree) pdraw_video_frame * { delete $1; }
 %typemap(newfree) pdraw_media_info * { delete $1; }
+%typemap(newfree) VideoFrameRef * { delete $1; }
+
+/* replaced by the extensions below */
+%ignore Pdraw::IPdraw::getProducerLastFrameRef(void *,
+    struct pdraw_video_frame *, void **, int);
+%ignore Pdraw::IPdraw::removeVideoFrameProducer(void *);
+
+%pythonappend Pdraw::IPdraw::getProducerLastFrameRef %{
+    if val is not None:
+        val._setOwner(self)
+%}
 
 %extend Pdraw::IPdraw {
     /*
@@ -89,26 +275,69 @@ PyObject* plane2numpyArray(const uint8_t* plane, int w, int h)
         return self->open(url_);
     }
 
+    /* the frame planes are valid until the next call */
     pdraw_video_frame* getProducerLastFrame(void *producerCtx, int timeout = 0)
     {
         pdraw_video_frame* frame = new pdraw_video_frame();
-        int ret = self->getProducerLastFrame(producerCtx, frame, timeout);
+        int ret;
+
+        /* other Python threads run while waiting for a frame */
+        Py_BEGIN_ALLOW_THREADS
+        ret = self->getProducerLastFrame(producerCtx, frame, timeout);
+        Py_END_ALLOW_THREADS
 
         if (ret) {
             delete frame;
-            return nullptr;
+            return NULL;
         } else {
             return frame;
         }
     }
 
+    /* the frame planes are valid until the returned reference and its
+     * plane arrays are released */
+    VideoFrameRef* getProducerLastFrameRef(void *producerCtx, int timeout = 0)
+    {
+        pdraw_video_frame frame;
+        void *frameRef = NULL;
+        int ret;
+
+        std::map<void *, VideoFrameProducerRefs>::iterator p =
+            producerRefs.find(producerCtx);
+        if ((p != producerRefs.end()) && (p->second.removePending))
+            return NULL;
+
+        Py_BEGIN_ALLOW_THREADS
+        ret = self->getProducerLastFrameRef(
+            producerCtx, &frame, &frameRef, timeout);
+        Py_END_ALLOW_THREADS
+
+        if (ret)
+            return NULL;
+        return new VideoFrameRef(self, producerCtx, frameRef, &frame);
+    }
+
+    /* the producer is removed once its frame references are released */
+    int removeVideoFrameProducer(void *producerCtx)
+    {
+        std::map<void *, VideoFrameProducerRefs>::iterator p =
+            producerRefs.find(producerCtx);
+        if (p != producerRefs.end()) {
+            if (p->second.removePending)
+                return -ENOENT;
+            p->second.removePending = true;
+            return 0;
+        }
+        return self->removeVideoFrameProducer(producerCtx);
+    }
+
     pdraw_media_info* getMediaInfo(unsigned int index)
     {
         pdraw_media_info* info = new pdraw_media_info();
         int ret = self->getMediaInfo(index, info);
         if (ret) {
             delete info;
-            return nullptr;
+            return NULL;
         } else {
             return info;
         }
@@ -116,18 +345,13 @@ PyObject* plane2numpyArray(const uint8_t* plane, int w, int h)
 }
 
 %extend pdraw_video_frame {
-    /* replace plane list with plane() method */
+    /* replace plane list with plane() method (numpy view, no copy) */
     PyObject* plane(size_t i) {
-        int planeNb = self->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR ? 3 : 2;
-        if ((int)i >= planeNb)
-            return Py_None;
-
-        int w = self->width, h = self->height;
-        if (planeNb == 3 && i > 0) {
-            w /= 2;
-            h /= 2;
-        }
+        int w, h, c;
+        if (!planeGeometry(self, i, &w, &h, &c))
+            Py_RETURN_NONE;
 
-        return plane2numpyArray(self->plane[i], w, h);
+        return plane2numpyArray(self->plane[i], w, h, c, self->stride[i],
+            NULL);
     }
 }
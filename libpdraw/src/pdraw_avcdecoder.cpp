@@ -28,12 +28,15 @@
  */
 
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_session.hpp"
+#include "pdraw_media_video.hpp"
 #include <unistd.h>
 #include <time.h>
 #define ULOG_TAG pdraw_decavc
 #include <ulog.h>
 ULOG_DECLARE_TAG(pdraw_decavc);
 #include <video-buffers/vbuf_generic.h>
+#include <utility>
 #include <vector>
 
 namespace Pdraw {
@@ -43,17 +46,48 @@ AvcDecoder::AvcDecoder(
 	VideoMedia *media)
 {
 	int ret;
-	struct vdec_config cfg;
-	struct vdec_cbs cbs;
 	uint32_t supported_input_format;
 
 	mConfigured = false;
 	mMedia = (Media*)media;
 	mInputBufferPool = NULL;
 	mInputBufferPoolAllocated = false;
+	mInputBufferPoolSize = 0;
 	mInputBufferQueue = NULL;
 	mVdec = NULL;
+	mVdecCtx = NULL;
 	mFrameIndex = 0;
+	mSkipToIdr = false;
+	mSkipToIdrStartTime = 0;
+	memset(&mStats, 0, sizeof(mStats));
+	mSps = NULL;
+	mSpsSize = 0;
+	mPps = NULL;
+	mPpsSize = 0;
+	mWidth = 0;
+	mHeight = 0;
+	mPendingSps = NULL;
+	mPendingSpsSize = 0;
+	mPendingPps = NULL;
+	mPendingPpsSize = 0;
+	mReconfiguring = false;
+	mReconfigureStartTime = 0;
+	mReconfigureLoop = NULL;
+	mPendingInputLost = false;
+	mFirstFrameOutput = false;
+	mNotifyCount = 0;
+
+	ret = pthread_mutex_init(&mMutex, NULL);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_mutex_init", ret);
+		goto error;
+	}
+
+	ret = pthread_cond_init(&mNotifyCond, NULL);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_cond_init", ret);
+		goto error;
+	}
 
 	supported_input_format = vdec_get_supported_input_format(
 		VDEC_DECODER_IMPLEM_AUTO);
@@ -66,6 +100,59 @@ AvcDecoder::AvcDecoder(
 		goto error;
 	}
 
+	/* The decoder instance is created on the first configuration,
+	 * where a parked instance with the same SPS can be reused */
+
+	return;
+
+error:
+	destroyVdec();
+}
+
+
+AvcDecoder::~AvcDecoder(
+	void)
+{
+	int ret;
+
+	if (mReconfigureLoop != NULL) {
+		ret = pomp_loop_idle_remove(mReconfigureLoop,
+			&reconfigureIdleCb, this);
+		if (ret < 0)
+			ULOG_ERRNO("pomp_loop_idle_remove", -ret);
+	}
+	clearPendingInput();
+
+	destroyVdec();
+
+	if ((mInputBufferPool != NULL) && (mInputBufferPoolAllocated)) {
+		ret = vbuf_pool_destroy(mInputBufferPool);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_pool_destroy:input", -ret);
+		mInputBufferPool = NULL;
+	}
+	mInputBufferPool = NULL;
+
+	/* The output queues are owned by the sinks */
+	mOutputSinks.clear();
+
+	free(mSps);
+	free(mPps);
+	free(mPendingSps);
+	free(mPendingPps);
+
+	pthread_cond_destroy(&mNotifyCond);
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+int AvcDecoder::createVdec(
+	void)
+{
+	int ret;
+	struct vdec_config cfg;
+	struct vdec_cbs cbs;
+
 	memset(&cfg, 0, sizeof(cfg));
 	cfg.implem = VDEC_DECODER_IMPLEM_AUTO;
 	cfg.encoding = VDEC_ENCODING_H264;
@@ -77,25 +164,26 @@ AvcDecoder::AvcDecoder(
 	cbs.frame_output = &frameOutputCb;
 	cbs.flush = &flushCb;
 	cbs.stop = &stopCb;
-	ret = vdec_new(&cfg, &cbs, this, &mVdec);
+	mVdecCtx = (struct avcdecoder_vdec_ctx *)calloc(1, sizeof(*mVdecCtx));
+	if (mVdecCtx == NULL) {
+		ULOG_ERRNO("calloc", ENOMEM);
+		return -ENOMEM;
+	}
+	mVdecCtx->decoder = this;
+	ret = vdec_new(&cfg, &cbs, mVdecCtx, &mVdec);
 	if (ret < 0) {
 		ULOG_ERRNO("vdec_new", -ret);
-		goto error;
-	}
-
-	return;
-
-error:
-	if (mVdec) {
-		ret = vdec_destroy(mVdec);
-		if (ret < 0)
-			ULOG_ERRNO("vdec_destroy", -ret);
 		mVdec = NULL;
+		free(mVdecCtx);
+		mVdecCtx = NULL;
+		return ret;
 	}
+
+	return 0;
 }
 
 
-AvcDecoder::~AvcDecoder(
+void AvcDecoder::destroyVdec(
 	void)
 {
 	int ret;
@@ -106,22 +194,62 @@ AvcDecoder::~AvcDecoder(
 			ULOG_ERRNO("vdec_destroy", -ret);
 		mVdec = NULL;
 		mInputBufferQueue = NULL;
+		if (!mInputBufferPoolAllocated)
+			mInputBufferPool = NULL;
+		clearDecodingInputTimes();
 	}
+	free(mVdecCtx);
+	mVdecCtx = NULL;
+}
 
-	if ((mInputBufferPool != NULL) && (mInputBufferPoolAllocated)) {
-		ret = vbuf_pool_destroy(mInputBufferPool);
-		if (ret < 0)
-			ULOG_ERRNO("vbuf_pool_destroy:input", -ret);
-		mInputBufferPool = NULL;
-	}
-	mInputBufferPool = NULL;
 
-	std::vector<struct vbuf_queue *>::iterator q =
-		mOutputBufferQueues.begin();
-	while (q != mOutputBufferQueues.end()) {
-		vbuf_queue_destroy(*q);
-		q++;
-	}
+/* Take over the instance of a parked decoder configured for the same
+ * SPS; the parked instance is flushed and idle, so its callbacks can
+ * be redirected to this decoder */
+bool AvcDecoder::adoptWarmVdec(
+	const uint8_t *pSps,
+	unsigned int spsSize)
+{
+	Session *session = (mMedia) ? mMedia->getSession() : NULL;
+	AvcDecoder *warm;
+
+	if (session == NULL)
+		return false;
+	warm = session->takeWarmDecoder(pSps, spsSize);
+	if (warm == NULL)
+		return false;
+
+	mVdec = warm->mVdec;
+	mVdecCtx = warm->mVdecCtx;
+	mVdecCtx->decoder = this;
+	mInputBufferPool = warm->mInputBufferPool;
+	mInputBufferPoolAllocated = warm->mInputBufferPoolAllocated;
+	mInputBufferPoolSize = warm->mInputBufferPoolSize;
+	mInputBufferQueue = warm->mInputBufferQueue;
+	mWidth = warm->mWidth;
+	mHeight = warm->mHeight;
+	free(mSps);
+	free(mPps);
+	mSps = warm->mSps;
+	mSpsSize = warm->mSpsSize;
+	mPps = warm->mPps;
+	mPpsSize = warm->mPpsSize;
+
+	warm->mVdec = NULL;
+	warm->mVdecCtx = NULL;
+	warm->mInputBufferPool = NULL;
+	warm->mInputBufferPoolAllocated = false;
+	warm->mInputBufferQueue = NULL;
+	warm->mSps = NULL;
+	warm->mPps = NULL;
+	delete warm;
+
+	pthread_mutex_lock(&mMutex);
+	mStats.warmStart = 1;
+	pthread_mutex_unlock(&mMutex);
+
+	ULOGI("reusing a warm decoder instance (%ux%u)", mWidth, mHeight);
+	return true;
 }
 
 
@@ -139,6 +267,133 @@ uint32_t AvcDecoder::getInputBitstreamFormatCaps(
 }
 
 
+int AvcDecoder::setSpsPps(
+	const uint8_t *pSps,
+	unsigned int spsSize,
+	const uint8_t *pPps,
+	unsigned int ppsSize,
+	unsigned int *width,
+	unsigned int *height)
+{
+	int ret;
+
+	ret = vdec_set_sps_pps(mVdec, pSps, spsSize, pPps, ppsSize,
+		mInputFormat);
+	if (ret < 0) {
+		ULOG_ERRNO("vdec_set_sps_pps", -ret);
+		return ret;
+	}
+
+	ret = vdec_get_video_dimensions(mVdec, width, height,
+		NULL, NULL, NULL, NULL, NULL, NULL);
+	if (ret < 0) {
+		ULOG_ERRNO("vdec_get_video_dimensions", -ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+
+int AvcDecoder::setupInputBufferPool(
+	unsigned int width,
+	unsigned int height)
+{
+	int ret;
+	struct vbuf_cbs cbs;
+	struct vbuf_pool *pool;
+	size_t size = width * height * 3 / 4;
+
+	mInputBufferQueue = vdec_get_input_buffer_queue(mVdec);
+
+	pool = vdec_get_input_buffer_pool(mVdec);
+	if (pool != NULL) {
+		if ((mInputBufferPool != NULL) && (mInputBufferPoolAllocated)) {
+			ret = vbuf_pool_destroy(mInputBufferPool);
+			if (ret < 0)
+				ULOG_ERRNO("vbuf_pool_destroy:input", -ret);
+		}
+		mInputBufferPool = pool;
+		mInputBufferPoolAllocated = false;
+		return 0;
+	}
+
+	/* Keep the current pool if its buffers are large enough */
+	if ((mInputBufferPool != NULL) && (mInputBufferPoolAllocated) &&
+		(mInputBufferPoolSize >= size))
+		return 0;
+
+	if ((mInputBufferPool != NULL) && (mInputBufferPoolAllocated)) {
+		ret = vbuf_pool_destroy(mInputBufferPool);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_pool_destroy:input", -ret);
+	}
+	mInputBufferPool = NULL;
+	mInputBufferPoolAllocated = false;
+	mInputBufferPoolSize = 0;
+
+	ret = vbuf_generic_get_cbs(&cbs);
+	if (ret < 0) {
+		ULOG_ERRNO("vbuf_generic_get_cbs", -ret);
+		return ret;
+	}
+
+	/* Input buffers pool allocation */
+	mInputBufferPool = vbuf_pool_new(
+		AVCDECODER_INPUT_BUFFER_COUNT,
+		size, 0,
+		&cbs); /* TODO: number of buffers and buffers size */
+	if (mInputBufferPool == NULL) {
+		ULOG_ERRNO("vbuf_pool_new:input", ENOMEM);
+		return -ENOMEM;
+	}
+	mInputBufferPoolAllocated = true;
+	mInputBufferPoolSize = size;
+
+	return 0;
+}
+
+
+int AvcDecoder::storeSpsPps(
+	const uint8_t *pSps,
+	unsigned int spsSize,
+	const uint8_t *pPps,
+	unsigned int ppsSize,
+	bool pending)
+{
+	uint8_t *sps, *pps;
+
+	sps = (uint8_t *)malloc(spsSize);
+	if (sps == NULL)
+		return -ENOMEM;
+	pps = (uint8_t *)malloc(ppsSize);
+	if (pps == NULL) {
+		free(sps);
+		return -ENOMEM;
+	}
+	memcpy(sps, pSps, spsSize);
+	memcpy(pps, pPps, ppsSize);
+
+	if (pending) {
+		free(mPendingSps);
+		free(mPendingPps);
+		mPendingSps = sps;
+		mPendingSpsSize = spsSize;
+		mPendingPps = pps;
+		mPendingPpsSize = ppsSize;
+	} else {
+		free(mSps);
+		free(mPps);
+		mSps = sps;
+		mSpsSize = spsSize;
+		mPps = pps;
+		mPpsSize = ppsSize;
+	}
+
+	return 0;
+}
+
+
 int AvcDecoder::open(
 	uint32_t inputBitstreamFormat,
 	const uint8_t *pSps,
@@ -147,8 +402,8 @@ int AvcDecoder::open(
 	unsigned int ppsSize)
 {
 	int ret;
-	struct vbuf_cbs cbs;
 	unsigned int width = 0, height = 0;
+	bool warm = false;
 
 	if (mConfigured) {
 		ULOGE("decoder is already configured");
@@ -159,50 +414,352 @@ int AvcDecoder::open(
 		ULOGE("unsupported input bitstream format");
 		return -EINVAL;
 	}
+	if (mVdec == NULL)
+		warm = adoptWarmVdec(pSps, spsSize);
+	if (mVdec == NULL) {
+		ret = createVdec();
+		if (ret < 0) {
+			ULOG_ERRNO("createVdec", -ret);
+			return ret;
+		}
+	}
 
-	ret = vdec_set_sps_pps(mVdec, pSps, spsSize, pPps, ppsSize,
-		mInputFormat);
+	if ((warm) && (mPps != NULL) && (ppsSize == mPpsSize) &&
+		(memcmp(pPps, mPps, ppsSize) == 0)) {
+		/* Same parameter sets: the instance and its input buffer
+		 * pool are ready */
+		width = mWidth;
+		height = mHeight;
+	} else {
+		ret = setSpsPps(pSps, spsSize, pPps, ppsSize, &width, &height);
+		if (ret < 0)
+			return ret;
+
+		ret = setupInputBufferPool(width, height);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = storeSpsPps(pSps, spsSize, pPps, ppsSize, false);
+	if (ret < 0)
+		ULOG_ERRNO("storeSpsPps", -ret);
+	mWidth = width;
+	mHeight = height;
+
+	mConfigured = true;
+	ULOGI("decoder is configured");
+
+	return 0;
+}
+
+
+int AvcDecoder::reconfigure(
+	uint32_t inputBitstreamFormat,
+	const uint8_t *pSps,
+	unsigned int spsSize,
+	const uint8_t *pPps,
+	unsigned int ppsSize)
+{
+	int ret;
+	struct timespec t1;
+	const uint8_t *sps, *pps;
+	unsigned int curSpsSize, curPpsSize;
+
+	if (!mConfigured) {
+		return open(inputBitstreamFormat,
+			pSps, spsSize, pPps, ppsSize);
+	}
+	if ((inputBitstreamFormat != AVCDECODER_BITSTREAM_FORMAT_BYTE_STREAM) &&
+		(inputBitstreamFormat != AVCDECODER_BITSTREAM_FORMAT_AVCC)) {
+		ULOGE("unsupported input bitstream format");
+		return -EINVAL;
+	}
+	if ((pSps == NULL) || (spsSize == 0) ||
+		(pPps == NULL) || (ppsSize == 0))
+		return -EINVAL;
+
+	/* Compare with the parameter sets that will be in use once the
+	 * pending reconfiguration, if any, is complete */
+	sps = (mReconfiguring) ? mPendingSps : mSps;
+	curSpsSize = (mReconfiguring) ? mPendingSpsSize : mSpsSize;
+	pps = (mReconfiguring) ? mPendingPps : mPps;
+	curPpsSize = (mReconfiguring) ? mPendingPpsSize : mPpsSize;
+	if ((sps != NULL) && (pps != NULL) &&
+		(spsSize == curSpsSize) && (ppsSize == curPpsSize) &&
+		(memcmp(pSps, sps, spsSize) == 0) &&
+		(memcmp(pPps, pps, ppsSize) == 0)) {
+		/* Nothing to do */
+		return 0;
+	}
+
+	ret = storeSpsPps(pSps, spsSize, pPps, ppsSize, true);
 	if (ret < 0) {
-		ULOG_ERRNO("vdec_set_sps_pps", -ret);
+		ULOG_ERRNO("storeSpsPps", -ret);
 		return ret;
 	}
 
-	ret = vdec_get_video_dimensions(mVdec, &width, &height,
-		NULL, NULL, NULL, NULL, NULL, NULL);
+	/* Only the last parameter sets of a pending
+	 * reconfiguration are applied */
+	if (mReconfiguring)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	Session *session = (mMedia) ? mMedia->getSession() : NULL;
+	mReconfigureLoop = (session) ? session->getLoop() : NULL;
+
+	pthread_mutex_lock(&mMutex);
+	mReconfiguring = true;
+	mReconfigureStartTime = (uint64_t)t1.tv_sec * 1000000 +
+		(uint64_t)t1.tv_nsec / 1000;
+	pthread_mutex_unlock(&mMutex);
+
+	/* Let the decoder output the frames already queued without
+	 * blocking the caller; the reconfiguration is completed on the
+	 * loop thread once the decoder is flushed */
+	ret = vdec_flush(mVdec, 0);
 	if (ret < 0) {
-		ULOG_ERRNO("vdec_get_video_dimensions", -ret);
-		return ret;
+		ULOG_ERRNO("vdec_flush", -ret);
+		return completeReconfigure();
 	}
 
-	mInputBufferPool = vdec_get_input_buffer_pool(mVdec);
-	mInputBufferQueue = vdec_get_input_buffer_queue(mVdec);
+	return 0;
+}
 
-	if (mInputBufferPool == NULL) {
-		ret = vbuf_generic_get_cbs(&cbs);
+
+int AvcDecoder::completeReconfigure(
+	void)
+{
+	int ret;
+	unsigned int width = 0, height = 0;
+	struct timespec t1;
+	uint64_t endTime;
+	bool inPlace = false, lost;
+	std::vector<struct avcdecoder_pending_input> pending;
+	std::vector<struct avcdecoder_pending_input>::iterator p;
+
+	pthread_mutex_lock(&mMutex);
+	if (!mReconfiguring) {
+		pthread_mutex_unlock(&mMutex);
+		return 0;
+	}
+	mReconfiguring = false;
+	mSkipToIdr = false;
+	pending.swap(mPendingInput);
+	lost = mPendingInputLost;
+	mPendingInputLost = false;
+	pthread_mutex_unlock(&mMutex);
+
+	/* Try to keep the current decoder instance; this only succeeds
+	 * if the decoder accepts new parameter sets without changing
+	 * the video dimensions */
+	ret = setSpsPps(mPendingSps, mPendingSpsSize,
+		mPendingPps, mPendingPpsSize, &width, &height);
+	if ((ret == 0) && (width == mWidth) && (height == mHeight))
+		inPlace = true;
+
+	if (!inPlace) {
+		/* The decoder output buffers are sized for the previous
+		 * dimensions; drop the frames still waiting in the sinks
+		 * before destroying the decoder instance */
+		flushOutputSinks();
+
+		destroyVdec();
+		ret = createVdec();
 		if (ret < 0) {
-			ULOG_ERRNO("vbuf_generic_get_cbs", -ret);
-			return ret;
+			ULOG_ERRNO("createVdec", -ret);
+			goto error;
 		}
 
-		/* Input buffers pool allocation */
-		mInputBufferPool = vbuf_pool_new(
-			AVCDECODER_INPUT_BUFFER_COUNT,
-			width * height * 3 / 4, 0,
-			&cbs); /* TODO: number of buffers and buffers size */
-		if (mInputBufferPool == NULL) {
-			ULOG_ERRNO("vbuf_pool_new:input", ENOMEM);
-			return -ENOMEM;
+		ret = setSpsPps(mPendingSps, mPendingSpsSize,
+			mPendingPps, mPendingPpsSize, &width, &height);
+		if (ret < 0)
+			goto error;
+
+		ret = setupInputBufferPool(width, height);
+		if (ret < 0)
+			goto error;
+	}
+
+	free(mSps);
+	free(mPps);
+	mSps = mPendingSps;
+	mSpsSize = mPendingSpsSize;
+	mPps = mPendingPps;
+	mPpsSize = mPendingPpsSize;
+	mPendingSps = NULL;
+	mPendingSpsSize = 0;
+	mPendingPps = NULL;
+	mPendingPpsSize = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	endTime = (uint64_t)t1.tv_sec * 1000000 +
+		(uint64_t)t1.tv_nsec / 1000;
+
+	pthread_mutex_lock(&mMutex);
+	mStats.reconfigureCount++;
+	mStats.reconfigureTime = (endTime > mReconfigureStartTime) ?
+		endTime - mReconfigureStartTime : 0;
+	if (mStats.reconfigureTime > mStats.maxReconfigureTime)
+		mStats.maxReconfigureTime = mStats.reconfigureTime;
+	pthread_mutex_unlock(&mMutex);
+
+	ULOGI("decoder is reconfigured (%s) %ux%u -> %ux%u in %.2fms",
+		(inPlace) ? "in place" : "new instance",
+		mWidth, mHeight, width, height,
+		(float)mStats.reconfigureTime / 1000.);
+
+	mWidth = width;
+	mHeight = height;
+
+	/* Decode the frames received during the drain with the new
+	 * parameter sets */
+	for (p = pending.begin(); p != pending.end(); p++) {
+		if (!lost) {
+			ret = resubmitInputBuffer(&(*p), endTime);
+			if (ret < 0) {
+				ULOG_ERRNO("resubmitInputBuffer", -ret);
+				lost = true;
+			}
 		}
-		mInputBufferPoolAllocated = true;
+		free(p->data);
+		free(p->userData);
+	}
+	if (lost) {
+		ULOGI("frames lost during the reconfiguration, "
+			"skip to next IDR frame");
+		pthread_mutex_lock(&mMutex);
+		mSkipToIdr = true;
+		mSkipToIdrStartTime = endTime;
+		pthread_mutex_unlock(&mMutex);
 	}
 
-	mConfigured = true;
-	ULOGI("decoder is configured");
+	return 0;
+
+error:
+	mConfigured = false;
+	for (p = pending.begin(); p != pending.end(); p++) {
+		free(p->data);
+		free(p->userData);
+	}
+	return ret;
+}
+
+
+int AvcDecoder::holdInputBuffer(
+	struct vbuf_buffer *buffer,
+	const struct avcdecoder_input_buffer *meta,
+	unsigned int level)
+{
+	struct avcdecoder_pending_input input;
+	const uint8_t *data, *userData;
+
+	if ((mPendingInputLost) ||
+		(mPendingInput.size() >= AVCDECODER_MAX_PENDING_INPUT)) {
+		/* The next frames cannot be decoded without this one */
+		mPendingInputLost = true;
+		return -ENOBUFS;
+	}
+
+	/* The data is copied so that the buffer returns to the input
+	 * pool, which may not survive the reconfiguration */
+	memset(&input, 0, sizeof(input));
+	input.size = vbuf_get_size(buffer);
+	input.userDataSize = vbuf_get_userdata_size(buffer);
+	input.level = level;
+	input.meta = *meta;
+	data = vbuf_get_cdata(buffer);
+	userData = vbuf_get_cuserdata(buffer);
+	if ((data == NULL) || (input.size == 0))
+		return -EINVAL;
+
+	input.data = (uint8_t *)malloc(input.size);
+	if (input.data == NULL)
+		return -ENOMEM;
+	memcpy(input.data, data, input.size);
+	if ((userData != NULL) && (input.userDataSize > 0)) {
+		input.userData = (uint8_t *)malloc(input.userDataSize);
+		if (input.userData == NULL) {
+			free(input.data);
+			return -ENOMEM;
+		}
+		memcpy(input.userData, userData, input.userDataSize);
+	} else {
+		input.userDataSize = 0;
+	}
 
+	mPendingInput.push_back(input);
 	return 0;
 }
 
 
+int AvcDecoder::resubmitInputBuffer(
+	const struct avcdecoder_pending_input *input,
+	uint64_t curTime)
+{
+	int ret;
+	struct vbuf_buffer *buffer = NULL;
+	struct avcdecoder_input_buffer *meta;
+
+	if (mInputBufferPool == NULL)
+		return -EPROTO;
+
+	ret = vbuf_pool_get(mInputBufferPool, 0, &buffer);
+	if ((ret < 0) || (buffer == NULL)) {
+		ULOG_ERRNO("vbuf_pool_get:input", -ret);
+		return (ret < 0) ? ret : -ENOBUFS;
+	}
+	if (vbuf_get_capacity(buffer) < input->size) {
+		ret = -ENOBUFS;
+		goto out;
+	}
+	memcpy(vbuf_get_data(buffer), input->data, input->size);
+	vbuf_set_size(buffer, input->size);
+
+	ret = vbuf_set_userdata_capacity(buffer, input->userDataSize);
+	if (ret < 0)
+		goto out;
+	if (input->userDataSize > 0) {
+		memcpy(vbuf_get_userdata(buffer), input->userData,
+			input->userDataSize);
+	}
+	vbuf_set_userdata_size(buffer, input->userDataSize);
+
+	meta = (struct avcdecoder_input_buffer *)vbuf_metadata_add(buffer,
+		mMedia, input->level, sizeof(*meta));
+	if (meta == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	*meta = input->meta;
+
+	ret = vbuf_write_lock(buffer);
+	if (ret < 0)
+		ULOG_ERRNO("vbuf_write_lock", -ret);
+
+	ret = queueInputBuffer(buffer, meta, input->level, curTime);
+
+out:
+	vbuf_unref(&buffer);
+	return ret;
+}
+
+
+void AvcDecoder::clearPendingInput(
+	void)
+{
+	std::vector<struct avcdecoder_pending_input>::iterator p;
+
+	pthread_mutex_lock(&mMutex);
+	for (p = mPendingInput.begin(); p != mPendingInput.end(); p++) {
+		free(p->data);
+		free(p->userData);
+	}
+	mPendingInput.clear();
+	mPendingInputLost = false;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
 int AvcDecoder::queueBufferCb(
 	struct vbuf_queue *queue,
 	struct vbuf_buffer *buffer,
@@ -211,7 +768,6 @@ int AvcDecoder::queueBufferCb(
 	int ret;
 	AvcDecoder *decoder = (AvcDecoder *)userdata;
 	struct avcdecoder_input_buffer *in_meta;
-	struct vdec_input_metadata *vdec_meta;
 	unsigned int level = 0;
 
 	if (queue == NULL)
@@ -235,32 +791,264 @@ int AvcDecoder::queueBufferCb(
 		ULOG_ERRNO("vbuf_metadata_get", EPROTO);
 		return -EPROTO;
 	}
+
+	struct timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	uint64_t curTime =
+		(uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+
+	pthread_mutex_lock(&decoder->mMutex);
+	bool reconfiguring = decoder->mReconfiguring;
+	uint64_t reconfigureStartTime = decoder->mReconfigureStartTime;
+	pthread_mutex_unlock(&decoder->mMutex);
+
+	if ((reconfiguring) && (curTime > reconfigureStartTime +
+		AVCDECODER_DRAIN_TIMEOUT)) {
+		ULOGW("decoder drain timeout");
+		ret = decoder->completeReconfigure();
+		if (ret < 0) {
+			ULOG_ERRNO("completeReconfigure", -ret);
+			return ret;
+		}
+		reconfiguring = false;
+	}
+
+	if (reconfiguring) {
+		/* Keep the frame until the new parameter sets
+		 * are applied */
+		pthread_mutex_lock(&decoder->mMutex);
+		ret = decoder->holdInputBuffer(buffer, in_meta, level);
+		if (ret < 0) {
+			decoder->mPendingInputLost = true;
+			decoder->mStats.inputFrameCount++;
+			decoder->mStats.droppedSkipToIdrFrameCount++;
+		}
+		pthread_mutex_unlock(&decoder->mMutex);
+		if (ret < 0)
+			ULOG_ERRNO("holdInputBuffer", -ret);
+		ret = vbuf_metadata_remove(buffer, decoder->mMedia);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_metadata_remove", -ret);
+		return 0;
+	}
+
+	return decoder->queueInputBuffer(buffer, in_meta, level, curTime);
+}
+
+
+int AvcDecoder::queueInputBuffer(
+	struct vbuf_buffer *buffer,
+	const struct avcdecoder_input_buffer *meta,
+	unsigned int level,
+	uint64_t curTime)
+{
+	int ret;
+	struct vdec_input_metadata *vdec_meta;
+
+	if (dropInputFrame(meta, curTime)) {
+		/* The buffer returns to the pool when
+		 * released by the caller */
+		ret = vbuf_metadata_remove(buffer, mMedia);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_metadata_remove", -ret);
+		return 0;
+	}
+
 	vdec_meta = (struct vdec_input_metadata *)vbuf_metadata_add(buffer,
-		decoder->mVdec, level + 1, sizeof(*vdec_meta));
+		mVdec, level + 1, sizeof(*vdec_meta));
 	if (vdec_meta == NULL) {
 		ULOG_ERRNO("vbuf_metadata_add", ENOMEM);
 		return -ENOMEM;
 	}
-	vdec_meta->timestamp = in_meta->auNtpTimestampRaw;
-	vdec_meta->index = decoder->mFrameIndex++;
-	vdec_meta->format = decoder->mInputFormat;
-	vdec_meta->complete = in_meta->isComplete;
-	vdec_meta->errors = in_meta->hasErrors;
-	vdec_meta->ref = in_meta->isRef;
-	vdec_meta->silent = in_meta->isSilent;
-	struct timespec t1;
-	clock_gettime(CLOCK_MONOTONIC, &t1);
-	vdec_meta->input_time =
-		(uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
-
-	ret = vbuf_queue_push(queue, buffer);
-	if (ret < 0)
+	vdec_meta->timestamp = meta->auNtpTimestampRaw;
+	vdec_meta->index = mFrameIndex++;
+	vdec_meta->format = mInputFormat;
+	vdec_meta->complete = meta->isComplete;
+	vdec_meta->errors = meta->hasErrors;
+	vdec_meta->ref = meta->isRef;
+	vdec_meta->silent = meta->isSilent;
+	vdec_meta->input_time = curTime;
+
+	/* Recorded before the push as the frame can be output
+	 * right away */
+	pthread_mutex_lock(&mMutex);
+	mDecodingInputTimes.push_back(curTime);
+	pthread_mutex_unlock(&mMutex);
+
+	ret = vbuf_queue_push(mInputBufferQueue, buffer);
+	if (ret < 0) {
 		ULOG_ERRNO("vbuf_queue_push:input", -ret);
+		pthread_mutex_lock(&mMutex);
+		if ((!mDecodingInputTimes.empty()) &&
+			(mDecodingInputTimes.back() == curTime))
+			mDecodingInputTimes.pop_back();
+		pthread_mutex_unlock(&mMutex);
+	}
+
+	return 0;
+}
+
+
+void AvcDecoder::updateBacklog(
+	uint64_t curTime)
+{
+	/* Must be called with mMutex held; the backlog is the age of the
+	 * oldest frame still in the decoder, so that it also decreases
+	 * while no frames are queued (e.g. when skipping to the next IDR
+	 * frame) */
+	if (mDecodingInputTimes.empty()) {
+		mStats.backlog = 0;
+		return;
+	}
+	mStats.backlog = (curTime > mDecodingInputTimes.front()) ?
+		curTime - mDecodingInputTimes.front() : 0;
+	if (mStats.backlog > mStats.maxBacklog)
+		mStats.maxBacklog = mStats.backlog;
+}
+
+
+void AvcDecoder::clearDecodingInputTimes(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	mDecodingInputTimes.clear();
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+bool AvcDecoder::dropInputFrame(
+	const struct avcdecoder_input_buffer *meta,
+	uint64_t curTime)
+{
+	enum pdraw_decoder_drop_policy policy = PDRAW_DECODER_DROP_POLICY_NONE;
+	unsigned int maxBacklog = 0;
+	bool drop = false;
+
+	Session *session = mMedia->getSession();
+	if (session != NULL) {
+		session->getSettings()->getDecoderDropSettings(
+			&policy, &maxBacklog);
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	mStats.inputFrameCount++;
+	updateBacklog(curTime);
+
+	if (mSkipToIdr) {
+		if (meta->isIdr) {
+			ULOGI("IDR frame received, resume decoding");
+			mSkipToIdr = false;
+		} else if (curTime - mSkipToIdrStartTime >
+			AVCDECODER_SKIP_TO_IDR_TIMEOUT) {
+			/* Do not freeze the video on streams without
+			 * periodic IDR frames (e.g. intra refresh) */
+			ULOGW("no IDR frame received after %.2fms, "
+				"resume decoding",
+				(float)(curTime - mSkipToIdrStartTime) / 1000.);
+			mSkipToIdr = false;
+			mStats.skipToIdrTimeoutCount++;
+		} else {
+			mStats.droppedSkipToIdrFrameCount++;
+			drop = true;
+		}
+		goto out;
+	}
+
+	if ((policy == PDRAW_DECODER_DROP_POLICY_NONE) || (meta->isIdr) ||
+		(meta->isSilent))
+		goto out;
+
+	if ((policy == PDRAW_DECODER_DROP_POLICY_SKIP_TO_IDR) &&
+		(meta->isRef) && (meta->hasErrors)) {
+		/* Errors in a reference frame propagate
+		 * until the next IDR frame */
+		ULOGI("corrupted reference frame, skip to next IDR frame");
+		mSkipToIdr = true;
+		mSkipToIdrStartTime = curTime;
+		mStats.skipToIdrErrorCount++;
+		mStats.droppedSkipToIdrFrameCount++;
+		drop = true;
+		goto out;
+	}
+
+	if ((maxBacklog == 0) || (mStats.backlog <= maxBacklog))
+		goto out;
+
+	if (!meta->isRef) {
+		mStats.droppedNonRefFrameCount++;
+		drop = true;
+	} else if ((policy == PDRAW_DECODER_DROP_POLICY_SKIP_TO_IDR) &&
+		(mStats.backlog > 2 * (uint64_t)maxBacklog)) {
+		/* Dropping non-reference frames was not enough */
+		ULOGI("decoder backlog is %.2fms, skip to next IDR frame",
+			(float)mStats.backlog / 1000.);
+		mSkipToIdr = true;
+		mSkipToIdrStartTime = curTime;
+		mStats.skipToIdrBacklogCount++;
+		mStats.droppedSkipToIdrFrameCount++;
+		drop = true;
+	}
+
+out:
+	pthread_mutex_unlock(&mMutex);
+	return drop;
+}
+
+
+int AvcDecoder::getStats(
+	struct pdraw_video_decoder_stats *stats)
+{
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+	*stats = mStats;
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+int AvcDecoder::park(
+	void)
+{
+	int ret;
+
+	/* Cancel a pending reconfiguration */
+	pthread_mutex_lock(&mMutex);
+	mReconfiguring = false;
+	pthread_mutex_unlock(&mMutex);
+	clearPendingInput();
+
+	/* Drop the frames of the previous media */
+	if ((mConfigured) && (mVdec != NULL)) {
+		ret = vdec_flush(mVdec, 1);
+		if (ret < 0)
+			ULOG_ERRNO("vdec_flush", -ret);
+		clearDecodingInputTimes();
+	}
+
+	pthread_mutex_lock(&mMutex);
+	mOutputSinks.clear();
+	mMedia = NULL;
+	mSkipToIdr = false;
+	pthread_mutex_unlock(&mMutex);
 
 	return 0;
 }
 
 
+bool AvcDecoder::matchSps(
+	const uint8_t *pSps,
+	unsigned int spsSize)
+{
+	if ((pSps == NULL) || (mSps == NULL) || (spsSize != mSpsSize))
+		return false;
+	return (memcmp(pSps, mSps, spsSize) == 0);
+}
+
+
 int AvcDecoder::getInputSource(
 	Media *media,
 	struct avcdecoder_input_source *src)
@@ -285,7 +1073,9 @@ int AvcDecoder::getInputSource(
 
 int AvcDecoder::addOutputSink(
 	Media *media,
-	struct vbuf_queue *queue)
+	struct vbuf_queue *queue,
+	avcdecoder_output_sink_notify_t notify,
+	void *notifyUserdata)
 {
 	if (media == NULL)
 		return -EINVAL;
@@ -296,7 +1086,16 @@ int AvcDecoder::addOutputSink(
 		return -ENOENT;
 	}
 
-	mOutputBufferQueues.push_back(queue);
+	struct avcdecoder_output_sink sink;
+	sink.queue = queue;
+	sink.notify = notify;
+	sink.notifyUserdata = notifyUserdata;
+	sink.totalHoldTime = 0;
+	memset(&sink.stats, 0, sizeof(sink.stats));
+
+	pthread_mutex_lock(&mMutex);
+	mOutputSinks.push_back(sink);
+	pthread_mutex_unlock(&mMutex);
 
 	return 0;
 }
@@ -316,22 +1115,146 @@ int AvcDecoder::removeOutputSink(
 	}
 
 	bool found = false;
-	std::vector<struct vbuf_queue *>::iterator q =
-		mOutputBufferQueues.begin();
-
-	while (q != mOutputBufferQueues.end()) {
-		if (*q == queue) {
-			mOutputBufferQueues.erase(q);
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct avcdecoder_output_sink>::iterator s =
+		mOutputSinks.begin();
+
+	while (s != mOutputSinks.end()) {
+		if (s->queue == queue) {
+			/* The frames still held by the sink are released
+			 * without being accounted for */
+			if (!s->held.empty()) {
+				ULOGD("output sink removed with %zu frames "
+					"held", s->held.size());
+			}
+			s->held.clear();
+			mOutputSinks.erase(s);
 			found = true;
 			break;
 		}
-		q++;
+		s++;
 	}
+	/* The sink may be destroyed once removed: wait for the
+	 * notifications in progress */
+	while ((found) && (mNotifyCount > 0))
+		pthread_cond_wait(&mNotifyCond, &mMutex);
+	pthread_mutex_unlock(&mMutex);
 
 	return (found) ? 0 : -ENOENT;
 }
 
 
+int AvcDecoder::releaseOutputBuffer(
+	struct vbuf_queue *queue,
+	struct vbuf_buffer **buffer)
+{
+	int ret;
+	struct timespec t1;
+	uint64_t curTime;
+
+	if ((buffer == NULL) || (*buffer == NULL))
+		return -EINVAL;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	curTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct avcdecoder_output_sink>::iterator s =
+		mOutputSinks.begin();
+	while (s != mOutputSinks.end()) {
+		if (s->queue == queue)
+			break;
+		s++;
+	}
+	if (s != mOutputSinks.end()) {
+		std::vector<struct avcdecoder_held_buffer>::iterator h =
+			s->held.begin();
+		while (h != s->held.end()) {
+			if (h->buffer == *buffer)
+				break;
+			h++;
+		}
+		if (h != s->held.end()) {
+			uint64_t holdTime = (curTime > h->outputTime) ?
+				curTime - h->outputTime : 0;
+			s->stats.releasedFrameCount++;
+			s->totalHoldTime += holdTime;
+			if (holdTime > s->stats.maxHoldTime)
+				s->stats.maxHoldTime = holdTime;
+			s->held.erase(h);
+		}
+	}
+	pthread_mutex_unlock(&mMutex);
+
+	ret = vbuf_unref(buffer);
+	if (ret < 0)
+		ULOG_ERRNO("vbuf_unref", -ret);
+
+	return ret;
+}
+
+
+int AvcDecoder::getOutputStats(
+	struct pdraw_video_decoder_output_stats *stats)
+{
+	unsigned int sinkMaxFrames = 0;
+
+	if (stats == NULL)
+		return -EINVAL;
+
+	Session *session = (mMedia) ? mMedia->getSession() : NULL;
+	if (session != NULL) {
+		session->getSettings()->getDecoderOutputSettings(
+			&sinkMaxFrames, NULL);
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	stats->sinkMaxFrames = sinkMaxFrames;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct avcdecoder_output_sink>::iterator s =
+		mOutputSinks.begin();
+	while ((s != mOutputSinks.end()) &&
+		(stats->sinkCount < PDRAW_VIDEO_DECODER_MAX_SINKS)) {
+		struct pdraw_video_decoder_sink_stats *ss =
+			&stats->sink[stats->sinkCount];
+		*ss = s->stats;
+		ss->heldFrameCount = s->held.size();
+		if (ss->releasedFrameCount > 0) {
+			ss->meanHoldTime =
+				s->totalHoldTime / ss->releasedFrameCount;
+		}
+		stats->heldFrameCount += s->held.size();
+		stats->sinkCount++;
+		s++;
+	}
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+void AvcDecoder::flushOutputSinks(
+	void)
+{
+	int ret;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct avcdecoder_output_sink>::iterator s =
+		mOutputSinks.begin();
+	while (s != mOutputSinks.end()) {
+		ret = vbuf_queue_flush(s->queue);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_queue_flush:output", -ret);
+		/* Frames already popped by the sink are released without
+		 * being accounted for */
+		s->held.clear();
+		s++;
+	}
+	pthread_mutex_unlock(&mMutex);
+}
+
+
 int AvcDecoder::flush(
 	void)
 {
@@ -342,15 +1265,11 @@ int AvcDecoder::flush(
 		return -EPROTO;
 	}
 
+	/* Drop the frames waiting for a pending reconfiguration */
+	clearPendingInput();
+
 	/* Flush the output queues */
-	std::vector<struct vbuf_queue *>::iterator q =
-		mOutputBufferQueues.begin();
-	while (q != mOutputBufferQueues.end()) {
-		ret = vbuf_queue_flush(*q);
-		if (ret < 0)
-			ULOG_ERRNO("vbuf_queue_flush:output", -ret);
-		q++;
-	}
+	flushOutputSinks();
 
 	/* TODO: flush the downstream elements */
 
@@ -360,6 +1279,7 @@ int AvcDecoder::flush(
 		ULOG_ERRNO("vdec_flush", -ret);
 		return ret;
 	}
+	clearDecodingInputTimes();
 
 	return 0;
 }
@@ -377,6 +1297,12 @@ int AvcDecoder::close(
 
 	mConfigured = false;
 
+	/* Cancel a pending reconfiguration */
+	pthread_mutex_lock(&mMutex);
+	mReconfiguring = false;
+	pthread_mutex_unlock(&mMutex);
+	clearPendingInput();
+
 	if (mInputBufferPool) {
 		ret = vbuf_pool_abort(mInputBufferPool);
 		if (ret < 0) {
@@ -400,14 +1326,15 @@ void AvcDecoder::frameOutputCb(
 	void *userdata)
 {
 	int ret;
-	AvcDecoder *decoder = (AvcDecoder *)userdata;
+	struct avcdecoder_vdec_ctx *ctx = (struct avcdecoder_vdec_ctx *)userdata;
+	AvcDecoder *decoder = (ctx != NULL) ? ctx->decoder : NULL;
 	struct vdec_output_metadata *vdec_meta;
 	struct avcdecoder_input_buffer *in_meta;
 	struct avcdecoder_output_buffer _out_meta;
 	struct avcdecoder_output_buffer *out_meta;
 	unsigned int level = 0;
 
-	if (userdata == NULL) {
+	if (decoder == NULL) {
 		ULOG_ERRNO("userdata", EINVAL);
 		return;
 	}
@@ -420,6 +1347,11 @@ void AvcDecoder::frameOutputCb(
 		vbuf_metadata_get(out_buf, decoder->mVdec, NULL, NULL);
 	in_meta = (struct avcdecoder_input_buffer *)
 		vbuf_metadata_get(out_buf, decoder->mMedia, &level, NULL);
+	if ((vdec_meta == NULL) || (in_meta == NULL)) {
+		/* Frame from a previous media of a warm decoder */
+		ULOGD("frame without metadata (ignored)");
+		return;
+	}
 	memset(&_out_meta, 0, sizeof(_out_meta));
 	_out_meta.plane_offset[0] = vdec_meta->plane_offset[0];
 	_out_meta.plane_offset[1] = vdec_meta->plane_offset[1];
@@ -467,6 +1399,41 @@ void AvcDecoder::frameOutputCb(
 		in_meta->demuxOutputTimestamp;
 	_out_meta.decoderOutputTimestamp = vdec_meta->output_time;
 
+	/* Time to first frame (the session lock must not be taken
+	 * while holding the decoder lock) */
+	uint64_t openTime = 0;
+	if (!decoder->mFirstFrameOutput) {
+		Session *session = decoder->mMedia->getSession();
+		openTime = (session) ? session->getOpenTime() : 0;
+	}
+
+	/* Decoder backlog */
+	pthread_mutex_lock(&decoder->mMutex);
+	decoder->mStats.outputFrameCount++;
+	/* The frames are output in decoding order; older frames that
+	 * were not output have been dropped by the decoder */
+	while ((!decoder->mDecodingInputTimes.empty()) &&
+		(decoder->mDecodingInputTimes.front() <=
+		vdec_meta->input_time))
+		decoder->mDecodingInputTimes.pop_front();
+	if (vdec_meta->output_time >= vdec_meta->input_time) {
+		decoder->mStats.backlog =
+			vdec_meta->output_time - vdec_meta->input_time;
+		if (decoder->mStats.backlog > decoder->mStats.maxBacklog)
+			decoder->mStats.maxBacklog = decoder->mStats.backlog;
+	}
+	if (!decoder->mFirstFrameOutput) {
+		decoder->mFirstFrameOutput = true;
+		if ((openTime != 0) && (vdec_meta->output_time >= openTime)) {
+			decoder->mStats.timeToFirstFrame =
+				vdec_meta->output_time - openTime;
+			ULOGI("time to first frame: %.2fms (%s start)",
+				(float)decoder->mStats.timeToFirstFrame / 1000.,
+				(decoder->mStats.warmStart) ? "warm" : "cold");
+		}
+	}
+	pthread_mutex_unlock(&decoder->mMutex);
+
 	/* Frame metadata */
 	if (in_meta->hasMetadata) {
 		memcpy(&_out_meta.metadata,
@@ -477,6 +1444,20 @@ void AvcDecoder::frameOutputCb(
 		_out_meta.hasMetadata = false;
 	}
 
+	/* Metadata subscribers */
+	VideoMedia *media = decoder->getVideoMedia();
+	if ((!_out_meta.isSilent) && (media->hasMetadataSubscribers(
+		PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER))) {
+		struct pdraw_video_frame_metadata meta;
+		VideoMedia::getFrameMetadata(in_meta, &meta);
+		meta.hasErrors = (_out_meta.hasErrors) ? 1 : 0;
+		meta.width = _out_meta.width;
+		meta.height = _out_meta.height;
+		meta.decoderOutputTimestamp = _out_meta.decoderOutputTimestamp;
+		media->notifyFrameMetadata(
+			PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER, &meta);
+	}
+
 #if 0
 	/* TODO: remove debug */
 	ULOGI("frame #%u dequeue=%.2fms decode=%.2fms",
@@ -508,30 +1489,149 @@ void AvcDecoder::frameOutputCb(
 	memcpy(out_meta, &_out_meta, sizeof(*out_meta));
 
 	/* Push the frame */
-	if (!_out_meta.isSilent) {
-		std::vector<struct vbuf_queue *>::iterator q =
-			decoder->mOutputBufferQueues.begin();
-		while (q != decoder->mOutputBufferQueues.end()) {
-			ret = vbuf_queue_push(*q, out_buf);
-			if (ret < 0)
-				ULOG_ERRNO("vbuf_queue_push:output", -ret);
-			q++;
-		}
-	} else {
+	if (!_out_meta.isSilent)
+		decoder->pushOutputBuffer(out_buf, vdec_meta->output_time);
+	else
 		ULOGD("silent frame (ignored)");
+}
+
+
+void AvcDecoder::pushOutputBuffer(
+	struct vbuf_buffer *buffer,
+	uint64_t outputTime)
+{
+	int ret;
+	unsigned int sinkMaxFrames = 0, leakTimeout = 0, i = 0;
+	struct avcdecoder_held_buffer held;
+	std::vector<std::pair<avcdecoder_output_sink_notify_t, void *> >
+		notifications;
+
+	Session *session = (mMedia) ? mMedia->getSession() : NULL;
+	if (session != NULL) {
+		session->getSettings()->getDecoderOutputSettings(
+			&sinkMaxFrames, &leakTimeout);
 	}
+
+	held.buffer = buffer;
+	held.outputTime = outputTime;
+	held.leakReported = false;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct avcdecoder_output_sink>::iterator s =
+		mOutputSinks.begin();
+	while (s != mOutputSinks.end()) {
+		/* Leak detection */
+		std::vector<struct avcdecoder_held_buffer>::iterator h =
+			s->held.begin();
+		while ((leakTimeout > 0) && (h != s->held.end())) {
+			if ((!h->leakReported) &&
+				(outputTime > h->outputTime + leakTimeout)) {
+				ULOGW("output sink %u: frame held for %.2fms, "
+					"possible leak", i,
+					(float)(outputTime - h->outputTime) /
+					1000.);
+				h->leakReported = true;
+				s->stats.leakCount++;
+			}
+			h++;
+		}
+
+		/* Do not let a slow sink starve the decoder */
+		if ((sinkMaxFrames > 0) && (s->held.size() >= sinkMaxFrames)) {
+			if (s->stats.droppedFrameCount == 0) {
+				ULOGW("output sink %u: %u frames held, "
+					"dropping frames", i, sinkMaxFrames);
+			}
+			s->stats.droppedFrameCount++;
+			s++;
+			i++;
+			continue;
+		}
+
+		/* Account the frame before the sink can release it */
+		s->held.push_back(held);
+		ret = vbuf_queue_push(s->queue, buffer);
+		if (ret < 0) {
+			ULOG_ERRNO("vbuf_queue_push:output", -ret);
+			s->held.pop_back();
+		} else {
+			s->stats.pushedFrameCount++;
+			if (s->held.size() > s->stats.maxHeldFrameCount)
+				s->stats.maxHeldFrameCount = s->held.size();
+			if (s->notify) {
+				notifications.push_back(std::make_pair(
+					s->notify, s->notifyUserdata));
+			}
+		}
+		s++;
+		i++;
+	}
+	if (notifications.empty()) {
+		pthread_mutex_unlock(&mMutex);
+		return;
+	}
+	mNotifyCount++;
+	pthread_mutex_unlock(&mMutex);
+
+	/* Notify without the decoder lock held: the sinks may call back
+	 * into the decoder */
+	std::vector<std::pair<avcdecoder_output_sink_notify_t, void *> >::
+		iterator n = notifications.begin();
+	while (n != notifications.end()) {
+		n->first(n->second);
+		n++;
+	}
+
+	pthread_mutex_lock(&mMutex);
+	mNotifyCount--;
+	if (mNotifyCount == 0)
+		pthread_cond_broadcast(&mNotifyCond);
+	pthread_mutex_unlock(&mMutex);
 }
 
 
 void AvcDecoder::flushCb(
 	void *userdata)
 {
+	struct avcdecoder_vdec_ctx *ctx = (struct avcdecoder_vdec_ctx *)userdata;
+	AvcDecoder *decoder = (ctx != NULL) ? ctx->decoder : NULL;
+
 	ULOGI("decoder is flushed");
 
+	if (decoder != NULL) {
+		/* Complete the reconfiguration on the loop thread: the
+		 * decoder instance cannot be destroyed from its own
+		 * callback */
+		pthread_mutex_lock(&decoder->mMutex);
+		if ((decoder->mReconfiguring) &&
+			(decoder->mReconfigureLoop != NULL)) {
+			int ret = pomp_loop_idle_add(decoder->mReconfigureLoop,
+				&reconfigureIdleCb, decoder);
+			if (ret < 0)
+				ULOG_ERRNO("pomp_loop_idle_add", -ret);
+		}
+		pthread_mutex_unlock(&decoder->mMutex);
+	}
+
 	/* TODO: signal the upstream elements */
 }
 
 
+void AvcDecoder::reconfigureIdleCb(
+	void *userdata)
+{
+	int ret;
+	AvcDecoder *decoder = (AvcDecoder *)userdata;
+
+	if (decoder == NULL)
+		return;
+
+	ret = decoder->completeReconfigure();
+	if (ret < 0)
+		ULOG_ERRNO("completeReconfigure", -ret);
+}
+
+
 void AvcDecoder::stopCb(
 	void *userdata)
 {
@@ -31,6 +31,11 @@
 #define _PDRAW_AVCDECODER_HPP_
 
 #include <inttypes.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include <pdraw/pdraw_defs.h>
+#include <libpomp.h>
 #include <video-buffers/vbuf.h>
 #include <video-decode/vdec.h>
 #include "pdraw_decoder.hpp"
@@ -51,6 +56,12 @@ namespace Pdraw {
 
 #define AVCDECODER_INPUT_BUFFER_COUNT			(10)
 
+#define AVCDECODER_SKIP_TO_IDR_TIMEOUT			(2000000)
+
+#define AVCDECODER_DRAIN_TIMEOUT			(500000)
+
+#define AVCDECODER_MAX_PENDING_INPUT			(10)
+
 
 struct avcdecoder_input_source {
 	struct vbuf_queue *queue;
@@ -67,6 +78,7 @@ struct avcdecoder_input_buffer {
 	bool isComplete;
 	bool hasErrors;
 	bool isRef;
+	bool isIdr;
 	bool isSilent;
 	uint64_t auNtpTimestamp;
 	uint64_t auNtpTimestampRaw;
@@ -77,6 +89,40 @@ struct avcdecoder_input_buffer {
 };
 
 
+/* Input frame received while the decoder drains for a reconfiguration */
+struct avcdecoder_pending_input {
+	uint8_t *data;
+	size_t size;
+	uint8_t *userData;
+	size_t userDataSize;
+	unsigned int level;
+	struct avcdecoder_input_buffer meta;
+};
+
+
+struct avcdecoder_held_buffer {
+	struct vbuf_buffer *buffer;
+	uint64_t outputTime;
+	bool leakReported;
+};
+
+
+/* Called after a buffer is pushed to a sink, without the decoder lock
+ * held; removeOutputSink() waits for the notifications in progress */
+typedef void (*avcdecoder_output_sink_notify_t)(
+	void *userdata);
+
+
+struct avcdecoder_output_sink {
+	struct vbuf_queue *queue;
+	avcdecoder_output_sink_notify_t notify;
+	void *notifyUserdata;
+	std::vector<struct avcdecoder_held_buffer> held;
+	uint64_t totalHoldTime;
+	struct pdraw_video_decoder_sink_stats stats;
+};
+
+
 struct avcdecoder_output_buffer {
 	size_t plane_offset[3];
 	size_t stride[3];
@@ -104,6 +150,14 @@ struct avcdecoder_output_buffer {
 
 
 class VideoMedia;
+class AvcDecoder;
+
+
+/* vdec callbacks context; it moves with the vdec instance when a new
+ * decoder takes over the instance of a parked one */
+struct avcdecoder_vdec_ctx {
+	AvcDecoder *decoder;
+};
 
 
 class AvcDecoder : public Decoder {
@@ -124,6 +178,13 @@ public:
 		const uint8_t *pPps,
 		unsigned int ppsSize);
 
+	int reconfigure(
+		uint32_t inputBitstreamFormat,
+		const uint8_t *pSps,
+		unsigned int spsSize,
+		const uint8_t *pPps,
+		unsigned int ppsSize);
+
 	bool isConfigured(
 		void) {
 		return mConfigured;
@@ -141,12 +202,22 @@ public:
 
 	int addOutputSink(
 		Media *media,
-		struct vbuf_queue *queue);
+		struct vbuf_queue *queue,
+		avcdecoder_output_sink_notify_t notify = NULL,
+		void *notifyUserdata = NULL);
 
 	int removeOutputSink(
 		Media *media,
 		struct vbuf_queue *queue);
 
+	/* Release a buffer popped from an output sink queue */
+	int releaseOutputBuffer(
+		struct vbuf_queue *queue,
+		struct vbuf_buffer **buffer);
+
+	int getOutputStats(
+		struct pdraw_video_decoder_output_stats *stats);
+
 	Media *getMedia(
 		void) {
 		return mMedia;
@@ -157,7 +228,94 @@ public:
 		return (VideoMedia *)mMedia;
 	}
 
+	int getStats(
+		struct pdraw_video_decoder_stats *stats);
+
+	int park(
+		void);
+
+	bool matchSps(
+		const uint8_t *pSps,
+		unsigned int spsSize);
+
+	unsigned int getWidth(
+		void) {
+		return mWidth;
+	}
+
+	unsigned int getHeight(
+		void) {
+		return mHeight;
+	}
+
 private:
+	int createVdec(
+		void);
+
+	void destroyVdec(
+		void);
+
+	bool adoptWarmVdec(
+		const uint8_t *pSps,
+		unsigned int spsSize);
+
+	int setSpsPps(
+		const uint8_t *pSps,
+		unsigned int spsSize,
+		const uint8_t *pPps,
+		unsigned int ppsSize,
+		unsigned int *width,
+		unsigned int *height);
+
+	int setupInputBufferPool(
+		unsigned int width,
+		unsigned int height);
+
+	int storeSpsPps(
+		const uint8_t *pSps,
+		unsigned int spsSize,
+		const uint8_t *pPps,
+		unsigned int ppsSize,
+		bool pending);
+
+	int completeReconfigure(
+		void);
+
+	int holdInputBuffer(
+		struct vbuf_buffer *buffer,
+		const struct avcdecoder_input_buffer *meta,
+		unsigned int level);
+
+	int resubmitInputBuffer(
+		const struct avcdecoder_pending_input *input,
+		uint64_t curTime);
+
+	void clearPendingInput(
+		void);
+
+	int queueInputBuffer(
+		struct vbuf_buffer *buffer,
+		const struct avcdecoder_input_buffer *meta,
+		unsigned int level,
+		uint64_t curTime);
+
+	void flushOutputSinks(
+		void);
+
+	void pushOutputBuffer(
+		struct vbuf_buffer *buffer,
+		uint64_t outputTime);
+
+	void updateBacklog(
+		uint64_t curTime);
+
+	void clearDecodingInputTimes(
+		void);
+
+	bool dropInputFrame(
+		const struct avcdecoder_input_buffer *meta,
+		uint64_t curTime);
+
 	static int queueBufferCb(
 		struct vbuf_queue *queue,
 		struct vbuf_buffer *buffer,
@@ -170,16 +328,48 @@ private:
 	static void flushCb(
 		void *userdata);
 
+	static void reconfigureIdleCb(
+		void *userdata);
+
 	static void stopCb(
 		void *userdata);
 
 	struct vbuf_pool *mInputBufferPool;
 	bool mInputBufferPoolAllocated;
+	size_t mInputBufferPoolSize;
 	struct vbuf_queue *mInputBufferQueue;
-	std::vector<struct vbuf_queue*> mOutputBufferQueues;
+	std::vector<struct avcdecoder_output_sink> mOutputSinks;
 	struct vdec_decoder *mVdec;
+	struct avcdecoder_vdec_ctx *mVdecCtx;
 	unsigned int mFrameIndex;
 	enum vdec_input_format mInputFormat;
+	pthread_mutex_t mMutex;
+	pthread_cond_t mNotifyCond;
+	unsigned int mNotifyCount;
+	bool mSkipToIdr;
+	uint64_t mSkipToIdrStartTime;
+	/* Input times of the frames queued to the decoder and not yet
+	 * output, oldest first */
+	std::deque<uint64_t> mDecodingInputTimes;
+	struct pdraw_video_decoder_stats mStats;
+	/* Set while the decoder drains before applying the pending
+	 * parameter sets; the input frames are held meanwhile */
+	bool mReconfiguring;
+	uint64_t mReconfigureStartTime;
+	struct pomp_loop *mReconfigureLoop;
+	std::vector<struct avcdecoder_pending_input> mPendingInput;
+	bool mPendingInputLost;
+	uint8_t *mSps;
+	unsigned int mSpsSize;
+	uint8_t *mPps;
+	unsigned int mPpsSize;
+	uint8_t *mPendingSps;
+	unsigned int mPendingSpsSize;
+	uint8_t *mPendingPps;
+	unsigned int mPendingPpsSize;
+	unsigned int mWidth;
+	unsigned int mHeight;
+	bool mFirstFrameOutput;
 };
 
 } /* namespace Pdraw */
@@ -0,0 +1,752 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Color conversion
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_colorconv.hpp"
+#include <errno.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define PDRAW_COLORCONV_X86
+#  include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PDRAW_COLORCONV_NEON
+#  include <arm_neon.h>
+#endif
+#define ULOG_TAG pdraw_colorconv
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_colorconv);
+
+
+/**
+ * BT.601 limited range YUV to RGB, 6-bit fixed point:
+ * R = (74 * (Y - 16) + 102 * (V - 128)) >> 6
+ * G = (74 * (Y - 16) - 52 * (V - 128) - 25 * (U - 128)) >> 6
+ * B = (74 * (Y - 16) + 129 * (U - 128)) >> 6
+ * The intermediate values fit in 16 bits except for B which saturates
+ * in the SIMD kernels; the result is the same after clamping.
+ */
+#define COLORCONV_COEF_Y (74)
+#define COLORCONV_COEF_RV (102)
+#define COLORCONV_COEF_GV (52)
+#define COLORCONV_COEF_GU (25)
+#define COLORCONV_COEF_BU (129)
+
+
+/* Packed output pixel layouts of the row functions */
+enum colorconv_layout {
+	COLORCONV_LAYOUT_RGB = 0,
+	COLORCONV_LAYOUT_BGRA,
+	COLORCONV_LAYOUT_RGBA,
+};
+
+
+typedef void (*colorconv_row_func_t)(
+	const uint8_t *y,
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	uint8_t *dst,
+	unsigned int width,
+	enum colorconv_layout layout);
+
+
+static inline uint8_t clampPixel(
+	int val)
+{
+	return (val < 0) ? 0 : ((val > 255) ? 255 : (uint8_t)val);
+}
+
+
+static void yuvToRgbRowScalar(
+	const uint8_t *y,
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	uint8_t *dst,
+	unsigned int width,
+	enum colorconv_layout layout)
+{
+	unsigned int x;
+
+	for (x = 0; x < width; x++) {
+		int yy = COLORCONV_COEF_Y * ((int)y[x] - 16);
+		int uu = (int)u[(x / 2) * uvStep] - 128;
+		int vv = (int)v[(x / 2) * uvStep] - 128;
+		uint8_t r = clampPixel((yy + COLORCONV_COEF_RV * vv) >> 6);
+		uint8_t g = clampPixel((yy - COLORCONV_COEF_GV * vv -
+			COLORCONV_COEF_GU * uu) >> 6);
+		uint8_t b = clampPixel((yy + COLORCONV_COEF_BU * uu) >> 6);
+		switch (layout) {
+		case COLORCONV_LAYOUT_BGRA:
+			dst[0] = b;
+			dst[1] = g;
+			dst[2] = r;
+			dst[3] = 255;
+			dst += 4;
+			break;
+		case COLORCONV_LAYOUT_RGBA:
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			dst[3] = 255;
+			dst += 4;
+			break;
+		default:
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			dst += 3;
+			break;
+		}
+	}
+}
+
+
+#ifdef PDRAW_COLORCONV_X86
+
+/* Load 8 chroma samples for 16 pixels as 16-bit values minus 128 */
+__attribute__((target("ssse3")))
+static inline void loadChromaSse(
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	unsigned int x,
+	__m128i *u16,
+	__m128i *v16)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+
+	if (uvStep == 2) {
+		/* Semi-planar: u points to the interleaved UV plane */
+		__m128i uv = _mm_loadu_si128((const __m128i *)(u + x));
+		*u16 = _mm_and_si128(uv, _mm_set1_epi16(0x00ff));
+		*v16 = _mm_srli_epi16(uv, 8);
+	} else {
+		*u16 = _mm_unpacklo_epi8(
+			_mm_loadl_epi64((const __m128i *)(u + x / 2)), zero);
+		*v16 = _mm_unpacklo_epi8(
+			_mm_loadl_epi64((const __m128i *)(v + x / 2)), zero);
+	}
+	*u16 = _mm_sub_epi16(*u16, c128);
+	*v16 = _mm_sub_epi16(*v16, c128);
+}
+
+
+/* Interleave and store 16 pixels */
+__attribute__((target("ssse3")))
+static inline void storeRgbSse(
+	__m128i r8,
+	__m128i g8,
+	__m128i b8,
+	uint8_t *dst,
+	enum colorconv_layout layout)
+{
+	const __m128i alpha = _mm_set1_epi8((char)0xff);
+
+	if (layout == COLORCONV_LAYOUT_RGBA) {
+		/* Same interleaving as BGRA with R and B swapped */
+		__m128i tmp = r8;
+		r8 = b8;
+		b8 = tmp;
+	}
+
+	if (layout != COLORCONV_LAYOUT_RGB) {
+		__m128i bgLo = _mm_unpacklo_epi8(b8, g8);
+		__m128i bgHi = _mm_unpackhi_epi8(b8, g8);
+		__m128i raLo = _mm_unpacklo_epi8(r8, alpha);
+		__m128i raHi = _mm_unpackhi_epi8(r8, alpha);
+		_mm_storeu_si128((__m128i *)dst,
+			_mm_unpacklo_epi16(bgLo, raLo));
+		_mm_storeu_si128((__m128i *)(dst + 16),
+			_mm_unpackhi_epi16(bgLo, raLo));
+		_mm_storeu_si128((__m128i *)(dst + 32),
+			_mm_unpacklo_epi16(bgHi, raHi));
+		_mm_storeu_si128((__m128i *)(dst + 48),
+			_mm_unpackhi_epi16(bgHi, raHi));
+	} else {
+		/* RGBx then drop every 4th byte */
+		const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+			10, 12, 13, 14, -128, -128, -128, -128);
+		__m128i rgLo = _mm_unpacklo_epi8(r8, g8);
+		__m128i rgHi = _mm_unpackhi_epi8(r8, g8);
+		__m128i bxLo = _mm_unpacklo_epi8(b8, alpha);
+		__m128i bxHi = _mm_unpackhi_epi8(b8, alpha);
+		__m128i p0 = _mm_shuffle_epi8(
+			_mm_unpacklo_epi16(rgLo, bxLo), shuf);
+		__m128i p1 = _mm_shuffle_epi8(
+			_mm_unpackhi_epi16(rgLo, bxLo), shuf);
+		__m128i p2 = _mm_shuffle_epi8(
+			_mm_unpacklo_epi16(rgHi, bxHi), shuf);
+		__m128i p3 = _mm_shuffle_epi8(
+			_mm_unpackhi_epi16(rgHi, bxHi), shuf);
+		_mm_storeu_si128((__m128i *)dst,
+			_mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+		_mm_storeu_si128((__m128i *)(dst + 16),
+			_mm_or_si128(_mm_srli_si128(p1, 4),
+			_mm_slli_si128(p2, 8)));
+		_mm_storeu_si128((__m128i *)(dst + 32),
+			_mm_or_si128(_mm_srli_si128(p2, 8),
+			_mm_slli_si128(p3, 4)));
+	}
+}
+
+
+__attribute__((target("ssse3")))
+static void yuvToRgbRowSsse3(
+	const uint8_t *y,
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	uint8_t *dst,
+	unsigned int width,
+	enum colorconv_layout layout)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c16 = _mm_set1_epi16(16);
+	const __m128i cy = _mm_set1_epi16(COLORCONV_COEF_Y);
+	const __m128i crv = _mm_set1_epi16(COLORCONV_COEF_RV);
+	const __m128i cgv = _mm_set1_epi16(COLORCONV_COEF_GV);
+	const __m128i cgu = _mm_set1_epi16(COLORCONV_COEF_GU);
+	const __m128i cbu = _mm_set1_epi16(COLORCONV_COEF_BU);
+	unsigned int pixelSize = (layout == COLORCONV_LAYOUT_RGB) ? 3 : 4;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i u16, v16;
+		loadChromaSse(u, v, uvStep, x, &u16, &v16);
+		__m128i rc = _mm_mullo_epi16(v16, crv);
+		__m128i gc = _mm_add_epi16(_mm_mullo_epi16(v16, cgv),
+			_mm_mullo_epi16(u16, cgu));
+		__m128i bc = _mm_mullo_epi16(u16, cbu);
+
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+		__m128i yLo = _mm_mullo_epi16(_mm_sub_epi16(
+			_mm_unpacklo_epi8(y8, zero), c16), cy);
+		__m128i yHi = _mm_mullo_epi16(_mm_sub_epi16(
+			_mm_unpackhi_epi8(y8, zero), c16), cy);
+
+		/* Each chroma sample covers 2 pixels */
+		__m128i r8 = _mm_packus_epi16(
+			_mm_srai_epi16(_mm_adds_epi16(yLo,
+			_mm_unpacklo_epi16(rc, rc)), 6),
+			_mm_srai_epi16(_mm_adds_epi16(yHi,
+			_mm_unpackhi_epi16(rc, rc)), 6));
+		__m128i g8 = _mm_packus_epi16(
+			_mm_srai_epi16(_mm_subs_epi16(yLo,
+			_mm_unpacklo_epi16(gc, gc)), 6),
+			_mm_srai_epi16(_mm_subs_epi16(yHi,
+			_mm_unpackhi_epi16(gc, gc)), 6));
+		__m128i b8 = _mm_packus_epi16(
+			_mm_srai_epi16(_mm_adds_epi16(yLo,
+			_mm_unpacklo_epi16(bc, bc)), 6),
+			_mm_srai_epi16(_mm_adds_epi16(yHi,
+			_mm_unpackhi_epi16(bc, bc)), 6));
+
+		storeRgbSse(r8, g8, b8, dst + x * pixelSize, layout);
+	}
+
+	if (x < width) {
+		yuvToRgbRowScalar(y + x, u + (x / 2) * uvStep,
+			v + (x / 2) * uvStep, uvStep, dst + x * pixelSize,
+			width - x, layout);
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void yuvToRgbRowAvx2(
+	const uint8_t *y,
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	uint8_t *dst,
+	unsigned int width,
+	enum colorconv_layout layout)
+{
+	const __m256i c16 = _mm256_set1_epi16(16);
+	const __m256i cy = _mm256_set1_epi16(COLORCONV_COEF_Y);
+	const __m128i crv = _mm_set1_epi16(COLORCONV_COEF_RV);
+	const __m128i cgv = _mm_set1_epi16(COLORCONV_COEF_GV);
+	const __m128i cgu = _mm_set1_epi16(COLORCONV_COEF_GU);
+	const __m128i cbu = _mm_set1_epi16(COLORCONV_COEF_BU);
+	unsigned int pixelSize = (layout == COLORCONV_LAYOUT_RGB) ? 3 : 4;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i u16, v16;
+		loadChromaSse(u, v, uvStep, x, &u16, &v16);
+		__m128i rc = _mm_mullo_epi16(v16, crv);
+		__m128i gc = _mm_add_epi16(_mm_mullo_epi16(v16, cgv),
+			_mm_mullo_epi16(u16, cgu));
+		__m128i bc = _mm_mullo_epi16(u16, cbu);
+
+		/* 16 pixels per 256-bit register */
+		__m256i rc2 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_unpacklo_epi16(rc, rc)),
+			_mm_unpackhi_epi16(rc, rc), 1);
+		__m256i gc2 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_unpacklo_epi16(gc, gc)),
+			_mm_unpackhi_epi16(gc, gc), 1);
+		__m256i bc2 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_unpacklo_epi16(bc, bc)),
+			_mm_unpackhi_epi16(bc, bc), 1);
+		__m256i y16 = _mm256_mullo_epi16(_mm256_sub_epi16(
+			_mm256_cvtepu8_epi16(_mm_loadu_si128(
+			(const __m128i *)(y + x))), c16), cy);
+
+		__m256i r16 = _mm256_srai_epi16(
+			_mm256_adds_epi16(y16, rc2), 6);
+		__m256i g16 = _mm256_srai_epi16(
+			_mm256_subs_epi16(y16, gc2), 6);
+		__m256i b16 = _mm256_srai_epi16(
+			_mm256_adds_epi16(y16, bc2), 6);
+
+		__m128i r8 = _mm_packus_epi16(_mm256_castsi256_si128(r16),
+			_mm256_extracti128_si256(r16, 1));
+		__m128i g8 = _mm_packus_epi16(_mm256_castsi256_si128(g16),
+			_mm256_extracti128_si256(g16, 1));
+		__m128i b8 = _mm_packus_epi16(_mm256_castsi256_si128(b16),
+			_mm256_extracti128_si256(b16, 1));
+
+		storeRgbSse(r8, g8, b8, dst + x * pixelSize, layout);
+	}
+
+	if (x < width) {
+		yuvToRgbRowScalar(y + x, u + (x / 2) * uvStep,
+			v + (x / 2) * uvStep, uvStep, dst + x * pixelSize,
+			width - x, layout);
+	}
+}
+
+#endif /* PDRAW_COLORCONV_X86 */
+
+
+#ifdef PDRAW_COLORCONV_NEON
+
+static void yuvToRgbRowNeon(
+	const uint8_t *y,
+	const uint8_t *u,
+	const uint8_t *v,
+	unsigned int uvStep,
+	uint8_t *dst,
+	unsigned int width,
+	enum colorconv_layout layout)
+{
+	const int16x8_t c16 = vdupq_n_s16(16);
+	const int16x8_t c128 = vdupq_n_s16(128);
+	unsigned int pixelSize = (layout == COLORCONV_LAYOUT_RGB) ? 3 : 4;
+	unsigned int x;
+
+	for (x = 0; x + 16 <= width; x += 16) {
+		uint8x8_t u8, v8;
+		if (uvStep == 2) {
+			uint8x8x2_t uv = vld2_u8(u + x);
+			u8 = uv.val[0];
+			v8 = uv.val[1];
+		} else {
+			u8 = vld1_u8(u + x / 2);
+			v8 = vld1_u8(v + x / 2);
+		}
+		int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(
+			vmovl_u8(u8)), c128);
+		int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(
+			vmovl_u8(v8)), c128);
+		int16x8_t rc = vmulq_n_s16(v16, COLORCONV_COEF_RV);
+		int16x8_t gc = vaddq_s16(vmulq_n_s16(v16, COLORCONV_COEF_GV),
+			vmulq_n_s16(u16, COLORCONV_COEF_GU));
+		int16x8_t bc = vmulq_n_s16(u16, COLORCONV_COEF_BU);
+
+		/* Each chroma sample covers 2 pixels */
+		int16x8x2_t rc2 = vzipq_s16(rc, rc);
+		int16x8x2_t gc2 = vzipq_s16(gc, gc);
+		int16x8x2_t bc2 = vzipq_s16(bc, bc);
+
+		uint8x16_t y8 = vld1q_u8(y + x);
+		int16x8_t yLo = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(
+			vmovl_u8(vget_low_u8(y8))), c16), COLORCONV_COEF_Y);
+		int16x8_t yHi = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(
+			vmovl_u8(vget_high_u8(y8))), c16), COLORCONV_COEF_Y);
+
+		uint8x16_t r8 = vcombine_u8(
+			vqmovun_s16(vshrq_n_s16(vqaddq_s16(yLo, rc2.val[0]), 6)),
+			vqmovun_s16(vshrq_n_s16(vqaddq_s16(yHi, rc2.val[1]), 6)));
+		uint8x16_t g8 = vcombine_u8(
+			vqmovun_s16(vshrq_n_s16(vqsubq_s16(yLo, gc2.val[0]), 6)),
+			vqmovun_s16(vshrq_n_s16(vqsubq_s16(yHi, gc2.val[1]), 6)));
+		uint8x16_t b8 = vcombine_u8(
+			vqmovun_s16(vshrq_n_s16(vqaddq_s16(yLo, bc2.val[0]), 6)),
+			vqmovun_s16(vshrq_n_s16(vqaddq_s16(yHi, bc2.val[1]), 6)));
+
+		if (layout != COLORCONV_LAYOUT_RGB) {
+			bool rgba = (layout == COLORCONV_LAYOUT_RGBA);
+			uint8x16x4_t out;
+			out.val[0] = (rgba) ? r8 : b8;
+			out.val[1] = g8;
+			out.val[2] = (rgba) ? b8 : r8;
+			out.val[3] = vdupq_n_u8(255);
+			vst4q_u8(dst + x * pixelSize, out);
+		} else {
+			uint8x16x3_t out;
+			out.val[0] = r8;
+			out.val[1] = g8;
+			out.val[2] = b8;
+			vst3q_u8(dst + x * pixelSize, out);
+		}
+	}
+
+	if (x < width) {
+		yuvToRgbRowScalar(y + x, u + (x / 2) * uvStep,
+			v + (x / 2) * uvStep, uvStep, dst + x * pixelSize,
+			width - x, layout);
+	}
+}
+
+#endif /* PDRAW_COLORCONV_NEON */
+
+
+static enum pdraw_colorconv_impl detectImpl(
+	void)
+{
+#if defined(PDRAW_COLORCONV_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return PDRAW_COLORCONV_IMPL_AVX2;
+	if (__builtin_cpu_supports("ssse3"))
+		return PDRAW_COLORCONV_IMPL_SSSE3;
+#elif defined(PDRAW_COLORCONV_NEON)
+	return PDRAW_COLORCONV_IMPL_NEON;
+#endif
+	return PDRAW_COLORCONV_IMPL_SCALAR;
+}
+
+
+enum pdraw_colorconv_impl pdraw_colorConvGetImpl(
+	void)
+{
+	static int impl = -1;
+
+	if (impl < 0) {
+		impl = (int)detectImpl();
+		ULOGI("color conversion implementation: %s",
+			pdraw_colorConvImplStr(
+			(enum pdraw_colorconv_impl)impl));
+	}
+
+	return (enum pdraw_colorconv_impl)impl;
+}
+
+
+bool pdraw_colorConvIsImplSupported(
+	enum pdraw_colorconv_impl impl)
+{
+	enum pdraw_colorconv_impl best = pdraw_colorConvGetImpl();
+
+	switch (impl) {
+	case PDRAW_COLORCONV_IMPL_SCALAR:
+		return true;
+	case PDRAW_COLORCONV_IMPL_SSSE3:
+		return (best == PDRAW_COLORCONV_IMPL_SSSE3) ||
+			(best == PDRAW_COLORCONV_IMPL_AVX2);
+	case PDRAW_COLORCONV_IMPL_AVX2:
+		return (best == PDRAW_COLORCONV_IMPL_AVX2);
+	case PDRAW_COLORCONV_IMPL_NEON:
+		return (best == PDRAW_COLORCONV_IMPL_NEON);
+	default:
+		return false;
+	}
+}
+
+
+const char *pdraw_colorConvImplStr(
+	enum pdraw_colorconv_impl impl)
+{
+	switch (impl) {
+	case PDRAW_COLORCONV_IMPL_SCALAR:
+		return "scalar";
+	case PDRAW_COLORCONV_IMPL_SSSE3:
+		return "ssse3";
+	case PDRAW_COLORCONV_IMPL_AVX2:
+		return "avx2";
+	case PDRAW_COLORCONV_IMPL_NEON:
+		return "neon";
+	default:
+		return "unknown";
+	}
+}
+
+
+static colorconv_row_func_t getRowFunc(
+	enum pdraw_colorconv_impl impl)
+{
+	if (!pdraw_colorConvIsImplSupported(impl))
+		return &yuvToRgbRowScalar;
+
+	switch (impl) {
+#if defined(PDRAW_COLORCONV_X86)
+	case PDRAW_COLORCONV_IMPL_SSSE3:
+		return &yuvToRgbRowSsse3;
+	case PDRAW_COLORCONV_IMPL_AVX2:
+		return &yuvToRgbRowAvx2;
+#elif defined(PDRAW_COLORCONV_NEON)
+	case PDRAW_COLORCONV_IMPL_NEON:
+		return &yuvToRgbRowNeon;
+#endif
+	default:
+		return &yuvToRgbRowScalar;
+	}
+}
+
+
+bool pdraw_colorConvIsFormatSupported(
+	enum pdraw_color_format format)
+{
+	switch (format) {
+	case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+	case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+	case PDRAW_COLOR_FORMAT_RGB24:
+	case PDRAW_COLOR_FORMAT_BGRA:
+	case PDRAW_COLOR_FORMAT_GRAY8:
+	case PDRAW_COLOR_FORMAT_RGBA:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+size_t pdraw_colorConvGetFrameSize(
+	enum pdraw_color_format format,
+	unsigned int width,
+	unsigned int height)
+{
+	size_t chromaSize = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+
+	switch (format) {
+	case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+	case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+		return (size_t)width * height + 2 * chromaSize;
+	case PDRAW_COLOR_FORMAT_RGB24:
+		return (size_t)width * height * 3;
+	case PDRAW_COLOR_FORMAT_BGRA:
+	case PDRAW_COLOR_FORMAT_RGBA:
+		return (size_t)width * height * 4;
+	case PDRAW_COLOR_FORMAT_GRAY8:
+		return (size_t)width * height;
+	default:
+		return 0;
+	}
+}
+
+
+int pdraw_colorConvRows(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int y,
+	unsigned int rowCount,
+	enum pdraw_color_format dstFormat,
+	uint8_t *dst,
+	unsigned int dstStride,
+	enum pdraw_colorconv_impl impl)
+{
+	enum colorconv_layout layout;
+	colorconv_row_func_t rowFunc;
+	bool srcSemiPlanar;
+	const uint8_t *srcY, *srcU, *srcV;
+	unsigned int srcUvStep, end;
+
+	if ((srcFrame == NULL) || (dst == NULL))
+		return -EINVAL;
+	if ((srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR) &&
+		(srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR))
+		return -ENOSYS;
+	switch (dstFormat) {
+	case PDRAW_COLOR_FORMAT_RGB24:
+		layout = COLORCONV_LAYOUT_RGB;
+		break;
+	case PDRAW_COLOR_FORMAT_BGRA:
+		layout = COLORCONV_LAYOUT_BGRA;
+		break;
+	case PDRAW_COLOR_FORMAT_RGBA:
+		layout = COLORCONV_LAYOUT_RGBA;
+		break;
+	default:
+		return -ENOSYS;
+	}
+	if (y + rowCount > srcFrame->height)
+		return -ERANGE;
+
+	srcSemiPlanar =
+		(srcFrame->colorFormat == PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR);
+	srcY = srcFrame->plane[0];
+	srcU = srcFrame->plane[1];
+	srcV = (srcSemiPlanar) ? srcFrame->plane[1] + 1 : srcFrame->plane[2];
+	srcUvStep = (srcSemiPlanar) ? 2 : 1;
+	rowFunc = getRowFunc(impl);
+
+	for (end = y + rowCount; y < end; y++) {
+		size_t uOffset = (size_t)(y / 2) * srcFrame->stride[1];
+		size_t vOffset = (srcSemiPlanar) ? uOffset :
+			(size_t)(y / 2) * srcFrame->stride[2];
+		rowFunc(srcY + (size_t)y * srcFrame->stride[0],
+			srcU + uOffset, srcV + vOffset, srcUvStep, dst,
+			srcFrame->width, layout);
+		dst += dstStride;
+	}
+
+	return 0;
+}
+
+
+int pdraw_colorConvFrame(
+	const struct pdraw_video_frame *srcFrame,
+	enum pdraw_color_format dstFormat,
+	uint8_t *dst,
+	size_t dstSize,
+	struct pdraw_video_frame *dstFrame,
+	enum pdraw_colorconv_impl impl)
+{
+	unsigned int width, height, chromaWidth, y, x;
+	bool srcSemiPlanar;
+	const uint8_t *srcY, *srcU, *srcV;
+	int ret;
+
+	if ((srcFrame == NULL) || (dst == NULL) || (dstFrame == NULL))
+		return -EINVAL;
+	if ((srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR) &&
+		(srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR))
+		return -ENOSYS;
+	if (!pdraw_colorConvIsFormatSupported(dstFormat))
+		return -ENOSYS;
+
+	width = srcFrame->width;
+	height = srcFrame->height;
+	chromaWidth = (width + 1) / 2;
+	if (dstSize < pdraw_colorConvGetFrameSize(dstFormat, width, height))
+		return -ENOBUFS;
+
+	srcSemiPlanar =
+		(srcFrame->colorFormat == PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR);
+	srcY = srcFrame->plane[0];
+	srcU = srcFrame->plane[1];
+	srcV = (srcSemiPlanar) ? srcFrame->plane[1] + 1 : srcFrame->plane[2];
+
+	/* Before dstFrame is updated, it can be srcFrame */
+	if ((dstFormat == PDRAW_COLOR_FORMAT_RGB24) ||
+		(dstFormat == PDRAW_COLOR_FORMAT_BGRA) ||
+		(dstFormat == PDRAW_COLOR_FORMAT_RGBA)) {
+		ret = pdraw_colorConvRows(srcFrame, 0, height, dstFormat,
+			dst, width * ((dstFormat ==
+			PDRAW_COLOR_FORMAT_RGB24) ? 3 : 4), impl);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (dstFrame != srcFrame)
+		memcpy(dstFrame, srcFrame, sizeof(*dstFrame));
+	dstFrame->colorFormat = dstFormat;
+	dstFrame->plane[0] = dst;
+	dstFrame->plane[1] = NULL;
+	dstFrame->plane[2] = NULL;
+	dstFrame->stride[1] = 0;
+	dstFrame->stride[2] = 0;
+
+	switch (dstFormat) {
+	case PDRAW_COLOR_FORMAT_RGB24:
+	case PDRAW_COLOR_FORMAT_BGRA:
+	case PDRAW_COLOR_FORMAT_RGBA:
+		dstFrame->stride[0] = width *
+			((dstFormat == PDRAW_COLOR_FORMAT_RGB24) ? 3 : 4);
+		break;
+	case PDRAW_COLOR_FORMAT_GRAY8:
+		dstFrame->stride[0] = width;
+		for (y = 0; y < height; y++) {
+			memcpy(dst + (size_t)y * width,
+				srcY + (size_t)y * srcFrame->stride[0], width);
+		}
+		break;
+	case PDRAW_COLOR_FORMAT_YUV420PLANAR: {
+		uint8_t *dstU = dst + (size_t)width * height;
+		uint8_t *dstV = dstU + (size_t)chromaWidth * ((height + 1) / 2);
+		dstFrame->plane[1] = dstU;
+		dstFrame->plane[2] = dstV;
+		dstFrame->stride[0] = width;
+		dstFrame->stride[1] = chromaWidth;
+		dstFrame->stride[2] = chromaWidth;
+		for (y = 0; y < height; y++) {
+			memcpy(dst + (size_t)y * width,
+				srcY + (size_t)y * srcFrame->stride[0], width);
+		}
+		for (y = 0; y < (height + 1) / 2; y++) {
+			const uint8_t *pU = srcU + (size_t)y * srcFrame->stride[1];
+			const uint8_t *pV = srcV + (size_t)y * srcFrame->stride[1];
+			uint8_t *pDstU = dstU + (size_t)y * chromaWidth;
+			uint8_t *pDstV = dstV + (size_t)y * chromaWidth;
+			if (!srcSemiPlanar) {
+				pV = srcV + (size_t)y * srcFrame->stride[2];
+				memcpy(pDstU, pU, chromaWidth);
+				memcpy(pDstV, pV, chromaWidth);
+				continue;
+			}
+			for (x = 0; x < chromaWidth; x++) {
+				pDstU[x] = pU[2 * x];
+				pDstV[x] = pV[2 * x];
+			}
+		}
+		break;
+	}
+	case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR: {
+		uint8_t *dstUv = dst + (size_t)width * height;
+		dstFrame->plane[1] = dstUv;
+		dstFrame->stride[0] = width;
+		dstFrame->stride[1] = chromaWidth * 2;
+		for (y = 0; y < height; y++) {
+			memcpy(dst + (size_t)y * width,
+				srcY + (size_t)y * srcFrame->stride[0], width);
+		}
+		for (y = 0; y < (height + 1) / 2; y++) {
+			const uint8_t *pU = srcU + (size_t)y * srcFrame->stride[1];
+			const uint8_t *pV;
+			uint8_t *pDstUv = dstUv + (size_t)y * chromaWidth * 2;
+			if (srcSemiPlanar) {
+				memcpy(pDstUv, pU, chromaWidth * 2);
+				continue;
+			}
+			pV = srcV + (size_t)y * srcFrame->stride[2];
+			for (x = 0; x < chromaWidth; x++) {
+				pDstUv[2 * x] = pU[x];
+				pDstUv[2 * x + 1] = pV[x];
+			}
+		}
+		break;
+	}
+	default:
+		return -ENOSYS;
+	}
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Color conversion
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_COLORCONV_HPP_
+#define _PDRAW_COLORCONV_HPP_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <pdraw/pdraw_defs.h>
+
+
+enum pdraw_colorconv_impl {
+	PDRAW_COLORCONV_IMPL_SCALAR = 0,
+	PDRAW_COLORCONV_IMPL_SSSE3,
+	PDRAW_COLORCONV_IMPL_AVX2,
+	PDRAW_COLORCONV_IMPL_NEON,
+};
+
+
+/* Best implementation available on the running CPU */
+enum pdraw_colorconv_impl pdraw_colorConvGetImpl(
+	void);
+
+
+bool pdraw_colorConvIsImplSupported(
+	enum pdraw_colorconv_impl impl);
+
+
+const char *pdraw_colorConvImplStr(
+	enum pdraw_colorconv_impl impl);
+
+
+bool pdraw_colorConvIsFormatSupported(
+	enum pdraw_color_format format);
+
+
+/* Size of a tightly packed frame; 0 if the format is not supported */
+size_t pdraw_colorConvGetFrameSize(
+	enum pdraw_color_format format,
+	unsigned int width,
+	unsigned int height);
+
+
+/**
+ * Convert the rows [y, y + rowCount) of a YUV420 planar or semi-planar
+ * frame to a packed RGB24, BGRA or RGBA format; the output rows are
+ * written dstStride bytes apart from dst
+ */
+int pdraw_colorConvRows(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int y,
+	unsigned int rowCount,
+	enum pdraw_color_format dstFormat,
+	uint8_t *dst,
+	unsigned int dstStride,
+	enum pdraw_colorconv_impl impl);
+
+
+/**
+ * Convert a YUV420 planar or semi-planar frame in a single pass over
+ * the rows of the source; the output is tightly packed in dst and
+ * dstFrame is a copy of srcFrame with the format, planes and strides
+ * of the output
+ */
+int pdraw_colorConvFrame(
+	const struct pdraw_video_frame *srcFrame,
+	enum pdraw_color_format dstFormat,
+	uint8_t *dst,
+	size_t dstSize,
+	struct pdraw_video_frame *dstFrame,
+	enum pdraw_colorconv_impl impl);
+
+
+#endif /* !_PDRAW_COLORCONV_HPP_ */
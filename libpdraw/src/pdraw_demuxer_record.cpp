@@ -29,6 +29,7 @@
 
 #include "pdraw_demuxer_record.hpp"
 #include "pdraw_session.hpp"
+#include "pdraw_media_video.hpp"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -669,11 +670,13 @@ int RecordDemuxer::openAvcDecoder(
 	memcpy(ppsBuffer, &start, sizeof(uint32_t));
 	memcpy(ppsBuffer + 4, pps, ppsSize);
 
-	ret = demuxer->mDecoder->open(demuxer->mDecoderBitstreamFormat,
+	/* The decoder may already be configured if reused from the
+	 * warm pool */
+	ret = demuxer->mDecoder->reconfigure(demuxer->mDecoderBitstreamFormat,
 		spsBuffer, (unsigned int)spsSize + 4,
 		ppsBuffer, (unsigned int)ppsSize + 4);
 	if (ret < 0) {
-		ULOG_ERRNO("decoder->open", -ret);
+		ULOG_ERRNO("decoder->reconfigure", -ret);
 		free(spsBuffer);
 		free(ppsBuffer);
 		return ret;
@@ -699,10 +702,12 @@ void RecordDemuxer::timerCb(
 	void *userdata)
 {
 	RecordDemuxer *demuxer = (RecordDemuxer *)userdata;
-	bool silent = false;
+	bool silent = false, isRef = false, isIdr = false;
+	uint8_t naluType;
 	float speed = 1.0;
 	struct mp4_track_sample sample;
 	struct avcdecoder_input_buffer *data = NULL;
+	VideoMedia *vm;
 	uint8_t *buf = NULL, *_buf, *sei = NULL;
 	size_t bufSize = 0, outSize = 0, offset = 0, naluSize = 0, seiSize = 0;
 	struct timespec t1;
@@ -738,6 +743,16 @@ void RecordDemuxer::timerCb(
 		}
 	}
 
+	/* The decoder input queue and pool change when the decoder
+	 * completes a reconfiguration with a new instance */
+	if ((!demuxer->mFirstFrame) && (demuxer->mDecoder->isConfigured())) {
+		ret = demuxer->mDecoder->getInputSource(
+			demuxer->mDecoder->getMedia(),
+			&demuxer->mDecoderSource);
+		if (ret < 0)
+			ULOG_ERRNO("decoder->getInputSource", -ret);
+	}
+
 	if (demuxer->mDecoderSource.pool == NULL) {
 		ULOGE("decoder is not configured");
 		retry = 1;
@@ -820,9 +835,17 @@ void RecordDemuxer::timerCb(
 		if (demuxer->mDecoderBitstreamFormat ==
 			AVCDECODER_BITSTREAM_FORMAT_BYTE_STREAM)
 			memcpy(_buf, &start, sizeof(uint32_t));
-		if (*(_buf + 4) == 0x06) {
+		naluType = *(_buf + 4) & 0x1F;
+		if (naluType == 0x06) {
 			sei = _buf + 4;
 			seiSize = naluSize;
+		} else if ((naluType == 0x01) || (naluType == 0x05)) {
+			/* Slice NAL unit: nal_ref_idc != 0
+			 * for reference frames */
+			if (*(_buf + 4) & 0x60)
+				isRef = true;
+			if (naluType == 0x05)
+				isIdr = true;
 		}
 		_buf += 4 + naluSize;
 		offset += 4 + naluSize;
@@ -847,7 +870,8 @@ void RecordDemuxer::timerCb(
 	}
 	data->isComplete = true; /* TODO? */
 	data->hasErrors = false; /* TODO? */
-	data->isRef = true; /* TODO? */
+	data->isRef = isRef;
+	data->isIdr = isIdr;
 	data->isSilent = silent;
 	data->auNtpTimestamp = sample.sample_dts;
 	data->auNtpTimestampRaw = sample.sample_dts;
@@ -865,6 +889,16 @@ void RecordDemuxer::timerCb(
 	data->auNtpTimestampLocal = data->demuxOutputTimestamp;
 	demuxer->mCurrentTime = sample.sample_dts;
 
+	/* Metadata subscribers */
+	vm = demuxer->mDecoder->getVideoMedia();
+	if ((!silent) && (vm != NULL) && (vm->hasMetadataSubscribers(
+		PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER))) {
+		struct pdraw_video_frame_metadata meta;
+		VideoMedia::getFrameMetadata(data, &meta);
+		vm->notifyFrameMetadata(
+			PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER, &meta);
+	}
+
 	/* Queue the buffer for decoding */
 	ret = vbuf_write_lock(demuxer->mCurrentBuffer);
 	if (ret < 0)
@@ -708,8 +708,7 @@ int StreamDemuxer::setElementaryStreamDecoder(
 		return -ENOSYS;
 	}
 
-	if ((mCodecInfo.codec == VSTRM_CODEC_VIDEO_H264) &&
-		(!mDecoder->isConfigured())) {
+	if (mCodecInfo.codec == VSTRM_CODEC_VIDEO_H264) {
 		int ret = openDecoder(this);
 		if (ret < 0)
 			ULOG_ERRNO("openDecoder", -ret);
@@ -1003,12 +1002,13 @@ int StreamDemuxer::openDecoder(
 	memcpy(pps_buf, &start, sizeof(uint32_t));
 	memcpy(pps_buf + 4, info->h264.pps, info->h264.ppslen);
 
-	ret = demuxer->mDecoder->open(
+	/* Reconfigure the decoder in place if it is already running */
+	ret = demuxer->mDecoder->reconfigure(
 		demuxer->mDecoderBitstreamFormat,
 		sps_buf, info->h264.spslen + 4,
 		pps_buf, info->h264.ppslen + 4);
 	if (ret < 0) {
-		ULOG_ERRNO("decoder->open", -ret);
+		ULOG_ERRNO("decoder->reconfigure", -ret);
 		free(sps_buf);
 		free(pps_buf);
 		return ret;
@@ -1178,8 +1178,7 @@ void StreamDemuxer::codecInfoChangedCb(
 		return;
 	}
 
-	if ((demuxer->mDecoder != NULL) &&
-		(!demuxer->mDecoder->isConfigured())) {
+	if (demuxer->mDecoder != NULL) {
 		ret = openDecoder(demuxer);
 		if (ret < 0)
 			ULOG_ERRNO("openDecoder", -ret);
@@ -1187,6 +1186,43 @@ void StreamDemuxer::codecInfoChangedCb(
 }
 
 
+void StreamDemuxer::notifyFrameMetadata(
+	struct vstrm_frame *frame)
+{
+	VideoMedia *media = mDecoder->getVideoMedia();
+	if ((media == NULL) || (!media->hasMetadataSubscribers(
+		PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER)))
+		return;
+
+	struct pdraw_video_frame_metadata meta;
+	struct timespec ts;
+	unsigned int i;
+	memset(&meta, 0, sizeof(meta));
+	meta.isComplete = (frame->info.complete) ? 1 : 0;
+	meta.hasErrors = (frame->info.error) ? 1 : 0;
+	meta.isRef = (frame->info.ref) ? 1 : 0;
+	for (i = 0; i < frame->nalu_count; i++) {
+		if ((*frame->nalus[i].cdata & 0x1F) == 0x05) {
+			meta.isIdr = 1;
+			break;
+		}
+	}
+	meta.auNtpTimestamp = frame->timestamp;
+	meta.auNtpTimestampRaw = frame->timestamp;
+	meta.auNtpTimestampLocal = frame->timestamp;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	meta.demuxOutputTimestamp =
+		(uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+	if (frame->metadata.type == VMETA_FRAME_TYPE_V2) {
+		meta.hasMetadata = 1;
+		meta.metadata = frame->metadata.v2;
+	}
+
+	media->notifyFrameMetadata(
+		PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER, &meta);
+}
+
+
 void StreamDemuxer::recvFrameCb(
 	struct vstrm_receiver *stream,
 	struct vstrm_frame *frame,
@@ -1208,6 +1244,20 @@ void StreamDemuxer::recvFrameCb(
 		ULOGD("no decoder configured");
 		return;
 	}
+
+	/* Metadata subscribers (also for frames not decoded) */
+	demuxer->notifyFrameMetadata(frame);
+
+	/* The decoder input queue and pool change when the decoder
+	 * completes a reconfiguration with a new instance */
+	if (demuxer->mDecoder->isConfigured()) {
+		ret = demuxer->mDecoder->getInputSource(
+			demuxer->mDecoder->getMedia(),
+			&demuxer->mDecoderSource);
+		if (ret < 0)
+			ULOG_ERRNO("decoder->getInputSource", -ret);
+	}
+
 	if (demuxer->mDecoderSource.pool == NULL) {
 		ULOGD("decoder is not configured");
 		return;
@@ -1298,6 +1348,15 @@ void StreamDemuxer::recvFrameCb(
 		(uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
 	data->demuxOutputTimestamp = curTime;
 
+	/* IDR frame */
+	for (i = 0; i < frame->nalu_count; i++) {
+		uint8_t nalu_header = *frame->nalus[i].cdata;
+		if ((nalu_header & 0x1F) == 0x05) {
+			data->isIdr = true;
+			break;
+		}
+	}
+
 	/* User data */
 	vbuf_set_userdata_size(buffer, 0);
 	for (i = 0; i < frame->nalu_count; i++) {
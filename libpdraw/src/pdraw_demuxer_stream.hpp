@@ -225,6 +225,9 @@ private:
 	static int openDecoder(
 		StreamDemuxer *demuxer);
 
+	void notifyFrameMetadata(
+		struct vstrm_frame *frame);
+
 	static void h264UserDataSeiCb(
 		struct h264_ctx *ctx,
 		const uint8_t *buf,
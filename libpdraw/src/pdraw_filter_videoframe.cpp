@@ -33,11 +33,17 @@
 #include "pdraw_demuxer.hpp"
 #include <sys/time.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <time.h>
+#ifdef __linux__
+#  include <sys/eventfd.h>
+#endif
 #define ULOG_TAG pdraw_filtrfrm
 #include <ulog.h>
 ULOG_DECLARE_TAG(pdraw_filtrfrm);
 
+#include <algorithm>
+
 namespace Pdraw {
 
 
@@ -46,8 +52,9 @@ namespace Pdraw {
 
 VideoFrameFilter::VideoFrameFilter(
 	VideoMedia *media,
-	bool frameByFrame) :
-	VideoFrameFilter(media, NULL, NULL, frameByFrame)
+	bool frameByFrame,
+	bool copy) :
+	VideoFrameFilter(media, NULL, NULL, frameByFrame, copy, false)
 {
 }
 
@@ -56,29 +63,52 @@ VideoFrameFilter::VideoFrameFilter(
 	VideoMedia *media,
 	pdraw_video_frame_filter_callback_t cb,
 	void *userPtr,
-	bool frameByFrame)
+	bool frameByFrame,
+	bool copy,
+	bool parallel)
 {
 	int ret;
+	pthread_condattr_t attr;
 
 	mMedia = (Media*)media;
 	mQueue = NULL;
-	mThreadLaunched = false;
+	mPool = NULL;
 	mThreadShouldStop = false;
 	mFrameByFrame = frameByFrame;
+	mCopy = copy;
+	/* Consecutive frames can only be processed in parallel by
+	 * callbacks, producers need them in order */
+	mParallel = (parallel) && (cb != NULL);
+	mScheduled = false;
+	mStalled = false;
+	mStallStartTime = 0;
+	mNotifyCount = 0;
+	mTaskCount = 0;
 	mCb = cb;
 	mUserPtr = userPtr;
-	mBuffer[0] = NULL;
-	mBuffer[1] = NULL;
-	mUserData[0] = NULL;
-	mUserData[1] = NULL;
-	mUserDataBuferSize[0] = 0;
-	mUserDataBuferSize[1] = 0;
-	mBufferIndex = 0;
+	mPolicy = VIDEO_FRAME_FILTER_DEFAULT_POLICY;
+	mDepth = VIDEO_FRAME_FILTER_DEFAULT_DEPTH;
+	mEntryCount = 0;
+	mConsumerEntry = NULL;
 	mColorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+	mFormatChangePending = false;
+	mOutputFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+	mScalingEnabled = false;
+	memset(&mScaling, 0, sizeof(mScaling));
+	mColorConvImpl = pdraw_colorConvGetImpl();
 	mWidth = 0;
 	mHeight = 0;
-	mFrameAvailable = false;
+	mSequenceNumber = 0;
+	memset(&mStats, 0, sizeof(mStats));
+	memset(&mFilterStats, 0, sizeof(mFilterStats));
+	mTotalProcessTime = 0;
 	mCondition = PTHREAD_COND_INITIALIZER;
+	mTaskCondition = PTHREAD_COND_INITIALIZER;
+	mEventFd[0] = -1;
+	mEventFd[1] = -1;
+	mEventSignaled = false;
+	mLegacyRef = NULL;
+	mFrameRefCount = 0;
 
 	if (media == NULL) {
 		ULOGE("invalid media");
@@ -97,13 +127,36 @@ VideoFrameFilter::VideoFrameFilter(
 		return;
 	}
 
-	ret = pthread_create(&mThread, NULL, runThread, (void*)this);
-	if (ret < 0) {
-		ULOG_ERRNO("pthread_create", -ret);
+	/* Timeouts must not depend on wall clock changes */
+	ret = pthread_condattr_init(&attr);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_condattr_init", ret);
+		return;
+	}
+	ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if (ret != 0)
+		ULOG_ERRNO("pthread_condattr_setclock", ret);
+	ret = pthread_cond_init(&mCondition, &attr);
+	pthread_condattr_destroy(&attr);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_cond_init", ret);
 		return;
 	}
 
-	mThreadLaunched = true;
+	if (cb == NULL) {
+		ret = createEventFd();
+		if (ret < 0) {
+			ULOG_ERRNO("createEventFd", -ret);
+			return;
+		}
+	}
+
+	/* Frames are processed on the shared worker pool */
+	mPool = WorkerPool::get();
+	if (mPool == NULL) {
+		ULOGE("failed to get the worker pool");
+		return;
+	}
 }
 
 
@@ -111,16 +164,29 @@ VideoFrameFilter::~VideoFrameFilter(
 	void)
 {
 	int ret;
+	std::vector<struct vbuf_buffer *> released;
+
+	/* Stop the decoder output to this filter; the decoder drops the
+	 * frames it accounts as held by the filter */
+	AvcDecoder *decoder = (mMedia != NULL) ?
+		(AvcDecoder *)mMedia->getDecoder() : NULL;
+	if ((decoder != NULL) && (mQueue != NULL)) {
+		ret = decoder->removeOutputSink(mMedia, mQueue);
+		if ((ret < 0) && (ret != -ENOENT))
+			ULOG_ERRNO("decoder->removeOutputSink", -ret);
+	}
 
+	/* Wait for the queued and running tasks */
+	pthread_mutex_lock(&mMutex);
 	mThreadShouldStop = true;
+	while (mTaskCount > 0)
+		pthread_cond_wait(&mTaskCondition, &mMutex);
+	pthread_mutex_unlock(&mMutex);
 	if (mQueue != NULL)
 		vbuf_queue_abort(mQueue);
 
-	if (mThreadLaunched) {
-		ret = pthread_join(mThread, NULL);
-		if (ret < 0)
-			ULOG_ERRNO("pthread_join", -ret);
-	}
+	WorkerPool::put(mPool);
+	mPool = NULL;
 
 	/**
 	 * this will not be sufficient if another thread gets a frame and
@@ -128,10 +194,30 @@ VideoFrameFilter::~VideoFrameFilter(
 	 * getting a frame
 	 */
 	pthread_mutex_lock(&mMutex);
-	mFrameAvailable = false;
+	while (!mPending.empty()) {
+		struct videoframefilter_ring_entry *entry = mPending.front();
+		mPending.pop_front();
+		if (entry->buffer != NULL)
+			released.push_back(entry->buffer);
+		entry->buffer = NULL;
+		mFree.push_back(entry);
+	}
 	pthread_cond_broadcast(&mCondition);
 	pthread_mutex_unlock(&mMutex);
 
+	releaseBuffers(&released);
+
+	if (mLegacyRef != NULL) {
+		ret = releaseFrame(mLegacyRef);
+		if (ret < 0)
+			ULOG_ERRNO("releaseFrame", -ret);
+		mLegacyRef = NULL;
+	}
+	if (mFrameRefCount > 0) {
+		ULOGW("%u frame references still held by the application",
+			mFrameRefCount);
+	}
+
 	if (mQueue != NULL) {
 		ret = vbuf_queue_destroy(mQueue);
 		if (ret < 0)
@@ -139,10 +225,30 @@ VideoFrameFilter::~VideoFrameFilter(
 		mQueue = NULL;
 	}
 
-	free(mBuffer[0]);
-	free(mBuffer[1]);
-	free(mUserData[0]);
-	free(mUserData[1]);
+	std::vector<struct videoframefilter_ring_entry *>::iterator e =
+		mFree.begin();
+	while (e != mFree.end()) {
+		freeEntry(*e);
+		e++;
+	}
+	mFree.clear();
+	e = mScratch.begin();
+	while (e != mScratch.end()) {
+		freeEntry(*e);
+		e++;
+	}
+	mScratch.clear();
+	e = mHeldEntries.begin();
+	while (e != mHeldEntries.end()) {
+		freeEntry(*e);
+		e++;
+	}
+	mHeldEntries.clear();
+	if (mConsumerEntry != NULL)
+		freeEntry(mConsumerEntry);
+	mConsumerEntry = NULL;
+
+	destroyEventFd();
 
 	pthread_mutex_destroy(&mMutex);
 }
@@ -167,24 +273,149 @@ int VideoFrameFilter::getInputSourceQueue(
 }
 
 
+int VideoFrameFilter::createEventFd(
+	void)
+{
+#ifdef __linux__
+	mEventFd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (mEventFd[0] < 0)
+		return -errno;
+	mEventFd[1] = mEventFd[0];
+#else
+	int i;
+	if (pipe(mEventFd) < 0)
+		return -errno;
+	for (i = 0; i < 2; i++) {
+		fcntl(mEventFd[i], F_SETFL,
+			fcntl(mEventFd[i], F_GETFL) | O_NONBLOCK);
+		fcntl(mEventFd[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+
+	return 0;
+}
+
+
+void VideoFrameFilter::destroyEventFd(
+	void)
+{
+	if (mEventFd[0] >= 0)
+		close(mEventFd[0]);
+	if ((mEventFd[1] >= 0) && (mEventFd[1] != mEventFd[0]))
+		close(mEventFd[1]);
+	mEventFd[0] = -1;
+	mEventFd[1] = -1;
+}
+
+
+void VideoFrameFilter::updateEventLocked(
+	void)
+{
+	ssize_t res;
+	bool signal = !mPending.empty();
+
+	/* Must be called with mMutex held; the fd is readable as long as
+	 * frames are pending (level-triggered) */
+	if ((mEventFd[0] < 0) || (signal == mEventSignaled))
+		return;
+
+	if (signal) {
+#ifdef __linux__
+		uint64_t val = 1;
+#else
+		uint8_t val = 1;
+#endif
+		do {
+			res = write(mEventFd[1], &val, sizeof(val));
+		} while ((res < 0) && (errno == EINTR));
+		if (res < 0)
+			ULOG_ERRNO("write", errno);
+	} else {
+		uint64_t val;
+		do {
+			res = read(mEventFd[0], &val, sizeof(val));
+		} while ((res > 0) || ((res < 0) && (errno == EINTR)));
+	}
+	mEventSignaled = signal;
+}
+
+
+int VideoFrameFilter::getEventFd(
+	void)
+{
+	if (mCb != NULL) {
+		ULOGE("unsupported in callback mode");
+		return -ENOSYS;
+	}
+	if (mEventFd[0] < 0)
+		return -EPROTO;
+
+	return mEventFd[0];
+}
+
+
 static void getTimeFromTimeout(
 	struct timespec* ts,
 	int timeout)
 {
-	struct timeval tp;
-	gettimeofday(&tp, NULL);
+	/* mCondition uses the monotonic clock */
+	clock_gettime(CLOCK_MONOTONIC, ts);
 
-	ts->tv_sec = tp.tv_sec;
-	ts->tv_nsec = tp.tv_usec * 1000 + timeout * 1000;
-	ts->tv_sec += ts->tv_nsec / 1000000000L;
+	ts->tv_nsec += (long)(timeout % 1000000) * 1000;
+	ts->tv_sec += timeout / 1000000 + ts->tv_nsec / 1000000000L;
 	ts->tv_nsec = ts->tv_nsec % 1000000000L;
 }
 
 
+int VideoFrameFilter::waitFrame(
+	int timeout)
+{
+	struct timespec ts;
+
+	/* Must be called with mMutex held */
+	if ((timeout != 0) && (timeout != -1))
+		getTimeFromTimeout(&ts, timeout);
+	while ((timeout != 0) && (mPending.empty()) && (!mThreadShouldStop)) {
+		if (timeout == -1) {
+			pthread_cond_wait(&mCondition, &mMutex);
+		} else if (pthread_cond_timedwait(
+			&mCondition, &mMutex, &ts) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	if (mPending.empty()) {
+		/* Not an error when polling the event fd */
+		if (timeout != 0)
+			ULOGI("no frame available");
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+
+void VideoFrameFilter::frameConsumed(
+	void)
+{
+	if ((mFrameByFrame) && (mMedia != NULL)) {
+		Demuxer *demuxer = mMedia->getSession()->getDemuxer();
+		int ret = demuxer->next();
+		if (ret < 0)
+			ULOG_ERRNO("demuxer->next", -ret);
+	}
+}
+
+
 int VideoFrameFilter::getLastFrame(
 	struct pdraw_video_frame *frame,
 	int timeout)
 {
+	int ret;
+	bool resume;
+	struct videoframefilter_ring_entry *entry;
+	std::vector<struct vbuf_buffer *> released;
+
 	if (frame == NULL) {
 		ULOGE("invalid frame structure pointer");
 		return -EINVAL;
@@ -194,252 +425,1047 @@ int VideoFrameFilter::getLastFrame(
 		return -ENOSYS;
 	}
 
+	if (!mCopy) {
+		/* The frame stays valid until the next call */
+		void *frameRef = NULL;
+		struct vbuf_buffer *old;
+		ret = getLastFrameRef(frame, &frameRef, timeout);
+		if (ret < 0)
+			return ret;
+		pthread_mutex_lock(&mMutex);
+		old = mLegacyRef;
+		mLegacyRef = (struct vbuf_buffer *)frameRef;
+		pthread_mutex_unlock(&mMutex);
+		if (old != NULL) {
+			ret = releaseFrame(old);
+			if (ret < 0)
+				ULOG_ERRNO("releaseFrame", -ret);
+		}
+		return 0;
+	}
+
 	pthread_mutex_lock(&mMutex);
 
-	if ((timeout != 0) && (!mFrameAvailable)) {
-		if (timeout == -1) {
-			pthread_cond_wait(&mCondition, &mMutex);
-		} else {
-			struct timespec ts;
-			getTimeFromTimeout(&ts, timeout);
-			pthread_cond_timedwait(&mCondition, &mMutex, &ts);
+	ret = waitFrame(timeout);
+	if (ret < 0) {
+		pthread_mutex_unlock(&mMutex);
+		return ret;
+	}
+
+	/* The previous frame returned by this function is recycled */
+	entry = mPending.front();
+	mPending.pop_front();
+	if (mConsumerEntry != NULL)
+		mFree.push_back(mConsumerEntry);
+	mConsumerEntry = entry;
+	memcpy(frame, &entry->frame, sizeof(*frame));
+	formatChangeDelivered(frame);
+	mStats.deliveredFrameCount++;
+	mStats.pendingFrameCount = mPending.size();
+	trimRing(&released);
+	resume = resumeLocked();
+
+	pthread_mutex_unlock(&mMutex);
+
+	if (resume)
+		submitTask();
+	releaseBuffers(&released);
+	frameConsumed();
+
+	return 0;
+}
+
+
+int VideoFrameFilter::getLastFrameRef(
+	struct pdraw_video_frame *frame,
+	void **frameRef,
+	int timeout)
+{
+	int ret;
+	bool resume;
+	struct videoframefilter_ring_entry *entry;
+	std::vector<struct vbuf_buffer *> released;
+
+	if (frame == NULL) {
+		ULOGE("invalid frame structure pointer");
+		return -EINVAL;
+	}
+	if (frameRef == NULL) {
+		ULOGE("invalid frame reference pointer");
+		return -EINVAL;
+	}
+	if (mCb != NULL) {
+		ULOGE("unsupported in callback mode");
+		return -ENOSYS;
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	ret = waitFrame(timeout);
+	if (ret < 0) {
+		pthread_mutex_unlock(&mMutex);
+		return ret;
+	}
+
+	entry = mPending.front();
+	if (mCopy) {
+		/* The copy is kept out of the ring until released */
+		mPending.pop_front();
+		*frameRef = entry;
+		memcpy(frame, &entry->frame, sizeof(*frame));
+		formatChangeDelivered(frame);
+		mHeldEntries.push_back(entry);
+		mFrameRefCount++;
+		mStats.deliveredFrameCount++;
+		mStats.pendingFrameCount = mPending.size();
+		trimRing(&released);
+		resume = resumeLocked();
+		pthread_mutex_unlock(&mMutex);
+		if (resume)
+			submitTask();
+		releaseBuffers(&released);
+		frameConsumed();
+		return 0;
+	}
+	mPending.pop_front();
+	*frameRef = entry->buffer;
+	memcpy(frame, &entry->frame, sizeof(*frame));
+	formatChangeDelivered(frame);
+	mHeldBuffers.push_back(entry->buffer);
+	mFrameRefCount++;
+
+	/* The application takes over the filter's reference, so that
+	 * the decoder accounts the frame as held by this sink until the
+	 * application releases it */
+	entry->buffer = NULL;
+	mFree.push_back(entry);
+	mStats.deliveredFrameCount++;
+	mStats.pendingFrameCount = mPending.size();
+	trimRing(&released);
+	resume = resumeLocked();
+
+	pthread_mutex_unlock(&mMutex);
+
+	if (resume)
+		submitTask();
+	releaseBuffers(&released);
+	frameConsumed();
+
+	return 0;
+}
+
+
+int VideoFrameFilter::releaseFrame(
+	void *frameRef)
+{
+	struct vbuf_buffer *buffer = (struct vbuf_buffer *)frameRef;
+
+	if (buffer == NULL)
+		return -EINVAL;
+
+	if (mCopy) {
+		std::vector<struct videoframefilter_ring_entry *>::iterator e;
+		pthread_mutex_lock(&mMutex);
+		e = std::find(mHeldEntries.begin(), mHeldEntries.end(),
+			(struct videoframefilter_ring_entry *)frameRef);
+		if (e == mHeldEntries.end()) {
+			pthread_mutex_unlock(&mMutex);
+			ULOGE("unknown frame reference");
+			return -ENOENT;
 		}
+		mFree.push_back(*e);
+		mHeldEntries.erase(e);
+		mFrameRefCount--;
+		pthread_mutex_unlock(&mMutex);
+		return 0;
 	}
 
-	if (!mFrameAvailable) {
+	std::vector<struct vbuf_buffer *>::iterator b;
+	pthread_mutex_lock(&mMutex);
+	b = std::find(mHeldBuffers.begin(), mHeldBuffers.end(), buffer);
+	if (b == mHeldBuffers.end()) {
 		pthread_mutex_unlock(&mMutex);
-		ULOGI("no frame available");
+		ULOGE("unknown frame reference");
 		return -ENOENT;
 	}
+	mHeldBuffers.erase(b);
+	mFrameRefCount--;
+	pthread_mutex_unlock(&mMutex);
+
+	return releaseBuffer(&buffer);
+}
 
-	mBufferIndex ^= 1;
-	memcpy(frame, &mBufferData[mBufferIndex], sizeof(*frame));
 
-	mFrameAvailable = false;
+int VideoFrameFilter::getRingSettings(
+	enum pdraw_video_frame_producer_policy *policy,
+	unsigned int *depth)
+{
+	pthread_mutex_lock(&mMutex);
+	if (policy)
+		*policy = mPolicy;
+	if (depth)
+		*depth = mDepth;
 	pthread_mutex_unlock(&mMutex);
 
-	if ((mFrameByFrame) && (mMedia != NULL)) {
-		Demuxer *demuxer = mMedia->getSession()->getDemuxer();
-		int ret = demuxer->next();
-		if (ret < 0)
-			ULOG_ERRNO("demuxer->next", -ret);
+	return 0;
+}
+
+
+int VideoFrameFilter::setRingSettings(
+	enum pdraw_video_frame_producer_policy policy,
+	unsigned int depth)
+{
+	std::vector<struct vbuf_buffer *> released;
+	bool resume;
+
+	if (mCb != NULL) {
+		ULOGE("unsupported in callback mode");
+		return -ENOSYS;
+	}
+	if ((policy != PDRAW_VIDEO_FRAME_PRODUCER_POLICY_LATEST_ONLY) &&
+		(policy != PDRAW_VIDEO_FRAME_PRODUCER_POLICY_DROP_OLDEST) &&
+		(policy != PDRAW_VIDEO_FRAME_PRODUCER_POLICY_BLOCK)) {
+		ULOGE("invalid policy");
+		return -EINVAL;
+	}
+	if ((depth == 0) || (depth > PDRAW_VIDEO_FRAME_PRODUCER_MAX_DEPTH)) {
+		ULOGE("invalid depth (%u)", depth);
+		return -EINVAL;
 	}
 
+	pthread_mutex_lock(&mMutex);
+	mPolicy = policy;
+	mDepth = depth;
+	/* Frames in excess are dropped, a blocked producer may resume */
+	trimRing(&released);
+	resume = resumeLocked();
+	pthread_mutex_unlock(&mMutex);
+
+	if (resume)
+		submitTask();
+	releaseBuffers(&released);
+
 	return 0;
 }
 
 
-void* VideoFrameFilter::runThread(
-	void *ptr)
+int VideoFrameFilter::getStats(
+	struct pdraw_video_frame_producer_stats *stats)
 {
-	VideoFrameFilter *filter = (VideoFrameFilter*)ptr;
-	int ret;
-	struct vbuf_buffer *buffer;
-	struct avcdecoder_output_buffer *data;
-	const uint8_t *cdata;
-	struct pdraw_video_frame frame;
-	unsigned int idx;
+	if (stats == NULL)
+		return -EINVAL;
 
-	while (!filter->mThreadShouldStop) {
-		if (filter->mQueue == NULL) {
-			usleep(5000); /* TODO */
-			continue;
-		}
+	pthread_mutex_lock(&mMutex);
+	memcpy(stats, &mStats, sizeof(*stats));
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+int VideoFrameFilter::getFilterStats(
+	struct pdraw_video_frame_filter_stats *stats)
+{
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+	memcpy(stats, &mFilterStats, sizeof(*stats));
+	stats->meanProcessTime = (mFilterStats.processedFrameCount > 0) ?
+		mTotalProcessTime / mFilterStats.processedFrameCount : 0;
+	pthread_mutex_unlock(&mMutex);
+	stats->bufferAllocCount = mBufferPool.getAllocCount();
+
+	return 0;
+}
+
+
+int VideoFrameFilter::getOutputFormat(
+	enum pdraw_color_format *format)
+{
+	if (format == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+	*format = mOutputFormat;
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+int VideoFrameFilter::setOutputFormat(
+	enum pdraw_color_format format)
+{
+	if ((mCb == NULL) && (!mCopy)) {
+		ULOGE("output format requires copy mode");
+		return -ENOSYS;
+	}
+	if ((format != PDRAW_COLOR_FORMAT_UNKNOWN) &&
+		(!pdraw_colorConvIsFormatSupported(format))) {
+		ULOGE("unsupported output format (%d)", format);
+		return -EINVAL;
+	}
+
+	/* Takes effect on the next frame; already queued frames keep
+	 * their format */
+	pthread_mutex_lock(&mMutex);
+	mOutputFormat = format;
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+int VideoFrameFilter::getScaling(
+	struct pdraw_video_frame_filter_scaling *scaling)
+{
+	if (scaling == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+	if (mScalingEnabled)
+		memcpy(scaling, &mScaling, sizeof(*scaling));
+	else
+		memset(scaling, 0, sizeof(*scaling));
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+int VideoFrameFilter::setScaling(
+	const struct pdraw_video_frame_filter_scaling *scaling)
+{
+	unsigned int i;
 
-		ret = vbuf_queue_pop(filter->mQueue, -1, &buffer);
-		if ((ret < 0) || (buffer == NULL)) {
-			if (ret != -EAGAIN)
-				ULOG_ERRNO("vbuf_queue_pop", -ret);
-			continue;
+	if ((mCb == NULL) && (!mCopy)) {
+		ULOGE("scaling requires copy mode");
+		return -ENOSYS;
+	}
+	if (scaling != NULL) {
+		if ((scaling->method != PDRAW_SCALING_METHOD_BOX) &&
+			(scaling->method != PDRAW_SCALING_METHOD_BILINEAR)) {
+			ULOGE("invalid scaling method (%d)", scaling->method);
+			return -EINVAL;
+		}
+		if (scaling->scaleCount > PDRAW_VIDEO_FRAME_MAX_SCALES) {
+			ULOGE("invalid scale count (%u)", scaling->scaleCount);
+			return -EINVAL;
 		}
+		for (i = 0; i < scaling->scaleCount; i++) {
+			if ((scaling->scaleWidth[i] == 0) ||
+				(scaling->scaleHeight[i] == 0)) {
+				ULOGE("invalid scale %u size", i);
+				return -EINVAL;
+			}
+		}
+	}
 
-		cdata = vbuf_get_cdata(buffer);
-		data = (struct avcdecoder_output_buffer *)
-			vbuf_metadata_get(buffer, filter->mMedia, NULL, NULL);
-		memset(&frame, 0, sizeof(frame));
-		switch(data->colorFormat) {
-		default:
-		case AVCDECODER_COLOR_FORMAT_UNKNOWN:
-			frame.colorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
-			break;
-		case AVCDECODER_COLOR_FORMAT_YUV420PLANAR:
-			frame.colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
-			break;
-		case AVCDECODER_COLOR_FORMAT_YUV420SEMIPLANAR:
-			frame.colorFormat = PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR;
-			break;
+	/* A null scaling or an empty one disables cropping and scaling */
+	pthread_mutex_lock(&mMutex);
+	mScalingEnabled = (scaling != NULL) &&
+		((scaling->scaleCount > 0) || (scaling->cropX > 0) ||
+		(scaling->cropY > 0) || (scaling->cropWidth > 0) ||
+		(scaling->cropHeight > 0));
+	if (mScalingEnabled)
+		memcpy(&mScaling, scaling, sizeof(mScaling));
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
+
+unsigned int VideoFrameFilter::getRingDepth(
+	void)
+{
+	return (mPolicy == PDRAW_VIDEO_FRAME_PRODUCER_POLICY_LATEST_ONLY) ?
+		1 : mDepth;
+}
+
+
+struct videoframefilter_ring_entry *VideoFrameFilter::getFreeEntry(
+	std::vector<struct vbuf_buffer *> *released)
+{
+	struct videoframefilter_ring_entry *entry = NULL;
+
+	/* Must be called with mMutex held; with the block policy the
+	 * ring is never full here (see isRingFull) */
+	if (mPending.size() >= getRingDepth()) {
+		/* Recycle the oldest pending frame */
+		entry = mPending.front();
+		mPending.pop_front();
+		if (entry->buffer != NULL)
+			released->push_back(entry->buffer);
+		entry->buffer = NULL;
+		mStats.droppedFrameCount++;
+		mStats.pendingFrameCount = mPending.size();
+		return entry;
+	}
+
+	if (!mFree.empty()) {
+		entry = mFree.back();
+		mFree.pop_back();
+		return entry;
+	}
+
+	entry = (struct videoframefilter_ring_entry *)calloc(1,
+		sizeof(*entry));
+	if (entry == NULL) {
+		ULOGE("ring entry allocation failed");
+		return NULL;
+	}
+	mEntryCount++;
+
+	return entry;
+}
+
+
+void VideoFrameFilter::trimRing(
+	std::vector<struct vbuf_buffer *> *released)
+{
+	unsigned int depth = getRingDepth();
+	unsigned int slotCount = depth + ((mCopy) ? 1 : 0);
+
+	/* Must be called with mMutex held */
+	while (mPending.size() > depth) {
+		struct videoframefilter_ring_entry *entry = mPending.front();
+		mPending.pop_front();
+		if (entry->buffer != NULL)
+			released->push_back(entry->buffer);
+		entry->buffer = NULL;
+		mFree.push_back(entry);
+		mStats.droppedFrameCount++;
+	}
+	mStats.pendingFrameCount = mPending.size();
+	updateEventLocked();
+
+	while ((mEntryCount > slotCount) && (!mFree.empty())) {
+		freeEntry(mFree.back());
+		mFree.pop_back();
+		mEntryCount--;
+	}
+}
+
+
+void VideoFrameFilter::releaseBuffers(
+	std::vector<struct vbuf_buffer *> *released)
+{
+	int ret;
+	std::vector<struct vbuf_buffer *>::iterator b = released->begin();
+
+	while (b != released->end()) {
+		struct vbuf_buffer *buffer = *b;
+		ret = releaseBuffer(&buffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+		b++;
+	}
+	released->clear();
+}
+
+
+int VideoFrameFilter::releaseBuffer(
+	struct vbuf_buffer **buffer)
+{
+	AvcDecoder *decoder = (mMedia != NULL) ?
+		(AvcDecoder *)mMedia->getDecoder() : NULL;
+
+	/* Let the decoder account for the hold time */
+	if (decoder != NULL)
+		return decoder->releaseOutputBuffer(mQueue, buffer);
+	else
+		return vbuf_unref(buffer);
+}
+
+
+void VideoFrameFilter::freeEntry(
+	struct videoframefilter_ring_entry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	mBufferPool.put(entry->data, entry->dataSize);
+	mBufferPool.put(entry->scaleData, entry->scaleDataSize);
+	free(entry->userData);
+	free(entry);
+}
+
+
+int VideoFrameFilter::copyScaledFrame(
+	struct videoframefilter_ring_entry *entry,
+	const struct pdraw_video_frame *frame,
+	enum pdraw_color_format format,
+	const struct pdraw_video_frame_filter_scaling *scaling)
+{
+	int ret;
+	unsigned int cropX, cropY, cropWidth, cropHeight, count, i;
+	unsigned int width[PDRAW_VIDEO_FRAME_MAX_SCALES];
+	unsigned int height[PDRAW_VIDEO_FRAME_MAX_SCALES];
+	size_t offset[PDRAW_VIDEO_FRAME_MAX_SCALES];
+	size_t size = 0, scaleSize = 0;
+	struct pdraw_video_frame scaled, out;
+
+	/* Clamp the crop region to the frame */
+	cropX = scaling->cropX & ~1;
+	cropY = scaling->cropY & ~1;
+	if ((cropX + 2 > frame->width) || (cropY + 2 > frame->height)) {
+		ULOGE("crop region outside of the frame (%ux%u)",
+			frame->width, frame->height);
+		return -ERANGE;
+	}
+	cropWidth = ((scaling->cropWidth == 0) ||
+		(cropX + scaling->cropWidth > frame->width)) ?
+		frame->width - cropX : scaling->cropWidth;
+	cropHeight = ((scaling->cropHeight == 0) ||
+		(cropY + scaling->cropHeight > frame->height)) ?
+		frame->height - cropY : scaling->cropHeight;
+
+	count = (scaling->scaleCount > 0) ? scaling->scaleCount : 1;
+	for (i = 0; i < count; i++) {
+		size_t s;
+		width[i] = (scaling->scaleCount > 0) ?
+			scaling->scaleWidth[i] : cropWidth;
+		height[i] = (scaling->scaleCount > 0) ?
+			scaling->scaleHeight[i] : cropHeight;
+		offset[i] = size;
+		size += pdraw_colorConvGetFrameSize(
+			format, width[i], height[i]);
+		s = pdraw_scalerGetBufferSize(cropWidth, width[i], height[i]);
+		if (s > scaleSize)
+			scaleSize = s;
+	}
+
+	ret = mBufferPool.resize(&entry->data, &entry->dataSize, size);
+	if (ret < 0)
+		return ret;
+	ret = mBufferPool.resize(&entry->scaleData, &entry->scaleDataSize,
+		scaleSize);
+	if (ret < 0)
+		return ret;
+
+	/* Each scale is computed from the decoder buffer, then
+	 * converted to the output format */
+	for (i = 0; i < count; i++) {
+		ret = pdraw_scaleFrame(frame, cropX, cropY, cropWidth,
+			cropHeight, scaling->method, width[i], height[i],
+			entry->scaleData, entry->scaleDataSize, &scaled);
+		if (ret < 0) {
+			ULOG_ERRNO("pdraw_scaleFrame", -ret);
+			return ret;
 		}
-		frame.plane[0] = cdata + data->plane_offset[0];
-		frame.plane[1] = cdata + data->plane_offset[1];
-		frame.plane[2] = cdata + data->plane_offset[2];
-		frame.stride[0] = data->stride[0];
-		frame.stride[1] = data->stride[1];
-		frame.stride[2] = data->stride[2];
-		frame.width = data->width;
-		frame.height = data->height;
-		frame.sarWidth = data->sarWidth;
-		frame.sarHeight = data->sarHeight;
-		frame.isComplete = (data->isComplete) ? 1 : 0;
-		frame.hasErrors = (data->hasErrors) ? 1 : 0;
-		frame.isRef = (data->isRef) ? 1 : 0;
-		frame.auNtpTimestamp = data->auNtpTimestamp;
-		frame.auNtpTimestampRaw = data->auNtpTimestampRaw;
-		frame.auNtpTimestampLocal = data->auNtpTimestampLocal;
-		frame.hasMetadata = (data->hasMetadata) ? 1 : 0;
-		memcpy(&frame.metadata, &data->metadata,
-			sizeof(frame.metadata));
-		frame.userData = vbuf_get_cuserdata(buffer);
-		frame.userDataSize = vbuf_get_userdata_size(buffer);
-
-		if (filter->mCb) {
-			filter->mCb(filter, &frame, filter->mUserPtr);
-			ret = vbuf_unref(&buffer);
-			if (ret < 0)
-				ULOG_ERRNO("vbuf_unref", -ret);
-			continue;
+		ret = pdraw_colorConvFrame(&scaled, format,
+			entry->data + offset[i], size - offset[i], &out,
+			mColorConvImpl);
+		if (ret < 0) {
+			ULOG_ERRNO("pdraw_colorConvFrame", -ret);
+			return ret;
 		}
+		if (i == 0)
+			memcpy(&entry->frame, &out, sizeof(entry->frame));
+		memcpy(entry->frame.scale[i].plane, out.plane,
+			sizeof(out.plane));
+		memcpy(entry->frame.scale[i].stride, out.stride,
+			sizeof(out.stride));
+		entry->frame.scale[i].width = out.width;
+		entry->frame.scale[i].height = out.height;
+	}
+	entry->frame.scaleCount = count;
 
-		if ((filter->mWidth == 0) || (filter->mHeight == 0) ||
-			(filter->mColorFormat == PDRAW_COLOR_FORMAT_UNKNOWN)) {
-			unsigned int size = frame.width * frame.height * 3 / 2;
-			filter->mBuffer[0] = (uint8_t *)malloc(size);
-			if (filter->mBuffer[0] == NULL) {
-				ULOGE("frame allocation failed (size %d)",
-					size);
-			}
-			filter->mBuffer[1] = (uint8_t *)malloc(size);
-			if (filter->mBuffer[1] == NULL) {
-				ULOGE("frame allocation failed (size %d)",
-					size);
-			}
-			if ((filter->mBuffer[0] != NULL) &&
-				(filter->mBuffer[1] != NULL)) {
-				filter->mWidth = frame.width;
-				filter->mHeight = frame.height;
-				filter->mColorFormat = frame.colorFormat;
+	return 0;
+}
+
+
+int VideoFrameFilter::copyFrame(
+	struct videoframefilter_ring_entry *entry,
+	const struct pdraw_video_frame *frame,
+	enum pdraw_color_format format,
+	const struct pdraw_video_frame_filter_scaling *scaling)
+{
+	int ret;
+	size_t size;
+
+	if (frame->colorFormat == PDRAW_COLOR_FORMAT_UNKNOWN) {
+		memcpy(&entry->frame, frame, sizeof(entry->frame));
+		entry->frame.plane[0] = NULL;
+		entry->frame.plane[1] = NULL;
+		entry->frame.plane[2] = NULL;
+		goto userdata;
+	}
+
+	/* Keep the decoder format unless an output format is set */
+	if (format == PDRAW_COLOR_FORMAT_UNKNOWN)
+		format = frame->colorFormat;
+	if (scaling != NULL) {
+		ret = copyScaledFrame(entry, frame, format, scaling);
+		if (ret < 0)
+			return ret;
+		goto userdata;
+	}
+	size = pdraw_colorConvGetFrameSize(
+		format, frame->width, frame->height);
+	/* Buffers of the current size class are reused, others go back
+	 * to the pool where they stay available if the format changes
+	 * back */
+	ret = mBufferPool.resize(&entry->data, &entry->dataSize, size);
+	if (ret < 0)
+		return ret;
+
+	/* Conversion and copy are done in a single pass over the rows */
+	ret = pdraw_colorConvFrame(frame, format, entry->data,
+		entry->dataSize, &entry->frame, mColorConvImpl);
+	if (ret < 0) {
+		ULOG_ERRNO("pdraw_colorConvFrame", -ret);
+		return ret;
+	}
+
+userdata:
+	entry->frame.userData = NULL;
+	entry->frame.userDataSize = 0;
+	if ((frame->userData) && (frame->userDataSize)) {
+		if (frame->userDataSize > entry->userDataSize) {
+			unsigned int size = (frame->userDataSize +
+				VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1) &
+				(~(VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1));
+			uint8_t *tmp = (uint8_t *)realloc(
+				entry->userData, size);
+			if (tmp) {
+				entry->userData = tmp;
+				entry->userDataSize = size;
 			}
 		}
+		if (frame->userDataSize <= entry->userDataSize) {
+			memcpy(entry->userData, frame->userData,
+				frame->userDataSize);
+			entry->frame.userData = entry->userData;
+			entry->frame.userDataSize = frame->userDataSize;
+		}
+	}
 
-		if ((frame.width != filter->mWidth) ||
-			(frame.height != filter->mHeight) ||
-			(frame.colorFormat != filter->mColorFormat)) {
-			ULOGW("unsupported change of frame format");
-			ret = vbuf_unref(&buffer);
-			if (ret < 0) {
-				ULOG_ERRNO("vbuf_unref", -ret);
-			}
-			continue;
+	return 0;
+}
+
+
+void VideoFrameFilter::formatChangeDelivered(
+	const struct pdraw_video_frame *frame)
+{
+	/* Must be called with mMutex held; the frames still pending were
+	 * flagged with the same change, which is now reported */
+	if (!frame->formatChanged)
+		return;
+
+	mFormatChangePending = false;
+	std::deque<struct videoframefilter_ring_entry *>::iterator p =
+		mPending.begin();
+	while (p != mPending.end()) {
+		(*p)->frame.formatChanged = 0;
+		p++;
+	}
+}
+
+
+bool VideoFrameFilter::isRingFull(
+	void)
+{
+	/* Must be called with mMutex held */
+	return ((mCb == NULL) &&
+		(mPolicy == PDRAW_VIDEO_FRAME_PRODUCER_POLICY_BLOCK) &&
+		(mPending.size() >= getRingDepth()));
+}
+
+
+bool VideoFrameFilter::scheduleLocked(
+	void)
+{
+	/* Must be called with mMutex held; returns true if a task
+	 * must be submitted */
+	if ((mThreadShouldStop) || (mPool == NULL))
+		return false;
+	if (mParallel) {
+		mTaskCount++;
+		return true;
+	}
+	if ((mScheduled) || (mStalled))
+		return false;
+	mScheduled = true;
+	mTaskCount++;
+	return true;
+}
+
+
+bool VideoFrameFilter::resumeLocked(
+	void)
+{
+	struct timespec t1;
+	uint64_t curTime;
+
+	/* Must be called with mMutex held */
+	if ((!mStalled) || (isRingFull()))
+		return false;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	curTime = (uint64_t)t1.tv_sec * 1000000 + (uint64_t)t1.tv_nsec / 1000;
+	mStats.blockedTime += curTime - mStallStartTime;
+	mStalled = false;
+
+	return (mNotifyCount > 0) ? scheduleLocked() : false;
+}
+
+
+void VideoFrameFilter::submitTask(
+	void)
+{
+	int ret;
+
+	ret = mPool->submit((mParallel) ? &parallelTask : &serialTask,
+		(void *)this);
+	if (ret < 0) {
+		ULOG_ERRNO("workerPool->submit", -ret);
+		pthread_mutex_lock(&mMutex);
+		mScheduled = false;
+		taskDoneLocked();
+		pthread_mutex_unlock(&mMutex);
+	}
+}
+
+
+void VideoFrameFilter::taskDoneLocked(
+	void)
+{
+	/* Must be called with mMutex held; the filter may be destroyed
+	 * as soon as the mutex is released */
+	mTaskCount--;
+	if (mTaskCount == 0)
+		pthread_cond_broadcast(&mTaskCondition);
+}
+
+
+void VideoFrameFilter::queueNotifyCb(
+	void *userdata)
+{
+	VideoFrameFilter *filter = (VideoFrameFilter *)userdata;
+	bool submit;
+
+	if (filter == NULL)
+		return;
+
+	/* One notification per buffer pushed to the queue */
+	pthread_mutex_lock(&filter->mMutex);
+	filter->mNotifyCount++;
+	submit = filter->scheduleLocked();
+	pthread_mutex_unlock(&filter->mMutex);
+
+	if (submit)
+		filter->submitTask();
+}
+
+
+void VideoFrameFilter::serialTask(
+	void *userdata)
+{
+	VideoFrameFilter *filter = (VideoFrameFilter *)userdata;
+	struct vbuf_buffer *buffer;
+	struct timespec t1;
+	int ret;
+
+	/* Only one serial task runs at a time for a given filter,
+	 * which keeps the frames in order */
+	pthread_mutex_lock(&filter->mMutex);
+	while ((!filter->mThreadShouldStop) && (filter->mNotifyCount > 0)) {
+		if (filter->isRingFull()) {
+			/* Backpressure: resumed when a frame is consumed */
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			filter->mStallStartTime = (uint64_t)t1.tv_sec * 1000000 +
+				(uint64_t)t1.tv_nsec / 1000;
+			filter->mStalled = true;
+			break;
 		}
+		filter->mNotifyCount--;
+		pthread_mutex_unlock(&filter->mMutex);
+
+		ret = vbuf_queue_pop(filter->mQueue, 0, &buffer);
+		if ((ret == 0) && (buffer != NULL))
+			filter->processBuffer(buffer);
+		else if ((ret < 0) && (ret != -EAGAIN))
+			ULOG_ERRNO("vbuf_queue_pop", -ret);
 
 		pthread_mutex_lock(&filter->mMutex);
-		idx = filter->mBufferIndex;
+	}
+	filter->mScheduled = false;
+	filter->taskDoneLocked();
+	pthread_mutex_unlock(&filter->mMutex);
+}
 
-		switch(frame.colorFormat) {
-		default:
-		case PDRAW_COLOR_FORMAT_UNKNOWN:
-			break;
-		case PDRAW_COLOR_FORMAT_YUV420PLANAR: {
-			const uint8_t *pSrcY = cdata + data->plane_offset[0];
-			const uint8_t *pSrcU = cdata + data->plane_offset[1];
-			const uint8_t *pSrcV = cdata + data->plane_offset[2];
-			frame.plane[0] = filter->mBuffer[idx ^ 1];
-			uint8_t *pDstY = (uint8_t *)frame.plane[0];
-			frame.plane[1] = filter->mBuffer[idx ^ 1] +
-				filter->mWidth * filter->mHeight;
-			uint8_t *pDstU = (uint8_t *)frame.plane[1];
-			frame.plane[2] = filter->mBuffer[idx ^ 1] +
-				filter->mWidth * filter->mHeight * 5 / 4;
-			uint8_t *pDstV = (uint8_t *)frame.plane[2];
-			frame.stride[0] = filter->mWidth;
-			frame.stride[1] = filter->mWidth / 2;
-			frame.stride[2] = filter->mWidth / 2;
-			unsigned int y;
-			for (y = 0; y < filter->mHeight; y++) {
-				memcpy(pDstY, pSrcY, filter->mWidth);
-				pSrcY += data->stride[0];
-				pDstY += filter->mWidth;
-			}
-			for (y = 0; y < filter->mHeight / 2; y++) {
-				memcpy(pDstU, pSrcU, filter->mWidth / 2);
-				memcpy(pDstV, pSrcV, filter->mWidth / 2);
-				pSrcU += data->stride[1];
-				pSrcV += data->stride[2];
-				pDstU += filter->mWidth / 2;
-				pDstV += filter->mWidth / 2;
-			}
+
+void VideoFrameFilter::parallelTask(
+	void *userdata)
+{
+	VideoFrameFilter *filter = (VideoFrameFilter *)userdata;
+	struct vbuf_buffer *buffer;
+	int ret;
+
+	/* One task per frame, consecutive frames can be processed
+	 * concurrently */
+	pthread_mutex_lock(&filter->mMutex);
+	if ((!filter->mThreadShouldStop) && (filter->mNotifyCount > 0)) {
+		filter->mNotifyCount--;
+		pthread_mutex_unlock(&filter->mMutex);
+
+		ret = vbuf_queue_pop(filter->mQueue, 0, &buffer);
+		if ((ret == 0) && (buffer != NULL))
+			filter->processBuffer(buffer);
+		else if ((ret < 0) && (ret != -EAGAIN))
+			ULOG_ERRNO("vbuf_queue_pop", -ret);
+
+		pthread_mutex_lock(&filter->mMutex);
+	}
+	filter->taskDoneLocked();
+	pthread_mutex_unlock(&filter->mMutex);
+}
+
+
+bool VideoFrameFilter::isCallbackThread(
+	void)
+{
+	pthread_t self = pthread_self();
+	bool ret = false;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<pthread_t>::iterator t = mCallbackThreads.begin();
+	while (t != mCallbackThreads.end()) {
+		if (pthread_equal(*t, self)) {
+			ret = true;
 			break;
 		}
-		case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR: {
-			const uint8_t *pSrcY = cdata + data->plane_offset[0];
-			const uint8_t *pSrcUV = cdata + data->plane_offset[1];
-			frame.plane[0] = filter->mBuffer[idx ^ 1];
-			uint8_t *pDstY = (uint8_t *)frame.plane[0];
-			frame.plane[1] = filter->mBuffer[idx ^ 1] +
-				filter->mWidth * filter->mHeight;
-			uint8_t *pDstUV = (uint8_t *)frame.plane[1];
-			frame.stride[0] = filter->mWidth;
-			frame.stride[1] = filter->mWidth;
-			unsigned int y;
-			for (y = 0; y < filter->mHeight; y++) {
-				memcpy(pDstY, pSrcY, filter->mWidth);
-				pSrcY += data->stride[0];
-				pDstY += filter->mWidth;
-			}
-			for (y = 0; y < filter->mHeight / 2; y++) {
-				memcpy(pDstUV, pSrcUV, filter->mWidth);
-				pSrcUV += data->stride[1];
-				pDstUV += filter->mWidth;
-			}
+		t++;
+	}
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+void VideoFrameFilter::runCallback(
+	struct pdraw_video_frame *frame)
+{
+	pthread_t self = pthread_self();
+
+	/* Track the threads running the callback so that a filter
+	 * removed from its own callback is not deleted in place */
+	pthread_mutex_lock(&mMutex);
+	mCallbackThreads.push_back(self);
+	pthread_mutex_unlock(&mMutex);
+
+	mCb(this, frame, mUserPtr);
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<pthread_t>::iterator t = mCallbackThreads.begin();
+	while (t != mCallbackThreads.end()) {
+		if (pthread_equal(*t, self)) {
+			mCallbackThreads.erase(t);
 			break;
 		}
+		t++;
+	}
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void VideoFrameFilter::processBuffer(
+	struct vbuf_buffer *buffer)
+{
+	int ret;
+	struct avcdecoder_output_buffer *data;
+	const uint8_t *cdata;
+	struct pdraw_video_frame frame;
+	struct videoframefilter_ring_entry *entry;
+	std::vector<struct vbuf_buffer *> released;
+	struct timespec t1;
+	uint64_t startTime, endTime, processTime;
+	unsigned int bucket;
+	enum pdraw_color_format outputFormat;
+	struct pdraw_video_frame_filter_scaling scaling;
+	bool scalingEnabled;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	startTime = (uint64_t)t1.tv_sec * 1000000 +
+		(uint64_t)t1.tv_nsec / 1000;
+
+	cdata = vbuf_get_cdata(buffer);
+	data = (struct avcdecoder_output_buffer *)
+		vbuf_metadata_get(buffer, mMedia, NULL, NULL);
+	if (data == NULL) {
+		ULOG_ERRNO("vbuf_metadata_get", EPROTO);
+		ret = releaseBuffer(&buffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+		return;
+	}
+	memset(&frame, 0, sizeof(frame));
+	switch(data->colorFormat) {
+	default:
+	case AVCDECODER_COLOR_FORMAT_UNKNOWN:
+		frame.colorFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+		break;
+	case AVCDECODER_COLOR_FORMAT_YUV420PLANAR:
+		frame.colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
+		break;
+	case AVCDECODER_COLOR_FORMAT_YUV420SEMIPLANAR:
+		frame.colorFormat = PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR;
+		break;
+	}
+	frame.plane[0] = cdata + data->plane_offset[0];
+	frame.plane[1] = cdata + data->plane_offset[1];
+	frame.plane[2] = cdata + data->plane_offset[2];
+	frame.stride[0] = data->stride[0];
+	frame.stride[1] = data->stride[1];
+	frame.stride[2] = data->stride[2];
+	frame.width = data->width;
+	frame.height = data->height;
+	frame.sarWidth = data->sarWidth;
+	frame.sarHeight = data->sarHeight;
+	frame.isComplete = (data->isComplete) ? 1 : 0;
+	frame.hasErrors = (data->hasErrors) ? 1 : 0;
+	frame.isRef = (data->isRef) ? 1 : 0;
+	frame.auNtpTimestamp = data->auNtpTimestamp;
+	frame.auNtpTimestampRaw = data->auNtpTimestampRaw;
+	frame.auNtpTimestampLocal = data->auNtpTimestampLocal;
+	frame.hasMetadata = (data->hasMetadata) ? 1 : 0;
+	memcpy(&frame.metadata, &data->metadata,
+		sizeof(frame.metadata));
+	frame.userData = vbuf_get_cuserdata(buffer);
+	frame.userDataSize = vbuf_get_userdata_size(buffer);
+
+	pthread_mutex_lock(&mMutex);
+	frame.sequenceNumber = mSequenceNumber++;
+	mStats.receivedFrameCount++;
+	if ((frame.width != mWidth) ||
+		(frame.height != mHeight) ||
+		(frame.colorFormat != mColorFormat)) {
+		if (mColorFormat != PDRAW_COLOR_FORMAT_UNKNOWN) {
+			/* Entry buffers follow the new size through the
+			 * buffer pool; consumers are told by the frame */
+			ULOGI("frame format changed: %ux%u -> %ux%u",
+				mWidth, mHeight, frame.width, frame.height);
+			mFormatChangePending = true;
+			mFilterStats.formatChangeCount++;
 		}
+		mWidth = frame.width;
+		mHeight = frame.height;
+		mColorFormat = frame.colorFormat;
+	}
+	/* Kept on the following frames until one is delivered */
+	frame.formatChanged = (mFormatChangePending) ? 1 : 0;
+	outputFormat = mOutputFormat;
+	scalingEnabled = mScalingEnabled;
+	if (scalingEnabled)
+		memcpy(&scaling, &mScaling, sizeof(scaling));
+	pthread_mutex_unlock(&mMutex);
 
-		memcpy(&filter->mBufferData[idx ^ 1],
-			&frame, sizeof(frame));
-
-		/* user data */
-		if ((frame.userData) && (frame.userDataSize)) {
-			if (frame.userDataSize > filter->mUserDataBuferSize[
-				idx ^ 1]) {
-				unsigned int size = (frame.userDataSize +
-					VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1) &
-					(~(VIDEO_FRAME_FILTER_USER_DATA_ALLOC_SIZE - 1));
-				uint8_t *tmp = (uint8_t *)realloc(
-					filter->mUserData[idx ^ 1], size);
-				if (tmp) {
-					filter->mUserData[idx ^ 1] = tmp;
-					filter->mUserDataBuferSize[
-						idx ^ 1] = size;
-				}
-			}
-			if (frame.userDataSize <= filter->mUserDataBuferSize[
-				idx ^ 1]) {
-				memcpy(filter->mUserData[idx ^ 1],
-					frame.userData, frame.userDataSize);
-				filter->mBufferData[
-					idx ^ 1].userData =
-					filter->mUserData[idx ^ 1];
-				filter->mBufferData[
-					idx ^ 1].userDataSize =
-					frame.userDataSize;
-			} else {
-				filter->mBufferData[
-					idx ^ 1].userData = NULL;
-				filter->mBufferData[
-					idx ^ 1].userDataSize = 0;
-			}
+	if ((mCb) && ((outputFormat != PDRAW_COLOR_FORMAT_UNKNOWN) ||
+		(scalingEnabled))) {
+		/* Convert into a scratch entry; parallel tasks each
+		 * take their own */
+		pthread_mutex_lock(&mMutex);
+		if (!mScratch.empty()) {
+			entry = mScratch.back();
+			mScratch.pop_back();
+		} else {
+			entry = (struct videoframefilter_ring_entry *)calloc(
+				1, sizeof(*entry));
+		}
+		pthread_mutex_unlock(&mMutex);
+		ret = (entry != NULL) ?
+			copyFrame(entry, &frame, outputFormat,
+			(scalingEnabled) ? &scaling : NULL) : -ENOMEM;
+		if (ret == 0)
+			runCallback(&entry->frame);
+		else
+			ULOG_ERRNO("copyFrame", -ret);
+		pthread_mutex_lock(&mMutex);
+		if (ret == 0) {
+			formatChangeDelivered(&entry->frame);
+			mStats.deliveredFrameCount++;
 		}
+		if (entry != NULL)
+			mScratch.push_back(entry);
+		pthread_mutex_unlock(&mMutex);
+		ret = releaseBuffer(&buffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+		goto out;
+	} else if (mCb) {
+		runCallback(&frame);
+		pthread_mutex_lock(&mMutex);
+		formatChangeDelivered(&frame);
+		mStats.deliveredFrameCount++;
+		pthread_mutex_unlock(&mMutex);
+		ret = releaseBuffer(&buffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+		goto out;
+	}
 
-		filter->mFrameAvailable = true;
-		pthread_mutex_unlock(&filter->mMutex);
-		pthread_cond_signal(&filter->mCondition);
+	pthread_mutex_lock(&mMutex);
+	entry = getFreeEntry(&released);
+	if (entry == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		releaseBuffers(&released);
+		ret = releaseBuffer(&buffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+		goto out;
+	}
 
-		ret = vbuf_unref(&buffer);
+	if (!mCopy) {
+		entry->buffer = buffer;
+		memcpy(&entry->frame, &frame, sizeof(frame));
+	} else {
+		/* The entry is owned by this task until queued */
+		pthread_mutex_unlock(&mMutex);
+		releaseBuffers(&released);
+		int err = copyFrame(entry, &frame, outputFormat,
+			(scalingEnabled) ? &scaling : NULL);
+		if (err < 0)
+			ULOG_ERRNO("copyFrame", -err);
+		ret = releaseBuffer(&buffer);
 		if (ret < 0)
-			ULOG_ERRNO("vbuf_unref", -ret);
+			ULOG_ERRNO("releaseBuffer", -ret);
+		pthread_mutex_lock(&mMutex);
+		if (err < 0) {
+			mFree.push_back(entry);
+			trimRing(&released);
+			pthread_mutex_unlock(&mMutex);
+			goto out;
+		}
 	}
 
-	return NULL;
+	mPending.push_back(entry);
+	trimRing(&released);
+	if (mStats.pendingFrameCount > mStats.maxPendingFrameCount)
+		mStats.maxPendingFrameCount = mStats.pendingFrameCount;
+	pthread_mutex_unlock(&mMutex);
+	pthread_cond_signal(&mCondition);
+
+	releaseBuffers(&released);
+
+out:
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	endTime = (uint64_t)t1.tv_sec * 1000000 +
+		(uint64_t)t1.tv_nsec / 1000;
+	processTime = endTime - startTime;
+	bucket = 0;
+	while ((bucket < PDRAW_VIDEO_FRAME_FILTER_HISTOGRAM_BUCKETS - 1) &&
+		((processTime >> bucket) != 0))
+		bucket++;
+
+	pthread_mutex_lock(&mMutex);
+	mFilterStats.processedFrameCount++;
+	mTotalProcessTime += processTime;
+	if (processTime > mFilterStats.maxProcessTime)
+		mFilterStats.maxProcessTime = processTime;
+	mFilterStats.processTimeHistogram[bucket]++;
+	pthread_mutex_unlock(&mMutex);
 }
 
 } /* namespace Pdraw */
@@ -31,27 +31,58 @@
 #define _PDRAW_FILTER_VIDEOFRAME_HPP_
 
 #include <pthread.h>
+#include <vector>
+#include <deque>
 #include <pdraw/pdraw_defs.h>
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_worker_pool.hpp"
+#include "pdraw_colorconv.hpp"
+#include "pdraw_scaler.hpp"
+#include "pdraw_frame_buffer_pool.hpp"
 
 namespace Pdraw {
 
 
+#define VIDEO_FRAME_FILTER_DEFAULT_POLICY \
+	PDRAW_VIDEO_FRAME_PRODUCER_POLICY_LATEST_ONLY
+#define VIDEO_FRAME_FILTER_DEFAULT_DEPTH (4)
+
+
 class Media;
 class VideoMedia;
 
 
+struct videoframefilter_ring_entry {
+	/* Zero-copy mode: reference on the decoder output buffer */
+	struct vbuf_buffer *buffer;
+	/* Copy mode: frame and user data copies, converted to the
+	 * output format if any; data and scaleData come from the filter
+	 * buffer pool */
+	uint8_t *data;
+	size_t dataSize;
+	uint8_t *userData;
+	unsigned int userDataSize;
+	/* Scaling work buffer */
+	uint8_t *scaleData;
+	size_t scaleDataSize;
+	struct pdraw_video_frame frame;
+};
+
+
 class VideoFrameFilter {
 public:
 	VideoFrameFilter(
 		VideoMedia *media,
-		bool frameByFrame = false);
+		bool frameByFrame = false,
+		bool copy = false);
 
 	VideoFrameFilter(
 		VideoMedia *media,
 		pdraw_video_frame_filter_callback_t cb,
 		void *userPtr,
-		bool frameByFrame = false);
+		bool frameByFrame = false,
+		bool copy = false,
+		bool parallel = false);
 
 	~VideoFrameFilter(
 		void);
@@ -70,6 +101,63 @@ public:
 		struct pdraw_video_frame *frame,
 		int timeout = 0);
 
+	/**
+	 * The frame planes point to the decoder output buffer (zero-copy
+	 * mode) or to the frame copy (copy mode), which is kept alive
+	 * until releaseFrame() is called with the returned frameRef
+	 */
+	int getLastFrameRef(
+		struct pdraw_video_frame *frame,
+		void **frameRef,
+		int timeout = 0);
+
+	int releaseFrame(
+		void *frameRef);
+
+	/**
+	 * File descriptor readable while frames are pending, to be used
+	 * with poll/epoll or a pomp loop; getLastFrame() or
+	 * getLastFrameRef() with a null timeout then never block.
+	 * The fd is owned by the filter.
+	 */
+	int getEventFd(
+		void);
+
+	int getRingSettings(
+		enum pdraw_video_frame_producer_policy *policy,
+		unsigned int *depth);
+
+	int setRingSettings(
+		enum pdraw_video_frame_producer_policy policy,
+		unsigned int depth);
+
+	int getStats(
+		struct pdraw_video_frame_producer_stats *stats);
+
+	int getFilterStats(
+		struct pdraw_video_frame_filter_stats *stats);
+
+	/**
+	 * Output color format of the frames (copy or callback mode);
+	 * PDRAW_COLOR_FORMAT_UNKNOWN keeps the decoder format
+	 */
+	int getOutputFormat(
+		enum pdraw_color_format *format);
+
+	int setOutputFormat(
+		enum pdraw_color_format format);
+
+	/* Crop and scaling (copy or callback mode); NULL disables it */
+	int getScaling(
+		struct pdraw_video_frame_filter_scaling *scaling);
+
+	int setScaling(
+		const struct pdraw_video_frame_filter_scaling *scaling);
+
+	/* Decoder output sink notification */
+	static void queueNotifyCb(
+		void *userdata);
+
 	Media *getMedia(
 		void) {
 		return mMedia;
@@ -80,29 +168,141 @@ public:
 		return (VideoMedia *)mMedia;
 	}
 
+	pdraw_video_frame_filter_callback_t getCallback(
+		void) {
+		return mCb;
+	}
+
+	void *getUserPtr(
+		void) {
+		return mUserPtr;
+	}
+
+	/* True if called from the filter callback */
+	bool isCallbackThread(
+		void);
+
 private:
-	static void *runThread(
-		void *ptr);
+	void runCallback(
+		struct pdraw_video_frame *frame);
+
+	int releaseBuffer(
+		struct vbuf_buffer **buffer);
+
+	int waitFrame(
+		int timeout);
+
+	void frameConsumed(
+		void);
+
+	int createEventFd(
+		void);
+
+	void destroyEventFd(
+		void);
+
+	void updateEventLocked(
+		void);
+
+	unsigned int getRingDepth(
+		void);
+
+	struct videoframefilter_ring_entry *getFreeEntry(
+		std::vector<struct vbuf_buffer *> *released);
+
+	void trimRing(
+		std::vector<struct vbuf_buffer *> *released);
+
+	void releaseBuffers(
+		std::vector<struct vbuf_buffer *> *released);
+
+	bool isRingFull(
+		void);
+
+	void formatChangeDelivered(
+		const struct pdraw_video_frame *frame);
+
+	bool scheduleLocked(
+		void);
+
+	bool resumeLocked(
+		void);
+
+	void submitTask(
+		void);
+
+	void taskDoneLocked(
+		void);
+
+	void processBuffer(
+		struct vbuf_buffer *buffer);
+
+	int copyFrame(
+		struct videoframefilter_ring_entry *entry,
+		const struct pdraw_video_frame *frame,
+		enum pdraw_color_format format,
+		const struct pdraw_video_frame_filter_scaling *scaling);
+
+	int copyScaledFrame(
+		struct videoframefilter_ring_entry *entry,
+		const struct pdraw_video_frame *frame,
+		enum pdraw_color_format format,
+		const struct pdraw_video_frame_filter_scaling *scaling);
+
+	void freeEntry(
+		struct videoframefilter_ring_entry *entry);
+
+	static void serialTask(
+		void *userdata);
+
+	static void parallelTask(
+		void *userdata);
 
 	Media *mMedia;
 	struct vbuf_queue *mQueue;
 	pthread_mutex_t mMutex;
-	pthread_t mThread;
 	pthread_cond_t mCondition;
-	bool mThreadLaunched;
+	pthread_cond_t mTaskCondition;
+	int mEventFd[2];
+	bool mEventSignaled;
+	WorkerPool *mPool;
 	bool mThreadShouldStop;
 	bool mFrameByFrame;
+	bool mCopy;
+	bool mParallel;
+	bool mScheduled;
+	bool mStalled;
+	uint64_t mStallStartTime;
+	unsigned int mNotifyCount;
+	unsigned int mTaskCount;
 	pdraw_video_frame_filter_callback_t mCb;
 	void *mUserPtr;
-	uint8_t *mBuffer[2];
-	uint8_t *mUserData[2];
-	unsigned int mUserDataBuferSize[2];
-	struct pdraw_video_frame mBufferData[2];
-	unsigned int mBufferIndex;
+	std::vector<pthread_t> mCallbackThreads;
+	enum pdraw_video_frame_producer_policy mPolicy;
+	unsigned int mDepth;
+	unsigned int mEntryCount;
+	std::deque<struct videoframefilter_ring_entry *> mPending;
+	std::vector<struct videoframefilter_ring_entry *> mFree;
+	struct videoframefilter_ring_entry *mConsumerEntry;
+	std::vector<struct videoframefilter_ring_entry *> mScratch;
+	std::vector<struct videoframefilter_ring_entry *> mHeldEntries;
+	std::vector<struct vbuf_buffer *> mHeldBuffers;
 	enum pdraw_color_format mColorFormat;
+	/* Format change not yet reported on a delivered frame */
+	bool mFormatChangePending;
+	enum pdraw_color_format mOutputFormat;
+	bool mScalingEnabled;
+	struct pdraw_video_frame_filter_scaling mScaling;
+	enum pdraw_colorconv_impl mColorConvImpl;
 	unsigned int mWidth;
 	unsigned int mHeight;
-	bool mFrameAvailable;
+	FrameBufferPool mBufferPool;
+	uint64_t mSequenceNumber;
+	struct pdraw_video_frame_producer_stats mStats;
+	struct pdraw_video_frame_filter_stats mFilterStats;
+	uint64_t mTotalProcessTime;
+	struct vbuf_buffer *mLegacyRef;
+	unsigned int mFrameRefCount;
 };
 
 } /* namespace Pdraw */
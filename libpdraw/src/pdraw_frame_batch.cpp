@@ -0,0 +1,485 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Video frame batch producer
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_frame_batch.hpp"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define ULOG_TAG pdraw_frmbatch
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_frmbatch);
+
+namespace Pdraw {
+
+
+static uint64_t getCurTime(
+	void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+/* Bytes per pixel of the packed formats usable as tensors */
+static unsigned int getChannelCount(
+	enum pdraw_color_format format)
+{
+	switch (format) {
+	case PDRAW_COLOR_FORMAT_RGB24:
+		return 3;
+	case PDRAW_COLOR_FORMAT_BGRA:
+	case PDRAW_COLOR_FORMAT_RGBA:
+		return 4;
+	case PDRAW_COLOR_FORMAT_GRAY8:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+
+/* Returns the plane count, 0 if the format is not supported */
+static unsigned int getPlaneLayout(
+	enum pdraw_color_format format,
+	unsigned int width,
+	unsigned int height,
+	size_t rowSize[3],
+	unsigned int rowCount[3])
+{
+	switch (format) {
+	case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+		rowSize[0] = width;
+		rowSize[1] = rowSize[2] = (width + 1) / 2;
+		rowCount[0] = height;
+		rowCount[1] = rowCount[2] = (height + 1) / 2;
+		return 3;
+	case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+		rowSize[0] = width;
+		rowSize[1] = 2 * ((width + 1) / 2);
+		rowCount[0] = height;
+		rowCount[1] = (height + 1) / 2;
+		return 2;
+	default:
+		rowSize[0] = (size_t)width * getChannelCount(format);
+		rowCount[0] = height;
+		return (rowSize[0] > 0) ? 1 : 0;
+	}
+}
+
+
+VideoFrameBatcher::VideoFrameBatcher(
+	const struct pdraw_video_frame_batch_settings *settings,
+	pdraw_video_frame_batch_callback_t cb,
+	void *userPtr)
+{
+	int ret;
+	pthread_condattr_t attr;
+	bool mutex_created = false, cond_created = false;
+
+	mThreadLaunched = false;
+	mThreadShouldStop = false;
+	mCb = cb;
+	mUserPtr = userPtr;
+	mCtx = NULL;
+	memset(&mSettings, 0, sizeof(mSettings));
+	if (settings != NULL)
+		mSettings = *settings;
+	if (mSettings.batchSize == 0)
+		mSettings.batchSize = VIDEO_FRAME_BATCHER_DEFAULT_SIZE;
+	if (mSettings.batchSize > PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE)
+		mSettings.batchSize = PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE;
+	memset(mBatch, 0, sizeof(mBatch));
+	mFillIndex = 0;
+	mSequenceNumber = 0;
+	mDroppedCount = 0;
+	mFormatErrorLogged = false;
+
+	ret = pthread_mutex_init(&mMutex, NULL);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_mutex_init", ret);
+		goto error;
+	}
+	mutex_created = true;
+
+	ret = pthread_condattr_init(&attr);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_condattr_init", ret);
+		goto error;
+	}
+	ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if (ret != 0)
+		ULOG_ERRNO("pthread_condattr_setclock", ret);
+	ret = pthread_cond_init(&mCondition, &attr);
+	pthread_condattr_destroy(&attr);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_cond_init", ret);
+		goto error;
+	}
+	cond_created = true;
+
+	ret = pthread_create(&mThread, NULL, runThread, (void *)this);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_create", ret);
+		goto error;
+	}
+	mThreadLaunched = true;
+	return;
+
+error:
+	if (cond_created)
+		pthread_cond_destroy(&mCondition);
+	if (mutex_created)
+		pthread_mutex_destroy(&mMutex);
+}
+
+
+VideoFrameBatcher::~VideoFrameBatcher(
+	void)
+{
+	unsigned int i;
+
+	if (!mThreadLaunched)
+		return;
+
+	int ret = stop();
+	if (ret < 0)
+		ULOG_ERRNO("stop", -ret);
+
+	if (mDroppedCount > 0) {
+		ULOGW("%llu frames dropped while no batch was available",
+			(unsigned long long)mDroppedCount);
+	}
+
+	for (i = 0; i < VIDEO_FRAME_BATCHER_COUNT; i++)
+		free(mBatch[i].data);
+
+	pthread_cond_destroy(&mCondition);
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+int VideoFrameBatcher::stop(
+	void)
+{
+	if (!mThreadLaunched)
+		return 0;
+	if (pthread_equal(mThread, pthread_self()))
+		return -EDEADLK;
+
+	pthread_mutex_lock(&mMutex);
+	if (mThreadShouldStop) {
+		/* Already stopped */
+		pthread_mutex_unlock(&mMutex);
+		return 0;
+	}
+	mThreadShouldStop = true;
+	pthread_cond_signal(&mCondition);
+	pthread_mutex_unlock(&mMutex);
+
+	pthread_join(mThread, NULL);
+
+	return 0;
+}
+
+
+void VideoFrameBatcher::setContext(
+	void *ctx)
+{
+	pthread_mutex_lock(&mMutex);
+	mCtx = ctx;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+int VideoFrameBatcher::getSettings(
+	struct pdraw_video_frame_batch_settings *settings)
+{
+	if (settings == NULL)
+		return -EINVAL;
+
+	*settings = mSettings;
+
+	return 0;
+}
+
+
+enum pdraw_color_format VideoFrameBatcher::getRequiredFormat(
+	void)
+{
+	return (mSettings.layout == PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES) ?
+		PDRAW_COLOR_FORMAT_UNKNOWN : PDRAW_COLOR_FORMAT_RGB24;
+}
+
+
+int VideoFrameBatcher::setupBatch(
+	struct videoframebatcher_batch *batch,
+	const struct pdraw_video_frame *frame)
+{
+	size_t rowSize[3];
+	unsigned int rowCount[3], planeCount, i;
+
+	/* Must be called with mMutex held on an empty batch */
+	if (mSettings.layout == PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES) {
+		planeCount = getPlaneLayout(frame->colorFormat,
+			frame->width, frame->height, rowSize, rowCount);
+		batch->channels = 0;
+		batch->slotSize = 0;
+		for (i = 0; i < planeCount; i++)
+			batch->slotSize += rowSize[i] * rowCount[i];
+	} else {
+		batch->channels = getChannelCount(frame->colorFormat);
+		batch->slotSize = (size_t)frame->width * frame->height *
+			batch->channels;
+	}
+	if (batch->slotSize == 0) {
+		if (!mFormatErrorLogged) {
+			ULOGE("unsupported frame format for the batch layout");
+			mFormatErrorLogged = true;
+		}
+		return -ENOTSUP;
+	}
+
+	size_t size = batch->slotSize * mSettings.batchSize;
+	if (size > batch->dataSize) {
+		free(batch->data);
+		batch->dataSize = 0;
+		batch->data = (uint8_t *)malloc(size);
+		if (batch->data == NULL) {
+			ULOGE("batch allocation failed (size %zu)", size);
+			return -ENOMEM;
+		}
+		batch->dataSize = size;
+	}
+	batch->format = frame->colorFormat;
+	batch->width = frame->width;
+	batch->height = frame->height;
+
+	return 0;
+}
+
+
+int VideoFrameBatcher::addFrame(
+	const struct pdraw_video_frame *frame)
+{
+	struct videoframebatcher_batch *batch = &mBatch[mFillIndex];
+	size_t rowSize[3];
+	unsigned int rowCount[3], planeCount, i, y;
+	int ret;
+
+	/* Must be called with mMutex held */
+	if ((batch->closed) || (batch->frameCount >= mSettings.batchSize)) {
+		mDroppedCount++;
+		return -ENOBUFS;
+	}
+	if ((batch->frameCount > 0) &&
+		((frame->colorFormat != batch->format) ||
+		(frame->width != batch->width) ||
+		(frame->height != batch->height))) {
+		/* Deliver the current batch first */
+		batch->closed = true;
+		pthread_cond_signal(&mCondition);
+		mDroppedCount++;
+		return -ENOBUFS;
+	}
+	if (batch->frameCount == 0) {
+		ret = setupBatch(batch, frame);
+		if (ret < 0)
+			return ret;
+		batch->firstFrameTime = getCurTime();
+	}
+
+	uint8_t *dst = batch->data + batch->frameCount * batch->slotSize;
+	struct pdraw_video_frame *out = &batch->frames[batch->frameCount];
+	memcpy(out, frame, sizeof(*out));
+	memset(out->plane, 0, sizeof(out->plane));
+	memset(out->stride, 0, sizeof(out->stride));
+	out->userData = NULL;
+	out->userDataSize = 0;
+	out->scaleCount = 0;
+	memset(out->scale, 0, sizeof(out->scale));
+
+	switch (mSettings.layout) {
+	case PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES:
+	default:
+		planeCount = getPlaneLayout(frame->colorFormat,
+			frame->width, frame->height, rowSize, rowCount);
+		for (i = 0; i < planeCount; i++) {
+			const uint8_t *src = frame->plane[i];
+			out->plane[i] = dst;
+			out->stride[i] = rowSize[i];
+			for (y = 0; y < rowCount[i]; y++) {
+				memcpy(dst, src, rowSize[i]);
+				dst += rowSize[i];
+				src += frame->stride[i];
+			}
+		}
+		break;
+	case PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NHWC: {
+		const uint8_t *src = frame->plane[0];
+		size_t rowBytes = (size_t)frame->width * batch->channels;
+		for (y = 0; y < frame->height; y++) {
+			memcpy(dst, src, rowBytes);
+			dst += rowBytes;
+			src += frame->stride[0];
+		}
+		break;
+	}
+	case PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NCHW: {
+		unsigned int c, x, channels = batch->channels;
+		size_t planeSize = (size_t)frame->width * frame->height;
+		for (c = 0; c < channels; c++) {
+			uint8_t *d = dst + c * planeSize;
+			for (y = 0; y < frame->height; y++) {
+				const uint8_t *s = frame->plane[0] +
+					(size_t)y * frame->stride[0] + c;
+				for (x = 0; x < frame->width; x++)
+					d[x] = s[x * channels];
+				d += frame->width;
+			}
+		}
+		break;
+	}
+	}
+
+	batch->frameCount++;
+
+	/* Wake up the thread on a full batch or to arm the timeout */
+	if ((batch->frameCount >= mSettings.batchSize) ||
+		((batch->frameCount == 1) && (mSettings.maxWaitTime > 0)))
+		pthread_cond_signal(&mCondition);
+
+	return 0;
+}
+
+
+bool VideoFrameBatcher::isBatchReady(
+	struct videoframebatcher_batch *batch,
+	uint64_t curTime)
+{
+	if (batch->frameCount == 0)
+		return false;
+	if ((batch->closed) || (batch->frameCount >= mSettings.batchSize))
+		return true;
+	return (mSettings.maxWaitTime > 0) &&
+		(curTime >= batch->firstFrameTime + mSettings.maxWaitTime);
+}
+
+
+void VideoFrameBatcher::deliverBatch(
+	struct videoframebatcher_batch *batch)
+{
+	struct pdraw_video_frame_batch out;
+	void *ctx;
+
+	/* Called with mMutex held, unlocked during the callback */
+	memset(&out, 0, sizeof(out));
+	out.sequenceNumber = mSequenceNumber++;
+	out.frameCount = batch->frameCount;
+	out.frames = batch->frames;
+	out.layout = mSettings.layout;
+	if (mSettings.layout != PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES) {
+		out.tensor = batch->data;
+		out.tensorSize = batch->slotSize * batch->frameCount;
+		out.width = batch->width;
+		out.height = batch->height;
+		out.channels = batch->channels;
+	}
+	out.droppedFrameCount = mDroppedCount;
+	ctx = mCtx;
+
+	pthread_mutex_unlock(&mMutex);
+	if (mCb != NULL)
+		(*mCb)(ctx, &out, mUserPtr);
+	pthread_mutex_lock(&mMutex);
+
+	batch->frameCount = 0;
+	batch->closed = false;
+}
+
+
+void *VideoFrameBatcher::runThread(
+	void *ptr)
+{
+	VideoFrameBatcher *batcher = (VideoFrameBatcher *)ptr;
+	struct videoframebatcher_batch *batch;
+	struct timespec ts;
+	uint64_t deadline;
+
+	pthread_mutex_lock(&batcher->mMutex);
+
+	while (!batcher->mThreadShouldStop) {
+		batch = &batcher->mBatch[batcher->mFillIndex];
+		if (batcher->isBatchReady(batch, getCurTime())) {
+			/* Frames go to the other batch during the delivery */
+			batcher->mFillIndex = (batcher->mFillIndex + 1) %
+				VIDEO_FRAME_BATCHER_COUNT;
+			batcher->deliverBatch(batch);
+			continue;
+		}
+		if ((batch->frameCount == 0) ||
+			(batcher->mSettings.maxWaitTime == 0)) {
+			pthread_cond_wait(&batcher->mCondition,
+				&batcher->mMutex);
+		} else {
+			deadline = batch->firstFrameTime +
+				batcher->mSettings.maxWaitTime;
+			ts.tv_sec = deadline / 1000000;
+			ts.tv_nsec = (deadline % 1000000) * 1000;
+			pthread_cond_timedwait(&batcher->mCondition,
+				&batcher->mMutex, &ts);
+		}
+	}
+
+	pthread_mutex_unlock(&batcher->mMutex);
+
+	return NULL;
+}
+
+
+void VideoFrameBatcher::frameCb(
+	void * /* filterCtx */,
+	const struct pdraw_video_frame *frame,
+	void *userPtr)
+{
+	int ret;
+	VideoFrameBatcher *batcher = (VideoFrameBatcher *)userPtr;
+
+	if ((batcher == NULL) || (frame == NULL))
+		return;
+
+	pthread_mutex_lock(&batcher->mMutex);
+	ret = batcher->addFrame(frame);
+	pthread_mutex_unlock(&batcher->mMutex);
+	if ((ret < 0) && (ret != -ENOBUFS) && (ret != -ENOTSUP))
+		ULOG_ERRNO("addFrame", -ret);
+}
+
+} /* namespace Pdraw */
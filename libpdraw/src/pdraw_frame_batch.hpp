@@ -0,0 +1,134 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Video frame batch producer
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_FRAME_BATCH_HPP_
+#define _PDRAW_FRAME_BATCH_HPP_
+
+#include <pthread.h>
+#include <pdraw/pdraw_defs.h>
+
+namespace Pdraw {
+
+
+#define VIDEO_FRAME_BATCHER_DEFAULT_SIZE (8)
+#define VIDEO_FRAME_BATCHER_COUNT (2)
+
+
+struct videoframebatcher_batch {
+	struct pdraw_video_frame frames[PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE];
+	unsigned int frameCount;
+	/* No more frames can be added (frame geometry change) */
+	bool closed;
+	uint64_t firstFrameTime;
+	/* Frame copies or tensor, reused across batches */
+	uint8_t *data;
+	size_t dataSize;
+	size_t slotSize;
+	enum pdraw_color_format format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+};
+
+
+class VideoFrameBatcher {
+public:
+	VideoFrameBatcher(
+		const struct pdraw_video_frame_batch_settings *settings,
+		pdraw_video_frame_batch_callback_t cb,
+		void *userPtr);
+
+	~VideoFrameBatcher(
+		void);
+
+	bool isRunning(
+		void) {
+		return mThreadLaunched;
+	}
+
+	/* Joins the batch thread, pending frames are discarded and no
+	 * batch is delivered anymore; returns -EDEADLK when called from
+	 * the batch callback */
+	int stop(
+		void);
+
+	/* Context passed to the batch callback */
+	void setContext(
+		void *ctx);
+
+	int getSettings(
+		struct pdraw_video_frame_batch_settings *settings);
+
+	/* Color format of the frames required by the batch layout */
+	enum pdraw_color_format getRequiredFormat(
+		void);
+
+	/* Video frame filter callback */
+	static void frameCb(
+		void *filterCtx,
+		const struct pdraw_video_frame *frame,
+		void *userPtr);
+
+private:
+	int addFrame(
+		const struct pdraw_video_frame *frame);
+
+	int setupBatch(
+		struct videoframebatcher_batch *batch,
+		const struct pdraw_video_frame *frame);
+
+	bool isBatchReady(
+		struct videoframebatcher_batch *batch,
+		uint64_t curTime);
+
+	void deliverBatch(
+		struct videoframebatcher_batch *batch);
+
+	static void *runThread(
+		void *ptr);
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mCondition;
+	pthread_t mThread;
+	bool mThreadLaunched;
+	bool mThreadShouldStop;
+	pdraw_video_frame_batch_callback_t mCb;
+	void *mUserPtr;
+	void *mCtx;
+	struct pdraw_video_frame_batch_settings mSettings;
+	struct videoframebatcher_batch mBatch[VIDEO_FRAME_BATCHER_COUNT];
+	unsigned int mFillIndex;
+	uint64_t mSequenceNumber;
+	uint64_t mDroppedCount;
+	bool mFormatErrorLogged;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_FRAME_BATCH_HPP_ */
@@ -0,0 +1,189 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame buffer size-class pool
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_frame_buffer_pool.hpp"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#define ULOG_TAG pdraw_frmbufpool
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_frmbufpool);
+
+namespace Pdraw {
+
+
+FrameBufferPool::FrameBufferPool(
+	void)
+{
+	mFreeSize = 0;
+	mAllocCount = 0;
+	pthread_mutex_init(&mMutex, NULL);
+}
+
+
+FrameBufferPool::~FrameBufferPool(
+	void)
+{
+	std::vector<struct frame_buffer_pool_entry>::iterator p =
+		mFree.begin();
+	while (p != mFree.end()) {
+		free(p->data);
+		p++;
+	}
+	mFree.clear();
+
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+size_t FrameBufferPool::getClassSize(
+	size_t size)
+{
+	unsigned int shift = FRAME_BUFFER_POOL_MIN_SIZE_LOG2;
+
+	if (size <= ((size_t)1 << shift))
+		return (size_t)1 << shift;
+
+	/* Round up to the next quarter of the power of two below size */
+	while ((size >> shift) >= 2)
+		shift++;
+	shift -= FRAME_BUFFER_POOL_CLASS_STEPS_LOG2;
+	size_t step = (size_t)1 << shift;
+	if (size > SIZE_MAX - (step - 1))
+		return 0;
+
+	return (size + step - 1) & ~(step - 1);
+}
+
+
+int FrameBufferPool::resize(
+	uint8_t **buffer,
+	size_t *allocSize,
+	size_t size)
+{
+	uint8_t *buf = NULL;
+
+	if ((buffer == NULL) || (allocSize == NULL))
+		return -EINVAL;
+
+	if (size == 0) {
+		put(*buffer, *allocSize);
+		*buffer = NULL;
+		*allocSize = 0;
+		return 0;
+	}
+
+	size_t classSize = getClassSize(size);
+	if (classSize == 0) {
+		ULOGE("unsupported buffer size %zu", size);
+		return -EINVAL;
+	}
+	if ((*buffer != NULL) && (*allocSize == classSize))
+		return 0;
+
+	/* Exact class match, most recently released first */
+	pthread_mutex_lock(&mMutex);
+	std::vector<struct frame_buffer_pool_entry>::iterator p = mFree.end();
+	while (p != mFree.begin()) {
+		p--;
+		if (p->size == classSize) {
+			buf = p->data;
+			mFreeSize -= p->size;
+			mFree.erase(p);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mMutex);
+
+	if (buf == NULL) {
+		buf = (uint8_t *)malloc(classSize);
+		if (buf == NULL) {
+			ULOGE("buffer allocation failed (size %zu)", classSize);
+			return -ENOMEM;
+		}
+		pthread_mutex_lock(&mMutex);
+		mAllocCount++;
+		pthread_mutex_unlock(&mMutex);
+	}
+
+	put(*buffer, *allocSize);
+	*buffer = buf;
+	*allocSize = classSize;
+
+	return 0;
+}
+
+
+void FrameBufferPool::put(
+	uint8_t *buffer,
+	size_t allocSize)
+{
+	if (buffer == NULL)
+		return;
+
+	if (allocSize > FRAME_BUFFER_POOL_MAX_FREE_SIZE) {
+		free(buffer);
+		return;
+	}
+
+	struct frame_buffer_pool_entry entry;
+	entry.data = buffer;
+	entry.size = allocSize;
+
+	pthread_mutex_lock(&mMutex);
+	mFree.push_back(entry);
+	mFreeSize += allocSize;
+	trim();
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+/* Called with mMutex held */
+void FrameBufferPool::trim(
+	void)
+{
+	while ((mFree.size() > FRAME_BUFFER_POOL_MAX_FREE) ||
+		(mFreeSize > FRAME_BUFFER_POOL_MAX_FREE_SIZE)) {
+		mFreeSize -= mFree.front().size;
+		free(mFree.front().data);
+		mFree.erase(mFree.begin());
+	}
+}
+
+
+uint64_t FrameBufferPool::getAllocCount(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	uint64_t ret = mAllocCount;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+} /* namespace Pdraw */
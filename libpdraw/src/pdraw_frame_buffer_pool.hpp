@@ -0,0 +1,100 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame buffer size-class pool
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_FRAME_BUFFER_POOL_HPP_
+#define _PDRAW_FRAME_BUFFER_POOL_HPP_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <vector>
+
+namespace Pdraw {
+
+
+/* Size classes from 4 KiB, four per power of two so that a buffer
+ * wastes less than 25% of its size */
+#define FRAME_BUFFER_POOL_MIN_SIZE_LOG2 (12)
+#define FRAME_BUFFER_POOL_CLASS_STEPS_LOG2 (2)
+/* Free buffers kept by the pool; the oldest are freed first */
+#define FRAME_BUFFER_POOL_MAX_FREE (8)
+#define FRAME_BUFFER_POOL_MAX_FREE_SIZE (64 * 1024 * 1024)
+
+
+struct frame_buffer_pool_entry {
+	uint8_t *data;
+	size_t size;
+};
+
+
+class FrameBufferPool {
+public:
+	FrameBufferPool(
+		void);
+
+	~FrameBufferPool(
+		void);
+
+	/**
+	 * Make *buffer hold at least size bytes: the buffer is kept if it
+	 * is in the size class of size, otherwise it is returned to the
+	 * pool and replaced; the contents are not preserved.
+	 * *allocSize is the size class of the buffer. A null size
+	 * releases the buffer.
+	 */
+	int resize(
+		uint8_t **buffer,
+		size_t *allocSize,
+		size_t size);
+
+	void put(
+		uint8_t *buffer,
+		size_t allocSize);
+
+	/* Buffers allocated since the pool creation (pool misses) */
+	uint64_t getAllocCount(
+		void);
+
+private:
+	static size_t getClassSize(
+		size_t size);
+
+	void trim(
+		void);
+
+	pthread_mutex_t mMutex;
+	/* Oldest first */
+	std::vector<struct frame_buffer_pool_entry> mFree;
+	size_t mFreeSize;
+	uint64_t mAllocCount;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_FRAME_BUFFER_POOL_HPP_ */
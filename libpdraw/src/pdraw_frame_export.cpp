@@ -0,0 +1,388 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Video frame export to shared memory
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_frame_export.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  ifndef MFD_CLOEXEC
+#    include <linux/memfd.h>
+#  endif
+#endif
+#define ULOG_TAG pdraw_frmexprt
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_frmexprt);
+
+namespace Pdraw {
+
+
+#define VIDEO_FRAME_EXPORTER_ALIGN(x) \
+	(((x) + PDRAW_SHM_ALIGN - 1) & ~(size_t)(PDRAW_SHM_ALIGN - 1))
+
+
+VideoFrameExporter::VideoFrameExporter(
+	unsigned int slotCount,
+	size_t slotDataSize)
+{
+	int ret;
+
+	mFd = -1;
+	mMap = NULL;
+	mMapSize = 0;
+	mHeader = NULL;
+	mSlotCount = (slotCount > 0) ? slotCount : PDRAW_SHM_DEFAULT_SLOT_COUNT;
+	if (mSlotCount > PDRAW_SHM_MAX_SLOT_COUNT)
+		mSlotCount = PDRAW_SHM_MAX_SLOT_COUNT;
+	mSlotDataSize = VIDEO_FRAME_EXPORTER_ALIGN(slotDataSize +
+		VIDEO_FRAME_EXPORTER_USER_DATA_SIZE);
+	mDroppedCount = 0;
+
+	ret = pthread_mutex_init(&mMutex, NULL);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_mutex_init", ret);
+		return;
+	}
+
+	ret = createRing();
+	if (ret < 0) {
+		ULOG_ERRNO("createRing", -ret);
+		return;
+	}
+}
+
+
+VideoFrameExporter::~VideoFrameExporter(
+	void)
+{
+	if (mDroppedCount > 0) {
+		ULOGW("%llu frames did not fit in the export slots",
+			(unsigned long long)mDroppedCount);
+	}
+
+	destroyRing();
+
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+int VideoFrameExporter::createRing(
+	void)
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+	int ret;
+	size_t slotSize;
+
+	slotSize = VIDEO_FRAME_EXPORTER_ALIGN(sizeof(struct pdraw_shm_slot)) +
+		mSlotDataSize;
+	mMapSize = VIDEO_FRAME_EXPORTER_ALIGN(sizeof(struct pdraw_shm_header)) +
+		slotSize * mSlotCount;
+
+	mFd = syscall(SYS_memfd_create, "pdraw-frames",
+		MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (mFd < 0) {
+		ret = -errno;
+		ULOG_ERRNO("memfd_create", -ret);
+		return ret;
+	}
+	if (ftruncate(mFd, mMapSize) < 0) {
+		ret = -errno;
+		ULOG_ERRNO("ftruncate", -ret);
+		goto error;
+	}
+
+	/* Readers can rely on the size never changing */
+	if (fcntl(mFd, F_ADD_SEALS,
+		F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+		ret = -errno;
+		ULOG_ERRNO("fcntl", -ret);
+		goto error;
+	}
+
+	mMap = (uint8_t *)mmap(NULL, mMapSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED, mFd, 0);
+	if (mMap == MAP_FAILED) {
+		mMap = NULL;
+		ret = -errno;
+		ULOG_ERRNO("mmap", -ret);
+		goto error;
+	}
+
+	/* The memfd is zero-filled: all sequence counters are even */
+	mHeader = (struct pdraw_shm_header *)mMap;
+	mHeader->version = PDRAW_SHM_VERSION;
+	mHeader->frameStructSize = sizeof(struct pdraw_shm_frame);
+	mHeader->slotCount = mSlotCount;
+	mHeader->slotOffset =
+		VIDEO_FRAME_EXPORTER_ALIGN(sizeof(struct pdraw_shm_header));
+	mHeader->slotSize = slotSize;
+	mHeader->slotDataOffset =
+		VIDEO_FRAME_EXPORTER_ALIGN(sizeof(struct pdraw_shm_slot));
+	mHeader->slotDataSize = mSlotDataSize;
+	__atomic_store_n(&mHeader->magic, PDRAW_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	ULOGI("frame export ring: %u slots of %zu bytes",
+		mSlotCount, mSlotDataSize);
+
+	return 0;
+
+error:
+	destroyRing();
+	return ret;
+#else
+	ULOGE("shared memory export is not supported on this platform");
+	return -ENOSYS;
+#endif
+}
+
+
+void VideoFrameExporter::destroyRing(
+	void)
+{
+	if (mHeader != NULL) {
+		/* Readers keep their mapping, but stop waiting */
+		__atomic_store_n(&mHeader->writerClosed, 1, __ATOMIC_RELEASE);
+		wake();
+	}
+	mHeader = NULL;
+	if (mMap != NULL)
+		munmap(mMap, mMapSize);
+	mMap = NULL;
+	if (mFd >= 0)
+		close(mFd);
+	mFd = -1;
+}
+
+
+int VideoFrameExporter::getFd(
+	void)
+{
+	return (mHeader != NULL) ? mFd : -EPROTO;
+}
+
+
+int VideoFrameExporter::sendFd(
+	int sock)
+{
+	ssize_t res;
+	char data = 0;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	if (sock < 0)
+		return -EINVAL;
+	if (mHeader == NULL)
+		return -EPROTO;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	iov.iov_base = &data;
+	iov.iov_len = sizeof(data);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &mFd, sizeof(int));
+
+	do {
+		res = sendmsg(sock, &msg, MSG_NOSIGNAL);
+	} while ((res < 0) && (errno == EINTR));
+	if (res < 0) {
+		int ret = -errno;
+		ULOG_ERRNO("sendmsg", -ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+
+void VideoFrameExporter::wake(
+	void)
+{
+	__atomic_add_fetch(&mHeader->futex, 1, __ATOMIC_RELEASE);
+#ifdef __linux__
+	/* Shared mapping: no FUTEX_PRIVATE_FLAG */
+	syscall(SYS_futex, &mHeader->futex, FUTEX_WAKE, INT_MAX,
+		NULL, NULL, 0);
+#endif
+}
+
+
+int VideoFrameExporter::publish(
+	const struct pdraw_video_frame *frame)
+{
+	unsigned int i, planeCount;
+	unsigned int rowSize[3], rowCount[3];
+	unsigned int chromaWidth = (frame->width + 1) / 2;
+	unsigned int chromaHeight = (frame->height + 1) / 2;
+	size_t size = 0, offset[3], userDataOffset;
+	uint64_t count, seq;
+	struct pdraw_shm_slot *slot;
+	struct pdraw_shm_frame *f;
+	uint8_t *data;
+
+	switch (frame->colorFormat) {
+	case PDRAW_COLOR_FORMAT_YUV420PLANAR:
+		planeCount = 3;
+		rowSize[0] = frame->width;
+		rowSize[1] = rowSize[2] = chromaWidth;
+		rowCount[0] = frame->height;
+		rowCount[1] = rowCount[2] = chromaHeight;
+		break;
+	case PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR:
+		planeCount = 2;
+		rowSize[0] = frame->width;
+		rowSize[1] = chromaWidth * 2;
+		rowCount[0] = frame->height;
+		rowCount[1] = chromaHeight;
+		break;
+	case PDRAW_COLOR_FORMAT_RGB24:
+	case PDRAW_COLOR_FORMAT_BGRA:
+	case PDRAW_COLOR_FORMAT_RGBA:
+	case PDRAW_COLOR_FORMAT_GRAY8:
+		planeCount = 1;
+		if (frame->colorFormat == PDRAW_COLOR_FORMAT_RGB24)
+			rowSize[0] = frame->width * 3;
+		else if (frame->colorFormat == PDRAW_COLOR_FORMAT_GRAY8)
+			rowSize[0] = frame->width;
+		else
+			rowSize[0] = frame->width * 4;
+		rowCount[0] = frame->height;
+		break;
+	default:
+		planeCount = 0;
+		break;
+	}
+	for (i = 0; i < planeCount; i++) {
+		offset[i] = size;
+		size = VIDEO_FRAME_EXPORTER_ALIGN(
+			size + (size_t)rowSize[i] * rowCount[i]);
+	}
+	userDataOffset = size;
+	size += frame->userDataSize;
+	if (size > mSlotDataSize) {
+		if (mDroppedCount++ == 0) {
+			ULOGW("frame too big for the export slots "
+				"(%zu > %zu bytes)", size, mSlotDataSize);
+		}
+		return -ENOBUFS;
+	}
+
+	count = mHeader->publishCount;
+	slot = (struct pdraw_shm_slot *)(mMap + mHeader->slotOffset +
+		(size_t)(count % mSlotCount) * mHeader->slotSize);
+	data = (uint8_t *)slot + mHeader->slotDataOffset;
+	f = &slot->frame;
+
+	/* Readers see an odd counter while the slot is written */
+	seq = slot->seq;
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memset(f, 0, sizeof(*f));
+	for (i = 0; i < planeCount; i++) {
+		unsigned int y;
+		const uint8_t *src = frame->plane[i];
+		for (y = 0; y < rowCount[i]; y++) {
+			memcpy(data + offset[i] + (size_t)y * rowSize[i], src,
+				rowSize[i]);
+			src += frame->stride[i];
+		}
+		f->planeOffset[i] = offset[i];
+		f->stride[i] = rowSize[i];
+	}
+	if ((frame->userData != NULL) && (frame->userDataSize > 0)) {
+		memcpy(data + userDataOffset, frame->userData,
+			frame->userDataSize);
+		f->userDataOffset = userDataOffset;
+		f->userDataSize = frame->userDataSize;
+	}
+	f->colorFormat = frame->colorFormat;
+	f->width = frame->width;
+	f->height = frame->height;
+	f->sarWidth = frame->sarWidth;
+	f->sarHeight = frame->sarHeight;
+	f->isComplete = frame->isComplete;
+	f->hasErrors = frame->hasErrors;
+	f->isRef = frame->isRef;
+	f->hasMetadata = frame->hasMetadata;
+	f->sequenceNumber = frame->sequenceNumber;
+	f->auNtpTimestamp = frame->auNtpTimestamp;
+	f->auNtpTimestampRaw = frame->auNtpTimestampRaw;
+	f->auNtpTimestampLocal = frame->auNtpTimestampLocal;
+	memcpy(&f->metadata, &frame->metadata, sizeof(f->metadata));
+	slot->index = count;
+
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&mHeader->publishCount, count + 1, __ATOMIC_RELEASE);
+	wake();
+
+	return 0;
+}
+
+
+void VideoFrameExporter::frameCb(
+	void * /* filterCtx */,
+	const struct pdraw_video_frame *frame,
+	void *userPtr)
+{
+	int ret;
+	VideoFrameExporter *exporter = (VideoFrameExporter *)userPtr;
+
+	if ((exporter == NULL) || (frame == NULL))
+		return;
+
+	pthread_mutex_lock(&exporter->mMutex);
+	if (exporter->mHeader == NULL) {
+		pthread_mutex_unlock(&exporter->mMutex);
+		return;
+	}
+	ret = exporter->publish(frame);
+	pthread_mutex_unlock(&exporter->mMutex);
+	if ((ret < 0) && (ret != -ENOBUFS))
+		ULOG_ERRNO("publish", -ret);
+}
+
+} /* namespace Pdraw */
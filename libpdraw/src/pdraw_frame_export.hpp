@@ -0,0 +1,93 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Video frame export to shared memory
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_FRAME_EXPORT_HPP_
+#define _PDRAW_FRAME_EXPORT_HPP_
+
+#include <pthread.h>
+#include <pdraw/pdraw_defs.h>
+#include <pdraw/pdraw_shm.h>
+
+namespace Pdraw {
+
+
+/* Slot room for the frame user data on top of the frame itself */
+#define VIDEO_FRAME_EXPORTER_USER_DATA_SIZE (4096)
+
+
+class VideoFrameExporter {
+public:
+	/* slotDataSize: maximum frame size (planes and user data) */
+	VideoFrameExporter(
+		unsigned int slotCount,
+		size_t slotDataSize);
+
+	~VideoFrameExporter(
+		void);
+
+	/* Shared memory fd, owned by the exporter */
+	int getFd(
+		void);
+
+	/* Send the shared memory fd on a connected Unix socket */
+	int sendFd(
+		int sock);
+
+	/* Video frame filter callback */
+	static void frameCb(
+		void *filterCtx,
+		const struct pdraw_video_frame *frame,
+		void *userPtr);
+
+private:
+	int createRing(
+		void);
+
+	void destroyRing(
+		void);
+
+	int publish(
+		const struct pdraw_video_frame *frame);
+
+	void wake(
+		void);
+
+	pthread_mutex_t mMutex;
+	int mFd;
+	uint8_t *mMap;
+	size_t mMapSize;
+	struct pdraw_shm_header *mHeader;
+	unsigned int mSlotCount;
+	size_t mSlotDataSize;
+	uint64_t mDroppedCount;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_FRAME_EXPORT_HPP_ */
@@ -0,0 +1,290 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame presentation scheduler
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_frame_scheduler.hpp"
+#include <string.h>
+#define ULOG_TAG pdraw_framesched
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_framesched);
+
+namespace Pdraw {
+
+
+FrameScheduler::FrameScheduler(
+	void)
+{
+	memset(mFrames, 0, sizeof(mFrames));
+	mHead = 0;
+	mCount = 0;
+	mSynced = false;
+	mOffset = 0;
+	mDelay = 0;
+	mWindowMin = 0;
+	mWindowCount = 0;
+	mLastTimestamp = 0;
+	mLastVsync = 0;
+	mLastPresentationTime = 0;
+	mJudderSum = 0;
+	mJudderCount = 0;
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+
+FrameScheduler::~FrameScheduler(
+	void)
+{
+	if (mCount > 0)
+		ULOGW("%u frames were not flushed", mCount);
+}
+
+
+struct vbuf_buffer *FrameScheduler::push(
+	struct vbuf_buffer *buffer,
+	uint64_t timestamp,
+	uint64_t availableTime)
+{
+	struct vbuf_buffer *dropped = NULL;
+	struct frame_scheduler_frame *frame;
+	int64_t transit;
+
+	mStats.receivedFrameCount++;
+
+	if (mCount == FRAME_SCHEDULER_MAX_FRAMES) {
+		dropped = mFrames[mHead].buffer;
+		mHead = (mHead + 1) % FRAME_SCHEDULER_MAX_FRAMES;
+		mCount--;
+		mStats.droppedFrameCount++;
+	}
+
+	frame = &mFrames[(mHead + mCount) % FRAME_SCHEDULER_MAX_FRAMES];
+	frame->buffer = buffer;
+	mCount++;
+
+	if (timestamp == 0) {
+		/* No timestamp, display as soon as possible */
+		frame->presentationTime = availableTime;
+		return dropped;
+	}
+
+	/* The minimum transit offset is the transit of the least delayed
+	 * frame; it decreases immediately and increases to the minimum of
+	 * the last window of frames. The playout delay follows the peak
+	 * excess over it and slowly decays when the jitter decreases */
+	transit = (int64_t)availableTime - (int64_t)timestamp;
+	if ((!mSynced) || (timestamp < mLastTimestamp) ||
+		(transit > mOffset + FRAME_SCHEDULER_RESYNC_THRESHOLD) ||
+		(transit < mOffset - FRAME_SCHEDULER_RESYNC_THRESHOLD)) {
+		if (mSynced)
+			ULOGD("clock resynchronization");
+		mOffset = transit;
+		mDelay = 0;
+		mWindowCount = 0;
+		mSynced = true;
+		/* The cadence is broken, do not measure the judder */
+		mLastVsync = 0;
+	} else if (transit < mOffset) {
+		/* Keep the presentation times continuous */
+		mDelay += mOffset - transit;
+		mOffset = transit;
+	}
+	if ((mWindowCount == 0) || (transit < mWindowMin))
+		mWindowMin = transit;
+	mWindowCount++;
+	if (mWindowCount == FRAME_SCHEDULER_OFFSET_WINDOW) {
+		if (mWindowMin > mOffset) {
+			/* Keep the presentation times continuous as far
+			 * as the playout delay allows */
+			mDelay -= mWindowMin - mOffset;
+			if (mDelay < 0)
+				mDelay = 0;
+			mOffset = mWindowMin;
+		}
+		mWindowCount = 0;
+	}
+	if (transit - mOffset > mDelay)
+		mDelay = transit - mOffset;
+	else
+		mDelay -= mDelay / FRAME_SCHEDULER_DELAY_DECAY;
+	if (mDelay > FRAME_SCHEDULER_MAX_DELAY)
+		mDelay = FRAME_SCHEDULER_MAX_DELAY;
+	mLastTimestamp = timestamp;
+
+	frame->presentationTime = (uint64_t)((int64_t)timestamp +
+		mOffset + mDelay);
+	return dropped;
+}
+
+
+/* A frame is due at a vsync when it is the first vsync one refresh
+ * after its presentation time: the refresh between the render and
+ * the display is a constant latency added to all the frames */
+bool FrameScheduler::isDue(
+	unsigned int index,
+	uint64_t vsync,
+	uint64_t period)
+{
+	struct frame_scheduler_frame *frame =
+		&mFrames[(mHead + index) % FRAME_SCHEDULER_MAX_FRAMES];
+
+	return (frame->presentationTime + period <= vsync);
+}
+
+
+struct vbuf_buffer *FrameScheduler::popDropped(
+	uint64_t vsync,
+	uint64_t period)
+{
+	struct vbuf_buffer *buffer;
+
+	if ((mCount < 2) || (!isDue(1, vsync, period)))
+		return NULL;
+
+	buffer = mFrames[mHead].buffer;
+	mFrames[mHead].buffer = NULL;
+	mHead = (mHead + 1) % FRAME_SCHEDULER_MAX_FRAMES;
+	mCount--;
+	mStats.droppedFrameCount++;
+
+	return buffer;
+}
+
+
+struct vbuf_buffer *FrameScheduler::pop(
+	uint64_t vsync,
+	uint64_t period,
+	bool hasCurrent)
+{
+	struct frame_scheduler_frame *frame;
+	struct vbuf_buffer *buffer;
+	uint64_t displayInterval, presentationInterval, judder;
+
+	if (mCount == 0)
+		return NULL;
+
+	if ((hasCurrent) && (!isDue(0, vsync, period))) {
+		mStats.heldFrameCount++;
+		return NULL;
+	}
+
+	frame = &mFrames[mHead];
+	buffer = frame->buffer;
+	frame->buffer = NULL;
+	mHead = (mHead + 1) % FRAME_SCHEDULER_MAX_FRAMES;
+	mCount--;
+	mStats.displayedFrameCount++;
+
+	/* Without a known refresh period there is no vsync to compare to */
+	if (period == 0) {
+		mLastVsync = 0;
+		return buffer;
+	}
+
+	/* A frame due at an earlier vsync arrived too late for it */
+	if (frame->presentationTime + 2 * period <= vsync)
+		mStats.lateFrameCount++;
+
+	if ((mLastVsync != 0) && (vsync > mLastVsync) &&
+		(frame->presentationTime > mLastPresentationTime)) {
+		displayInterval = vsync - mLastVsync;
+		presentationInterval =
+			frame->presentationTime - mLastPresentationTime;
+		judder = (displayInterval > presentationInterval) ?
+			displayInterval - presentationInterval :
+			presentationInterval - displayInterval;
+		mJudderSum += judder;
+		mJudderCount++;
+		if (judder > mStats.maxJudder)
+			mStats.maxJudder = judder;
+	}
+	mLastVsync = vsync;
+	mLastPresentationTime = frame->presentationTime;
+
+	return buffer;
+}
+
+
+struct vbuf_buffer *FrameScheduler::flush(
+	void)
+{
+	struct vbuf_buffer *buffer;
+
+	if (mCount == 0)
+		return NULL;
+
+	buffer = mFrames[mHead].buffer;
+	mFrames[mHead].buffer = NULL;
+	mHead = (mHead + 1) % FRAME_SCHEDULER_MAX_FRAMES;
+	mCount--;
+
+	return buffer;
+}
+
+
+void FrameScheduler::getStats(
+	struct pdraw_video_renderer_stats *stats)
+{
+	*stats = mStats;
+	stats->meanJudder = (mJudderCount > 0) ?
+		mJudderSum / mJudderCount : 0;
+	stats->playoutDelay = (uint64_t)mDelay;
+	stats->displayPeriod = 0;
+	stats->renderTime = 0;
+	stats->hmdResolutionScale = 1.f;
+}
+
+
+void FrameScheduler::updateDisplayPeriod(
+	uint64_t timestamp,
+	uint64_t *lastTimestamp,
+	uint64_t *period)
+{
+	uint64_t interval;
+
+	if (timestamp == 0)
+		return;
+
+	if ((*lastTimestamp != 0) && (timestamp > *lastTimestamp)) {
+		interval = timestamp - *lastTimestamp;
+		if ((interval >= FRAME_SCHEDULER_MIN_PERIOD) &&
+			(interval <= FRAME_SCHEDULER_MAX_PERIOD)) {
+			/* Intervals spanning several refreshes only help
+			 * to lower an overestimated period */
+			if (*period == 0) {
+				*period = interval;
+			} else if (interval < *period * 3 / 2) {
+				*period = (uint64_t)((int64_t)*period +
+					((int64_t)interval - (int64_t)*period) /
+					FRAME_SCHEDULER_PERIOD_SMOOTHING);
+			}
+		}
+	}
+	*lastTimestamp = timestamp;
+}
+
+} /* namespace Pdraw */
@@ -0,0 +1,151 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame presentation scheduler
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_FRAME_SCHEDULER_HPP_
+#define _PDRAW_FRAME_SCHEDULER_HPP_
+
+#include <inttypes.h>
+#include <video-buffers/vbuf.h>
+#include <pdraw/pdraw_defs.h>
+
+namespace Pdraw {
+
+
+/* Frames waiting for their presentation time; kept low as the frames
+ * are held out of the decoder output pool */
+#define FRAME_SCHEDULER_MAX_FRAMES (3)
+/* Clock offset change that restarts the clock synchronization (seek,
+ * pause or stream restart) in us */
+#define FRAME_SCHEDULER_RESYNC_THRESHOLD (1000000)
+/* Frames over which the minimum transit is taken to let the clock
+ * offset increase (sender clock drift or longer network path) */
+#define FRAME_SCHEDULER_OFFSET_WINDOW (128)
+/* Maximum playout delay in us */
+#define FRAME_SCHEDULER_MAX_DELAY (200000)
+/* Playout delay decay per frame when the jitter decreases (1/n) */
+#define FRAME_SCHEDULER_DELAY_DECAY (4096)
+/* Display period smoothing factor (1/n) */
+#define FRAME_SCHEDULER_PERIOD_SMOOTHING (8)
+/* Valid display refresh period range in us */
+#define FRAME_SCHEDULER_MIN_PERIOD (4000)
+#define FRAME_SCHEDULER_MAX_PERIOD (100000)
+
+
+struct frame_scheduler_frame {
+	struct vbuf_buffer *buffer;
+	/* Presentation time on the local monotonic clock in us */
+	uint64_t presentationTime;
+};
+
+
+/**
+ * Paces the frames of a media on the display refresh: the frame
+ * timestamps are mapped on the local clock with the minimum transit
+ * offset observed over a window of frames plus a playout delay
+ * covering the jitter, and at each render the most recent frame due at
+ * the next vsync is displayed.
+ * Early frames are held and frames made obsolete by a more recent one
+ * are dropped. The buffers are not referenced by the scheduler: push()
+ * transfers them and the pop functions give them back.
+ */
+class FrameScheduler {
+public:
+	FrameScheduler(
+		void);
+
+	~FrameScheduler(
+		void);
+
+	/**
+	 * Queue a frame; timestamp is the frame timestamp and availableTime
+	 * the local time it was output by the decoder, both in us.
+	 * Returns the oldest frame if the scheduler was full, to be
+	 * released by the caller, or NULL.
+	 */
+	struct vbuf_buffer *push(
+		struct vbuf_buffer *buffer,
+		uint64_t timestamp,
+		uint64_t availableTime);
+
+	/* Return the next queued frame if a more recent frame is also due
+	 * at vsync, or NULL */
+	struct vbuf_buffer *popDropped(
+		uint64_t vsync,
+		uint64_t period);
+
+	/* Return the frame to display at vsync, or NULL to keep the
+	 * current frame; the first frame is never held when there is no
+	 * current frame */
+	struct vbuf_buffer *pop(
+		uint64_t vsync,
+		uint64_t period,
+		bool hasCurrent);
+
+	/* Return the queued frames one by one regardless of their time */
+	struct vbuf_buffer *flush(
+		void);
+
+	void getStats(
+		struct pdraw_video_renderer_stats *stats);
+
+	/**
+	 * Estimate the display refresh period from the successive render
+	 * timestamps; *period is kept when the interval is out of range
+	 * (first call, skipped renders or stalls).
+	 */
+	static void updateDisplayPeriod(
+		uint64_t timestamp,
+		uint64_t *lastTimestamp,
+		uint64_t *period);
+
+private:
+	bool isDue(
+		unsigned int index,
+		uint64_t vsync,
+		uint64_t period);
+
+	struct frame_scheduler_frame mFrames[FRAME_SCHEDULER_MAX_FRAMES];
+	unsigned int mHead;
+	unsigned int mCount;
+	bool mSynced;
+	int64_t mOffset;
+	int64_t mDelay;
+	int64_t mWindowMin;
+	unsigned int mWindowCount;
+	uint64_t mLastTimestamp;
+	uint64_t mLastVsync;
+	uint64_t mLastPresentationTime;
+	uint64_t mJudderSum;
+	uint64_t mJudderCount;
+	struct pdraw_video_renderer_stats mStats;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_FRAME_SCHEDULER_HPP_ */
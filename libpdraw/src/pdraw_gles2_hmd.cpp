@@ -281,6 +281,18 @@ Gles2HmdEye::Gles2HmdEye(
 	if (mProgramLensLimits < 0)
 		ULOGE("failed to get uniform location 'LensLimits'");
 
+	mProgramReprojection = glGetUniformLocation(mProgram, "Reprojection");
+	if (mProgramReprojection < 0)
+		ULOGE("failed to get uniform location 'Reprojection'");
+
+	mProgramEyeAspect = glGetUniformLocation(mProgram, "EyeAspect");
+	if (mProgramEyeAspect < 0)
+		ULOGE("failed to get uniform location 'EyeAspect'");
+
+	mProgramTextureScale = glGetUniformLocation(mProgram, "TextureScale");
+	if (mProgramTextureScale < 0)
+		ULOGE("failed to get uniform location 'TextureScale'");
+
 	mProgramPosition = glGetAttribLocation(mProgram, "Position");
 	if (mProgramPosition < 0)
 		ULOGE("failed to get attribute location 'Position'");
@@ -352,8 +364,17 @@ Gles2HmdEye::~Gles2HmdEye(
 int Gles2HmdEye::renderEye(
 	GLuint texture,
 	unsigned int textureWidth,
-	unsigned int textureHeight)
+	unsigned int textureHeight,
+	unsigned int eyeWidth,
+	unsigned int eyeHeight,
+	const GLfloat reprojection[9])
 {
+	static const GLfloat identity[9] = {
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		0.f, 0.f, 1.f,
+	};
+
 	GLCHK(glUseProgram(mProgram));
 
 	GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit));
@@ -389,9 +410,9 @@ int Gles2HmdEye::renderEye(
 
 	float ratio;
 	if ((mRotation == 90) || (mRotation == 270))
-		ratio = (float)textureHeight / (float)textureWidth;
+		ratio = (float)eyeHeight / (float)eyeWidth;
 	else
-		ratio = (float)textureWidth / (float)textureHeight;
+		ratio = (float)eyeWidth / (float)eyeHeight;
 
 	if (ratio > 1.) {
 		GLCHK(glUniform2f(mProgramEyeToSourceUVScale,
@@ -405,6 +426,13 @@ int Gles2HmdEye::renderEye(
 	GLCHK(glUniform1i(mProgramChromaticAberrationCorrection, 0));
 	GLCHK(glUniform1i(mProgramRotation, mRotation));
 	GLCHK(glUniform1i(mProgramLensLimits, 0));
+	GLCHK(glUniformMatrix3fv(mProgramReprojection, 1, false,
+		(reprojection) ? reprojection : identity));
+	GLCHK(glUniform1f(mProgramEyeAspect,
+		(float)eyeWidth / (float)eyeHeight));
+	GLCHK(glUniform2f(mProgramTextureScale,
+		(float)eyeWidth / (float)textureWidth,
+		(float)eyeHeight / (float)textureHeight));
 	GLCHK(glUniform2f(mProgramEyeToSourceScale,
 		2.f / mMetricsWidth, -2.f / mMetricsHeight));
 	GLCHK(glUniform2f(mProgramEyeToSourceOffset,
@@ -473,20 +501,25 @@ Gles2Hmd::~Gles2Hmd(
 int Gles2Hmd::renderHmd(
 	GLuint texture,
 	unsigned int textureWidth,
-	unsigned int textureHeight)
+	unsigned int textureHeight,
+	unsigned int eyeWidth,
+	unsigned int eyeHeight,
+	const GLfloat reprojection[9])
 {
 	int ret = 0;
 
 	if (mLeftEye != NULL) {
 		ret = mLeftEye->renderEye(texture,
-			textureWidth, textureHeight);
+			textureWidth, textureHeight, eyeWidth, eyeHeight,
+			reprojection);
 		if (ret != 0)
 			return ret;
 	}
 
 	if (mRightEye != NULL) {
 		ret = mRightEye->renderEye(texture,
-			textureWidth, textureHeight);
+			textureWidth, textureHeight, eyeWidth, eyeHeight,
+			reprojection);
 		if (ret != 0)
 			return ret;
 	}
@@ -64,10 +64,16 @@ public:
 	~Gles2HmdEye(
 		void);
 
+	/* The eye buffer covers the bottom-left eyeWidth x eyeHeight
+	 * part of the texture; the reprojection is a column-major 3x3
+	 * rotation applied to the eye buffer view rays, or NULL for none */
 	int renderEye(
 		GLuint texture,
 		unsigned int textureWidth,
-		unsigned int textureHeight);
+		unsigned int textureHeight,
+		unsigned int eyeWidth,
+		unsigned int eyeHeight,
+		const GLfloat reprojection[9]);
 
 private:
 	unsigned int mRotation;
@@ -95,6 +101,9 @@ private:
 	GLint mProgramChromaticAberrationCorrection;
 	GLint mProgramRotation;
 	GLint mProgramLensLimits;
+	GLint mProgramReprojection;
+	GLint mProgramEyeAspect;
+	GLint mProgramTextureScale;
 	GLint mProgramPosition;
 	GLint mProgramColor;
 	GLint mProgramTexCoord0;
@@ -129,7 +138,10 @@ public:
 	int renderHmd(
 		GLuint texture,
 		unsigned int textureWidth,
-		unsigned int textureHeight);
+		unsigned int textureHeight,
+		unsigned int eyeWidth,
+		unsigned int eyeHeight,
+		const GLfloat reprojection[9]);
 
 private:
 	enum pdraw_hmd_model mHmdModel;
@@ -49,6 +49,8 @@ const GLchar *pdraw_gles2HmdVertexShader =
 	"uniform vec2 EyeToSourceOffset;\n"
 	"uniform int ChromaticAberrationCorrection;\n"
 	"uniform int Rotation;\n"
+	"uniform mat3 Reprojection;\n"
+	"uniform float EyeAspect;\n"
 	"\n"
 	"attribute vec2 Position;\n"
 	"attribute vec4 Color;\n"
@@ -63,6 +65,18 @@ const GLchar *pdraw_gles2HmdVertexShader =
 	"\n"
 	"varying vec4 oColor;\n"
 	"\n"
+	"/* Rotate the view ray of an eye buffer lookup from the current head\n"
+	" * orientation to the one the eye buffer was rendered with */\n"
+	"vec2 reproject(vec2 uv)\n"
+	"{\n"
+	"    vec2 ndc = uv * 2.0 - vec2(1.0, 1.0);\n"
+	"    vec3 ray = Reprojection * vec3(ndc.x, ndc.y / EyeAspect, 1.0);\n"
+	"    if (ray.z < 0.01)\n"
+	"        return vec2(-1.0, -1.0);\n"
+	"    return vec2(ray.x / ray.z, EyeAspect * ray.y / ray.z) * 0.5 + "
+		"vec2(0.5, 0.5);\n"
+	"}\n"
+	"\n"
 	"void main()\n"
 	"{\n"
 	"    gl_Position.x = Position.x * EyeToSourceScale.x "
@@ -122,6 +136,10 @@ const GLchar *pdraw_gles2HmdVertexShader =
 		"EyeToSourceUVScale * (1.0 + blue_color_distorsion)) + "
 		"vec2(0.5,0.5) + EyeToSourceUVOffset;\n"
 	"\n"
+	"    oTexCoord0 = reproject(oTexCoord0);\n"
+	"    oTexCoord1 = reproject(oTexCoord1);\n"
+	"    oTexCoord2 = reproject(oTexCoord2);\n"
+	"\n"
 	"    oColor = Color; // Used for vignette fade.\n"
 	"}\n";
 
@@ -142,6 +160,7 @@ const GLchar *pdraw_gles2HmdFragmentShader =
 #endif
 	"\n"
 	"uniform int LensLimits;\n"
+	"uniform vec2 TextureScale;\n"
 	"\n"
 	"varying vec4 oColor;\n"
 	"varying vec2 oTexCoord0;\n"
@@ -161,8 +180,10 @@ const GLchar *pdraw_gles2HmdFragmentShader =
 	"    }\n"
 	"    else\n"
 	"    {\n"
-	"        ResultR = texture2D(Texture0, oTexCoord0).r;\n"
-	"        ResultA = texture2D(Texture0, oTexCoord1).a;\n"
+	"        ResultR = texture2D(Texture0, "
+		"oTexCoord0 * TextureScale).r;\n"
+	"        ResultA = texture2D(Texture0, "
+		"oTexCoord1 * TextureScale).a;\n"
 	"    }\n"
 	"\n"
 	"    float ResultG;\n"
@@ -173,7 +194,8 @@ const GLchar *pdraw_gles2HmdFragmentShader =
 	"    }\n"
 	"    else\n"
 	"    {\n"
-	"        ResultG = texture2D(Texture0, oTexCoord1).g;\n"
+	"        ResultG = texture2D(Texture0, "
+		"oTexCoord1 * TextureScale).g;\n"
 	"    }\n"
 	"\n"
 	"    float ResultB;\n"
@@ -184,7 +206,8 @@ const GLchar *pdraw_gles2HmdFragmentShader =
 	"    }\n"
 	"    else\n"
 	"    {\n"
-	"        ResultB = texture2D(Texture0, oTexCoord2).b;\n"
+	"        ResultB = texture2D(Texture0, "
+		"oTexCoord2 * TextureScale).b;\n"
 	"    }\n"
 	"\n"
 	"    gl_FragColor = vec4(ResultR * oColor.r, ResultG * oColor.g, "
@@ -0,0 +1,895 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * OpenGL ES 2.0 HUD geometry batching
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_gles2_hud_batch.hpp"
+
+#ifdef USE_GLES2
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#define ULOG_TAG pdraw_gles2hudbatch
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_gles2hudbatch);
+
+namespace Pdraw {
+
+
+static const GLchar *hudBatchVertexShader =
+	"uniform mat4 transform_matrix;\n"
+	"attribute vec4 position;\n"
+	"attribute vec4 color;\n"
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"    gl_Position = transform_matrix * position;\n"
+	"    v_color = color;\n"
+	"}\n";
+
+static const GLchar *hudBatchFragmentShader =
+#if defined(GL_ES_VERSION_2_0) && (defined(ANDROID) || defined(__APPLE__))
+	"precision mediump float;\n"
+#endif
+	"varying vec4 v_color;\n"
+	"void main() {\n"
+	"    gl_FragColor = v_color;\n"
+	"}\n";
+
+static const GLchar *hudBatchTexVertexShader =
+	"uniform mat4 transform_matrix;\n"
+	"attribute vec4 position;\n"
+	"attribute vec2 texcoord;\n"
+	"attribute vec4 color;\n"
+	"varying vec2 v_texcoord;\n"
+	"varying vec4 v_color;\n"
+	"\n"
+	"void main()\n"
+	"{\n"
+	"    gl_Position = transform_matrix * position;\n"
+	"    v_texcoord = texcoord;\n"
+	"    v_color = color;\n"
+	"}\n";
+
+static const GLchar *hudBatchTexFragmentShader =
+#if defined(GL_ES_VERSION_2_0) && (defined(ANDROID) || defined(__APPLE__))
+	"precision mediump float;\n"
+#endif
+	"varying vec2 v_texcoord;\n"
+	"varying vec4 v_color;\n"
+	"uniform sampler2D s_texture;\n"
+	"\n"
+	"void main()\n"
+	"{\n"
+	"    gl_FragColor = vec4(v_color.r, v_color.g, v_color.b, "
+		"v_color.a * texture2D(s_texture, v_texcoord).r);\n"
+	"}\n";
+
+
+static GLuint createProgram(
+	const GLchar *vertexShaderSource,
+	const GLchar *fragmentShaderSource)
+{
+	GLint vertexShader = 0, fragmentShader = 0;
+	GLint success = 0;
+	GLuint program = 0;
+
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	if ((vertexShader == 0) || (vertexShader == GL_INVALID_ENUM)) {
+		ULOGE("failed to create vertex shader");
+		goto err;
+	}
+
+	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+	glCompileShader(vertexShader);
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+		ULOGE("vertex shader compilation failed '%s'", infoLog);
+		goto err;
+	}
+
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	if ((fragmentShader == 0) || (fragmentShader == GL_INVALID_ENUM)) {
+		ULOGE("failed to create fragment shader");
+		goto err;
+	}
+
+	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+	glCompileShader(fragmentShader);
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+		ULOGE("fragment shader compilation failed '%s'", infoLog);
+		goto err;
+	}
+
+	/* Link shaders */
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		ULOGE("program link failed '%s'", infoLog);
+		goto err;
+	}
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	return program;
+
+err:
+	if (vertexShader > 0)
+		GLCHK(glDeleteShader(vertexShader));
+	if (fragmentShader > 0)
+		GLCHK(glDeleteShader(fragmentShader));
+	if (program > 0)
+		GLCHK(glDeleteProgram(program));
+	return 0;
+}
+
+
+static const GLfloat identity[16] = {
+	1., 0., 0., 0.,
+	0., 1., 0., 0.,
+	0., 0., 1., 0.,
+	0., 0., 0., 1.,
+};
+
+
+static unsigned int getBucketPass(
+	const struct gles2_hud_batch_bucket *bucket)
+{
+	/* Solid triangles first, then solid lines, then textured
+	 * primitives */
+	if (bucket->textured)
+		return 2;
+	else if (bucket->mode == GL_TRIANGLES)
+		return 0;
+	else
+		return 1;
+}
+
+
+Gles2HudBatch::Gles2HudBatch(
+	void)
+{
+	unsigned int i;
+
+	mProgram[0] = 0;
+	mProgram[1] = 0;
+	mPositionHandle[0] = -1;
+	mPositionHandle[1] = -1;
+	mTransformMatrixHandle[0] = -1;
+	mTransformMatrixHandle[1] = -1;
+	mColorHandle[0] = -1;
+	mColorHandle[1] = -1;
+	mTexCoordHandle = -1;
+	mTexUniformSampler = -1;
+	for (i = 0; i < GLES2_HUD_BATCH_BUFFER_COUNT; i++) {
+		mVertexBuffer[i] = 0;
+		mIndexBuffer[i] = 0;
+		mVertexBufferSize[i] = 0;
+		mIndexBufferSize[i] = 0;
+	}
+	mBufferIndex = 0;
+	mBucketCount = 0;
+	mRecordingMesh = -1;
+	mDrawProgram = -1;
+	mDrawTexture = 0;
+	mDrawLineWidth = 0.;
+	mDrawVertexBuffer = 0;
+	mDrawIndexBuffer = 0;
+	mDrawCallCount = 0;
+	memcpy(mTransform, identity, sizeof(mTransform));
+
+	GLCHK();
+
+	mProgram[0] = createProgram(hudBatchVertexShader,
+		hudBatchFragmentShader);
+	if (mProgram[0] == 0)
+		goto err;
+	mPositionHandle[0] = glGetAttribLocation(mProgram[0], "position");
+	mColorHandle[0] = glGetAttribLocation(mProgram[0], "color");
+	mTransformMatrixHandle[0] = glGetUniformLocation(mProgram[0],
+		"transform_matrix");
+
+	mProgram[1] = createProgram(hudBatchTexVertexShader,
+		hudBatchTexFragmentShader);
+	if (mProgram[1] == 0)
+		goto err;
+	mPositionHandle[1] = glGetAttribLocation(mProgram[1], "position");
+	mColorHandle[1] = glGetAttribLocation(mProgram[1], "color");
+	mTransformMatrixHandle[1] = glGetUniformLocation(mProgram[1],
+		"transform_matrix");
+	mTexCoordHandle = glGetAttribLocation(mProgram[1], "texcoord");
+	mTexUniformSampler = glGetUniformLocation(mProgram[1], "s_texture");
+
+	GLCHK(glGenBuffers(GLES2_HUD_BATCH_BUFFER_COUNT, mVertexBuffer));
+	GLCHK(glGenBuffers(GLES2_HUD_BATCH_BUFFER_COUNT, mIndexBuffer));
+
+	return;
+
+err:
+	if (mProgram[0] > 0)
+		GLCHK(glDeleteProgram(mProgram[0]));
+	if (mProgram[1] > 0)
+		GLCHK(glDeleteProgram(mProgram[1]));
+	mProgram[0] = 0;
+	mProgram[1] = 0;
+}
+
+
+Gles2HudBatch::~Gles2HudBatch(
+	void)
+{
+	std::vector<struct gles2_hud_batch_bucket *>::iterator b;
+	unsigned int i;
+
+	for (i = 0; i < mMeshes.size(); i++)
+		destroyMesh(i);
+
+	if (mVertexBuffer[0] > 0)
+		GLCHK(glDeleteBuffers(GLES2_HUD_BATCH_BUFFER_COUNT,
+			mVertexBuffer));
+	if (mIndexBuffer[0] > 0)
+		GLCHK(glDeleteBuffers(GLES2_HUD_BATCH_BUFFER_COUNT,
+			mIndexBuffer));
+	if (mProgram[0] > 0)
+		GLCHK(glDeleteProgram(mProgram[0]));
+	if (mProgram[1] > 0)
+		GLCHK(glDeleteProgram(mProgram[1]));
+
+	for (b = mBuckets.begin(); b != mBuckets.end(); b++)
+		delete *b;
+}
+
+
+int Gles2HudBatch::createTexture(
+	const uint8_t *buffer,
+	unsigned int width,
+	unsigned int height,
+	unsigned int texUnit)
+{
+	GLuint tex = 0;
+
+	if ((buffer == NULL) || (width == 0) || (height == 0))
+		return -EINVAL;
+
+	GLCHK(glGenTextures(1, &tex));
+	if (tex <= 0) {
+		ULOGE("failed to create texture");
+		return -ENOMEM;
+	}
+
+	GLCHK(glActiveTexture(GL_TEXTURE0 + texUnit));
+	GLCHK(glBindTexture(GL_TEXTURE_2D, tex));
+
+	GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+		GL_LUMINANCE, GL_UNSIGNED_BYTE, buffer));
+
+	GLCHK(glTexParameteri(GL_TEXTURE_2D,
+		GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GLCHK(glTexParameteri(GL_TEXTURE_2D,
+		GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GLCHK(glTexParameterf(GL_TEXTURE_2D,
+		GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCHK(glTexParameterf(GL_TEXTURE_2D,
+		GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+	return (int)tex;
+}
+
+
+void Gles2HudBatch::destroyTexture(
+	int texture)
+{
+	GLuint tex = (GLuint)texture;
+
+	if (texture > 0)
+		GLCHK(glDeleteTextures(1, &tex));
+}
+
+
+void Gles2HudBatch::setTransform(
+	const GLfloat matrix[16])
+{
+	memcpy(mTransform, matrix, sizeof(mTransform));
+}
+
+
+struct gles2_hud_batch_bucket *Gles2HudBatch::getBucket(
+	bool textured,
+	GLuint texture,
+	unsigned int texUnit,
+	GLenum mode,
+	GLfloat lineWidth,
+	unsigned int count)
+{
+	std::vector<struct gles2_hud_batch_bucket *> *buckets = &mBuckets;
+	unsigned int *bucketCount = &mBucketCount;
+	struct gles2_hud_batch_bucket *bucket;
+	unsigned int i;
+
+	if (count > GLES2_HUD_BATCH_MAX_VERTICES) {
+		ULOGE("too many vertices (%u)", count);
+		return NULL;
+	}
+
+	if (mRecordingMesh >= 0) {
+		buckets = &mMeshes[mRecordingMesh]->buckets;
+		bucketCount = &mMeshes[mRecordingMesh]->bucketCount;
+	}
+
+	for (i = *bucketCount; i > 0; i--) {
+		bucket = (*buckets)[i - 1];
+		if ((bucket->textured == textured) &&
+			(bucket->texture == texture) &&
+			(bucket->texUnit == texUnit) &&
+			(bucket->mode == mode) &&
+			(bucket->lineWidth == lineWidth) &&
+			(bucket->vertices.size() + count <=
+			GLES2_HUD_BATCH_MAX_VERTICES))
+			return bucket;
+	}
+
+	if (*bucketCount == buckets->size()) {
+		bucket = new struct gles2_hud_batch_bucket;
+		if (bucket == NULL) {
+			ULOGE("allocation failed");
+			return NULL;
+		}
+		buckets->push_back(bucket);
+	}
+
+	bucket = (*buckets)[(*bucketCount)++];
+	bucket->textured = textured;
+	bucket->texture = texture;
+	bucket->texUnit = texUnit;
+	bucket->mode = mode;
+	bucket->lineWidth = lineWidth;
+	bucket->vertices.clear();
+	bucket->indices.clear();
+	bucket->vertexOffset = 0;
+	bucket->indexOffset = 0;
+	bucket->indexCount = 0;
+
+	return bucket;
+}
+
+
+void Gles2HudBatch::addVertices(
+	struct gles2_hud_batch_bucket *bucket,
+	const GLfloat *vertices,
+	unsigned int dim,
+	const GLfloat *texCoords,
+	unsigned int count,
+	const GLfloat color[4])
+{
+	const GLfloat *m = mTransform;
+	size_t first = bucket->vertices.size();
+	unsigned int i, j;
+
+	bucket->vertices.resize(first + count);
+
+	for (i = 0; i < count; i++, vertices += dim) {
+		struct gles2_hud_batch_vertex *v = &bucket->vertices[first + i];
+		GLfloat x = vertices[0];
+		GLfloat y = vertices[1];
+		GLfloat z = (dim > 2) ? vertices[2] : 0.;
+		for (j = 0; j < 4; j++) {
+			v->position[j] = m[j] * x + m[4 + j] * y +
+				m[8 + j] * z + m[12 + j];
+		}
+		if (texCoords) {
+			v->texCoord[0] = texCoords[2 * i];
+			v->texCoord[1] = texCoords[2 * i + 1];
+		} else {
+			v->texCoord[0] = 0.;
+			v->texCoord[1] = 0.;
+		}
+		memcpy(v->color, color, sizeof(v->color));
+	}
+}
+
+
+void Gles2HudBatch::addLines(
+	enum hud_canvas_line_mode mode,
+	const GLfloat *vertices,
+	unsigned int dim,
+	unsigned int count,
+	const GLfloat color[4],
+	GLfloat lineWidth)
+{
+	struct gles2_hud_batch_bucket *bucket;
+	unsigned int i;
+	GLushort first;
+
+	if ((mode != HUD_CANVAS_LINE_MODE_LINES) &&
+		(mode != HUD_CANVAS_LINE_MODE_LINE_STRIP) &&
+		(mode != HUD_CANVAS_LINE_MODE_LINE_LOOP)) {
+		ULOGE("unsupported mode %d", mode);
+		return;
+	}
+	if ((vertices == NULL) || (count < 2))
+		return;
+
+	bucket = getBucket(false, 0, 0, GL_LINES, lineWidth, count);
+	if (bucket == NULL)
+		return;
+
+	first = (GLushort)bucket->vertices.size();
+	addVertices(bucket, vertices, dim, NULL, count, color);
+
+	if (mode == HUD_CANVAS_LINE_MODE_LINES) {
+		for (i = 0; i + 1 < count; i += 2) {
+			bucket->indices.push_back(first + i);
+			bucket->indices.push_back(first + i + 1);
+		}
+	} else {
+		for (i = 0; i + 1 < count; i++) {
+			bucket->indices.push_back(first + i);
+			bucket->indices.push_back(first + i + 1);
+		}
+		if (mode == HUD_CANVAS_LINE_MODE_LINE_LOOP) {
+			bucket->indices.push_back(first + count - 1);
+			bucket->indices.push_back(first);
+		}
+	}
+}
+
+
+void Gles2HudBatch::addTriangleStrip(
+	const GLfloat *vertices,
+	unsigned int dim,
+	unsigned int count,
+	const GLfloat color[4])
+{
+	struct gles2_hud_batch_bucket *bucket;
+	unsigned int i;
+	GLushort first;
+
+	if ((vertices == NULL) || (count < 3))
+		return;
+
+	bucket = getBucket(false, 0, 0, GL_TRIANGLES, 0., count);
+	if (bucket == NULL)
+		return;
+
+	first = (GLushort)bucket->vertices.size();
+	addVertices(bucket, vertices, dim, NULL, count, color);
+
+	for (i = 0; i + 2 < count; i++) {
+		bucket->indices.push_back(first + i);
+		bucket->indices.push_back(first + i + 1);
+		bucket->indices.push_back(first + i + 2);
+	}
+}
+
+
+void Gles2HudBatch::addTexturedStrip(
+	int texture,
+	unsigned int texUnit,
+	const GLfloat *vertices,
+	const GLfloat *texCoords,
+	unsigned int count,
+	const GLfloat color[4])
+{
+	struct gles2_hud_batch_bucket *bucket;
+	unsigned int i;
+	GLushort first;
+
+	if ((vertices == NULL) || (texCoords == NULL) || (count < 3))
+		return;
+
+	bucket = getBucket(true, (GLuint)texture, texUnit,
+		GL_TRIANGLES, 0., count);
+	if (bucket == NULL)
+		return;
+
+	first = (GLushort)bucket->vertices.size();
+	addVertices(bucket, vertices, 2, texCoords, count, color);
+
+	for (i = 0; i + 2 < count; i++) {
+		bucket->indices.push_back(first + i);
+		bucket->indices.push_back(first + i + 1);
+		bucket->indices.push_back(first + i + 2);
+	}
+}
+
+
+void Gles2HudBatch::reset(
+	void)
+{
+	unsigned int i;
+
+	for (i = 0; i < mBucketCount; i++) {
+		mBuckets[i]->vertices.clear();
+		mBuckets[i]->indices.clear();
+	}
+	mBucketCount = 0;
+	mOrder.clear();
+	mMeshDraws.clear();
+	memcpy(mTransform, identity, sizeof(mTransform));
+}
+
+
+int Gles2HudBatch::beginMesh(
+	void)
+{
+	struct gles2_hud_batch_mesh *mesh;
+	unsigned int i;
+
+	if (mRecordingMesh >= 0) {
+		ULOGE("a mesh is already being recorded");
+		return -EBUSY;
+	}
+
+	mesh = new struct gles2_hud_batch_mesh;
+	if (mesh == NULL) {
+		ULOGE("allocation failed");
+		return -ENOMEM;
+	}
+	mesh->vertexBuffer = 0;
+	mesh->indexBuffer = 0;
+	mesh->bucketCount = 0;
+
+	for (i = 0; i < mMeshes.size(); i++) {
+		if (mMeshes[i] == NULL)
+			break;
+	}
+	if (i == mMeshes.size())
+		mMeshes.push_back(mesh);
+	else
+		mMeshes[i] = mesh;
+
+	mRecordingMesh = i;
+	memcpy(mTransform, identity, sizeof(mTransform));
+
+	return i;
+}
+
+
+int Gles2HudBatch::endMesh(
+	void)
+{
+	struct gles2_hud_batch_mesh *mesh;
+	size_t vertexSize = 0, indexSize = 0;
+	unsigned int i;
+
+	if (mRecordingMesh < 0) {
+		ULOGE("no mesh is being recorded");
+		return -EPROTO;
+	}
+
+	mesh = mMeshes[mRecordingMesh];
+	mRecordingMesh = -1;
+	memcpy(mTransform, identity, sizeof(mTransform));
+
+	for (i = 0; i < mesh->bucketCount; i++) {
+		struct gles2_hud_batch_bucket *bucket = mesh->buckets[i];
+		bucket->vertexOffset = vertexSize;
+		bucket->indexOffset = indexSize;
+		bucket->indexCount = bucket->indices.size();
+		vertexSize += bucket->vertices.size() *
+			sizeof(struct gles2_hud_batch_vertex);
+		indexSize += bucket->indices.size() * sizeof(GLushort);
+	}
+	if (indexSize == 0)
+		return 0;
+
+	GLCHK(glGenBuffers(1, &mesh->vertexBuffer));
+	GLCHK(glGenBuffers(1, &mesh->indexBuffer));
+	GLCHK(glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer));
+	GLCHK(glBufferData(GL_ARRAY_BUFFER, vertexSize, NULL,
+		GL_STATIC_DRAW));
+	GLCHK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer));
+	GLCHK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, NULL,
+		GL_STATIC_DRAW));
+	for (i = 0; i < mesh->bucketCount; i++) {
+		struct gles2_hud_batch_bucket *bucket = mesh->buckets[i];
+		if (bucket->indexCount == 0)
+			continue;
+		GLCHK(glBufferSubData(GL_ARRAY_BUFFER, bucket->vertexOffset,
+			bucket->vertices.size() *
+			sizeof(struct gles2_hud_batch_vertex),
+			&bucket->vertices[0]));
+		GLCHK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+			bucket->indexOffset,
+			bucket->indexCount * sizeof(GLushort),
+			&bucket->indices[0]));
+		/* The CPU copy is not needed anymore */
+		std::vector<struct gles2_hud_batch_vertex>().swap(
+			bucket->vertices);
+		std::vector<GLushort>().swap(bucket->indices);
+	}
+	GLCHK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	GLCHK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	return 0;
+}
+
+
+void Gles2HudBatch::destroyMesh(
+	int mesh)
+{
+	std::vector<struct gles2_hud_batch_bucket *>::iterator b;
+	struct gles2_hud_batch_mesh *m;
+
+	if ((mesh < 0) || ((unsigned int)mesh >= mMeshes.size()) ||
+		(mMeshes[mesh] == NULL))
+		return;
+
+	m = mMeshes[mesh];
+	if (mRecordingMesh == mesh)
+		mRecordingMesh = -1;
+	if (m->vertexBuffer > 0)
+		GLCHK(glDeleteBuffers(1, &m->vertexBuffer));
+	if (m->indexBuffer > 0)
+		GLCHK(glDeleteBuffers(1, &m->indexBuffer));
+	for (b = m->buckets.begin(); b != m->buckets.end(); b++)
+		delete *b;
+	delete m;
+	mMeshes[mesh] = NULL;
+}
+
+
+void Gles2HudBatch::drawMesh(
+	int mesh,
+	const GLfloat matrix[16])
+{
+	struct gles2_hud_batch_mesh_draw draw;
+
+	if ((mesh < 0) || ((unsigned int)mesh >= mMeshes.size()) ||
+		(mMeshes[mesh] == NULL) || (mesh == mRecordingMesh))
+		return;
+
+	draw.mesh = mesh;
+	memcpy(draw.transform, matrix, sizeof(draw.transform));
+	mMeshDraws.push_back(draw);
+}
+
+
+void Gles2HudBatch::drawBucket(
+	struct gles2_hud_batch_bucket *bucket,
+	GLuint vertexBuffer,
+	GLuint indexBuffer,
+	const GLfloat matrix[16])
+{
+	int program = (bucket->textured) ? 1 : 0;
+	size_t offset = bucket->vertexOffset;
+
+	if (program != mDrawProgram) {
+		if (mDrawProgram >= 0) {
+			GLCHK(glDisableVertexAttribArray(
+				mPositionHandle[mDrawProgram]));
+			GLCHK(glDisableVertexAttribArray(
+				mColorHandle[mDrawProgram]));
+			if (mDrawProgram == 1) {
+				GLCHK(glDisableVertexAttribArray(
+					mTexCoordHandle));
+			}
+		}
+		mDrawProgram = program;
+		GLCHK(glUseProgram(mProgram[program]));
+		GLCHK(glEnableVertexAttribArray(mPositionHandle[program]));
+		GLCHK(glEnableVertexAttribArray(mColorHandle[program]));
+		if (program == 1)
+			GLCHK(glEnableVertexAttribArray(mTexCoordHandle));
+	}
+
+	if ((bucket->textured) && (bucket->texture != mDrawTexture)) {
+		mDrawTexture = bucket->texture;
+		GLCHK(glActiveTexture(GL_TEXTURE0 + bucket->texUnit));
+		GLCHK(glBindTexture(GL_TEXTURE_2D, mDrawTexture));
+		GLCHK(glUniform1i(mTexUniformSampler, bucket->texUnit));
+	}
+
+	if ((bucket->mode == GL_LINES) &&
+		(bucket->lineWidth != mDrawLineWidth)) {
+		mDrawLineWidth = bucket->lineWidth;
+		GLCHK(glLineWidth(mDrawLineWidth));
+	}
+
+	if (vertexBuffer != mDrawVertexBuffer) {
+		mDrawVertexBuffer = vertexBuffer;
+		GLCHK(glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer));
+	}
+	if (indexBuffer != mDrawIndexBuffer) {
+		mDrawIndexBuffer = indexBuffer;
+		GLCHK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer));
+	}
+
+	GLCHK(glUniformMatrix4fv(mTransformMatrixHandle[program],
+		1, false, matrix));
+
+	GLCHK(glVertexAttribPointer(mPositionHandle[program],
+		4, GL_FLOAT, false,
+		sizeof(struct gles2_hud_batch_vertex),
+		(const GLvoid *)(uintptr_t)(offset +
+		offsetof(struct gles2_hud_batch_vertex, position))));
+	GLCHK(glVertexAttribPointer(mColorHandle[program],
+		4, GL_FLOAT, false,
+		sizeof(struct gles2_hud_batch_vertex),
+		(const GLvoid *)(uintptr_t)(offset +
+		offsetof(struct gles2_hud_batch_vertex, color))));
+	if (program == 1) {
+		GLCHK(glVertexAttribPointer(mTexCoordHandle,
+			2, GL_FLOAT, false,
+			sizeof(struct gles2_hud_batch_vertex),
+			(const GLvoid *)(uintptr_t)(offset +
+			offsetof(struct gles2_hud_batch_vertex, texCoord))));
+	}
+
+	GLCHK(glDrawElements(bucket->mode, bucket->indexCount,
+		GL_UNSIGNED_SHORT,
+		(const GLvoid *)(uintptr_t)bucket->indexOffset));
+	mDrawCallCount++;
+}
+
+
+void Gles2HudBatch::endDraw(
+	void)
+{
+	if (mDrawProgram >= 0) {
+		GLCHK(glDisableVertexAttribArray(
+			mPositionHandle[mDrawProgram]));
+		GLCHK(glDisableVertexAttribArray(mColorHandle[mDrawProgram]));
+		if (mDrawProgram == 1)
+			GLCHK(glDisableVertexAttribArray(mTexCoordHandle));
+	}
+
+	GLCHK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	GLCHK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	mDrawProgram = -1;
+	mDrawTexture = 0;
+	mDrawLineWidth = 0.;
+	mDrawVertexBuffer = 0;
+	mDrawIndexBuffer = 0;
+}
+
+
+int Gles2HudBatch::flush(
+	void)
+{
+	std::vector<struct gles2_hud_batch_mesh_draw>::iterator d;
+	std::vector<struct gles2_hud_batch_bucket *>::iterator b;
+	size_t vertexSize = 0, indexSize = 0;
+	unsigned int i, pass;
+
+	mDrawCallCount = 0;
+
+	if ((mProgram[0] == 0) || (mProgram[1] == 0)) {
+		reset();
+		return -EPROTO;
+	}
+	if (mRecordingMesh >= 0) {
+		ULOGE("a mesh is still being recorded");
+		reset();
+		return -EPROTO;
+	}
+
+	/* The order of the primitives within a bucket is kept */
+	for (pass = 0; pass < 3; pass++) {
+		for (i = 0; i < mBucketCount; i++) {
+			struct gles2_hud_batch_bucket *bucket = mBuckets[i];
+			if ((getBucketPass(bucket) != pass) ||
+				(bucket->indices.empty()))
+				continue;
+			bucket->vertexOffset = vertexSize;
+			bucket->indexOffset = indexSize;
+			bucket->indexCount = bucket->indices.size();
+			vertexSize += bucket->vertices.size() *
+				sizeof(struct gles2_hud_batch_vertex);
+			indexSize += bucket->indices.size() * sizeof(GLushort);
+			mOrder.push_back(bucket);
+		}
+	}
+	if ((mOrder.empty()) && (mMeshDraws.empty())) {
+		reset();
+		return 0;
+	}
+
+	if (!mOrder.empty()) {
+		/* Orphan the buffer storage so that the upload does not have
+		 * to wait for the draw calls of the previous frames */
+		mBufferIndex = (mBufferIndex + 1) %
+			GLES2_HUD_BATCH_BUFFER_COUNT;
+		if (vertexSize > mVertexBufferSize[mBufferIndex])
+			mVertexBufferSize[mBufferIndex] = vertexSize;
+		if (indexSize > mIndexBufferSize[mBufferIndex])
+			mIndexBufferSize[mBufferIndex] = indexSize;
+		GLCHK(glBindBuffer(GL_ARRAY_BUFFER,
+			mVertexBuffer[mBufferIndex]));
+		GLCHK(glBufferData(GL_ARRAY_BUFFER,
+			mVertexBufferSize[mBufferIndex], NULL,
+			GL_STREAM_DRAW));
+		GLCHK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+			mIndexBuffer[mBufferIndex]));
+		GLCHK(glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+			mIndexBufferSize[mBufferIndex], NULL,
+			GL_STREAM_DRAW));
+		mDrawVertexBuffer = mVertexBuffer[mBufferIndex];
+		mDrawIndexBuffer = mIndexBuffer[mBufferIndex];
+		for (b = mOrder.begin(); b != mOrder.end(); b++) {
+			GLCHK(glBufferSubData(GL_ARRAY_BUFFER,
+				(*b)->vertexOffset,
+				(*b)->vertices.size() *
+				sizeof(struct gles2_hud_batch_vertex),
+				&(*b)->vertices[0]));
+			GLCHK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+				(*b)->indexOffset,
+				(*b)->indexCount * sizeof(GLushort),
+				&(*b)->indices[0]));
+		}
+	}
+
+	GLCHK(glEnable(GL_BLEND));
+	GLCHK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+	/* Within a pass the static meshes are drawn before the streamed
+	 * primitives */
+	for (pass = 0; pass < 3; pass++) {
+		for (d = mMeshDraws.begin(); d != mMeshDraws.end(); d++) {
+			struct gles2_hud_batch_mesh *mesh = mMeshes[d->mesh];
+			if (mesh == NULL)
+				continue;
+			for (i = 0; i < mesh->bucketCount; i++) {
+				struct gles2_hud_batch_bucket *bucket =
+					mesh->buckets[i];
+				if ((getBucketPass(bucket) != pass) ||
+					(bucket->indexCount == 0))
+					continue;
+				drawBucket(bucket, mesh->vertexBuffer,
+					mesh->indexBuffer, d->transform);
+			}
+		}
+		for (b = mOrder.begin(); b != mOrder.end(); b++) {
+			if (getBucketPass(*b) != pass)
+				continue;
+			drawBucket(*b, mVertexBuffer[mBufferIndex],
+				mIndexBuffer[mBufferIndex], identity);
+		}
+	}
+
+	endDraw();
+
+	reset();
+	return 0;
+}
+
+} /* namespace Pdraw */
+
+#endif /* USE_GLES2 */
@@ -0,0 +1,215 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * OpenGL ES 2.0 HUD geometry batching
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_GLES2_HUD_BATCH_HPP_
+#define _PDRAW_GLES2_HUD_BATCH_HPP_
+
+#ifdef USE_GLES2
+
+#include <stddef.h>
+#include <vector>
+#include "pdraw_gles2_common.hpp"
+#include "pdraw_hud_canvas.hpp"
+
+namespace Pdraw {
+
+
+#define GLES2_HUD_BATCH_BUFFER_COUNT 3
+#define GLES2_HUD_BATCH_MAX_VERTICES 65536
+
+
+struct gles2_hud_batch_vertex {
+	/* Clip space position */
+	GLfloat position[4];
+	GLfloat texCoord[2];
+	GLfloat color[4];
+};
+
+
+struct gles2_hud_batch_bucket {
+	bool textured;
+	GLuint texture;
+	unsigned int texUnit;
+	GLenum mode;
+	GLfloat lineWidth;
+	std::vector<struct gles2_hud_batch_vertex> vertices;
+	std::vector<GLushort> indices;
+	size_t vertexOffset;
+	size_t indexOffset;
+	size_t indexCount;
+};
+
+
+struct gles2_hud_batch_mesh {
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	std::vector<struct gles2_hud_batch_bucket *> buckets;
+	unsigned int bucketCount;
+};
+
+
+struct gles2_hud_batch_mesh_draw {
+	int mesh;
+	GLfloat transform[16];
+};
+
+
+/**
+ * Collects the HUD lines, triangles and textured quads of a frame and draws
+ * them with one draw call per program, texture and line width combination
+ * from streaming vertex and index buffers. Strips and loops are converted to
+ * independent lines and triangles; the vertices are transformed on the CPU so
+ * that primitives drawn with different matrices can share a draw call.
+ * Static geometry can be recorded once into a mesh stored in GPU buffers and
+ * then drawn with a transform matrix uniform.
+ */
+class Gles2HudBatch : public HudCanvas {
+public:
+	Gles2HudBatch(
+		void);
+
+	~Gles2HudBatch(
+		void);
+
+	int createTexture(
+		const uint8_t *buffer,
+		unsigned int width,
+		unsigned int height,
+		unsigned int texUnit);
+
+	void destroyTexture(
+		int texture);
+
+	void setTransform(
+		const GLfloat matrix[16]);
+
+	void addLines(
+		enum hud_canvas_line_mode mode,
+		const GLfloat *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const GLfloat color[4],
+		GLfloat lineWidth);
+
+	void addTriangleStrip(
+		const GLfloat *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const GLfloat color[4]);
+
+	void addTexturedStrip(
+		int texture,
+		unsigned int texUnit,
+		const GLfloat *vertices,
+		const GLfloat *texCoords,
+		unsigned int count,
+		const GLfloat color[4]);
+
+	int beginMesh(
+		void);
+
+	/* Stop recording and upload the mesh to the GPU */
+	int endMesh(
+		void);
+
+	void destroyMesh(
+		int mesh);
+
+	void drawMesh(
+		int mesh,
+		const GLfloat matrix[16]);
+
+	int flush(
+		void);
+
+	unsigned int getDrawCallCount(
+		void) {
+		return mDrawCallCount;
+	}
+
+private:
+	struct gles2_hud_batch_bucket *getBucket(
+		bool textured,
+		GLuint texture,
+		unsigned int texUnit,
+		GLenum mode,
+		GLfloat lineWidth,
+		unsigned int count);
+
+	void addVertices(
+		struct gles2_hud_batch_bucket *bucket,
+		const GLfloat *vertices,
+		unsigned int dim,
+		const GLfloat *texCoords,
+		unsigned int count,
+		const GLfloat color[4]);
+
+	void reset(
+		void);
+
+	void drawBucket(
+		struct gles2_hud_batch_bucket *bucket,
+		GLuint vertexBuffer,
+		GLuint indexBuffer,
+		const GLfloat matrix[16]);
+
+	void endDraw(
+		void);
+
+	GLuint mProgram[2];
+	GLint mPositionHandle[2];
+	GLint mTransformMatrixHandle[2];
+	GLint mColorHandle[2];
+	GLint mTexCoordHandle;
+	GLint mTexUniformSampler;
+	GLuint mVertexBuffer[GLES2_HUD_BATCH_BUFFER_COUNT];
+	GLuint mIndexBuffer[GLES2_HUD_BATCH_BUFFER_COUNT];
+	size_t mVertexBufferSize[GLES2_HUD_BATCH_BUFFER_COUNT];
+	size_t mIndexBufferSize[GLES2_HUD_BATCH_BUFFER_COUNT];
+	unsigned int mBufferIndex;
+	GLfloat mTransform[16];
+	std::vector<struct gles2_hud_batch_bucket *> mBuckets;
+	unsigned int mBucketCount;
+	std::vector<struct gles2_hud_batch_bucket *> mOrder;
+	std::vector<struct gles2_hud_batch_mesh *> mMeshes;
+	int mRecordingMesh;
+	std::vector<struct gles2_hud_batch_mesh_draw> mMeshDraws;
+	int mDrawProgram;
+	GLuint mDrawTexture;
+	GLfloat mDrawLineWidth;
+	GLuint mDrawVertexBuffer;
+	GLuint mDrawIndexBuffer;
+	unsigned int mDrawCallCount;
+};
+
+} /* namespace Pdraw */
+
+#endif /* USE_GLES2 */
+
+#endif /* !_PDRAW_GLES2_HUD_BATCH_HPP_ */
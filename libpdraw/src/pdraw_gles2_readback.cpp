@@ -0,0 +1,600 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * OpenGL ES 2.0 offscreen rendering readback
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_gles2_readback.hpp"
+
+#ifdef USE_GLES2
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#define ULOG_TAG pdraw_gles2readback
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_gles2readback);
+
+namespace Pdraw {
+
+
+#define GLES2_READBACK_PROGRAM_RGBA 0
+#define GLES2_READBACK_PROGRAM_LUMA 1
+#define GLES2_READBACK_PROGRAM_CHROMA 2
+
+
+static const GLchar *readbackVertexShader =
+	"attribute vec2 position;\n"
+	"void main() {\n"
+	"    gl_Position = vec4(position, 0.0, 1.0);\n"
+	"}\n";
+
+/* The output pixels are addressed with gl_FragCoord, which needs more
+ * than mediump precision for large frames; the rows are flipped so
+ * that the image read back is top-down */
+#if defined(GL_ES_VERSION_2_0) && (defined(ANDROID) || defined(__APPLE__))
+#define GLES2_READBACK_PRECISION \
+	"#ifdef GL_FRAGMENT_PRECISION_HIGH\n" \
+	"precision highp float;\n" \
+	"#else\n" \
+	"precision mediump float;\n" \
+	"#endif\n"
+#else
+#define GLES2_READBACK_PRECISION ""
+#endif
+
+static const GLchar *readbackRgbaFragmentShader =
+	GLES2_READBACK_PRECISION
+	"uniform sampler2D s_texture;\n"
+	"uniform vec2 size;\n"
+	"void main() {\n"
+	"    vec2 t = vec2(gl_FragCoord.x / size.x,\n"
+	"        1.0 - gl_FragCoord.y / size.y);\n"
+	"    gl_FragColor = vec4(texture2D(s_texture, t).rgb, 1.0);\n"
+	"}\n";
+
+/* 4 luma samples per texel; same BT.601 full range coefficients as
+ * the YUV to RGB conversion of Gles2Video */
+static const GLchar *readbackLumaFragmentShader =
+	GLES2_READBACK_PRECISION
+	"uniform sampler2D s_texture;\n"
+	"uniform vec2 size;\n"
+	"const vec3 coefY = vec3(0.299, 0.587, 0.114);\n"
+	"void main() {\n"
+	"    float x = floor(gl_FragCoord.x) * 4.0 + 0.5;\n"
+	"    float t = 1.0 - gl_FragCoord.y / size.y;\n"
+	"    gl_FragColor = vec4(\n"
+	"        dot(texture2D(s_texture,\n"
+	"            vec2(x / size.x, t)).rgb, coefY),\n"
+	"        dot(texture2D(s_texture,\n"
+	"            vec2((x + 1.0) / size.x, t)).rgb, coefY),\n"
+	"        dot(texture2D(s_texture,\n"
+	"            vec2((x + 2.0) / size.x, t)).rgb, coefY),\n"
+	"        dot(texture2D(s_texture,\n"
+	"            vec2((x + 3.0) / size.x, t)).rgb, coefY));\n"
+	"}\n";
+
+/* 2 interleaved chroma pairs per texel; each sample is taken at the
+ * center of a 2x2 pixel block so that linear filtering averages it;
+ * the chroma rows are drawn below the luma rows */
+static const GLchar *readbackChromaFragmentShader =
+	GLES2_READBACK_PRECISION
+	"uniform sampler2D s_texture;\n"
+	"uniform vec2 size;\n"
+	"const vec3 coefU = vec3(-0.169, -0.331, 0.5);\n"
+	"const vec3 coefV = vec3(0.5, -0.419, -0.081);\n"
+	"void main() {\n"
+	"    float x = floor(gl_FragCoord.x) * 4.0 + 1.0;\n"
+	"    float t = 1.0 - (gl_FragCoord.y - size.y) * 2.0 / size.y;\n"
+	"    vec3 a = texture2D(s_texture, vec2(x / size.x, t)).rgb;\n"
+	"    vec3 b = texture2D(s_texture,\n"
+	"        vec2((x + 2.0) / size.x, t)).rgb;\n"
+	"    gl_FragColor = vec4(dot(a, coefU), dot(a, coefV),\n"
+	"        dot(b, coefU), dot(b, coefV)) + 0.5;\n"
+	"}\n";
+
+
+static const GLfloat quadVertices[8] = {
+	-1., -1.,
+	1., -1.,
+	-1., 1.,
+	1., 1.,
+};
+
+
+static GLuint createProgram(
+	const GLchar *vertexShaderSource,
+	const GLchar *fragmentShaderSource)
+{
+	GLint vertexShader = 0, fragmentShader = 0;
+	GLint success = 0;
+	GLuint program = 0;
+
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	if ((vertexShader == 0) || (vertexShader == GL_INVALID_ENUM)) {
+		ULOGE("failed to create vertex shader");
+		goto err;
+	}
+
+	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+	glCompileShader(vertexShader);
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+		ULOGE("vertex shader compilation failed '%s'", infoLog);
+		goto err;
+	}
+
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	if ((fragmentShader == 0) || (fragmentShader == GL_INVALID_ENUM)) {
+		ULOGE("failed to create fragment shader");
+		goto err;
+	}
+
+	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+	glCompileShader(fragmentShader);
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+		ULOGE("fragment shader compilation failed '%s'", infoLog);
+		goto err;
+	}
+
+	/* Link shaders */
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
+		ULOGE("program link failed '%s'", infoLog);
+		goto err;
+	}
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	return program;
+
+err:
+	if (vertexShader > 0)
+		GLCHK(glDeleteShader(vertexShader));
+	if (fragmentShader > 0)
+		GLCHK(glDeleteShader(fragmentShader));
+	if (program > 0)
+		GLCHK(glDeleteProgram(program));
+	return 0;
+}
+
+
+static GLuint createTarget(
+	unsigned int width,
+	unsigned int height,
+	unsigned int texUnit,
+	GLuint *texture)
+{
+	GLuint fbo = 0, tex = 0;
+
+	GLCHK(glGenTextures(1, &tex));
+	if (tex <= 0) {
+		ULOGE("failed to create texture");
+		return 0;
+	}
+	GLCHK(glActiveTexture(GL_TEXTURE0 + texUnit));
+	GLCHK(glBindTexture(GL_TEXTURE_2D, tex));
+	GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+	GLCHK(glTexParameteri(GL_TEXTURE_2D,
+		GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GLCHK(glTexParameteri(GL_TEXTURE_2D,
+		GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GLCHK(glTexParameterf(GL_TEXTURE_2D,
+		GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GLCHK(glTexParameterf(GL_TEXTURE_2D,
+		GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+	GLCHK(glGenFramebuffers(1, &fbo));
+	if (fbo <= 0) {
+		ULOGE("failed to create framebuffer");
+		GLCHK(glDeleteTextures(1, &tex));
+		return 0;
+	}
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+	GLCHK(glFramebufferTexture2D(GL_FRAMEBUFFER,
+		GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0));
+	GLenum gle = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLCHK(glBindTexture(GL_TEXTURE_2D, 0));
+	if (gle != GL_FRAMEBUFFER_COMPLETE) {
+		ULOGE("invalid framebuffer status");
+		GLCHK(glDeleteFramebuffers(1, &fbo));
+		GLCHK(glDeleteTextures(1, &tex));
+		return 0;
+	}
+
+	*texture = tex;
+	return fbo;
+}
+
+
+Gles2Readback::Gles2Readback(
+	unsigned int width,
+	unsigned int height,
+	enum pdraw_color_format format,
+	unsigned int firstTexUnit,
+	pdraw_offscreen_frame_callback_t cb,
+	void *userPtr)
+{
+	unsigned int i;
+	const GLchar *fragmentShader[3] = {
+		readbackRgbaFragmentShader,
+		readbackLumaFragmentShader,
+		readbackChromaFragmentShader,
+	};
+
+	mWidth = width;
+	mHeight = height;
+	mFormat = format;
+	mOutWidth = 0;
+	mOutHeight = 0;
+	mFirstTexUnit = firstTexUnit;
+	mCb = cb;
+	mUserPtr = userPtr;
+	for (i = 0; i < 3; i++) {
+		mProgram[i] = 0;
+		mPositionHandle[i] = -1;
+		mSizeHandle[i] = -1;
+		mSamplerHandle[i] = -1;
+	}
+	mFbo = 0;
+	mFboTexture = 0;
+	memset(mSlots, 0, sizeof(mSlots));
+	mSlotIndex = 0;
+	mBuffer = NULL;
+	mSequenceNumber = 0;
+
+	if ((width == 0) || (height == 0) || (cb == NULL)) {
+		ULOGE("invalid parameters");
+		return;
+	}
+	if (format == PDRAW_COLOR_FORMAT_RGBA) {
+		mOutWidth = width;
+		mOutHeight = height;
+	} else if (format == PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR) {
+		if ((width & 3) || (height & 1)) {
+			ULOGE("NV12 output needs a width multiple of 4 "
+				"and an even height");
+			return;
+		}
+		mOutWidth = width / 4;
+		mOutHeight = height + height / 2;
+	} else {
+		ULOGE("unsupported output format");
+		return;
+	}
+
+	GLCHK();
+
+	for (i = 0; i < 3; i++) {
+		if ((format == PDRAW_COLOR_FORMAT_RGBA) ?
+			(i != GLES2_READBACK_PROGRAM_RGBA) :
+			(i == GLES2_READBACK_PROGRAM_RGBA))
+			continue;
+		mProgram[i] = createProgram(readbackVertexShader,
+			fragmentShader[i]);
+		if (mProgram[i] == 0)
+			goto err;
+		mPositionHandle[i] = glGetAttribLocation(mProgram[i],
+			"position");
+		mSizeHandle[i] = glGetUniformLocation(mProgram[i], "size");
+		mSamplerHandle[i] = glGetUniformLocation(mProgram[i],
+			"s_texture");
+	}
+
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		mSlots[i].fbo = createTarget(mOutWidth, mOutHeight,
+			mFirstTexUnit, &mSlots[i].texture);
+		if (mSlots[i].fbo == 0)
+			goto err;
+	}
+
+	if (!createPixelBuffers()) {
+		mBuffer = (uint8_t *)malloc(
+			(size_t)mOutWidth * mOutHeight * 4);
+		if (mBuffer == NULL) {
+			ULOGE("allocation failed");
+			goto err;
+		}
+	}
+
+	/* Created last: a non-zero framebuffer means success */
+	mFbo = createTarget(mWidth, mHeight, mFirstTexUnit, &mFboTexture);
+	if (mFbo == 0)
+		goto err;
+
+	return;
+
+err:
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		if (mSlots[i].fbo > 0)
+			GLCHK(glDeleteFramebuffers(1, &mSlots[i].fbo));
+		if (mSlots[i].texture > 0)
+			GLCHK(glDeleteTextures(1, &mSlots[i].texture));
+		if (mSlots[i].pbo > 0)
+			GLCHK(glDeleteBuffers(1, &mSlots[i].pbo));
+		mSlots[i].fbo = 0;
+		mSlots[i].texture = 0;
+		mSlots[i].pbo = 0;
+	}
+	for (i = 0; i < 3; i++) {
+		if (mProgram[i] > 0)
+			GLCHK(glDeleteProgram(mProgram[i]));
+		mProgram[i] = 0;
+	}
+	free(mBuffer);
+	mBuffer = NULL;
+}
+
+
+Gles2Readback::~Gles2Readback(
+	void)
+{
+	unsigned int i;
+
+	if (mFbo > 0)
+		GLCHK(glDeleteFramebuffers(1, &mFbo));
+	if (mFboTexture > 0)
+		GLCHK(glDeleteTextures(1, &mFboTexture));
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		if (mSlots[i].fbo > 0)
+			GLCHK(glDeleteFramebuffers(1, &mSlots[i].fbo));
+		if (mSlots[i].texture > 0)
+			GLCHK(glDeleteTextures(1, &mSlots[i].texture));
+		if (mSlots[i].pbo > 0)
+			GLCHK(glDeleteBuffers(1, &mSlots[i].pbo));
+	}
+	for (i = 0; i < 3; i++) {
+		if (mProgram[i] > 0)
+			GLCHK(glDeleteProgram(mProgram[i]));
+	}
+	free(mBuffer);
+}
+
+
+/* Returns true if every slot got a pixel pack buffer */
+bool Gles2Readback::createPixelBuffers(
+	void)
+{
+#ifdef GLES2_READBACK_PBO
+	const char *version = (const char *)glGetString(GL_VERSION);
+	unsigned int i;
+
+	/* The API may be declared while the context is GLES 2.0 */
+	if ((version == NULL) ||
+		(strncmp(version, "OpenGL ES ", 10) != 0) ||
+		(atoi(version + 10) < 3))
+		return false;
+
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		GLCHK(glGenBuffers(1, &mSlots[i].pbo));
+		if (mSlots[i].pbo == 0)
+			break;
+		GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, mSlots[i].pbo));
+		GLCHK(glBufferData(GL_PIXEL_PACK_BUFFER,
+			(GLsizeiptr)mOutWidth * mOutHeight * 4, NULL,
+			GL_STREAM_READ));
+	}
+	GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	if (i == GLES2_READBACK_RING_SIZE)
+		return true;
+
+	ULOGW("failed to create the pixel buffers, "
+		"falling back to synchronous readback");
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		if (mSlots[i].pbo > 0)
+			GLCHK(glDeleteBuffers(1, &mSlots[i].pbo));
+		mSlots[i].pbo = 0;
+	}
+#endif /* GLES2_READBACK_PBO */
+	return false;
+}
+
+
+int Gles2Readback::readSlot(
+	struct gles2_readback_slot *slot)
+{
+	slot->pending = false;
+
+#ifdef GLES2_READBACK_PBO
+	if (slot->pbo > 0) {
+		int ret;
+
+		/* The pixels were packed when the frame was converted */
+		GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo));
+		const uint8_t *data = (const uint8_t *)glMapBufferRange(
+			GL_PIXEL_PACK_BUFFER, 0,
+			(GLsizeiptr)mOutWidth * mOutHeight * 4, GL_MAP_READ_BIT);
+		if (data == NULL) {
+			GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+			ULOGE("failed to map the pixel buffer");
+			return -EIO;
+		}
+		ret = deliverSlot(slot, data);
+		GLCHK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+		GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+		return ret;
+	}
+#endif /* GLES2_READBACK_PBO */
+
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, slot->fbo));
+	GLCHK(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+	GLCHK(glReadPixels(0, 0, mOutWidth, mOutHeight, GL_RGBA,
+		GL_UNSIGNED_BYTE, mBuffer));
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+	return deliverSlot(slot, mBuffer);
+}
+
+
+int Gles2Readback::deliverSlot(
+	struct gles2_readback_slot *slot,
+	const uint8_t *data)
+{
+	struct pdraw_video_frame frame;
+
+	memcpy(&frame, &slot->info, sizeof(frame));
+	memset(frame.plane, 0, sizeof(frame.plane));
+	memset(frame.stride, 0, sizeof(frame.stride));
+	frame.userData = NULL;
+	frame.userDataSize = 0;
+	frame.scaleCount = 0;
+	frame.colorFormat = mFormat;
+	frame.width = mWidth;
+	frame.height = mHeight;
+	frame.sarWidth = 1;
+	frame.sarHeight = 1;
+	frame.plane[0] = data;
+	if (mFormat == PDRAW_COLOR_FORMAT_RGBA) {
+		frame.stride[0] = mWidth * 4;
+	} else {
+		frame.stride[0] = mWidth;
+		frame.plane[1] = data + (size_t)mWidth * mHeight;
+		frame.stride[1] = mWidth;
+	}
+	frame.sequenceNumber = mSequenceNumber++;
+
+	mCb(&frame, mUserPtr);
+
+	return 0;
+}
+
+
+int Gles2Readback::endFrame(
+	const struct pdraw_video_frame *info)
+{
+	struct gles2_readback_slot *slot;
+	int program;
+	int ret;
+
+	if (mFbo == 0)
+		return -EPROTO;
+
+	/* Reuse the oldest slot; its frame was rendered
+	 * GLES2_READBACK_RING_SIZE frames ago */
+	slot = &mSlots[mSlotIndex];
+	if (slot->pending) {
+		ret = readSlot(slot);
+		if (ret < 0)
+			ULOG_ERRNO("readSlot", -ret);
+	}
+
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, slot->fbo));
+	GLCHK(glDisable(GL_BLEND));
+	GLCHK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit));
+	GLCHK(glBindTexture(GL_TEXTURE_2D, mFboTexture));
+
+	for (program = 0; program < 3; program++) {
+		if (mProgram[program] == 0)
+			continue;
+		if (program == GLES2_READBACK_PROGRAM_CHROMA) {
+			GLCHK(glViewport(0, mHeight, mOutWidth,
+				mHeight / 2));
+		} else {
+			GLCHK(glViewport(0, 0, mOutWidth, mHeight));
+		}
+		GLCHK(glUseProgram(mProgram[program]));
+		GLCHK(glUniform1i(mSamplerHandle[program], mFirstTexUnit));
+		GLCHK(glUniform2f(mSizeHandle[program],
+			(GLfloat)mWidth, (GLfloat)mHeight));
+		GLCHK(glVertexAttribPointer(mPositionHandle[program], 2,
+			GL_FLOAT, false, 0, quadVertices));
+		GLCHK(glEnableVertexAttribArray(mPositionHandle[program]));
+		GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+		GLCHK(glDisableVertexAttribArray(mPositionHandle[program]));
+	}
+
+	GLCHK(glBindTexture(GL_TEXTURE_2D, 0));
+
+#ifdef GLES2_READBACK_PBO
+	if (slot->pbo > 0) {
+		/* Asynchronous copy into the pixel buffer, mapped when the
+		 * slot is reused */
+		GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo));
+		GLCHK(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+		GLCHK(glReadPixels(0, 0, mOutWidth, mOutHeight, GL_RGBA,
+			GL_UNSIGNED_BYTE, 0));
+		GLCHK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	}
+#endif /* GLES2_READBACK_PBO */
+
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+	/* Submit the commands now so that the GPU works on the frame
+	 * while the next ones are rendered */
+	GLCHK(glFlush());
+
+	if (info != NULL)
+		memcpy(&slot->info, info, sizeof(slot->info));
+	else
+		memset(&slot->info, 0, sizeof(slot->info));
+	slot->pending = true;
+	mSlotIndex = (mSlotIndex + 1) % GLES2_READBACK_RING_SIZE;
+
+	return 0;
+}
+
+
+int Gles2Readback::flush(
+	void)
+{
+	unsigned int i;
+	int ret;
+
+	if (mFbo == 0)
+		return -EPROTO;
+
+	/* The oldest slot is the next one to be reused */
+	for (i = 0; i < GLES2_READBACK_RING_SIZE; i++) {
+		struct gles2_readback_slot *slot =
+			&mSlots[(mSlotIndex + i) % GLES2_READBACK_RING_SIZE];
+		if (!slot->pending)
+			continue;
+		ret = readSlot(slot);
+		if (ret < 0)
+			ULOG_ERRNO("readSlot", -ret);
+	}
+
+	return 0;
+}
+
+} /* namespace Pdraw */
+
+#endif /* USE_GLES2 */
@@ -0,0 +1,145 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * OpenGL ES 2.0 offscreen rendering readback
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_GLES2_READBACK_HPP_
+#define _PDRAW_GLES2_READBACK_HPP_
+
+#ifdef USE_GLES2
+
+#include <inttypes.h>
+#include <pdraw/pdraw_defs.h>
+#include "pdraw_gles2_common.hpp"
+#if defined(ANDROID_NDK) && (__ANDROID_API__ >= 18)
+	#include <GLES3/gl3.h>
+#endif
+
+/* Pixel pack buffers need the OpenGL ES 3.0 API */
+#if defined(GL_ES_VERSION_3_0)
+	#define GLES2_READBACK_PBO
+#endif
+
+namespace Pdraw {
+
+
+/* Frames in flight between the rendering and the readback */
+#define GLES2_READBACK_RING_SIZE (3)
+
+
+struct gles2_readback_slot {
+	GLuint fbo;
+	GLuint texture;
+	/* Pixel pack buffer, 0 without the GLES 3.0 API */
+	GLuint pbo;
+	bool pending;
+	/* Timestamps and metadata of the rendered frame */
+	struct pdraw_video_frame info;
+};
+
+
+/**
+ * Offscreen render target: the frame is rendered into a framebuffer
+ * object, then converted on the GPU to a packed RGBA or NV12 image
+ * (4 luma or 2 chroma pairs per RGBA texel) in the next slot of a ring.
+ * A slot is read back only when it is reused, GLES2_READBACK_RING_SIZE
+ * frames later, so that glReadPixels() does not wait for the GPU to
+ * finish the current frame. With a GLES 3.0 context the pixels are
+ * packed into a per-slot pixel buffer right after the conversion and
+ * the readback only maps it. Frames are delivered to the callback on
+ * the rendering thread.
+ */
+class Gles2Readback {
+public:
+	Gles2Readback(
+		unsigned int width,
+		unsigned int height,
+		enum pdraw_color_format format,
+		unsigned int firstTexUnit,
+		pdraw_offscreen_frame_callback_t cb,
+		void *userPtr);
+
+	~Gles2Readback(
+		void);
+
+	static int getTexUnitCount(
+		void) {
+		return 1;
+	}
+
+	/* Framebuffer to render the frames into; 0 if the
+	 * initialization failed */
+	GLuint getFramebuffer(
+		void) {
+		return mFbo;
+	}
+
+	/* Queue the readback of the frame rendered into the framebuffer;
+	 * info holds its timestamps and metadata (can be NULL) */
+	int endFrame(
+		const struct pdraw_video_frame *info);
+
+	/* Read back and deliver all the pending frames */
+	int flush(
+		void);
+
+private:
+	int readSlot(
+		struct gles2_readback_slot *slot);
+
+	int deliverSlot(
+		struct gles2_readback_slot *slot,
+		const uint8_t *data);
+
+	bool createPixelBuffers(
+		void);
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+	enum pdraw_color_format mFormat;
+	unsigned int mOutWidth;
+	unsigned int mOutHeight;
+	unsigned int mFirstTexUnit;
+	pdraw_offscreen_frame_callback_t mCb;
+	void *mUserPtr;
+	GLuint mProgram[3];
+	GLint mPositionHandle[3];
+	GLint mSizeHandle[3];
+	GLint mSamplerHandle[3];
+	GLuint mFbo;
+	GLuint mFboTexture;
+	struct gles2_readback_slot mSlots[GLES2_READBACK_RING_SIZE];
+	unsigned int mSlotIndex;
+	uint8_t *mBuffer;
+	uint64_t mSequenceNumber;
+};
+
+} /* namespace Pdraw */
+
+#endif /* USE_GLES2 */
+
+#endif /* !_PDRAW_GLES2_READBACK_HPP_ */
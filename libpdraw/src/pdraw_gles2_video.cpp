@@ -32,6 +32,7 @@
 #ifdef USE_GLES2
 
 #include <math.h>
+#include <string.h>
 #define ULOG_TAG pdraw_gles2vid
 #include <ulog.h>
 ULOG_DECLARE_TAG(pdraw_gles2vid);
@@ -49,6 +50,11 @@ namespace Pdraw {
 #define PDRAW_GLES2_VIDEO_DEFAULT_HFOV (78.)
 #define PDRAW_GLES2_VIDEO_DEFAULT_VFOV (49.)
 
+#ifndef GL_UNPACK_ROW_LENGTH
+/* Same value as GL_UNPACK_ROW_LENGTH_EXT (GL_EXT_unpack_subimage) */
+#  define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
 
 static const GLchar *videoVertexShader =
 	"uniform mat4 transform_matrix;\n"
@@ -134,7 +140,8 @@ Gles2Video::Gles2Video(
 	GLint fragmentShaderYuvp = 0, fragmentShaderYuvsp = 0;
 	GLint success = 0;
 	GLenum gle;
-	unsigned int i;
+	unsigned int i, j;
+	const char *glVersion, *glExtensions;
 
 	mSession = session;
 	mMedia = media;
@@ -142,12 +149,25 @@ Gles2Video::Gles2Video(
 	mPaddingWidth = mPaddingHeight = GLES2_VIDEO_PADDING_FBO_WIDTH;
 	memset(mProgram, 0, sizeof(mProgram));
 	memset(mTextures, 0, sizeof(mTextures));
+	memset(mTexFormat, 0, sizeof(mTexFormat));
+	memset(mTexWidth, 0, sizeof(mTexWidth));
+	memset(mTexHeight, 0, sizeof(mTexHeight));
+	mTexSet = 0;
 	mPaddingFbo = 0;
 	mPaddingFboTexture = 0;
 #ifdef BCM_VIDEOCORE
 	mEglImage = EGL_NO_IMAGE_KHR;
 #endif /* BCM_VIDEOCORE */
 
+	/* Row length unpacking is core in desktop GL and GLES 3, and an
+	 * extension in GLES 2; without it the stride padding is uploaded */
+	glVersion = (const char *)glGetString(GL_VERSION);
+	glExtensions = (const char *)glGetString(GL_EXTENSIONS);
+	mUnpackRowLength = ((glVersion != NULL) &&
+		(strncmp(glVersion, "OpenGL ES 2", 11) != 0)) ||
+		((glExtensions != NULL) &&
+		(strstr(glExtensions, "GL_EXT_unpack_subimage") != NULL));
+
 	if (mMedia != NULL) {
 		unsigned int width = 0, height = 0;
 		mMedia->getDimensions(NULL, NULL, NULL, NULL, NULL, NULL,
@@ -384,29 +404,33 @@ Gles2Video::Gles2Video(
 
 	GLCHK();
 
-	GLCHK(glGenTextures(GLES2_VIDEO_TEX_UNIT_COUNT, mTextures));
+	GLCHK(glGenTextures(GLES2_VIDEO_TEX_SET_COUNT *
+		GLES2_VIDEO_TEX_UNIT_COUNT, &mTextures[0][0]));
 
-	for (i = 0; i < GLES2_VIDEO_TEX_UNIT_COUNT; i++) {
-		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
+	for (j = 0; j < GLES2_VIDEO_TEX_SET_COUNT; j++) {
+		for (i = 0; i < GLES2_VIDEO_TEX_UNIT_COUNT; i++) {
+			GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
 #ifdef BCM_VIDEOCORE
-		if (i == 0) {
-			GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES,
-				mTextures[i]));
-		} else {
-			GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[i]));
-		}
+			if (i == 0) {
+				GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES,
+					mTextures[j][i]));
+			} else {
+				GLCHK(glBindTexture(GL_TEXTURE_2D,
+					mTextures[j][i]));
+			}
 #else /* BCM_VIDEOCORE */
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[i]));
+			GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[j][i]));
 #endif /* BCM_VIDEOCORE */
 
-		GLCHK(glTexParameteri(GL_TEXTURE_2D,
-			GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-		GLCHK(glTexParameteri(GL_TEXTURE_2D,
-			GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-		GLCHK(glTexParameterf(GL_TEXTURE_2D,
-			GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-		GLCHK(glTexParameterf(GL_TEXTURE_2D,
-			GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+			GLCHK(glTexParameteri(GL_TEXTURE_2D,
+				GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+			GLCHK(glTexParameteri(GL_TEXTURE_2D,
+				GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+			GLCHK(glTexParameterf(GL_TEXTURE_2D,
+				GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+			GLCHK(glTexParameterf(GL_TEXTURE_2D,
+				GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		}
 	}
 
 	GLCHK(glGenFramebuffers(1, &mPaddingFbo));
@@ -453,8 +477,9 @@ Gles2Video::Gles2Video(
 	return;
 
 err:
-	if (mTextures[0]) {
-		GLCHK(glDeleteTextures(GLES2_VIDEO_TEX_UNIT_COUNT, mTextures));
+	if (mTextures[0][0]) {
+		GLCHK(glDeleteTextures(GLES2_VIDEO_TEX_SET_COUNT *
+			GLES2_VIDEO_TEX_UNIT_COUNT, &mTextures[0][0]));
 	}
 	if (mPaddingFboTexture > 0) {
 		GLCHK(glDeleteTextures(1, &mPaddingFboTexture));
@@ -492,8 +517,10 @@ err:
 Gles2Video::~Gles2Video(
 	void)
 {
-	if (mTextures[0])
-		GLCHK(glDeleteTextures(GLES2_VIDEO_TEX_UNIT_COUNT, mTextures));
+	if (mTextures[0][0]) {
+		GLCHK(glDeleteTextures(GLES2_VIDEO_TEX_SET_COUNT *
+			GLES2_VIDEO_TEX_UNIT_COUNT, &mTextures[0][0]));
+	}
 	if (mPaddingFboTexture > 0)
 		GLCHK(glDeleteTextures(1, &mPaddingFboTexture));
 	if (mPaddingFbo > 0)
@@ -544,7 +571,10 @@ int Gles2Video::loadFrame(
 	enum gles2_video_color_conversion colorConversion,
 	struct egl_display *eglDisplay)
 {
-	unsigned int i;
+	int ret = 0;
+	unsigned int i, set, planeCount = 0;
+	GLenum format[GLES2_VIDEO_TEX_UNIT_COUNT];
+	unsigned int bpp[GLES2_VIDEO_TEX_UNIT_COUNT];
 
 	if ((frameWidth == 0) || (frameHeight == 0) || (frameStride[0] == 0)) {
 		ULOGE("invalid dimensions");
@@ -560,7 +590,7 @@ int Gles2Video::loadFrame(
 #ifdef BCM_VIDEOCORE
 		EGLDisplay display = (EGLDisplay)eglDisplay;
 		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit));
-		GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, mTextures[0]));
+		GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, mTextures[0][0]));
 		if (mEglImage != EGL_NO_IMAGE_KHR) {
 			eglDestroyImageKHR(display, mEglImage);
 			mEglImage = EGL_NO_IMAGE_KHR;
@@ -577,35 +607,92 @@ int Gles2Video::loadFrame(
 		GLCHK(glUniform1i(mUniformSamplers[colorConversion][0],
 			mFirstTexUnit));
 #endif /* BCM_VIDEOCORE */
-		break;
+		return 0;
 	}
 	case GLES2_VIDEO_COLOR_CONVERSION_YUV420PLANAR_TO_RGB:
-		for (i = 0; i < GLES2_VIDEO_TEX_UNIT_COUNT; i++) {
-			GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
-			GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[i]));
-			GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE,
-				frameStride[i], frameHeight / ((i > 0) ? 2 : 1),
-				0, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-				frameData + framePlaneOffset[i]));
+		planeCount = 3;
+		for (i = 0; i < planeCount; i++) {
+			format[i] = GL_LUMINANCE;
+			bpp[i] = 1;
 		}
 		break;
 	case GLES2_VIDEO_COLOR_CONVERSION_YUV420SEMIPLANAR_TO_RGB:
-		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + 0));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[0]));
-		GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE,
-			frameStride[0], frameHeight,
-			0, GL_LUMINANCE, GL_UNSIGNED_BYTE,
-			frameData + framePlaneOffset[0]));
-
-		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + 1));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[1]));
-		GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA,
-			frameStride[1] / 2, frameHeight / 2,
-			0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
-			frameData + framePlaneOffset[1]));
+		planeCount = 2;
+		format[0] = GL_LUMINANCE;
+		bpp[0] = 1;
+		format[1] = GL_LUMINANCE_ALPHA;
+		bpp[1] = 2;
 		break;
 	}
 
+	/* Upload to the set not used by the last rendered frame */
+	set = (mTexSet + 1) % GLES2_VIDEO_TEX_SET_COUNT;
+
+	GLCHK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+	for (i = 0; i < planeCount; i++) {
+		unsigned int w = (i > 0) ? (frameWidth + 1) / 2 : frameWidth;
+		unsigned int h = (i > 0) ? (frameHeight + 1) / 2 : frameHeight;
+		unsigned int rowLength = frameStride[i] / bpp[i];
+
+		/* Without row length unpacking, the stride padding is
+		 * uploaded and the texture is as wide as the stride */
+		if (!mUnpackRowLength)
+			w = rowLength;
+
+		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
+		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[set][i]));
+		if ((mTexFormat[set][i] != format[i]) ||
+			(mTexWidth[set][i] != w) ||
+			(mTexHeight[set][i] != h)) {
+			ret = allocTextureStorage(set, i, format[i], w, h);
+			if (ret < 0)
+				break;
+		}
+		if (mUnpackRowLength)
+			GLCHK(glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength));
+		GLCHK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h,
+			format[i], GL_UNSIGNED_BYTE,
+			frameData + framePlaneOffset[i]));
+	}
+	if (mUnpackRowLength)
+		GLCHK(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+	GLCHK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	if (ret < 0)
+		return ret;
+
+	mTexSet = set;
+
+	return 0;
+}
+
+
+int Gles2Video::allocTextureStorage(
+	unsigned int set,
+	unsigned int index,
+	GLenum format,
+	unsigned int width,
+	unsigned int height)
+{
+	GLenum err;
+
+	/* The texture must be bound; storage is only re-specified on
+	 * a format or dimensions change */
+	while (glGetError() != GL_NO_ERROR)
+		;
+	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+		format, GL_UNSIGNED_BYTE, NULL);
+	err = glGetError();
+	if (err != GL_NO_ERROR) {
+		ULOGE("texture storage allocation failed (%ux%u, 0x%x)",
+			width, height, err);
+		mTexFormat[set][index] = 0;
+		mTexWidth[set][index] = mTexHeight[set][index] = 0;
+		return -ENOMEM;
+	}
+	mTexFormat[set][index] = format;
+	mTexWidth[set][index] = width;
+	mTexHeight[set][index] = height;
+
 	return 0;
 }
 
@@ -626,11 +713,13 @@ int Gles2Video::renderFrame(
 	enum gles2_video_color_conversion colorConversion,
 	const struct vmeta_frame_v2 *metadata,
 	bool headtracking,
+	const struct vmeta_quaternion *headOrientation,
 	GLuint fbo)
 {
 	unsigned int i;
 	float vertices[16];
 	float texCoords[8];
+	float texWidth;
 
 	if ((cropWidth == 0) || (cropHeight == 0) ||
 		(sarWidth == 0) || (sarHeight == 0) ||
@@ -640,15 +729,20 @@ int Gles2Video::renderFrame(
 		return -EINVAL;
 	}
 
+	/* The renderer clears the render area once per frame, a clear
+	 * here would also erase the tiles of the other medias */
 	GLCHK(glUseProgram(mProgram[colorConversion]));
-	GLCHK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+	/* Uploaded textures may be narrower than the stride */
+	texWidth = (mTexWidth[mTexSet][0] > 0) ?
+		(float)mTexWidth[mTexSet][0] : (float)frameStride[0];
 
 	switch (colorConversion) {
 	default:
 	case GLES2_VIDEO_COLOR_CONVERSION_NONE:
 #ifdef BCM_VIDEOCORE
 		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit));
-		GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, mTextures[0]));
+		GLCHK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, mTextures[0][0]));
 		GLCHK(glUniform1i(mUniformSamplers[colorConversion][0],
 			mFirstTexUnit));
 #endif /* BCM_VIDEOCORE */
@@ -656,19 +750,20 @@ int Gles2Video::renderFrame(
 	case GLES2_VIDEO_COLOR_CONVERSION_YUV420PLANAR_TO_RGB:
 		for (i = 0; i < GLES2_VIDEO_TEX_UNIT_COUNT; i++) {
 			GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
-			GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[i]));
+			GLCHK(glBindTexture(GL_TEXTURE_2D,
+				mTextures[mTexSet][i]));
 			GLCHK(glUniform1i(mUniformSamplers[colorConversion][i],
 				mFirstTexUnit + i));
 		}
 		break;
 	case GLES2_VIDEO_COLOR_CONVERSION_YUV420SEMIPLANAR_TO_RGB:
 		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + 0));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[0]));
+		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[mTexSet][0]));
 		GLCHK(glUniform1i(mUniformSamplers[colorConversion][0],
 			mFirstTexUnit + 0));
 
 		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + 1));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[1]));
+		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[mTexSet][1]));
 		GLCHK(glUniform1i(mUniformSamplers[colorConversion][1],
 			mFirstTexUnit + 1));
 		break;
@@ -713,8 +808,13 @@ int Gles2Video::renderFrame(
 	createProjectionMatrix(projMat, hFov, hFov,
 		windowW, windowH, 0.1, 100.);
 
-	if ((headtracking) && (mSession)) {
-		Eigen::Quaternionf headQuat =
+	if ((headtracking) && ((headOrientation) || (mSession))) {
+		/* The renderer latches the orientation shared by the passes
+		 * of a frame */
+		Eigen::Quaternionf headQuat = (headOrientation) ?
+			Eigen::Quaternionf(headOrientation->w,
+				headOrientation->x, headOrientation->y,
+				headOrientation->z) :
 			mSession->getSelfMetadata()->getDebiasedHeadOrientation();
 		Eigen::Matrix3f headRotNed = headQuat.toRotationMatrix();
 
@@ -770,30 +870,30 @@ int Gles2Video::renderFrame(
 			mPositionHandle[colorConversion]));
 
 #ifdef BCM_VIDEOCORE
-		texCoords[0] = (float)cropLeft / (float)frameStride[0];
+		texCoords[0] = (float)cropLeft / texWidth;
 		texCoords[1] = (float)cropTop / (float)frameHeight;
 		texCoords[2] = (float)(cropLeft + cropWidth) /
-			(float)frameStride[0];
+			texWidth;
 		texCoords[3] = (float)cropTop / (float)frameHeight;
-		texCoords[4] = (float)cropLeft / (float)frameStride[0];
+		texCoords[4] = (float)cropLeft / texWidth;
 		texCoords[5] = (float)(cropTop + cropHeight) /
 			(float)frameHeight;
 		texCoords[6] = (float)(cropLeft + cropWidth) /
-			(float)frameStride[0];
+			texWidth;
 		texCoords[7] = (float)(cropTop + cropHeight) /
 			(float)frameHeight;
 #else /* BCM_VIDEOCORE */
-		texCoords[0] = (float)cropLeft / (float)frameStride[0];
+		texCoords[0] = (float)cropLeft / texWidth;
 		texCoords[1] = (float)(cropTop + cropHeight) /
 			(float)frameHeight;
 		texCoords[2] = (float)(cropLeft + cropWidth) /
-			(float)frameStride[0];
+			texWidth;
 		texCoords[3] = (float)(cropTop + cropHeight) /
 			(float)frameHeight;
-		texCoords[4] = (float)cropLeft / (float)frameStride[0];
+		texCoords[4] = (float)cropLeft / texWidth;
 		texCoords[5] = (float)cropTop / (float)frameHeight;
 		texCoords[6] = (float)(cropLeft + cropWidth) /
-			(float)frameStride[0];
+			texWidth;
 		texCoords[7] = (float)cropTop / (float)frameHeight;
 #endif /* BCM_VIDEOCORE */
 
@@ -899,22 +999,22 @@ int Gles2Video::renderFrame(
 	GLCHK(glEnableVertexAttribArray(mPositionHandle[colorConversion]));
 
 #ifdef BCM_VIDEOCORE
-	texCoords[0] = (float)cropLeft / (float)frameStride[0];
+	texCoords[0] = (float)cropLeft / texWidth;
 	texCoords[1] = (float)cropTop / (float)frameHeight;
-	texCoords[2] = (float)(cropLeft + cropWidth) / (float)frameStride[0];
+	texCoords[2] = (float)(cropLeft + cropWidth) / texWidth;
 	texCoords[3] = (float)cropTop / (float)frameHeight;
-	texCoords[4] = (float)cropLeft / (float)frameStride[0];
+	texCoords[4] = (float)cropLeft / texWidth;
 	texCoords[5] = (float)(cropTop + cropHeight) / (float)frameHeight;
-	texCoords[6] = (float)(cropLeft + cropWidth) / (float)frameStride[0];
+	texCoords[6] = (float)(cropLeft + cropWidth) / texWidth;
 	texCoords[7] = (float)(cropTop + cropHeight) / (float)frameHeight;
 #else /* BCM_VIDEOCORE */
-	texCoords[0] = (float)cropLeft / (float)frameStride[0];
+	texCoords[0] = (float)cropLeft / texWidth;
 	texCoords[1] = (float)(cropTop + cropHeight) / (float)frameHeight;
-	texCoords[2] = (float)(cropLeft + cropWidth) / (float)frameStride[0];
+	texCoords[2] = (float)(cropLeft + cropWidth) / texWidth;
 	texCoords[3] = (float)(cropTop + cropHeight) / (float)frameHeight;
-	texCoords[4] = (float)cropLeft / (float)frameStride[0];
+	texCoords[4] = (float)cropLeft / texWidth;
 	texCoords[5] = (float)cropTop / (float)frameHeight;
-	texCoords[6] = (float)(cropLeft + cropWidth) / (float)frameStride[0];
+	texCoords[6] = (float)(cropLeft + cropWidth) / texWidth;
 	texCoords[7] = (float)cropTop / (float)frameHeight;
 #endif /* BCM_VIDEOCORE */
 
@@ -934,7 +1034,7 @@ int Gles2Video::renderFrame(
 GLuint* Gles2Video::getTextures(
 	void)
 {
-	return mTextures;
+	return mTextures[mTexSet];
 }
 
 
@@ -946,10 +1046,11 @@ int Gles2Video::allocTextures(
 
 	for (i = 0; i < GLES2_VIDEO_TEX_UNIT_COUNT; i++) {
 		GLCHK(glActiveTexture(GL_TEXTURE0 + mFirstTexUnit + i));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[i]));
-		GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-			videoWidth, videoHeight, 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+		GLCHK(glBindTexture(GL_TEXTURE_2D, mTextures[mTexSet][i]));
+		ret = allocTextureStorage(mTexSet, i, GL_RGBA,
+			videoWidth, videoHeight);
+		if (ret < 0)
+			break;
 	}
 
 	return ret;
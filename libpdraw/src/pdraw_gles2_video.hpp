@@ -44,6 +44,14 @@ namespace Pdraw {
 
 
 #define GLES2_VIDEO_TEX_UNIT_COUNT 3
+#ifdef BCM_VIDEOCORE
+/* Frames are bound as EGL images, there is no upload to overlap */
+#  define GLES2_VIDEO_TEX_SET_COUNT 1
+#else /* BCM_VIDEOCORE */
+/* Frame N+1 is uploaded to one set while frame N is rendered from
+ * the other */
+#  define GLES2_VIDEO_TEX_SET_COUNT 2
+#endif /* BCM_VIDEOCORE */
 #define GLES2_VIDEO_FBO_TEX_UNIT_COUNT 1
 #define GLES2_VIDEO_PADDING_FBO_WIDTH 32
 
@@ -107,18 +115,36 @@ public:
 		unsigned int renderHeight,
 		enum gles2_video_color_conversion colorConversion,
 		const struct vmeta_frame_v2 *metadata,
-		bool headtracking, GLuint fbo);
+		bool headtracking,
+		const struct vmeta_quaternion *headOrientation,
+		GLuint fbo);
 
 	void setVideoMedia(
 		VideoMedia *media);
 
 private:
+	int allocTextureStorage(
+		unsigned int set,
+		unsigned int index,
+		GLenum format,
+		unsigned int width,
+		unsigned int height);
+
 	Session *mSession;
 	VideoMedia *mMedia;
 	unsigned int mFirstTexUnit;
 	GLint mProgram[GLES2_VIDEO_COLOR_CONVERSION_MAX];
 	GLint mProgramTransformMatrix[GLES2_VIDEO_COLOR_CONVERSION_MAX];
-	GLuint mTextures[GLES2_VIDEO_TEX_UNIT_COUNT];
+	GLuint mTextures[GLES2_VIDEO_TEX_SET_COUNT][GLES2_VIDEO_TEX_UNIT_COUNT];
+	/* Allocated storage of each texture (0: not allocated) */
+	GLenum mTexFormat[GLES2_VIDEO_TEX_SET_COUNT][GLES2_VIDEO_TEX_UNIT_COUNT];
+	unsigned int mTexWidth[GLES2_VIDEO_TEX_SET_COUNT][
+		GLES2_VIDEO_TEX_UNIT_COUNT];
+	unsigned int mTexHeight[GLES2_VIDEO_TEX_SET_COUNT][
+		GLES2_VIDEO_TEX_UNIT_COUNT];
+	/* Set holding the last loaded frame */
+	unsigned int mTexSet;
+	bool mUnpackRowLength;
 	GLint mUniformSamplers[GLES2_VIDEO_COLOR_CONVERSION_MAX][
 		GLES2_VIDEO_TEX_UNIT_COUNT];
 	GLint mPositionHandle[GLES2_VIDEO_COLOR_CONVERSION_MAX];
@@ -27,21 +27,20 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "pdraw_gles2_hud.hpp"
-
-#ifdef USE_GLES2
+#include "pdraw_hud.hpp"
 
+#include <errno.h>
 #include <stdio.h>
-#define ULOG_TAG pdraw_gles2hud
+#define ULOG_TAG pdraw_hud
 #include <ulog.h>
-ULOG_DECLARE_TAG(pdraw_gles2hud);
+ULOG_DECLARE_TAG(pdraw_hud);
 
 #include "pdraw_session.hpp"
 #include "pdraw_settings.hpp"
 #include "pdraw_media_video.hpp"
 
-#include "pdraw_gles2_hud_icons.cpp"
-#include "pdraw_gles2_hud_text_profontwindows36.cpp"
+#include "pdraw_hud_icons.cpp"
+#include "pdraw_hud_text_profontwindows36.cpp"
 
 namespace Pdraw {
 
@@ -54,48 +53,6 @@ namespace Pdraw {
 #endif
 
 
-static const GLchar *hudVertexShader =
-	"uniform mat4 transform_matrix;\n"
-	"attribute vec4 vPosition;\n"
-	"void main() {\n"
-	"    gl_Position = transform_matrix * vPosition;\n"
-	"}\n";
-
-static const GLchar *hudFragmentShader =
-#if defined(GL_ES_VERSION_2_0) && (defined(ANDROID) || defined(__APPLE__))
-	"precision mediump float;\n"
-#endif
-	"uniform vec4 vColor;\n"
-	"void main() {\n"
-	"    gl_FragColor = vColor;\n"
-	"}\n";
-
-static const GLchar *hudTexVertexShader =
-	"uniform mat4 transform_matrix;\n"
-	"attribute vec4 position;\n"
-	"attribute vec2 texcoord;\n"
-	"varying vec2 v_texcoord;\n"
-	"\n"
-	"void main()\n"
-	"{\n"
-	"    gl_Position = transform_matrix * position;\n"
-	"    v_texcoord = texcoord;\n"
-	"}\n";
-
-static const GLchar *hudTexFragmentShader =
-#if defined(GL_ES_VERSION_2_0) && (defined(ANDROID) || defined(__APPLE__))
-	"precision mediump float;\n"
-#endif
-	"uniform vec4 vColor;\n"
-	"varying vec2 v_texcoord;\n"
-	"uniform sampler2D s_texture;\n"
-	"\n"
-	"void main()\n"
-	"{\n"
-	"    gl_FragColor = vec4(vColor.r, vColor.g, vColor.b, "
-		"texture2D(s_texture, v_texcoord).r);\n"
-	"}\n";
-
 static const int pdraw_droneModelIconIndex[] = {
 	2,
 	0,
@@ -130,6 +87,14 @@ static const char *pdraw_strPilotingMode[] = {
 	"FOLLOW ME",
 };
 
+/* min, max, critical min, critical max of the battery level, Wi-Fi RSSI
+ * and satellite count vu-meters */
+static const float pdraw_vuMeterRange[3][4] = {
+	{ 0., 100., 0., 20. },
+	{ -90., -20., -90., -70. },
+	{ 0., 30., 0., 5. },
+};
+
 static const float colorGreen[4] = {
 	0.0f, 0.9f, 0.0f, 1.0f
 };
@@ -151,30 +116,30 @@ static const float colorGray2[4] = {
 };
 
 
-Gles2Hud::Gles2Hud(
+Hud::Hud(
 	Session *session,
 	VideoMedia *media,
+	HudCanvas *canvas,
 	unsigned int firstTexUnit)
 {
-	GLint vertexShader = 0, fragmentShader = 0;
-	GLint success = 0;
+	unsigned int i;
 	int ret;
 
 	mSession = session;
 	mMedia = media;
 	mFirstTexUnit = firstTexUnit;
-	mHudCentralZoneSize = GLES2_HUD_DEFAULT_CENTRAL_ZONE_SIZE;
-	mHudHeadingZoneVOffset = GLES2_HUD_DEFAULT_HEADING_ZONE_V_OFFSET;
-	mHudRollZoneVOffset = GLES2_HUD_DEFAULT_ROLL_ZONE_V_OFFSET;
-	mHudVuMeterZoneHOffset = GLES2_HUD_DEFAULT_VU_METER_ZONE_H_OFFSET;
-	mHudVuMeterVInterval = GLES2_HUD_DEFAULT_VU_METER_V_INTERVAL;
-	mHudRightZoneHOffset = GLES2_HUD_DEFAULT_RIGHT_ZONE_H_OFFSET;
-	mHudRadarZoneHOffset = GLES2_HUD_DEFAULT_RADAR_ZONE_H_OFFSET;
-	mHudRadarZoneVOffset = GLES2_HUD_DEFAULT_RADAR_ZONE_V_OFFSET;
-	mTextSize = GLES2_HUD_DEFAULT_TEXT_SIZE;
-	mSmallIconSize = GLES2_HUD_DEFAULT_SMALL_ICON_SIZE;
-	mMediumIconSize = GLES2_HUD_DEFAULT_MEDIUM_ICON_SIZE;
-	mHudScale = GLES2_HUD_DEFAULT_SCALE;
+	mHudCentralZoneSize = HUD_DEFAULT_CENTRAL_ZONE_SIZE;
+	mHudHeadingZoneVOffset = HUD_DEFAULT_HEADING_ZONE_V_OFFSET;
+	mHudRollZoneVOffset = HUD_DEFAULT_ROLL_ZONE_V_OFFSET;
+	mHudVuMeterZoneHOffset = HUD_DEFAULT_VU_METER_ZONE_H_OFFSET;
+	mHudVuMeterVInterval = HUD_DEFAULT_VU_METER_V_INTERVAL;
+	mHudRightZoneHOffset = HUD_DEFAULT_RIGHT_ZONE_H_OFFSET;
+	mHudRadarZoneHOffset = HUD_DEFAULT_RADAR_ZONE_H_OFFSET;
+	mHudRadarZoneVOffset = HUD_DEFAULT_RADAR_ZONE_V_OFFSET;
+	mTextSize = HUD_DEFAULT_TEXT_SIZE;
+	mSmallIconSize = HUD_DEFAULT_SMALL_ICON_SIZE;
+	mMediumIconSize = HUD_DEFAULT_MEDIUM_ICON_SIZE;
+	mHudScale = HUD_DEFAULT_SCALE;
 	mAspectRatio = 1.;
 	mVideoAspectRatio = 1.;
 	mHfov = 0.;
@@ -185,156 +150,57 @@ Gles2Hud::Gles2Hud(
 	mRatioH = 1.;
 	mCockpitSphereVertices = NULL;
 	mCockpitSphereVerticesCount = 0;
-	mProgram[0] = 0;
-	mProgram[1] = 0;
+	mCockpitMesh = -1;
+	mHelmetMesh = -1;
+	mRadarMesh = -1;
+	mLayoutValid = false;
+	mLayoutVideoWidth = 0;
+	mLayoutVideoHeight = 0;
+	mLayoutWindowWidth = 0;
+	mLayoutWindowHeight = 0;
+	mLayoutHmd = false;
+	mCanvas = canvas;
+
+	for (i = 0; i < HUD_HEADING_TICK_COUNT; i++) {
+		float angle = 2. * M_PI * i / HUD_HEADING_TICK_COUNT;
+		mHeadingTickCos[i] = cosf(angle);
+		mHeadingTickSin[i] = sinf(angle);
+	}
 	mLogoTexture = 0;
 	mIconsTexture = 0;
 	mTextTexture = 0;
 
-	GLCHK();
-
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	if ((vertexShader == 0) || (vertexShader == GL_INVALID_ENUM)) {
-		ULOGE("failed to create vertex shader");
-		goto err;
-	}
-
-	glShaderSource(vertexShader, 1, &hudVertexShader, NULL);
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		ULOGE("vertex shader compilation failed '%s'", infoLog);
-		goto err;
-	}
-
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	if ((fragmentShader == 0) || (fragmentShader == GL_INVALID_ENUM)) {
-		ULOGE("failed to create fragment shader");
-		goto err;
-	}
-
-	glShaderSource(fragmentShader, 1, &hudFragmentShader, NULL);
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		ULOGE("fragment shader compilation failed '%s'", infoLog);
-		goto err;
-	}
-
-	/* Link shaders */
-	mProgram[0] = glCreateProgram();
-	glAttachShader(mProgram[0], vertexShader);
-	glAttachShader(mProgram[0], fragmentShader);
-	glLinkProgram(mProgram[0]);
-	glGetProgramiv(mProgram[0], GL_LINK_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetProgramInfoLog(mProgram[0], 512, NULL, infoLog);
-		ULOGE("program link failed '%s'", infoLog);
-		goto err;
-	}
-
-	glDeleteShader(vertexShader);
-	vertexShader = 0;
-	glDeleteShader(fragmentShader);
-	fragmentShader = 0;
-
-	mPositionHandle = glGetAttribLocation(mProgram[0], "vPosition");
-	mTransformMatrixHandle = glGetUniformLocation(mProgram[0],
-		"transform_matrix");
-	mColorHandle = glGetUniformLocation(mProgram[0], "vColor");
-
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	if ((vertexShader == 0) || (vertexShader == GL_INVALID_ENUM)) {
-		ULOGE("failed to create vertex shader");
-		goto err;
-	}
-
-	GLCHK();
-
-	glShaderSource(vertexShader, 1, &hudTexVertexShader, NULL);
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		ULOGE("vertex shader compilation failed '%s'", infoLog);
-		goto err;
-	}
-
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	if ((fragmentShader == 0) || (fragmentShader == GL_INVALID_ENUM)) {
-		ULOGE("failed to create fragment shader");
-		goto err;
-	}
-
-	glShaderSource(fragmentShader, 1, &hudTexFragmentShader, NULL);
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		ULOGE("fragment shader compilation failed '%s'", infoLog);
-		goto err;
-	}
-
-	/* Link shaders */
-	mProgram[1] = glCreateProgram();
-	glAttachShader(mProgram[1], vertexShader);
-	glAttachShader(mProgram[1], fragmentShader);
-	glLinkProgram(mProgram[1]);
-	glGetProgramiv(mProgram[1], GL_LINK_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetProgramInfoLog(mProgram[1], 512, NULL, infoLog);
-		ULOGE("program link failed '%s'", infoLog);
+	if (mCanvas == NULL) {
+		ULOGE("invalid HUD canvas");
 		goto err;
 	}
 
-	glDeleteShader(vertexShader);
-	vertexShader = 0;
-	glDeleteShader(fragmentShader);
-	fragmentShader = 0;
-
-	mTexUniformSampler = glGetUniformLocation(mProgram[1], "s_texture");
-	mTexPositionHandle = glGetAttribLocation(mProgram[1], "position");
-	mTexTexcoordHandle = glGetAttribLocation(mProgram[1], "texcoord");
-	mTexTransformMatrixHandle = glGetUniformLocation(mProgram[1],
-		"transform_matrix");
-	mTexColorHandle = glGetUniformLocation(mProgram[1], "vColor");
-
-	GLCHK();
-
 	mLogoTexUnit = mFirstTexUnit;
-	ret = loadTextureFromBuffer(hudLogo,
+	ret = mCanvas->createTexture(hudLogo,
 		hudLogoWidth, hudLogoHeight, mLogoTexUnit);
 	if (ret < 0) {
-		ULOG_ERRNO("loadTextureFromBuffer", -ret);
+		ULOG_ERRNO("canvas->createTexture", -ret);
 		goto err;
 	}
-	mLogoTexture = (GLuint)ret;
+	mLogoTexture = ret;
 
 	mIconsTexUnit = mFirstTexUnit + 1;
-	ret = loadTextureFromBuffer(hudIcons,
+	ret = mCanvas->createTexture(hudIcons,
 		hudIconsWidth, hudIconsHeight, mIconsTexUnit);
 	if (ret < 0) {
-		ULOG_ERRNO("loadTextureFromBuffer", -ret);
+		ULOG_ERRNO("canvas->createTexture", -ret);
 		goto err;
 	}
-	mIconsTexture = (GLuint)ret;
+	mIconsTexture = ret;
 
 	mTextTexUnit = mFirstTexUnit + 2;
-	ret = loadTextureFromBuffer(font_36::image,
+	ret = mCanvas->createTexture(font_36::image,
 		font_36::imageW, font_36::imageH, mTextTexUnit);
 	if (ret < 0) {
-		ULOG_ERRNO("loadTextureFromBuffer", -ret);
+		ULOG_ERRNO("canvas->createTexture", -ret);
 		goto err;
 	}
-	mTextTexture = (GLuint)ret;
+	mTextTexture = ret;
 
 	ret = initCockpit();
 	if (ret < 0) {
@@ -345,43 +211,31 @@ Gles2Hud::Gles2Hud(
 	return;
 
 err:
-	if (vertexShader > 0)
-		GLCHK(glDeleteShader(vertexShader));
-	if (fragmentShader > 0)
-		GLCHK(glDeleteShader(fragmentShader));
-	if (mLogoTexture > 0)
-		GLCHK(glDeleteTextures(1, &mLogoTexture));
-	if (mIconsTexture > 0)
-		GLCHK(glDeleteTextures(1, &mIconsTexture));
-	if (mTextTexture > 0)
-		GLCHK(glDeleteTextures(1, &mTextTexture));
-	if (mProgram[0] > 0)
-		GLCHK(glDeleteProgram(mProgram[0]));
-	if (mProgram[1] > 0)
-		GLCHK(glDeleteProgram(mProgram[1]));
+	if (mCanvas != NULL) {
+		mCanvas->destroyTexture(mLogoTexture);
+		mCanvas->destroyTexture(mIconsTexture);
+		mCanvas->destroyTexture(mTextTexture);
+	}
+	mCanvas = NULL;
 	mLogoTexture = 0;
 	mIconsTexture = 0;
 	mTextTexture = 0;
-	mProgram[0] = 0;
-	mProgram[1] = 0;
 	free(mCockpitSphereVertices);
 	mCockpitSphereVertices = NULL;
 }
 
 
-Gles2Hud::~Gles2Hud(
+Hud::~Hud(
 	void)
 {
-	if (mLogoTexture > 0)
-		GLCHK(glDeleteTextures(1, &mLogoTexture));
-	if (mIconsTexture > 0)
-		GLCHK(glDeleteTextures(1, &mIconsTexture));
-	if (mTextTexture > 0)
-		GLCHK(glDeleteTextures(1, &mTextTexture));
-	if (mProgram[0] > 0)
-		GLCHK(glDeleteProgram(mProgram[0]));
-	if (mProgram[1] > 0)
-		GLCHK(glDeleteProgram(mProgram[1]));
+	if (mCanvas != NULL) {
+		mCanvas->destroyMesh(mCockpitMesh);
+		mCanvas->destroyMesh(mHelmetMesh);
+		mCanvas->destroyMesh(mRadarMesh);
+		mCanvas->destroyTexture(mLogoTexture);
+		mCanvas->destroyTexture(mIconsTexture);
+		mCanvas->destroyTexture(mTextTexture);
+	}
 	free(mCockpitSphereVertices);
 }
 
@@ -408,47 +262,52 @@ static void createProjectionMatrix(
 }
 
 
-int Gles2Hud::renderHud(
+int Hud::renderHud(
 	unsigned int videoWidth,
 	unsigned int videoHeight,
 	unsigned int windowWidth,
 	unsigned int windowHeight,
 	const struct vmeta_frame_v2 *metadata,
 	bool hmdDistorsionCorrection,
-	bool headtracking)
+	bool headtracking,
+	const struct vmeta_quaternion *headOrientation)
 {
+	int ret;
+
 	if ((videoWidth == 0) || (videoHeight == 0) ||
 		(windowWidth == 0) || (windowHeight == 0) || (metadata == NULL))
 		return -EINVAL;
+	if (mCanvas == NULL)
+		return -EPROTO;
 
 	if (hmdDistorsionCorrection) {
-		mHudCentralZoneSize = GLES2_HUD_HMD_CENTRAL_ZONE_SIZE;
-		mHudHeadingZoneVOffset = GLES2_HUD_HMD_HEADING_ZONE_V_OFFSET;
-		mHudRollZoneVOffset = GLES2_HUD_HMD_ROLL_ZONE_V_OFFSET;
-		mHudVuMeterZoneHOffset = GLES2_HUD_HMD_VU_METER_ZONE_H_OFFSET;
-		mHudVuMeterVInterval = GLES2_HUD_HMD_VU_METER_V_INTERVAL;
-		mHudRightZoneHOffset = GLES2_HUD_HMD_RIGHT_ZONE_H_OFFSET;
-		mHudRadarZoneHOffset = GLES2_HUD_HMD_RADAR_ZONE_H_OFFSET;
-		mHudRadarZoneVOffset = GLES2_HUD_HMD_RADAR_ZONE_V_OFFSET;
-		mTextSize = GLES2_HUD_HMD_TEXT_SIZE;
-		mSmallIconSize = GLES2_HUD_HMD_SMALL_ICON_SIZE;
-		mMediumIconSize = GLES2_HUD_HMD_MEDIUM_ICON_SIZE;
-		mHudScale = GLES2_HUD_HMD_SCALE;
+		mHudCentralZoneSize = HUD_HMD_CENTRAL_ZONE_SIZE;
+		mHudHeadingZoneVOffset = HUD_HMD_HEADING_ZONE_V_OFFSET;
+		mHudRollZoneVOffset = HUD_HMD_ROLL_ZONE_V_OFFSET;
+		mHudVuMeterZoneHOffset = HUD_HMD_VU_METER_ZONE_H_OFFSET;
+		mHudVuMeterVInterval = HUD_HMD_VU_METER_V_INTERVAL;
+		mHudRightZoneHOffset = HUD_HMD_RIGHT_ZONE_H_OFFSET;
+		mHudRadarZoneHOffset = HUD_HMD_RADAR_ZONE_H_OFFSET;
+		mHudRadarZoneVOffset = HUD_HMD_RADAR_ZONE_V_OFFSET;
+		mTextSize = HUD_HMD_TEXT_SIZE;
+		mSmallIconSize = HUD_HMD_SMALL_ICON_SIZE;
+		mMediumIconSize = HUD_HMD_MEDIUM_ICON_SIZE;
+		mHudScale = HUD_HMD_SCALE;
 	} else {
-		mHudCentralZoneSize = GLES2_HUD_DEFAULT_CENTRAL_ZONE_SIZE;
+		mHudCentralZoneSize = HUD_DEFAULT_CENTRAL_ZONE_SIZE;
 		mHudHeadingZoneVOffset =
-			GLES2_HUD_DEFAULT_HEADING_ZONE_V_OFFSET;
-		mHudRollZoneVOffset = GLES2_HUD_DEFAULT_ROLL_ZONE_V_OFFSET;
+			HUD_DEFAULT_HEADING_ZONE_V_OFFSET;
+		mHudRollZoneVOffset = HUD_DEFAULT_ROLL_ZONE_V_OFFSET;
 		mHudVuMeterZoneHOffset =
-			GLES2_HUD_DEFAULT_VU_METER_ZONE_H_OFFSET;
-		mHudVuMeterVInterval = GLES2_HUD_DEFAULT_VU_METER_V_INTERVAL;
-		mHudRightZoneHOffset = GLES2_HUD_DEFAULT_RIGHT_ZONE_H_OFFSET;
-		mHudRadarZoneHOffset = GLES2_HUD_DEFAULT_RADAR_ZONE_H_OFFSET;
-		mHudRadarZoneVOffset = GLES2_HUD_DEFAULT_RADAR_ZONE_V_OFFSET;
-		mTextSize = GLES2_HUD_DEFAULT_TEXT_SIZE;
-		mSmallIconSize = GLES2_HUD_DEFAULT_SMALL_ICON_SIZE;
-		mMediumIconSize = GLES2_HUD_DEFAULT_MEDIUM_ICON_SIZE;
-		mHudScale = GLES2_HUD_DEFAULT_SCALE;
+			HUD_DEFAULT_VU_METER_ZONE_H_OFFSET;
+		mHudVuMeterVInterval = HUD_DEFAULT_VU_METER_V_INTERVAL;
+		mHudRightZoneHOffset = HUD_DEFAULT_RIGHT_ZONE_H_OFFSET;
+		mHudRadarZoneHOffset = HUD_DEFAULT_RADAR_ZONE_H_OFFSET;
+		mHudRadarZoneVOffset = HUD_DEFAULT_RADAR_ZONE_V_OFFSET;
+		mTextSize = HUD_DEFAULT_TEXT_SIZE;
+		mSmallIconSize = HUD_DEFAULT_SMALL_ICON_SIZE;
+		mMediumIconSize = HUD_DEFAULT_MEDIUM_ICON_SIZE;
+		mHudScale = HUD_DEFAULT_SCALE;
 	}
 
 	float transformMatrix[16];
@@ -477,6 +336,25 @@ int Gles2Hud::renderHud(
 	mAspectRatio = windowAR;
 	mVideoAspectRatio = videoAR;
 
+	if ((!mLayoutValid) || (videoWidth != mLayoutVideoWidth) ||
+		(videoHeight != mLayoutVideoHeight) ||
+		(windowWidth != mLayoutWindowWidth) ||
+		(windowHeight != mLayoutWindowHeight) ||
+		(hmdDistorsionCorrection != mLayoutHmd)) {
+		mLayoutValid = false;
+		ret = buildMeshes(windowWidth);
+		if (ret < 0) {
+			ULOG_ERRNO("buildMeshes", -ret);
+			return ret;
+		}
+		mLayoutVideoWidth = videoWidth;
+		mLayoutVideoHeight = videoHeight;
+		mLayoutWindowWidth = windowWidth;
+		mLayoutWindowHeight = windowHeight;
+		mLayoutHmd = hmdDistorsionCorrection;
+		mLayoutValid = true;
+	}
+
 	Eigen::Matrix4f modelMat = Eigen::Matrix4f::Identity();
 	Eigen::Matrix4f viewMat = Eigen::Matrix4f::Identity();
 	Eigen::Matrix4f projMat = Eigen::Matrix4f::Identity();
@@ -487,9 +365,9 @@ int Gles2Hud::renderHud(
 	if (mMedia)
 		mMedia->getFov(&hFov, &vFov);
 	if (hFov == 0.)
-		hFov = GLES2_HUD_DEFAULT_HFOV;
+		hFov = HUD_DEFAULT_HFOV;
 	if (vFov == 0.)
-		vFov = GLES2_HUD_DEFAULT_VFOV;
+		vFov = HUD_DEFAULT_VFOV;
 	mHfov = hFov * M_PI / 180.;
 	mVfov = vFov * M_PI / 180.;
 
@@ -576,13 +454,11 @@ int Gles2Hud::renderHud(
 	}
 	int headingInt = ((int)(droneAttitude.psi * RAD_TO_DEG) + 360) % 360;
 
-	GLCHK(glUseProgram(mProgram[0]));
-
-	GLCHK(glEnableVertexAttribArray(mPositionHandle));
-	GLCHK(glEnableVertexAttribArray(mColorHandle));
-
 	if (headtracking) {
-		Eigen::Quaternionf headQuat =
+		Eigen::Quaternionf headQuat = (headOrientation) ?
+			Eigen::Quaternionf(headOrientation->w,
+				headOrientation->x, headOrientation->y,
+				headOrientation->z) :
 			mSession->getSelfMetadata()->getDebiasedHeadOrientation();
 		Eigen::Matrix3f headRotNed = headQuat.toRotationMatrix();
 
@@ -606,8 +482,7 @@ int Gles2Hud::renderHud(
 	}
 
 	Eigen::Matrix4f xformMat = projMat * viewMat * modelMat;
-	GLCHK(glUniformMatrix4fv(mTransformMatrixHandle,
-		1, false, xformMat.data()));
+	mCanvas->setTransform(xformMat.data());
 
 	/* World */
 	if (takeoffDistance >= 50.) {
@@ -617,14 +492,12 @@ int Gles2Hud::renderHud(
 	}
 
 	/* Cockpit */
-	if (headtracking) {
-		drawCockpit(colorGray, colorGray2,
-			0.005 * (float)windowWidth, xformMat);
-	}
+	if (headtracking)
+		mCanvas->drawMesh(mCockpitMesh, xformMat.data());
 
 	xformMat = Eigen::Matrix4f::Identity();
-	GLCHK(glUniformMatrix4fv(mTransformMatrixHandle,
-		1, false, xformMat.data()));
+	mCanvas->setTransform(xformMat.data());
+	mCanvas->drawMesh(mHelmetMesh, xformMat.data());
 
 	/* Helmet */
 	if (horizontalSpeed >= 0.2)
@@ -638,58 +511,39 @@ int Gles2Hud::renderHud(
 	drawSpeed(horizontalSpeed, colorGreen);
 #ifdef DEBUG_RADAR /* used to test the radar on records */
 	if ((metadata->base.location.valid) && (takeoffLocation.valid) &&
-		(isControllerOrientationValid))
+		(isControllerOrientationValid)) {
+		mCanvas->drawMesh(mRadarMesh, xformMat.data());
 		drawControllerRadar(takeoffDistance, takeoffBearing,
 			controllerOrientation.psi, droneAttitude.psi,
 			controllerRadarAngle, colorGreen);
+	}
 #else
 	if ((metadata->base.location.valid) && (selfLocation.valid) &&
-		(isControllerOrientationValid))
+		(isControllerOrientationValid)) {
+		mCanvas->drawMesh(mRadarMesh, xformMat.data());
 		drawControllerRadar(selfDistance, selfBearing,
 			controllerOrientation.psi, droneAttitude.psi,
 			controllerRadarAngle, colorGreen);
+	}
 #endif
 	if ((duration > 0) && (duration != (uint64_t)-1))
 		drawRecordTimeline(currentTime, duration, colorGreen);
 	else if (sessionType == PDRAW_SESSION_TYPE_STREAM)
 		drawRecordingStatus(recordingDuration, colorGreen);
 
+	const float *range = pdraw_vuMeterRange[0];
 	drawVuMeter(mHudVuMeterZoneHOffset, -mHudVuMeterVInterval, 0.05,
-		metadata->base.batteryPercentage, 0., 100., 0., 20.,
-		colorGreen, colorDarkGreen, 2.);
+		metadata->base.batteryPercentage, range[0], range[1],
+		colorGreen, 2.);
+	range = pdraw_vuMeterRange[1];
 	drawVuMeter(mHudVuMeterZoneHOffset, 0.0, 0.05,
-		metadata->base.wifiRssi, -90., -20., -90., -70.,
-		colorGreen, colorDarkGreen, 2.);
+		metadata->base.wifiRssi, range[0], range[1],
+		colorGreen, 2.);
+	range = pdraw_vuMeterRange[2];
 	drawVuMeter(mHudVuMeterZoneHOffset, mHudVuMeterVInterval, 0.05,
-		metadata->base.location.svCount, 0., 30., 0., 5.,
-		colorGreen, colorDarkGreen, 2.);
-
-	GLCHK(glDisableVertexAttribArray(mPositionHandle));
-	GLCHK(glDisableVertexAttribArray(mColorHandle));
-
-	GLCHK(glEnable(GL_BLEND));
-	GLCHK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+		metadata->base.location.svCount, range[0], range[1],
+		colorGreen, 2.);
 
-	GLCHK(glUseProgram(mProgram[1]));
-	GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-		1, false, xformMat.data()));
-
-	GLCHK(glActiveTexture(GL_TEXTURE0 + mIconsTexUnit));
-	GLCHK(glBindTexture(GL_TEXTURE_2D, mIconsTexture));
-	GLCHK(glUniform1i(mTexUniformSampler, mIconsTexUnit));
-	GLCHK(glEnableVertexAttribArray(mTexPositionHandle));
-	GLCHK(glEnableVertexAttribArray(mTexTexcoordHandle));
-	GLCHK(glEnableVertexAttribArray(mTexColorHandle));
-
-	drawIcon(3, mHudVuMeterZoneHOffset * mRatioW,
-		(-mHudVuMeterVInterval - 0.01) * mRatioH, mSmallIconSize,
-		mRatioW, mRatioW * mAspectRatio, colorGreen);
-	drawIcon(4, mHudVuMeterZoneHOffset * mRatioW,
-		(0.0 - 0.01) * mRatioH, mSmallIconSize,
-		mRatioW, mRatioW * mAspectRatio, colorGreen);
-	drawIcon(5, mHudVuMeterZoneHOffset * mRatioW,
-		(mHudVuMeterVInterval - 0.01) * mRatioH, mSmallIconSize,
-		mRatioW, mRatioW * mAspectRatio, colorGreen);
 	if (droneModel != PDRAW_DRONE_MODEL_UNKNOWN)
 		drawIcon(pdraw_droneModelIconIndex[droneModel], 0.0,
 			mHudHeadingZoneVOffset * mRatioH, mSmallIconSize,
@@ -745,8 +599,7 @@ int Gles2Hud::renderHud(
 			transformMatrix[13] = deltaY;
 			transformMatrix[14] = 0;
 			transformMatrix[15] = 1;
-			GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-				1, false, transformMatrix));
+			mCanvas->setTransform(transformMatrix);
 			drawIcon(pdraw_droneModelIconIndex[droneModel],
 				0., 0., mSmallIconSize, mScaleW,
 				mScaleH * mVideoAspectRatio, colorGreen);
@@ -778,49 +631,43 @@ int Gles2Hud::renderHud(
 			transformMatrix[13] = deltaY;
 			transformMatrix[14] = 0;
 			transformMatrix[15] = 1;
-			GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-				1, false, transformMatrix));
+			mCanvas->setTransform(transformMatrix);
 			drawIcon(8, 0., cy, mSmallIconSize, mScaleW,
 				mScaleH * mVideoAspectRatio, colorGreen);
 		}
 	}
 
-	GLCHK(glActiveTexture(GL_TEXTURE0 + mTextTexUnit));
-	GLCHK(glBindTexture(GL_TEXTURE_2D, mTextTexture));
-	GLCHK(glUniform1i(mTexUniformSampler, mTextTexUnit));
-
-	GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-		1, false, xformMat.data()));
+	mCanvas->setTransform(xformMat.data());
 
 	char str[20];
 	snprintf(str, sizeof(str), "%d%%", metadata->base.batteryPercentage);
 	drawText(str, mHudVuMeterZoneHOffset * mRatioW,
 		(-mHudVuMeterVInterval - 0.07) * mRatioH,
 		mTextSize * mRatioW, 1.,
-		mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-		GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+		mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+		HUD_TEXT_ALIGN_TOP, colorGreen);
 	snprintf(str, sizeof(str), "%ddBm", metadata->base.wifiRssi);
 	drawText(str, mHudVuMeterZoneHOffset * mRatioW,
 		(0.0 - 0.07) * mRatioH, mTextSize * mRatioW, 1.,
-		mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-		GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+		mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+		HUD_TEXT_ALIGN_TOP, colorGreen);
 	snprintf(str, sizeof(str), "%d", metadata->base.location.svCount);
 	drawText(str, mHudVuMeterZoneHOffset * mRatioW,
 		(mHudVuMeterVInterval - 0.07) * mRatioH,
 		mTextSize * mRatioW, 1., mAspectRatio,
-		GLES2_HUD_TEXT_ALIGN_CENTER,
-		GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+		HUD_TEXT_ALIGN_CENTER,
+		HUD_TEXT_ALIGN_TOP, colorGreen);
 	snprintf(str, sizeof(str), "ALT");
 	drawText(str, mHudCentralZoneSize * mRatioW,
 		(mHudCentralZoneSize - 0.01) * mRatioH,
 		mTextSize * mRatioW, 1., mAspectRatio,
-		GLES2_HUD_TEXT_ALIGN_LEFT,
-		GLES2_HUD_TEXT_ALIGN_BOTTOM, colorGreen);
+		HUD_TEXT_ALIGN_LEFT,
+		HUD_TEXT_ALIGN_BOTTOM, colorGreen);
 	snprintf(str, sizeof(str), "%.1fm", metadata->base.location.altitude);
 	drawText(str, (mHudCentralZoneSize + 0.04) * mRatioW,
 		0.0 * mRatioH, mTextSize * mRatioW, 1.,
-		mAspectRatio, GLES2_HUD_TEXT_ALIGN_LEFT,
-		GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+		mAspectRatio, HUD_TEXT_ALIGN_LEFT,
+		HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	if (droneModel == PDRAW_DRONE_MODEL_DISCO) {
 		if ((metadata->base.location.valid) &&
 			(takeoffLocation.valid)) {
@@ -830,8 +677,8 @@ int Gles2Hud::renderHud(
 			drawText(str, mHudCentralZoneSize * mRatioW,
 				(-mHudCentralZoneSize + 0.01) * mRatioH,
 				mTextSize * mRatioW, 1., mAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_LEFT,
-				GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+				HUD_TEXT_ALIGN_LEFT,
+				HUD_TEXT_ALIGN_TOP, colorGreen);
 		}
 	} else {
 		snprintf(str, sizeof(str), "GND: %.1fm",
@@ -839,36 +686,36 @@ int Gles2Hud::renderHud(
 		drawText(str, mHudCentralZoneSize * mRatioW,
 			(-mHudCentralZoneSize + 0.01) * mRatioH,
 			mTextSize * mRatioW, 1., mAspectRatio,
-			GLES2_HUD_TEXT_ALIGN_LEFT,
-			GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+			HUD_TEXT_ALIGN_LEFT,
+			HUD_TEXT_ALIGN_TOP, colorGreen);
 	}
 	snprintf(str, sizeof(str), "SPD");
 	drawText(str, -mHudCentralZoneSize * mRatioW,
 		(mHudCentralZoneSize - 0.01) * mRatioH,
 		mTextSize * mRatioW, 1., mAspectRatio,
-		GLES2_HUD_TEXT_ALIGN_RIGHT,
-		GLES2_HUD_TEXT_ALIGN_BOTTOM, colorGreen);
+		HUD_TEXT_ALIGN_RIGHT,
+		HUD_TEXT_ALIGN_BOTTOM, colorGreen);
 	snprintf(str, sizeof(str), "%.1fm/s", horizontalSpeed);
 	drawText(str, -(mHudCentralZoneSize + 0.04) * mRatioW,
 		0.0 * mRatioH, mTextSize * mRatioW, 1.,
-		mAspectRatio, GLES2_HUD_TEXT_ALIGN_RIGHT,
-		GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+		mAspectRatio, HUD_TEXT_ALIGN_RIGHT,
+		HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	if (metadata->base.airSpeed != -1.) {
 		snprintf(str, sizeof(str), "AIR: %4.1fm/s",
 			metadata->base.airSpeed);
 		drawText(str, -mHudCentralZoneSize * mRatioW,
 			(-mHudCentralZoneSize + 0.01) * mRatioH,
 			mTextSize * mRatioW, 1., mAspectRatio,
-			GLES2_HUD_TEXT_ALIGN_RIGHT,
-			GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+			HUD_TEXT_ALIGN_RIGHT,
+			HUD_TEXT_ALIGN_TOP, colorGreen);
 	}
 	if (takeoffDistance != 0.) {
 		/* TODO: pilot */
 		snprintf(str, sizeof(str), "DIST: %.0fm", takeoffDistance);
 		drawText(str, 0.0, (-mHudCentralZoneSize / 2. - 0.10) *
 			mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	}
 	if ((metadata->base.state == VMETA_FLYING_STATE_TAKINGOFF) ||
 		(metadata->base.state == VMETA_FLYING_STATE_LANDING) ||
@@ -876,23 +723,23 @@ int Gles2Hud::renderHud(
 		drawText(pdraw_strFlyingState[metadata->base.state], 0.0,
 			(mHudCentralZoneSize / 2. + 0.10) *
 			mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	} else if ((metadata->base.mode == VMETA_PILOTING_MODE_RETURN_HOME) ||
 		(metadata->base.mode == VMETA_PILOTING_MODE_FLIGHT_PLAN)) {
 		drawText(pdraw_strPilotingMode[metadata->base.mode], 0.0,
 			(mHudCentralZoneSize / 2. + 0.10) *
 			mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	} else if ((metadata->base.mode == VMETA_PILOTING_MODE_FOLLOW_ME) &&
 		(metadata->has_followme) && (metadata->followme.enabled)) {
 		drawText((metadata->followme.mode == 1) ?
 			"FOLLOW ME" : "LOOK AT ME", 0.0,
 			(mHudCentralZoneSize / 2. + 0.10) *
 			mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_CENTER,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_CENTER,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	}
 	if ((controllerBattery > 0) && (controllerBattery <= 255)) {
 		if (controllerBattery <= 100) {
@@ -903,23 +750,23 @@ int Gles2Hud::renderHud(
 		}
 		drawText(str, mHudRightZoneHOffset * mRatioW,
 			0. * mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_RIGHT,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_RIGHT,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	}
 	if (sessionType == PDRAW_SESSION_TYPE_STREAM) {
 		snprintf(str, sizeof(str), "CTRL LOC: %s",
 			(selfLocation.valid) ? "OK" : "NOK");
 		drawText(str, mHudRightZoneHOffset * mRatioW,
 			0.05 * mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_RIGHT,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_RIGHT,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	}
 	if ((friendlyName) && strlen(friendlyName))
 		drawText(friendlyName, friendlyNameXOffset,
 			mHudRollZoneVOffset * mRatioH +
 			0.12 * mRatioW * mAspectRatio, mTextSize * mRatioW, 1.,
-			mAspectRatio, GLES2_HUD_TEXT_ALIGN_LEFT,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			mAspectRatio, HUD_TEXT_ALIGN_LEFT,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 	if ((currentTime > 0) && (currentTime != (uint64_t)-1) &&
 		(duration > 0) && (duration != (uint64_t)-1)) {
 		uint64_t remainingTime = duration - currentTime;
@@ -944,8 +791,8 @@ int Gles2Hud::renderHud(
 			mHudRollZoneVOffset * mRatioH +
 			0.12 * mRatioW * mAspectRatio,
 			mTextSize * mRatioW, 1., mAspectRatio,
-			GLES2_HUD_TEXT_ALIGN_LEFT,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			HUD_TEXT_ALIGN_LEFT,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 		if (dHrs) {
 			snprintf(str, sizeof(str),
 				"-%02d:%02d:%02d.%03d",
@@ -958,8 +805,8 @@ int Gles2Hud::renderHud(
 			mHudRollZoneVOffset * mRatioH +
 			0.12 * mRatioW * mAspectRatio,
 			mTextSize * mRatioW, 1., mAspectRatio,
-			GLES2_HUD_TEXT_ALIGN_RIGHT,
-			GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+			HUD_TEXT_ALIGN_RIGHT,
+			HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 		if (dHrs) {
 			snprintf(str, sizeof(str),
 				"DUR: %02d:%02d:%02d",
@@ -972,8 +819,8 @@ int Gles2Hud::renderHud(
 			mHudRollZoneVOffset * mRatioH +
 			0.10 * mRatioW * mAspectRatio,
 			mTextSize * mRatioW, 1., mAspectRatio,
-			GLES2_HUD_TEXT_ALIGN_CENTER,
-			GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+			HUD_TEXT_ALIGN_CENTER,
+			HUD_TEXT_ALIGN_TOP, colorGreen);
 	} else if (sessionType == PDRAW_SESSION_TYPE_STREAM) {
 		if (recordingDuration > 0) {
 			unsigned int dHrs = 0, dMin = 0, dSec = 0, dMsec = 0;
@@ -990,22 +837,22 @@ int Gles2Hud::renderHud(
 				mHudRollZoneVOffset * mRatioH +
 				0.12 * mRatioW * mAspectRatio,
 				mTextSize * mRatioW, 1., mAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_RIGHT,
-				GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+				HUD_TEXT_ALIGN_RIGHT,
+				HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 		} else {
 			drawText("REC", mHudRightZoneHOffset * mRatioW,
 				mHudRollZoneVOffset * mRatioH +
 				0.12 * mRatioW * mAspectRatio,
 				mTextSize * mRatioW, 1., mAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_RIGHT,
-				GLES2_HUD_TEXT_ALIGN_MIDDLE, colorGreen);
+				HUD_TEXT_ALIGN_RIGHT,
+				HUD_TEXT_ALIGN_MIDDLE, colorGreen);
 		}
 	}
 	snprintf(str, sizeof(str), "%03d", headingInt);
 	drawText(str, 0. * mRatioW, (mHudHeadingZoneVOffset + 0.10) * mRatioH,
 		mTextSize * mRatioW, 1., mAspectRatio,
-		GLES2_HUD_TEXT_ALIGN_CENTER,
-		GLES2_HUD_TEXT_ALIGN_BOTTOM, colorGreen);
+		HUD_TEXT_ALIGN_CENTER,
+		HUD_TEXT_ALIGN_BOTTOM, colorGreen);
 
 	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
 	int steps = 6, i;
@@ -1016,8 +863,8 @@ int Gles2Hud::renderHud(
 				drawText(str, 0. * mRatioW,
 					i * height / 2 / steps,
 					mTextSize * mRatioW, 1., mAspectRatio,
-					GLES2_HUD_TEXT_ALIGN_CENTER,
-					GLES2_HUD_TEXT_ALIGN_MIDDLE,
+					HUD_TEXT_ALIGN_CENTER,
+					HUD_TEXT_ALIGN_MIDDLE,
 					colorGreen);
 			}
 		}
@@ -1052,16 +899,15 @@ int Gles2Hud::renderHud(
 			transformMatrix[1] = sinf(angle) * windowH;
 			transformMatrix[4] = -sinf(angle) * windowW;
 			transformMatrix[5] = cosf(angle) * windowH;
-			GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-				1, false, transformMatrix));
+			mCanvas->setTransform(transformMatrix);
 			if (i == 0)
 				snprintf(str, sizeof(str), "0");
 			else
 				snprintf(str, sizeof(str), "%+2d ", -i * 30);
 			drawText(str, 0., cy, mTextSize,
 				mScaleW, mScaleH * mVideoAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_CENTER,
-				GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+				HUD_TEXT_ALIGN_CENTER,
+				HUD_TEXT_ALIGN_TOP, colorGreen);
 		}
 	}
 
@@ -1092,12 +938,11 @@ int Gles2Hud::renderHud(
 			transformMatrix[1] = sinf(angle) * windowH;
 			transformMatrix[4] = -sinf(angle) * windowW;
 			transformMatrix[5] = cosf(angle) * windowH;
-			GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-				1, false, transformMatrix));
+			mCanvas->setTransform(transformMatrix);
 			drawText(pdraw_strHeading[i], 0., cy, mTextSize,
 				mScaleW, mScaleH * mVideoAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_CENTER,
-				GLES2_HUD_TEXT_ALIGN_TOP, colorGreen);
+				HUD_TEXT_ALIGN_CENTER,
+				HUD_TEXT_ALIGN_TOP, colorGreen);
 		}
 	}
 
@@ -1134,66 +979,32 @@ int Gles2Hud::renderHud(
 			transformMatrix[1] = sinf(angle) * windowH;
 			transformMatrix[4] = -sinf(angle) * windowW;
 			transformMatrix[5] = cosf(angle) * windowH;
-			GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-				1, false, transformMatrix));
+			mCanvas->setTransform(transformMatrix);
 			drawText(pdraw_strHeading[i], 0., cy, mTextSize,
 				mScaleW, mScaleH * mVideoAspectRatio,
-				GLES2_HUD_TEXT_ALIGN_CENTER,
-				GLES2_HUD_TEXT_ALIGN_BOTTOM, colorGreen);
+				HUD_TEXT_ALIGN_CENTER,
+				HUD_TEXT_ALIGN_BOTTOM, colorGreen);
 		}
 	}
 
-	GLCHK(glDisableVertexAttribArray(mTexPositionHandle));
-	GLCHK(glDisableVertexAttribArray(mTexTexcoordHandle));
-	GLCHK(glDisableVertexAttribArray(mTexColorHandle));
-
 	free(friendlyName);
-	return 0;
-}
 
+	ret = mCanvas->flush();
+	if (ret < 0)
+		ULOG_ERRNO("canvas->flush", -ret);
 
-void Gles2Hud::setVideoMedia(
-	VideoMedia *media)
-{
-	mMedia = media;
+	return ret;
 }
 
 
-int Gles2Hud::loadTextureFromBuffer(
-	const uint8_t *buffer,
-	int width,
-	int height,
-	int texUnit)
+void Hud::setVideoMedia(
+	VideoMedia *media)
 {
-	int ret = 0;
-
-	if ((ret == 0) && (width > 0) && (height > 0) && (buffer != NULL)) {
-		GLuint tex;
-		GLCHK(glGenTextures(1, &tex));
-
-		GLCHK(glActiveTexture(GL_TEXTURE0 + texUnit));
-		GLCHK(glBindTexture(GL_TEXTURE_2D, tex));
-
-		GLCHK(glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
-			GL_LUMINANCE, GL_UNSIGNED_BYTE, buffer));
-
-		GLCHK(glTexParameteri(GL_TEXTURE_2D,
-			GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-		GLCHK(glTexParameteri(GL_TEXTURE_2D,
-			GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-		GLCHK(glTexParameterf(GL_TEXTURE_2D,
-			GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-		GLCHK(glTexParameterf(GL_TEXTURE_2D,
-			GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-
-		ret = (int)tex;
-	}
-
-	return ret;
+	mMedia = media;
 }
 
 
-void Gles2Hud::drawIcon(
+void Hud::drawIcon(
 	int index,
 	float x,
 	float y,
@@ -1214,9 +1025,6 @@ void Gles2Hud::drawIcon(
 	vertices[6] = x + size * scaleW / 2.;
 	vertices[7] = y + size * scaleH / 2.;
 
-	GLCHK(glVertexAttribPointer(mTexPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
 	int ix = index % 3;
 	int iy = index / 3;
 
@@ -1229,16 +1037,12 @@ void Gles2Hud::drawIcon(
 	texCoords[6] = ((float)ix + 0.99) / 3.;
 	texCoords[7] = ((float)iy + 0.) / 3.;
 
-	GLCHK(glVertexAttribPointer(mTexTexcoordHandle,
-		2, GL_FLOAT, false, 0, texCoords));
-
-	GLCHK(glUniform4fv(mTexColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+	mCanvas->addTexturedStrip(mIconsTexture, mIconsTexUnit,
+		vertices, texCoords, 4, color);
 }
 
 
-void Gles2Hud::drawLogo(
+void Hud::drawLogo(
 	float x,
 	float y,
 	float size,
@@ -1258,9 +1062,6 @@ void Gles2Hud::drawLogo(
 	vertices[6] = x + size * scaleW / 2.;
 	vertices[7] = y + size * scaleH / 2.;
 
-	GLCHK(glVertexAttribPointer(mTexPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
 	texCoords[0] = 0.;
 	texCoords[1] = 1.;
 	texCoords[2] = 1.;
@@ -1270,16 +1071,12 @@ void Gles2Hud::drawLogo(
 	texCoords[6] = 1.;
 	texCoords[7] = 0.;
 
-	GLCHK(glVertexAttribPointer(mTexTexcoordHandle,
-		2, GL_FLOAT, false, 0, texCoords));
-
-	GLCHK(glUniform4fv(mTexColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+	mCanvas->addTexturedStrip(mLogoTexture, mLogoTexUnit,
+		vertices, texCoords, 4, color);
 }
 
 
-void Gles2Hud::getTextDimensions(
+void Hud::getTextDimensions(
 	const char *str,
 	float size,
 	float scaleW,
@@ -1314,15 +1111,15 @@ void Gles2Hud::getTextDimensions(
 }
 
 
-void Gles2Hud::drawText(
+void Hud::drawText(
 	const char *str,
 	float x,
 	float y,
 	float size,
 	float scaleW,
 	float scaleH,
-	enum gles2_hud_text_align halign,
-	enum gles2_hud_text_align valign,
+	enum hud_text_align halign,
+	enum hud_text_align valign,
 	const float color[4])
 {
 	float w, h;
@@ -1334,30 +1131,28 @@ void Gles2Hud::drawText(
 
 	switch (halign) {
 	default:
-	case GLES2_HUD_TEXT_ALIGN_LEFT:
+	case HUD_TEXT_ALIGN_LEFT:
 		break;
-	case GLES2_HUD_TEXT_ALIGN_CENTER:
+	case HUD_TEXT_ALIGN_CENTER:
 		x -= w / 2;
 		break;
-	case GLES2_HUD_TEXT_ALIGN_RIGHT:
+	case HUD_TEXT_ALIGN_RIGHT:
 		x -= w;
 		break;
 	}
 
 	switch (valign) {
 	default:
-	case GLES2_HUD_TEXT_ALIGN_TOP:
+	case HUD_TEXT_ALIGN_TOP:
 		y -= h;
 		break;
-	case GLES2_HUD_TEXT_ALIGN_MIDDLE:
+	case HUD_TEXT_ALIGN_MIDDLE:
 		y -= h / 2;
 		break;
-	case GLES2_HUD_TEXT_ALIGN_BOTTOM:
+	case HUD_TEXT_ALIGN_BOTTOM:
 		break;
 	}
 
-	GLCHK(glUniform4fv(mTexColorHandle, 1, color));
-
 	const char *c = str;
 	float cx = 0.;
 	while (*c != '\0') {
@@ -1387,11 +1182,8 @@ void Gles2Hud::drawText(
 			texCoords[6] = g.norm.u + g.norm.width;
 			texCoords[7] = g.norm.v;
 
-			GLCHK(glVertexAttribPointer(mTexPositionHandle,
-				2, GL_FLOAT, false, 0, vertices));
-			GLCHK(glVertexAttribPointer(mTexTexcoordHandle,
-				2, GL_FLOAT, false, 0, texCoords));
-			GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+			mCanvas->addTexturedStrip(mTextTexture, mTextTexUnit,
+				vertices, texCoords, 4, color);
 
 			cx += g.norm.advance * size * scaleW;
 		}
@@ -1400,7 +1192,7 @@ void Gles2Hud::drawText(
 }
 
 
-void Gles2Hud::drawLine(
+void Hud::drawLine(
 	float x1,
 	float y1,
 	float x2,
@@ -1415,18 +1207,12 @@ void Gles2Hud::drawLine(
 	vertices[2] = x2;
 	vertices[3] = y2;
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINES, 0, 2));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINES, vertices, 2, 2,
+		color, lineWidth);
 }
 
 
-void Gles2Hud::drawLineZ(
+void Hud::drawLineZ(
 	float x1,
 	float y1,
 	float z1,
@@ -1445,18 +1231,12 @@ void Gles2Hud::drawLineZ(
 	vertices[4] = y2;
 	vertices[5] = z2;
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		3, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINES, 0, 2));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINES, vertices, 3, 2,
+		color, lineWidth);
 }
 
 
-void Gles2Hud::drawRect(
+void Hud::drawRect(
 	float x1,
 	float y1,
 	float x2,
@@ -1475,18 +1255,12 @@ void Gles2Hud::drawRect(
 	vertices[6] = x2;
 	vertices[7] = y1;
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINE_LOOP, 0, 4));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_LOOP, vertices, 2, 4,
+		color, lineWidth);
 }
 
 
-void Gles2Hud::drawArc(
+void Hud::drawArc(
 	float cx,
 	float cy,
 	float rx,
@@ -1518,18 +1292,12 @@ void Gles2Hud::drawArc(
 		y = s * t + c * y;
 	}
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINE_STRIP, 0, numSegments + 1));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_STRIP, vertices, 2,
+		numSegments + 1, color, lineWidth);
 }
 
 
-void Gles2Hud::drawArcZ(
+void Hud::drawArcZ(
 	float cx,
 	float cy,
 	float rx,
@@ -1563,18 +1331,12 @@ void Gles2Hud::drawArcZ(
 		y = s * t + c * y;
 	}
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		3, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINE_STRIP, 0, numSegments + 1));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_STRIP, vertices, 3,
+		numSegments + 1, color, lineWidth);
 }
 
 
-void Gles2Hud::drawEllipse(
+void Hud::drawEllipse(
 	float cx,
 	float cy,
 	float rx,
@@ -1605,18 +1367,12 @@ void Gles2Hud::drawEllipse(
 		y = s * t + c * y;
 	}
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINE_LOOP, 0, numSegments));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_LOOP, vertices, 2,
+		numSegments, color, lineWidth);
 }
 
 
-void Gles2Hud::drawEllipseZ(
+void Hud::drawEllipseZ(
 	float cx,
 	float cy,
 	float rx,
@@ -1649,18 +1405,12 @@ void Gles2Hud::drawEllipseZ(
 		y = s * t + c * y;
 	}
 
-	GLCHK(glLineWidth(lineWidth));
-
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		3, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_LINE_LOOP, 0, numSegments));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_LOOP, vertices, 3,
+		numSegments, color, lineWidth);
 }
 
 
-void Gles2Hud::drawEllipseFilled(
+void Hud::drawEllipseFilled(
 	float cx,
 	float cy,
 	float rx,
@@ -1704,20 +1454,15 @@ void Gles2Hud::drawEllipseFilled(
 	vertices[6 * i] = x * rx + cx;
 	vertices[6 * i + 1] = y * ry + cy;
 
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-
-	GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, 3 * (numSegments / 2) + 1));
+	mCanvas->addTriangleStrip(vertices, 2, 3 * (numSegments / 2) + 1,
+		color);
 }
 
 
-void Gles2Hud::drawVuMeter(
+void Hud::drawVuMeterScale(
 	float x,
 	float y,
 	float r,
-	float value,
 	float minVal,
 	float maxVal,
 	float criticalMin,
@@ -1728,8 +1473,6 @@ void Gles2Hud::drawVuMeter(
 {
 	x *= mRatioW;
 	y *= mRatioH;
-	if (value < minVal) value = minVal;
-	if (value > maxVal) value = maxVal;
 	float span = 4. * M_PI / 3.;
 	float start = (M_PI - span) / 2.;
 	drawArc(x, y, r * mRatioW, r * mRatioW * mAspectRatio,
@@ -1745,6 +1488,25 @@ void Gles2Hud::drawVuMeter(
 			r * mRatioW * mAspectRatio * 0.9,
 			start2, end2 - start2, 10, criticalColor, 2.);
 	}
+}
+
+
+void Hud::drawVuMeter(
+	float x,
+	float y,
+	float r,
+	float value,
+	float minVal,
+	float maxVal,
+	const float color[4],
+	float lineWidth)
+{
+	x *= mRatioW;
+	y *= mRatioH;
+	if (value < minVal) value = minVal;
+	if (value > maxVal) value = maxVal;
+	float span = 4. * M_PI / 3.;
+	float start = (M_PI - span) / 2.;
 	float angle = start + (1. - (value - minVal) /
 		(maxVal - minVal)) * span;
 	float x1 = x + r * mRatioW * 0.4 * cosf(angle);
@@ -1755,7 +1517,7 @@ void Gles2Hud::drawVuMeter(
 }
 
 
-int Gles2Hud::initCockpit(
+int Hud::initCockpit(
 	void)
 {
 	float x1, y1, z1, x2, y2, z2;
@@ -1811,11 +1573,94 @@ int Gles2Hud::initCockpit(
 }
 
 
-void Gles2Hud::drawCockpit(
+int Hud::buildMeshes(
+	unsigned int windowWidth)
+{
+	int ret;
+	const float *range;
+
+	mCanvas->destroyMesh(mCockpitMesh);
+	mCanvas->destroyMesh(mHelmetMesh);
+	mCanvas->destroyMesh(mRadarMesh);
+	mCockpitMesh = -1;
+	mHelmetMesh = -1;
+	mRadarMesh = -1;
+
+	/* Cockpit, drawn with the headtracking transform */
+	ret = mCanvas->beginMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->beginMesh", -ret);
+		return ret;
+	}
+	mCockpitMesh = ret;
+	drawCockpit(colorGray, colorGray2, 0.005 * (float)windowWidth);
+	ret = mCanvas->endMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->endMesh", -ret);
+		return ret;
+	}
+
+	/* Helmet scales, dials and icons that only depend on the layout */
+	ret = mCanvas->beginMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->beginMesh", -ret);
+		return ret;
+	}
+	mHelmetMesh = ret;
+	drawArtificialHorizonScale(colorGreen);
+	drawRollScale(colorGreen);
+	drawHeadingScale(colorGreen);
+	drawAltitudeScale(colorGreen);
+	drawSpeedScale(colorGreen);
+	range = pdraw_vuMeterRange[0];
+	drawVuMeterScale(mHudVuMeterZoneHOffset, -mHudVuMeterVInterval, 0.05,
+		range[0], range[1], range[2], range[3],
+		colorGreen, colorDarkGreen, 2.);
+	range = pdraw_vuMeterRange[1];
+	drawVuMeterScale(mHudVuMeterZoneHOffset, 0.0, 0.05,
+		range[0], range[1], range[2], range[3],
+		colorGreen, colorDarkGreen, 2.);
+	range = pdraw_vuMeterRange[2];
+	drawVuMeterScale(mHudVuMeterZoneHOffset, mHudVuMeterVInterval, 0.05,
+		range[0], range[1], range[2], range[3],
+		colorGreen, colorDarkGreen, 2.);
+	drawIcon(3, mHudVuMeterZoneHOffset * mRatioW,
+		(-mHudVuMeterVInterval - 0.01) * mRatioH, mSmallIconSize,
+		mRatioW, mRatioW * mAspectRatio, colorGreen);
+	drawIcon(4, mHudVuMeterZoneHOffset * mRatioW,
+		(0.0 - 0.01) * mRatioH, mSmallIconSize,
+		mRatioW, mRatioW * mAspectRatio, colorGreen);
+	drawIcon(5, mHudVuMeterZoneHOffset * mRatioW,
+		(mHudVuMeterVInterval - 0.01) * mRatioH, mSmallIconSize,
+		mRatioW, mRatioW * mAspectRatio, colorGreen);
+	ret = mCanvas->endMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->endMesh", -ret);
+		return ret;
+	}
+
+	/* Controller radar dial */
+	ret = mCanvas->beginMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->beginMesh", -ret);
+		return ret;
+	}
+	mRadarMesh = ret;
+	drawControllerRadarScale(colorGreen);
+	ret = mCanvas->endMesh();
+	if (ret < 0) {
+		ULOG_ERRNO("canvas->endMesh", -ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+
+void Hud::drawCockpit(
 	const float color[4],
 	const float color2[4],
-	float lineWidth,
-	Eigen::Matrix4f &xformMat)
+	float lineWidth)
 {
 	int i;
 	float rx = 1.;
@@ -1827,10 +1672,8 @@ void Gles2Hud::drawCockpit(
 	float halfSphereDepth = 1.;
 
 	/* sphere */
-	GLCHK(glUniform4fv(mColorHandle, 1, color2));
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		3, GL_FLOAT, false, 0, mCockpitSphereVertices));
-	GLCHK(glDrawArrays(GL_TRIANGLE_STRIP, 0, mCockpitSphereVerticesCount));
+	mCanvas->addTriangleStrip(mCockpitSphereVertices, 3,
+		mCockpitSphereVerticesCount, color2);
 
 	/* circles of latitude */
 	drawEllipseZ(0., 0., sinf(limitAngle) * rx, sinf(limitAngle) * ry,
@@ -1871,14 +1714,6 @@ void Gles2Hud::drawCockpit(
 	}
 
 	/* logo */
-	GLCHK(glDisableVertexAttribArray(mPositionHandle));
-	GLCHK(glDisableVertexAttribArray(mColorHandle));
-
-	GLCHK(glEnable(GL_BLEND));
-	GLCHK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-
-	GLCHK(glUseProgram(mProgram[1]));
-
 	Eigen::Matrix4f modelMat = Eigen::Matrix4f::Identity();
 	Eigen::Matrix3f rot1 = Eigen::AngleAxisf(M_PI,
 		Eigen::Vector3f::UnitY()).matrix();
@@ -1888,28 +1723,10 @@ void Gles2Hud::drawCockpit(
 		0, 0, halfSphereDepth;
 	modelMat.block<3, 3>(0, 0) = scale * rot1;
 	modelMat.col(3) << 0., 0., cosf(M_PI - inc) * halfSphereDepth, 1.;
-	Eigen::Matrix4f xformMat2 = xformMat * modelMat;
-	GLCHK(glUniformMatrix4fv(mTexTransformMatrixHandle,
-		1, false, xformMat2.data()));
-
-	GLCHK(glActiveTexture(GL_TEXTURE0 + mLogoTexUnit));
-	GLCHK(glBindTexture(GL_TEXTURE_2D, mLogoTexture));
-	GLCHK(glUniform1i(mTexUniformSampler, mLogoTexUnit));
-	GLCHK(glEnableVertexAttribArray(mTexPositionHandle));
-	GLCHK(glEnableVertexAttribArray(mTexTexcoordHandle));
-	GLCHK(glEnableVertexAttribArray(mTexColorHandle));
+	mCanvas->setTransform(modelMat.data());
 
 	drawLogo(0., 0., sinf(inc), 1., 1., color);
 
-	GLCHK(glDisableVertexAttribArray(mTexPositionHandle));
-	GLCHK(glDisableVertexAttribArray(mTexTexcoordHandle));
-	GLCHK(glDisableVertexAttribArray(mTexColorHandle));
-
-	GLCHK(glUseProgram(mProgram[0]));
-
-	GLCHK(glEnableVertexAttribArray(mPositionHandle));
-	GLCHK(glEnableVertexAttribArray(mColorHandle));
-
 	/* lines of longitude */
 	modelMat = Eigen::Matrix4f::Identity();
 	rot1 = Eigen::AngleAxisf(-M_PI / 2., Eigen::Vector3f::UnitY()).matrix();
@@ -1921,9 +1738,7 @@ void Gles2Hud::drawCockpit(
 		rot2 = Eigen::AngleAxisf(-angle,
 			Eigen::Vector3f::UnitZ()).matrix();
 		modelMat.block<3, 3>(0, 0) = scale * rot2 * rot1;
-		xformMat2 = xformMat * modelMat;
-		GLCHK(glUniformMatrix4fv(mTransformMatrixHandle,
-			1, false, xformMat2.data()));
+		mCanvas->setTransform(modelMat.data());
 
 		drawArcZ(0., 0., 1., 1., 0., centerAngle,
 			M_PI - centerAngle - inc, 40, color, lineWidth);
@@ -1931,17 +1746,13 @@ void Gles2Hud::drawCockpit(
 }
 
 
-void Gles2Hud::drawArtificialHorizon(
-	const struct vmeta_euler *drone,
-	const struct vmeta_euler *frame,
+void Hud::drawArtificialHorizonScale(
 	const float color[4])
 {
 	int i;
-	float x1, y1, x2, y2;
 	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
 	int steps = 6;
 
-	/* Scale */
 	for (i = -steps; i <= steps; i++) {
 		if (i != 0) {
 			if (i & 1) {
@@ -1951,6 +1762,17 @@ void Gles2Hud::drawArtificialHorizon(
 			}
 		}
 	}
+}
+
+
+void Hud::drawArtificialHorizon(
+	const struct vmeta_euler *drone,
+	const struct vmeta_euler *frame,
+	const float color[4])
+{
+	float x1, y1, x2, y2;
+	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
+	int steps = 6;
 
 	/* Horizon */
 	x1 = -0.5 * mHudCentralZoneSize * mRatioW * cosf(frame->phi);
@@ -1979,16 +1801,12 @@ void Gles2Hud::drawArtificialHorizon(
 	vertices[8] = 0.06 * mRatioW * cosf(frame->phi - drone->phi);
 	vertices[9] = 0.06 * mRatioW * mAspectRatio *
 		sinf(frame->phi - drone->phi) + droneY;
-	GLCHK(glLineWidth(6.));
-	GLCHK(glVertexAttribPointer(mPositionHandle,
-		2, GL_FLOAT, false, 0, vertices));
-	GLCHK(glUniform4fv(mColorHandle, 1, color));
-	GLCHK(glDrawArrays(GL_LINE_STRIP, 0, 5));
+	mCanvas->addLines(HUD_CANVAS_LINE_MODE_LINE_STRIP, vertices, 2, 5,
+		color, 6.);
 }
 
 
-void Gles2Hud::drawRoll(
-	float droneRoll,
+void Hud::drawRollScale(
 	const float color[4])
 {
 	int i;
@@ -2000,14 +1818,6 @@ void Gles2Hud::drawRoll(
 	drawArc(0., yOffset, width, width * mAspectRatio,
 		M_PI * (90. - 10. * steps) / 180.,
 		M_PI * 20. * steps / 180., 100, color, 2.);
-	rotation = M_PI / 2. - droneRoll;
-	x1 = (width - 0.012 * mRatioW) * cosf(rotation);
-	y1 = (width - 0.012 * mRatioW) *
-		mAspectRatio * sinf(rotation) + yOffset;
-	x2 = (width + 0.012 * mRatioW) * cosf(rotation);
-	y2 = (width + 0.012 * mRatioW) *
-		mAspectRatio * sinf(rotation) + yOffset;
-	drawLine(x1, y1, x2, y2, color, 2.);
 
 	for (i = -steps, rotation = M_PI * (90. - 10. * steps) / 180.;
 		i <= steps; i++, rotation += M_PI * 10. / 180.) {
@@ -2030,18 +1840,29 @@ void Gles2Hud::drawRoll(
 }
 
 
-void Gles2Hud::drawHeading(
-	float droneYaw,
-	float horizontalSpeed,
-	float speedPsi,
+void Hud::drawRoll(
+	float droneRoll,
 	const float color[4])
 {
-	int i;
-	int heading = ((int)(droneYaw * RAD_TO_DEG) + 360) % 360;
 	float rotation, x1, y1, x2, y2;
-	char strHeading[20];
-	snprintf(strHeading, sizeof(strHeading), "%d", heading);
+	float width = 0.12 * mRatioW;
+	float yOffset = mHudRollZoneVOffset * mRatioH;
 
+	rotation = M_PI / 2. - droneRoll;
+	x1 = (width - 0.012 * mRatioW) * cosf(rotation);
+	y1 = (width - 0.012 * mRatioW) *
+		mAspectRatio * sinf(rotation) + yOffset;
+	x2 = (width + 0.012 * mRatioW) * cosf(rotation);
+	y2 = (width + 0.012 * mRatioW) *
+		mAspectRatio * sinf(rotation) + yOffset;
+	drawLine(x1, y1, x2, y2, color, 2.);
+}
+
+
+void Hud::drawHeadingScale(
+	const float color[4])
+{
+	float x1, y1, x2, y2;
 	float width = 0.12 * mRatioW;
 	float yOffset = mHudHeadingZoneVOffset * mRatioH;
 
@@ -2052,16 +1873,38 @@ void Gles2Hud::drawHeading(
 	x2 = 0.;
 	y2 = yOffset + (width + 0.01 * mRatioW) * mAspectRatio;
 	drawLine(x1, y1, x2, y2, color, 2.);
+}
+
 
-	for (i = 0, rotation = droneYaw + M_PI / 2.; i < 36;
-		i++, rotation += M_PI * 10. / 180.) {
+void Hud::drawHeading(
+	float droneYaw,
+	float horizontalSpeed,
+	float speedPsi,
+	const float color[4])
+{
+	int i;
+	int heading = ((int)(droneYaw * RAD_TO_DEG) + 360) % 360;
+	float rotation, x1, y1, x2, y2;
+
+	float width = 0.12 * mRatioW;
+	float yOffset = mHudHeadingZoneVOffset * mRatioH;
+
+	/* The tick angles are droneYaw + 90 deg + i * 10 deg; use the
+	 * precomputed tick table and the angle addition formulas */
+	float c = cosf(droneYaw + M_PI / 2.);
+	float s = sinf(droneYaw + M_PI / 2.);
+	for (i = 0; i < HUD_HEADING_TICK_COUNT; i++) {
 		int angle = (heading + i * 10 + 70 + 360) % 360;
 		if (angle <= 140) {
-			x1 = width * cosf(rotation);
-			y1 = width * mAspectRatio * sinf(rotation) + yOffset;
-			x2 = (width - 0.01 * mRatioW) * cosf(rotation);
+			float cr = c * mHeadingTickCos[i] -
+				s * mHeadingTickSin[i];
+			float sr = s * mHeadingTickCos[i] +
+				c * mHeadingTickSin[i];
+			x1 = width * cr;
+			y1 = width * mAspectRatio * sr + yOffset;
+			x2 = (width - 0.01 * mRatioW) * cr;
 			y2 = (width - 0.01 * mRatioW) *
-				mAspectRatio * sinf(rotation) + yOffset;
+				mAspectRatio * sr + yOffset;
 			drawLine(x1, y1, x2, y2, color, 2.);
 		}
 	}
@@ -2089,18 +1932,11 @@ void Gles2Hud::drawHeading(
 }
 
 
-void Gles2Hud::drawAltitude(
-	double altitude,
-	float groundDistance,
-	float downSpeed,
+void Hud::drawAltitudeScale(
 	const float color[4])
 {
-	char strAltitude[20];
-	snprintf(strAltitude, sizeof(strAltitude), "%.1fm", altitude);
-
 	float xOffset = mHudCentralZoneSize * mRatioW;
 	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
-	float altitudeInterval = height / 20.;
 
 	drawLine(xOffset, -height / 2., xOffset, height / 2., color, 2.);
 	drawLine(xOffset, -height / 2., xOffset + 0.08 * mRatioW,
@@ -2114,6 +1950,21 @@ void Gles2Hud::drawAltitude(
 		-0.017 * mRatioW * mAspectRatio, color, 2.);
 	drawLine(xOffset, 0., xOffset + 0.03 * mRatioW,
 		0.017 * mRatioW * mAspectRatio, color, 2.);
+}
+
+
+void Hud::drawAltitude(
+	double altitude,
+	float groundDistance,
+	float downSpeed,
+	const float color[4])
+{
+	char strAltitude[20];
+	snprintf(strAltitude, sizeof(strAltitude), "%.1fm", altitude);
+
+	float xOffset = mHudCentralZoneSize * mRatioW;
+	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
+	float altitudeInterval = height / 20.;
 
 	float y = (ceil(altitude) - altitude) * altitudeInterval;
 	int altInt = ((int)ceil(altitude));
@@ -2225,16 +2076,11 @@ void Gles2Hud::drawAltitude(
 }
 
 
-void Gles2Hud::drawSpeed(
-	float horizontalSpeed,
+void Hud::drawSpeedScale(
 	const float color[4])
 {
-	char strSpeed[20];
-	snprintf(strSpeed, sizeof(strSpeed), "%.1fm/s", horizontalSpeed);
-
 	float xOffset = -mHudCentralZoneSize * mRatioW;
 	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
-	float speedInterval = height / 20.;
 
 	drawLine(xOffset, -height / 2., xOffset, height / 2., color, 2.);
 	drawLine(xOffset, -height / 2., xOffset - 0.08 * mRatioW,
@@ -2248,6 +2094,19 @@ void Gles2Hud::drawSpeed(
 		-0.017 * mRatioW * mAspectRatio, color, 2.);
 	drawLine(xOffset, 0., xOffset - 0.03 * mRatioW,
 		0.017 * mRatioW * mAspectRatio, color, 2.);
+}
+
+
+void Hud::drawSpeed(
+	float horizontalSpeed,
+	const float color[4])
+{
+	char strSpeed[20];
+	snprintf(strSpeed, sizeof(strSpeed), "%.1fm/s", horizontalSpeed);
+
+	float xOffset = -mHudCentralZoneSize * mRatioW;
+	float height = mHudCentralZoneSize * mRatioW * mAspectRatio;
+	float speedInterval = height / 20.;
 
 	float y = (ceil(horizontalSpeed) - horizontalSpeed) * speedInterval;
 	int spdInt = ((int)ceil(horizontalSpeed));
@@ -2288,12 +2147,7 @@ void Gles2Hud::drawSpeed(
 }
 
 
-void Gles2Hud::drawControllerRadar(
-	double distance,
-	double bearing,
-	float controllerYaw,
-	float droneYaw,
-	float controllerRadarAngle,
+void Hud::drawControllerRadarScale(
 	const float color[4])
 {
 	float width = 0.08 * mRatioW;
@@ -2308,6 +2162,21 @@ void Gles2Hud::drawControllerRadar(
 	x2 = xOffset;
 	y2 = yOffset + (width + 0.008 * mRatioW) * mAspectRatio;
 	drawLine(x1, y1, x2, y2, color, 2.);
+}
+
+
+void Hud::drawControllerRadar(
+	double distance,
+	double bearing,
+	float controllerYaw,
+	float droneYaw,
+	float controllerRadarAngle,
+	const float color[4])
+{
+	float width = 0.08 * mRatioW;
+	float xOffset = mHudRadarZoneHOffset * mRatioW;
+	float yOffset = mHudRadarZoneVOffset * mRatioH;
+	float x1, y1, x2, y2;
 
 	if (distance > 50.) {
 		x1 = xOffset - width / 3. * sinf(controllerRadarAngle / 2.);
@@ -2328,7 +2197,7 @@ void Gles2Hud::drawControllerRadar(
 }
 
 
-void Gles2Hud::drawRecordTimeline(
+void Hud::drawRecordTimeline(
 	uint64_t currentTime,
 	uint64_t duration,
 	const float color[4])
@@ -2388,7 +2257,7 @@ void Gles2Hud::drawRecordTimeline(
 }
 
 
-void Gles2Hud::drawRecordingStatus(
+void Hud::drawRecordingStatus(
 	uint64_t recordingDuration,
 	const float color[4])
 {
@@ -2434,7 +2303,7 @@ void Gles2Hud::drawRecordingStatus(
 }
 
 
-void Gles2Hud::drawFlightPathVector(
+void Hud::drawFlightPathVector(
 	const struct vmeta_euler *frame,
 	float speedTheta,
 	float speedPsi,
@@ -2486,7 +2355,7 @@ void Gles2Hud::drawFlightPathVector(
 }
 
 
-void Gles2Hud::drawPositionPin(
+void Hud::drawPositionPin(
 	const struct vmeta_euler *frame,
 	double bearing,
 	double elevation,
@@ -2532,5 +2401,3 @@ void Gles2Hud::drawPositionPin(
 }
 
 } /* namespace Pdraw */
-
-#endif /* USE_GLES2 */
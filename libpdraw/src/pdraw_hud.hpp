@@ -27,58 +27,57 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef _PDRAW_GLES2_HUD_HPP_
-#define _PDRAW_GLES2_HUD_HPP_
-
-#ifdef USE_GLES2
+#ifndef _PDRAW_HUD_HPP_
+#define _PDRAW_HUD_HPP_
 
 #include <math.h>
-#include "pdraw_gles2_common.hpp"
+#include "pdraw_hud_canvas.hpp"
 #include "pdraw_metadata_videoframe.hpp"
 
 namespace Pdraw {
 
 
-#define GLES2_HUD_TEX_UNIT_COUNT 3
-
-#define GLES2_HUD_DEFAULT_CENTRAL_ZONE_SIZE         (0.25f)
-#define GLES2_HUD_DEFAULT_HEADING_ZONE_V_OFFSET     (-0.80f)
-#define GLES2_HUD_DEFAULT_ROLL_ZONE_V_OFFSET        (0.50f)
-#define GLES2_HUD_DEFAULT_VU_METER_ZONE_H_OFFSET    (-0.60f)
-#define GLES2_HUD_DEFAULT_VU_METER_V_INTERVAL       (-0.30f)
-#define GLES2_HUD_DEFAULT_RIGHT_ZONE_H_OFFSET       (0.65f)
-#define GLES2_HUD_DEFAULT_RADAR_ZONE_H_OFFSET       (0.45f)
-#define GLES2_HUD_DEFAULT_RADAR_ZONE_V_OFFSET       (-0.65f)
-#define GLES2_HUD_DEFAULT_TEXT_SIZE                 (0.15f)
-#define GLES2_HUD_DEFAULT_SMALL_ICON_SIZE           (0.040f)
-#define GLES2_HUD_DEFAULT_MEDIUM_ICON_SIZE          (0.050f)
-#define GLES2_HUD_DEFAULT_SCALE                     (1.00f)
-
-#define GLES2_HUD_HMD_SCALE                         (1.00f)
-#define GLES2_HUD_HMD_CENTRAL_ZONE_SIZE             (0.20f)
-#define GLES2_HUD_HMD_HEADING_ZONE_V_OFFSET         (-0.80f)
-#define GLES2_HUD_HMD_ROLL_ZONE_V_OFFSET            (0.50f)
-#define GLES2_HUD_HMD_VU_METER_ZONE_H_OFFSET        (-0.50f)
-#define GLES2_HUD_HMD_VU_METER_V_INTERVAL           (-0.25f)
-#define GLES2_HUD_HMD_RIGHT_ZONE_H_OFFSET           (0.55f)
-#define GLES2_HUD_HMD_RADAR_ZONE_H_OFFSET           (0.35f)
-#define GLES2_HUD_HMD_RADAR_ZONE_V_OFFSET           (-0.65f)
-#define GLES2_HUD_HMD_TEXT_SIZE                     (0.14f)
-#define GLES2_HUD_HMD_SMALL_ICON_SIZE               (0.037f)
-#define GLES2_HUD_HMD_MEDIUM_ICON_SIZE              (0.047f)
-#define GLES2_HUD_HMD_SCALE                         (1.00f)
-
-#define GLES2_HUD_DEFAULT_HFOV                      (78.)
-#define GLES2_HUD_DEFAULT_VFOV                      (49.)
-
-
-enum gles2_hud_text_align {
-	GLES2_HUD_TEXT_ALIGN_LEFT = 0,
-	GLES2_HUD_TEXT_ALIGN_TOP = 0,
-	GLES2_HUD_TEXT_ALIGN_CENTER = 1,
-	GLES2_HUD_TEXT_ALIGN_MIDDLE = 1,
-	GLES2_HUD_TEXT_ALIGN_RIGHT = 2,
-	GLES2_HUD_TEXT_ALIGN_BOTTOM = 2,
+#define HUD_TEX_UNIT_COUNT 3
+#define HUD_HEADING_TICK_COUNT 36
+
+#define HUD_DEFAULT_CENTRAL_ZONE_SIZE         (0.25f)
+#define HUD_DEFAULT_HEADING_ZONE_V_OFFSET     (-0.80f)
+#define HUD_DEFAULT_ROLL_ZONE_V_OFFSET        (0.50f)
+#define HUD_DEFAULT_VU_METER_ZONE_H_OFFSET    (-0.60f)
+#define HUD_DEFAULT_VU_METER_V_INTERVAL       (-0.30f)
+#define HUD_DEFAULT_RIGHT_ZONE_H_OFFSET       (0.65f)
+#define HUD_DEFAULT_RADAR_ZONE_H_OFFSET       (0.45f)
+#define HUD_DEFAULT_RADAR_ZONE_V_OFFSET       (-0.65f)
+#define HUD_DEFAULT_TEXT_SIZE                 (0.15f)
+#define HUD_DEFAULT_SMALL_ICON_SIZE           (0.040f)
+#define HUD_DEFAULT_MEDIUM_ICON_SIZE          (0.050f)
+#define HUD_DEFAULT_SCALE                     (1.00f)
+
+#define HUD_HMD_SCALE                         (1.00f)
+#define HUD_HMD_CENTRAL_ZONE_SIZE             (0.20f)
+#define HUD_HMD_HEADING_ZONE_V_OFFSET         (-0.80f)
+#define HUD_HMD_ROLL_ZONE_V_OFFSET            (0.50f)
+#define HUD_HMD_VU_METER_ZONE_H_OFFSET        (-0.50f)
+#define HUD_HMD_VU_METER_V_INTERVAL           (-0.25f)
+#define HUD_HMD_RIGHT_ZONE_H_OFFSET           (0.55f)
+#define HUD_HMD_RADAR_ZONE_H_OFFSET           (0.35f)
+#define HUD_HMD_RADAR_ZONE_V_OFFSET           (-0.65f)
+#define HUD_HMD_TEXT_SIZE                     (0.14f)
+#define HUD_HMD_SMALL_ICON_SIZE               (0.037f)
+#define HUD_HMD_MEDIUM_ICON_SIZE              (0.047f)
+#define HUD_HMD_SCALE                         (1.00f)
+
+#define HUD_DEFAULT_HFOV                      (78.)
+#define HUD_DEFAULT_VFOV                      (49.)
+
+
+enum hud_text_align {
+	HUD_TEXT_ALIGN_LEFT = 0,
+	HUD_TEXT_ALIGN_TOP = 0,
+	HUD_TEXT_ALIGN_CENTER = 1,
+	HUD_TEXT_ALIGN_MIDDLE = 1,
+	HUD_TEXT_ALIGN_RIGHT = 2,
+	HUD_TEXT_ALIGN_BOTTOM = 2,
 };
 
 
@@ -86,18 +85,23 @@ class Session;
 class VideoMedia;
 
 
-class Gles2Hud {
+/**
+ * The HUD only draws through a HudCanvas; the canvas is owned by the
+ * caller and must outlive the HUD.
+ */
+class Hud {
 public:
-	Gles2Hud(Session *session,
+	Hud(Session *session,
 		VideoMedia *media,
+		HudCanvas *canvas,
 		unsigned int firstTexUnit);
 
-	~Gles2Hud(
+	~Hud(
 		void);
 
 	static int getTexUnitCount(
 		void) {
-		return GLES2_HUD_TEX_UNIT_COUNT;
+		return HUD_TEX_UNIT_COUNT;
 	}
 
 	int renderHud(
@@ -107,18 +111,13 @@ public:
 		unsigned int windowHeight,
 		const struct vmeta_frame_v2 *metadata,
 		bool hmdDistorsionCorrection,
-		bool headtracking);
+		bool headtracking,
+		const struct vmeta_quaternion *headOrientation);
 
 	void setVideoMedia(
 		VideoMedia *media);
 
 private:
-	int loadTextureFromBuffer(
-		const uint8_t *buffer,
-		int width,
-		int height,
-		int texUnit);
-
 	void drawIcon(
 		int index,
 		float x,
@@ -151,8 +150,8 @@ private:
 		float size,
 		float scaleW,
 		float scaleH,
-		enum gles2_hud_text_align halign,
-		enum gles2_hud_text_align valign,
+		enum hud_text_align halign,
+		enum hud_text_align valign,
 		const float color[4]);
 
 	void drawLine(
@@ -231,11 +230,10 @@ private:
 		const float color[4],
 		float lineWidth);
 
-	void drawVuMeter(
+	void drawVuMeterScale(
 		float x,
 		float y,
 		float r,
-		float value,
 		float minVal,
 		float maxVal,
 		float criticalMin,
@@ -244,40 +242,71 @@ private:
 		const float criticalColor[4],
 		float lineWidth);
 
+	void drawVuMeter(
+		float x,
+		float y,
+		float r,
+		float value,
+		float minVal,
+		float maxVal,
+		const float color[4],
+		float lineWidth);
+
 	int initCockpit(
 		void);
 
+	/* Record the static meshes; called when the layout changes */
+	int buildMeshes(
+		unsigned int windowWidth);
+
 	void drawCockpit(
 		const float color[4],
 		const float color2[4],
-		float lineWidth,
-		Eigen::Matrix4f &xformMat);
+		float lineWidth);
+
+	void drawArtificialHorizonScale(
+		const float color[4]);
 
 	void drawArtificialHorizon(
 		const struct vmeta_euler *drone,
 		const struct vmeta_euler *frame,
 		const float color[4]);
 
+	void drawRollScale(
+		const float color[4]);
+
 	void drawRoll(
 		float droneRoll,
 		const float color[4]);
 
+	void drawHeadingScale(
+		const float color[4]);
+
 	void drawHeading(
 		float droneYaw,
 		float speedHorizRho,
 		float speedPsi,
 		const float color[4]);
 
+	void drawAltitudeScale(
+		const float color[4]);
+
 	void drawAltitude(
 		double altitude,
 		float groundDistance,
 		float downSpeed,
 		const float color[4]);
 
+	void drawSpeedScale(
+		const float color[4]);
+
 	void drawSpeed(
 		float horizontalSpeed,
 		const float color[4]);
 
+	void drawControllerRadarScale(
+		const float color[4]);
+
 	void drawControllerRadar(
 		double distance,
 		double bearing,
@@ -312,21 +341,13 @@ private:
 	unsigned int mFirstTexUnit;
 	float mAspectRatio;
 	float mVideoAspectRatio;
-	GLint mProgram[2];
-	GLint mPositionHandle;
-	GLint mTransformMatrixHandle;
-	GLint mColorHandle;
-	GLuint mLogoTexture;
+	HudCanvas *mCanvas;
+	int mLogoTexture;
 	unsigned int mLogoTexUnit;
-	GLuint mIconsTexture;
+	int mIconsTexture;
 	unsigned int mIconsTexUnit;
-	GLuint mTextTexture;
+	int mTextTexture;
 	unsigned int mTextTexUnit;
-	GLint mTexUniformSampler;
-	GLint mTexPositionHandle;
-	GLint mTexTexcoordHandle;
-	GLint mTexTransformMatrixHandle;
-	GLint mTexColorHandle;
 	float mHudCentralZoneSize;
 	float mHudHeadingZoneVOffset;
 	float mHudRollZoneVOffset;
@@ -347,10 +368,19 @@ private:
 	float mRatioH;
 	float *mCockpitSphereVertices;
 	unsigned int mCockpitSphereVerticesCount;
+	int mCockpitMesh;
+	int mHelmetMesh;
+	int mRadarMesh;
+	bool mLayoutValid;
+	unsigned int mLayoutVideoWidth;
+	unsigned int mLayoutVideoHeight;
+	unsigned int mLayoutWindowWidth;
+	unsigned int mLayoutWindowHeight;
+	bool mLayoutHmd;
+	float mHeadingTickCos[HUD_HEADING_TICK_COUNT];
+	float mHeadingTickSin[HUD_HEADING_TICK_COUNT];
 };
 
 } /* namespace Pdraw */
 
-#endif /* USE_GLES2 */
-
-#endif /* !_PDRAW_GLES2_HUD_HPP_ */
+#endif /* !_PDRAW_HUD_HPP_ */
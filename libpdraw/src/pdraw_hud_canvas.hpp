@@ -0,0 +1,117 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * HUD drawing canvas interface
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_HUD_CANVAS_HPP_
+#define _PDRAW_HUD_CANVAS_HPP_
+
+#include <inttypes.h>
+
+namespace Pdraw {
+
+
+enum hud_canvas_line_mode {
+	HUD_CANVAS_LINE_MODE_LINES = 0,
+	HUD_CANVAS_LINE_MODE_LINE_STRIP,
+	HUD_CANVAS_LINE_MODE_LINE_LOOP,
+};
+
+
+/**
+ * Drawing backend of the HUD: the positions are transformed by the current
+ * matrix into clip space; the primitives of a frame are drawn at flush()
+ * with alpha blending, solid triangles first, then solid lines, then
+ * textured primitives, the static meshes first within each pass.
+ */
+class HudCanvas {
+public:
+	virtual ~HudCanvas(
+		void) {}
+
+	/* Luminance texture used as alpha by addTexturedStrip();
+	 * returns a texture id > 0 or a negative errno */
+	virtual int createTexture(
+		const uint8_t *buffer,
+		unsigned int width,
+		unsigned int height,
+		unsigned int texUnit) = 0;
+
+	virtual void destroyTexture(
+		int texture) = 0;
+
+	/* Column-major matrix applied to the following primitives */
+	virtual void setTransform(
+		const float matrix[16]) = 0;
+
+	/* dim: 2 or 3 */
+	virtual void addLines(
+		enum hud_canvas_line_mode mode,
+		const float *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const float color[4],
+		float lineWidth) = 0;
+
+	virtual void addTriangleStrip(
+		const float *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const float color[4]) = 0;
+
+	virtual void addTexturedStrip(
+		int texture,
+		unsigned int texUnit,
+		const float *vertices,
+		const float *texCoords,
+		unsigned int count,
+		const float color[4]) = 0;
+
+	/* Start recording the following primitives into a new static mesh;
+	 * returns the mesh id */
+	virtual int beginMesh(
+		void) = 0;
+
+	virtual int endMesh(
+		void) = 0;
+
+	virtual void destroyMesh(
+		int mesh) = 0;
+
+	/* Draw a static mesh with a column-major matrix at the next flush */
+	virtual void drawMesh(
+		int mesh,
+		const float matrix[16]) = 0;
+
+	/* Draw all the primitives and meshes added since the last flush */
+	virtual int flush(
+		void) = 0;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_HUD_CANVAS_HPP_ */
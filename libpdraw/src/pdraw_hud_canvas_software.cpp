@@ -0,0 +1,790 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Software HUD canvas
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_hud_canvas_software.hpp"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#  define PDRAW_HUD_CANVAS_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PDRAW_HUD_CANVAS_NEON
+#  include <arm_neon.h>
+#endif
+#define ULOG_TAG pdraw_hudcanvassw
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_hudcanvassw);
+
+namespace Pdraw {
+
+
+/* Vertices closer to the eye plane are dropped instead of clipped */
+#define SOFTWARE_HUD_CANVAS_MIN_W 1e-6f
+
+
+static const float identity[16] = {
+	1., 0., 0., 0.,
+	0., 1., 0., 0.,
+	0., 0., 1., 0.,
+	0., 0., 0., 1.,
+};
+
+
+static inline void blendPixel(
+	uint8_t *dst,
+	const uint8_t color[4],
+	unsigned int a)
+{
+	unsigned int inv = 255 - a;
+	unsigned int c, x;
+
+	for (c = 0; c < 3; c++) {
+		x = dst[c] * inv + color[c] * a + 128;
+		dst[c] = (x + (x >> 8)) >> 8;
+	}
+	dst[3] = 255;
+}
+
+
+/* Blend a row of packed 4-byte pixels with a solid color using either a
+ * constant alpha or a per-pixel alpha array; the output alpha is opaque */
+static void blendSpan(
+	uint8_t *dst,
+	unsigned int count,
+	const uint8_t color[4],
+	uint8_t constAlpha,
+	const uint8_t *alpha)
+{
+	unsigned int x = 0;
+
+#if defined(PDRAW_HUD_CANVAS_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i alphaLane = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	const __m128i cst = _mm_set1_epi16(constAlpha);
+	uint32_t c32 = color[0] | (color[1] << 8) | (color[2] << 16) |
+		(255U << 24);
+	const __m128i col = _mm_unpacklo_epi8(
+		_mm_set1_epi32((int)c32), zero);
+
+	for (; x + 4 <= count; x += 4) {
+		__m128i aLo, aHi, d, dLo, dHi, lo, hi;
+		if (alpha) {
+			__m128i a;
+			uint32_t a32;
+			memcpy(&a32, alpha + x, sizeof(a32));
+			a = _mm_cvtsi32_si128((int)a32);
+			a = _mm_unpacklo_epi8(a, a);
+			a = _mm_unpacklo_epi16(a, a);
+			aLo = _mm_unpacklo_epi8(a, zero);
+			aHi = _mm_unpackhi_epi8(a, zero);
+		} else {
+			aLo = cst;
+			aHi = cst;
+		}
+		/* The alpha lanes blend 255 with a weight of 1 */
+		aLo = _mm_or_si128(_mm_andnot_si128(alphaLane, aLo),
+			_mm_and_si128(alphaLane, c255));
+		aHi = _mm_or_si128(_mm_andnot_si128(alphaLane, aHi),
+			_mm_and_si128(alphaLane, c255));
+		d = _mm_loadu_si128((const __m128i *)(dst + 4 * x));
+		dLo = _mm_unpacklo_epi8(d, zero);
+		dHi = _mm_unpackhi_epi8(d, zero);
+		lo = _mm_add_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(dLo, _mm_sub_epi16(c255, aLo)),
+			_mm_mullo_epi16(col, aLo)), round);
+		hi = _mm_add_epi16(_mm_add_epi16(
+			_mm_mullo_epi16(dHi, _mm_sub_epi16(c255, aHi)),
+			_mm_mullo_epi16(col, aHi)), round);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)),
+			8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)),
+			8);
+		_mm_storeu_si128((__m128i *)(dst + 4 * x),
+			_mm_packus_epi16(lo, hi));
+	}
+#elif defined(PDRAW_HUD_CANVAS_NEON)
+	const uint8x8_t c255 = vdup_n_u8(255);
+	unsigned int c;
+
+	for (; x + 8 <= count; x += 8) {
+		uint8x8x4_t d = vld4_u8(dst + 4 * x);
+		uint8x8_t a = (alpha) ? vld1_u8(alpha + x) :
+			vdup_n_u8(constAlpha);
+		uint8x8_t inv = vsub_u8(c255, a);
+		for (c = 0; c < 3; c++) {
+			uint16x8_t v = vmull_u8(d.val[c], inv);
+			v = vmlal_u8(v, vdup_n_u8(color[c]), a);
+			d.val[c] = vrshrn_n_u16(vrsraq_n_u16(v, v, 8), 8);
+		}
+		d.val[3] = c255;
+		vst4_u8(dst + 4 * x, d);
+	}
+#endif
+
+	for (; x < count; x++) {
+		blendPixel(dst + 4 * x, color,
+			(alpha) ? alpha[x] : constAlpha);
+	}
+}
+
+
+/* Bilinear luminance sample with clamp to edge */
+static inline unsigned int sampleTexture(
+	const struct software_hud_canvas_texture *tex,
+	float u,
+	float v)
+{
+	float fx = u * tex->width - 0.5f;
+	float fy = v * tex->height - 0.5f;
+	int x0 = (int)floorf(fx);
+	int y0 = (int)floorf(fy);
+	float wx = fx - x0;
+	float wy = fy - y0;
+	int x1 = x0 + 1, y1 = y0 + 1;
+	int maxX = (int)tex->width - 1, maxY = (int)tex->height - 1;
+	const uint8_t *r0, *r1;
+	float top, bottom;
+
+	x0 = (x0 < 0) ? 0 : ((x0 > maxX) ? maxX : x0);
+	x1 = (x1 < 0) ? 0 : ((x1 > maxX) ? maxX : x1);
+	y0 = (y0 < 0) ? 0 : ((y0 > maxY) ? maxY : y0);
+	y1 = (y1 < 0) ? 0 : ((y1 > maxY) ? maxY : y1);
+	r0 = tex->data + y0 * tex->width;
+	r1 = tex->data + y1 * tex->width;
+	top = r0[x0] + (r0[x1] - r0[x0]) * wx;
+	bottom = r1[x0] + (r1[x1] - r1[x0]) * wx;
+
+	return (unsigned int)(top + (bottom - top) * wy + 0.5f);
+}
+
+
+static inline float edgeX(
+	float xa,
+	float ya,
+	float xb,
+	float yb,
+	float y)
+{
+	if (yb == ya)
+		return xa;
+	return xa + (y - ya) * (xb - xa) / (yb - ya);
+}
+
+
+static inline uint8_t toByte(
+	float v)
+{
+	if (v <= 0.)
+		return 0;
+	else if (v >= 1.)
+		return 255;
+	else
+		return (uint8_t)(v * 255. + 0.5);
+}
+
+
+SoftwareHudCanvas::SoftwareHudCanvas(
+	void)
+{
+	mWidth = 0;
+	mHeight = 0;
+	mRecordingMesh = -1;
+	memcpy(mTransform, identity, sizeof(mTransform));
+}
+
+
+SoftwareHudCanvas::~SoftwareHudCanvas(
+	void)
+{
+	unsigned int i;
+
+	for (i = 0; i < mMeshes.size(); i++)
+		destroyMesh(i);
+	for (i = 0; i < mTextures.size(); i++)
+		destroyTexture(i + 1);
+}
+
+
+int SoftwareHudCanvas::createTexture(
+	const uint8_t *buffer,
+	unsigned int width,
+	unsigned int height,
+	unsigned int /* texUnit */)
+{
+	struct software_hud_canvas_texture *tex;
+	unsigned int i;
+
+	if ((buffer == NULL) || (width == 0) || (height == 0))
+		return -EINVAL;
+
+	tex = new struct software_hud_canvas_texture;
+	if (tex == NULL) {
+		ULOGE("allocation failed");
+		return -ENOMEM;
+	}
+	tex->data = (uint8_t *)malloc(width * height);
+	if (tex->data == NULL) {
+		ULOGE("allocation failed");
+		delete tex;
+		return -ENOMEM;
+	}
+	memcpy(tex->data, buffer, width * height);
+	tex->width = width;
+	tex->height = height;
+
+	for (i = 0; i < mTextures.size(); i++) {
+		if (mTextures[i] == NULL)
+			break;
+	}
+	if (i == mTextures.size())
+		mTextures.push_back(tex);
+	else
+		mTextures[i] = tex;
+
+	return i + 1;
+}
+
+
+void SoftwareHudCanvas::destroyTexture(
+	int texture)
+{
+	struct software_hud_canvas_texture *tex;
+
+	if ((texture <= 0) || ((unsigned int)texture > mTextures.size()) ||
+		(mTextures[texture - 1] == NULL))
+		return;
+
+	tex = mTextures[texture - 1];
+	free(tex->data);
+	delete tex;
+	mTextures[texture - 1] = NULL;
+}
+
+
+void SoftwareHudCanvas::setTransform(
+	const float matrix[16])
+{
+	memcpy(mTransform, matrix, sizeof(mTransform));
+}
+
+
+void SoftwareHudCanvas::addPrimitive(
+	unsigned int pass,
+	unsigned int vertexCount,
+	const float *vertices,
+	unsigned int dim,
+	const float *texCoords,
+	const unsigned int index[3],
+	const float color[4],
+	int texture,
+	float lineWidth)
+{
+	struct software_hud_canvas_primitive prim;
+	const float *m = mTransform;
+	unsigned int i, j;
+
+	prim.vertexCount = vertexCount;
+	for (i = 0; i < vertexCount; i++) {
+		const float *v = vertices + index[i] * dim;
+		float x = v[0];
+		float y = v[1];
+		float z = (dim > 2) ? v[2] : 0.;
+		for (j = 0; j < 4; j++) {
+			prim.position[i][j] = m[j] * x + m[4 + j] * y +
+				m[8 + j] * z + m[12 + j];
+		}
+		if (texCoords) {
+			prim.texCoord[i][0] = texCoords[2 * index[i]];
+			prim.texCoord[i][1] = texCoords[2 * index[i] + 1];
+		} else {
+			prim.texCoord[i][0] = 0.;
+			prim.texCoord[i][1] = 0.;
+		}
+	}
+	memcpy(prim.color, color, sizeof(prim.color));
+	prim.texture = texture;
+	prim.lineWidth = lineWidth;
+
+	if (mRecordingMesh >= 0)
+		mMeshes[mRecordingMesh]->primitives[pass].push_back(prim);
+	else
+		mPrimitives[pass].push_back(prim);
+}
+
+
+void SoftwareHudCanvas::addLines(
+	enum hud_canvas_line_mode mode,
+	const float *vertices,
+	unsigned int dim,
+	unsigned int count,
+	const float color[4],
+	float lineWidth)
+{
+	unsigned int i, index[3];
+
+	if ((mode != HUD_CANVAS_LINE_MODE_LINES) &&
+		(mode != HUD_CANVAS_LINE_MODE_LINE_STRIP) &&
+		(mode != HUD_CANVAS_LINE_MODE_LINE_LOOP)) {
+		ULOGE("unsupported mode %d", mode);
+		return;
+	}
+	if ((vertices == NULL) || (count < 2))
+		return;
+
+	index[2] = 0;
+	for (i = 0; i + 1 < count;
+		i += (mode == HUD_CANVAS_LINE_MODE_LINES) ? 2 : 1) {
+		index[0] = i;
+		index[1] = i + 1;
+		addPrimitive(1, 2, vertices, dim, NULL, index, color, 0,
+			lineWidth);
+	}
+	if (mode == HUD_CANVAS_LINE_MODE_LINE_LOOP) {
+		index[0] = count - 1;
+		index[1] = 0;
+		addPrimitive(1, 2, vertices, dim, NULL, index, color, 0,
+			lineWidth);
+	}
+}
+
+
+void SoftwareHudCanvas::addTriangleStrip(
+	const float *vertices,
+	unsigned int dim,
+	unsigned int count,
+	const float color[4])
+{
+	unsigned int i, index[3];
+
+	if ((vertices == NULL) || (count < 3))
+		return;
+
+	for (i = 0; i + 2 < count; i++) {
+		index[0] = i;
+		index[1] = i + 1;
+		index[2] = i + 2;
+		addPrimitive(0, 3, vertices, dim, NULL, index, color, 0, 0.);
+	}
+}
+
+
+void SoftwareHudCanvas::addTexturedStrip(
+	int texture,
+	unsigned int /* texUnit */,
+	const float *vertices,
+	const float *texCoords,
+	unsigned int count,
+	const float color[4])
+{
+	unsigned int i, index[3];
+
+	if ((vertices == NULL) || (texCoords == NULL) || (count < 3))
+		return;
+
+	for (i = 0; i + 2 < count; i++) {
+		index[0] = i;
+		index[1] = i + 1;
+		index[2] = i + 2;
+		addPrimitive(2, 3, vertices, 2, texCoords, index, color,
+			texture, 0.);
+	}
+}
+
+
+int SoftwareHudCanvas::beginMesh(
+	void)
+{
+	struct software_hud_canvas_mesh *mesh;
+	unsigned int i;
+
+	if (mRecordingMesh >= 0) {
+		ULOGE("a mesh is already being recorded");
+		return -EBUSY;
+	}
+
+	mesh = new struct software_hud_canvas_mesh;
+	if (mesh == NULL) {
+		ULOGE("allocation failed");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < mMeshes.size(); i++) {
+		if (mMeshes[i] == NULL)
+			break;
+	}
+	if (i == mMeshes.size())
+		mMeshes.push_back(mesh);
+	else
+		mMeshes[i] = mesh;
+
+	mRecordingMesh = i;
+	memcpy(mTransform, identity, sizeof(mTransform));
+
+	return i;
+}
+
+
+int SoftwareHudCanvas::endMesh(
+	void)
+{
+	if (mRecordingMesh < 0) {
+		ULOGE("no mesh is being recorded");
+		return -EPROTO;
+	}
+
+	mRecordingMesh = -1;
+	memcpy(mTransform, identity, sizeof(mTransform));
+
+	return 0;
+}
+
+
+void SoftwareHudCanvas::destroyMesh(
+	int mesh)
+{
+	if ((mesh < 0) || ((unsigned int)mesh >= mMeshes.size()) ||
+		(mMeshes[mesh] == NULL))
+		return;
+
+	if (mRecordingMesh == mesh)
+		mRecordingMesh = -1;
+	delete mMeshes[mesh];
+	mMeshes[mesh] = NULL;
+}
+
+
+void SoftwareHudCanvas::drawMesh(
+	int mesh,
+	const float matrix[16])
+{
+	struct software_hud_canvas_mesh_draw draw;
+
+	if ((mesh < 0) || ((unsigned int)mesh >= mMeshes.size()) ||
+		(mMeshes[mesh] == NULL) || (mesh == mRecordingMesh))
+		return;
+
+	draw.mesh = mesh;
+	memcpy(draw.transform, matrix, sizeof(draw.transform));
+	mMeshDraws.push_back(draw);
+}
+
+
+void SoftwareHudCanvas::setViewport(
+	unsigned int width,
+	unsigned int height)
+{
+	mWidth = width;
+	mHeight = height;
+}
+
+
+void SoftwareHudCanvas::addRaster(
+	const float x[3],
+	const float y[3],
+	const float *texCoords,
+	const float color[4],
+	int texture)
+{
+	struct software_hud_canvas_raster r;
+	float xMin, xMax, det;
+	unsigned int i;
+
+	r.yMin = r.yMax = y[0];
+	xMin = xMax = x[0];
+	for (i = 0; i < 3; i++) {
+		r.x[i] = x[i];
+		r.y[i] = y[i];
+		if (y[i] < r.yMin)
+			r.yMin = y[i];
+		if (y[i] > r.yMax)
+			r.yMax = y[i];
+		if (x[i] < xMin)
+			xMin = x[i];
+		if (x[i] > xMax)
+			xMax = x[i];
+	}
+	if ((xMax <= 0.) || (xMin >= mWidth) ||
+		(r.yMax <= 0.) || (r.yMin >= mHeight))
+		return;
+
+	det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (det == 0.)
+		return;
+
+	for (i = 0; i < 4; i++)
+		r.color[i] = toByte(color[i]);
+	if (r.color[3] == 0)
+		return;
+
+	r.texture = NULL;
+	if (texCoords != NULL) {
+		const float *t = texCoords;
+		float du1 = t[2] - t[0], du2 = t[4] - t[0];
+		float dv1 = t[3] - t[1], dv2 = t[5] - t[1];
+		if ((texture <= 0) ||
+			((unsigned int)texture > mTextures.size()))
+			return;
+		r.texture = mTextures[texture - 1];
+		if (r.texture == NULL)
+			return;
+		r.uPlane[0] = (du1 * (y[2] - y[0]) - du2 * (y[1] - y[0])) / det;
+		r.uPlane[1] = ((x[1] - x[0]) * du2 - (x[2] - x[0]) * du1) / det;
+		r.uPlane[2] = t[0] - r.uPlane[0] * x[0] - r.uPlane[1] * y[0];
+		r.vPlane[0] = (dv1 * (y[2] - y[0]) - dv2 * (y[1] - y[0])) / det;
+		r.vPlane[1] = ((x[1] - x[0]) * dv2 - (x[2] - x[0]) * dv1) / det;
+		r.vPlane[2] = t[1] - r.vPlane[0] * x[0] - r.vPlane[1] * y[0];
+	}
+
+	mRaster.push_back(r);
+}
+
+
+void SoftwareHudCanvas::project(
+	const struct software_hud_canvas_primitive *prim,
+	const float matrix[16])
+{
+	float x[3], y[3], qx[3], qy[3];
+	float dx, dy, len, half, nx, ny;
+	unsigned int i, j;
+
+	for (i = 0; i < prim->vertexCount; i++) {
+		float p[4];
+		if (matrix != NULL) {
+			const float *v = prim->position[i];
+			for (j = 0; j < 4; j++) {
+				p[j] = matrix[j] * v[0] +
+					matrix[4 + j] * v[1] +
+					matrix[8 + j] * v[2] +
+					matrix[12 + j] * v[3];
+			}
+		} else {
+			memcpy(p, prim->position[i], sizeof(p));
+		}
+		if (p[3] <= SOFTWARE_HUD_CANVAS_MIN_W)
+			return;
+		x[i] = (p[0] / p[3] * 0.5f + 0.5f) * mWidth;
+		y[i] = (0.5f - p[1] / p[3] * 0.5f) * mHeight;
+	}
+
+	if (prim->vertexCount == 3) {
+		addRaster(x, y, (prim->texture > 0) ?
+			&prim->texCoord[0][0] : NULL,
+			prim->color, prim->texture);
+		return;
+	}
+
+	/* Lines are drawn as quads of the line width in pixels */
+	dx = x[1] - x[0];
+	dy = y[1] - y[0];
+	len = sqrtf(dx * dx + dy * dy);
+	if (len < 1e-6f)
+		return;
+	half = ((prim->lineWidth < 1.) ? 1. : prim->lineWidth) / 2.;
+	nx = -dy / len * half;
+	ny = dx / len * half;
+	qx[0] = x[0] + nx;
+	qy[0] = y[0] + ny;
+	qx[1] = x[0] - nx;
+	qy[1] = y[0] - ny;
+	qx[2] = x[1] + nx;
+	qy[2] = y[1] + ny;
+	addRaster(qx, qy, NULL, prim->color, 0);
+	qx[0] = x[1] - nx;
+	qy[0] = y[1] - ny;
+	addRaster(qx, qy, NULL, prim->color, 0);
+}
+
+
+void SoftwareHudCanvas::reset(
+	void)
+{
+	unsigned int pass;
+
+	for (pass = 0; pass < 3; pass++)
+		mPrimitives[pass].clear();
+	mMeshDraws.clear();
+	memcpy(mTransform, identity, sizeof(mTransform));
+}
+
+
+int SoftwareHudCanvas::flush(
+	void)
+{
+	std::vector<struct software_hud_canvas_mesh_draw>::iterator d;
+	std::vector<struct software_hud_canvas_primitive>::iterator p;
+	unsigned int pass;
+
+	mRaster.clear();
+
+	if ((mWidth == 0) || (mHeight == 0)) {
+		reset();
+		return -EPROTO;
+	}
+	if (mRecordingMesh >= 0) {
+		ULOGE("a mesh is still being recorded");
+		reset();
+		return -EPROTO;
+	}
+
+	/* The order of the primitives within a pass is kept */
+	for (pass = 0; pass < 3; pass++) {
+		for (d = mMeshDraws.begin(); d != mMeshDraws.end(); d++) {
+			struct software_hud_canvas_mesh *mesh =
+				mMeshes[d->mesh];
+			if (mesh == NULL)
+				continue;
+			for (p = mesh->primitives[pass].begin();
+				p != mesh->primitives[pass].end(); p++)
+				project(&(*p), d->transform);
+		}
+		for (p = mPrimitives[pass].begin();
+			p != mPrimitives[pass].end(); p++)
+			project(&(*p), NULL);
+	}
+
+	reset();
+	return 0;
+}
+
+
+void SoftwareHudCanvas::rasterizeTriangle(
+	const struct software_hud_canvas_raster *r,
+	uint8_t *dst,
+	unsigned int dstStride,
+	bool bgra,
+	unsigned int yStart,
+	unsigned int yEnd,
+	uint8_t *alpha) const
+{
+	unsigned int i0 = 0, i1 = 1, i2 = 2, t;
+	int row, rowStart, rowEnd, x0, x1, x;
+	uint8_t color[4], *line;
+
+	/* Sort the vertices by y */
+	if (r->y[i1] < r->y[i0]) {
+		t = i0;
+		i0 = i1;
+		i1 = t;
+	}
+	if (r->y[i2] < r->y[i1]) {
+		t = i1;
+		i1 = i2;
+		i2 = t;
+	}
+	if (r->y[i1] < r->y[i0]) {
+		t = i0;
+		i0 = i1;
+		i1 = t;
+	}
+
+	/* Rows whose center is within [yMin, yMax) */
+	rowStart = (int)ceilf(r->yMin - 0.5f);
+	rowEnd = (int)ceilf(r->yMax - 0.5f);
+	if (rowStart < (int)yStart)
+		rowStart = yStart;
+	if (rowEnd > (int)yEnd)
+		rowEnd = yEnd;
+
+	color[0] = (bgra) ? r->color[2] : r->color[0];
+	color[1] = r->color[1];
+	color[2] = (bgra) ? r->color[0] : r->color[2];
+	color[3] = 255;
+
+	for (row = rowStart; row < rowEnd; row++) {
+		float yc = row + 0.5f;
+		float xa, xb, xl, xr;
+		xa = edgeX(r->x[i0], r->y[i0], r->x[i2], r->y[i2], yc);
+		if (yc < r->y[i1])
+			xb = edgeX(r->x[i0], r->y[i0], r->x[i1], r->y[i1], yc);
+		else
+			xb = edgeX(r->x[i1], r->y[i1], r->x[i2], r->y[i2], yc);
+		xl = (xa < xb) ? xa : xb;
+		xr = (xa < xb) ? xb : xa;
+
+		/* Pixels whose center is within [xl, xr) */
+		x0 = (int)ceilf(xl - 0.5f);
+		x1 = (int)ceilf(xr - 0.5f);
+		if (x0 < 0)
+			x0 = 0;
+		if (x1 > (int)mWidth)
+			x1 = mWidth;
+		if (x1 <= x0)
+			continue;
+
+		line = dst + row * dstStride + 4 * x0;
+		if (r->texture == NULL) {
+			blendSpan(line, x1 - x0, color, r->color[3], NULL);
+			continue;
+		}
+		for (x = x0; x < x1; x++) {
+			float xc = x + 0.5f;
+			float u = r->uPlane[0] * xc + r->uPlane[1] * yc +
+				r->uPlane[2];
+			float v = r->vPlane[0] * xc + r->vPlane[1] * yc +
+				r->vPlane[2];
+			alpha[x - x0] = (r->color[3] *
+				sampleTexture(r->texture, u, v) + 127) / 255;
+		}
+		blendSpan(line, x1 - x0, color, 0, alpha);
+	}
+}
+
+
+void SoftwareHudCanvas::rasterize(
+	uint8_t *dst,
+	unsigned int dstStride,
+	bool bgra,
+	unsigned int yStart,
+	unsigned int yEnd,
+	uint8_t *alpha) const
+{
+	std::vector<struct software_hud_canvas_raster>::const_iterator r;
+
+	if ((dst == NULL) || (mRaster.empty()))
+		return;
+	if (yEnd > mHeight)
+		yEnd = mHeight;
+	if (yStart >= yEnd)
+		return;
+
+	for (r = mRaster.begin(); r != mRaster.end(); r++) {
+		if ((r->yMax <= yStart) || (r->yMin >= yEnd))
+			continue;
+		if ((r->texture != NULL) && (alpha == NULL))
+			continue;
+		rasterizeTriangle(&(*r), dst, dstStride, bgra, yStart, yEnd,
+			alpha);
+	}
+}
+
+} /* namespace Pdraw */
@@ -0,0 +1,216 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Software HUD canvas
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_HUD_CANVAS_SOFTWARE_HPP_
+#define _PDRAW_HUD_CANVAS_SOFTWARE_HPP_
+
+#include <inttypes.h>
+#include <vector>
+#include "pdraw_hud_canvas.hpp"
+
+namespace Pdraw {
+
+
+struct software_hud_canvas_texture {
+	uint8_t *data;
+	unsigned int width;
+	unsigned int height;
+};
+
+
+/* Line (2 vertices) or triangle (3 vertices) in clip space */
+struct software_hud_canvas_primitive {
+	unsigned int vertexCount;
+	float position[3][4];
+	float texCoord[3][2];
+	float color[4];
+	int texture;
+	float lineWidth;
+};
+
+
+struct software_hud_canvas_mesh {
+	std::vector<struct software_hud_canvas_primitive> primitives[3];
+};
+
+
+struct software_hud_canvas_mesh_draw {
+	int mesh;
+	float transform[16];
+};
+
+
+/* Triangle in pixel coordinates ready to be rasterized */
+struct software_hud_canvas_raster {
+	float x[3];
+	float y[3];
+	float yMin;
+	float yMax;
+	/* R, G, B, A */
+	uint8_t color[4];
+	/* NULL for solid triangles */
+	const struct software_hud_canvas_texture *texture;
+	/* Texture coordinates as affine functions of the pixel position:
+	 * u = uPlane[0] * x + uPlane[1] * y + uPlane[2] */
+	float uPlane[3];
+	float vPlane[3];
+};
+
+
+/**
+ * CPU implementation of the HUD canvas: flush() only projects the
+ * primitives of the frame to the viewport and converts the lines to
+ * quads; rasterize() then draws them into a packed RGBA or BGRA image,
+ * band by band so that the bands can be drawn by concurrent threads.
+ * The alpha blending kernel uses SSE2 or NEON when available.
+ */
+class SoftwareHudCanvas : public HudCanvas {
+public:
+	SoftwareHudCanvas(
+		void);
+
+	~SoftwareHudCanvas(
+		void);
+
+	int createTexture(
+		const uint8_t *buffer,
+		unsigned int width,
+		unsigned int height,
+		unsigned int texUnit);
+
+	void destroyTexture(
+		int texture);
+
+	void setTransform(
+		const float matrix[16]);
+
+	void addLines(
+		enum hud_canvas_line_mode mode,
+		const float *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const float color[4],
+		float lineWidth);
+
+	void addTriangleStrip(
+		const float *vertices,
+		unsigned int dim,
+		unsigned int count,
+		const float color[4]);
+
+	void addTexturedStrip(
+		int texture,
+		unsigned int texUnit,
+		const float *vertices,
+		const float *texCoords,
+		unsigned int count,
+		const float color[4]);
+
+	int beginMesh(
+		void);
+
+	int endMesh(
+		void);
+
+	void destroyMesh(
+		int mesh);
+
+	void drawMesh(
+		int mesh,
+		const float matrix[16]);
+
+	int flush(
+		void);
+
+	/* Size in pixels of the image drawn by the next flush() */
+	void setViewport(
+		unsigned int width,
+		unsigned int height);
+
+	/* Draw the triangles of the last flush() into the rows
+	 * [yStart, yEnd) of the image; thread-safe for distinct rows and
+	 * scratch rows. The scratch row holds at least the viewport width
+	 * and is needed by the textured triangles, skipped otherwise */
+	void rasterize(
+		uint8_t *dst,
+		unsigned int dstStride,
+		bool bgra,
+		unsigned int yStart,
+		unsigned int yEnd,
+		uint8_t *alpha) const;
+
+private:
+	void addPrimitive(
+		unsigned int pass,
+		unsigned int vertexCount,
+		const float *vertices,
+		unsigned int dim,
+		const float *texCoords,
+		const unsigned int index[3],
+		const float color[4],
+		int texture,
+		float lineWidth);
+
+	void project(
+		const struct software_hud_canvas_primitive *prim,
+		const float matrix[16]);
+
+	void addRaster(
+		const float x[3],
+		const float y[3],
+		const float *texCoords,
+		const float color[4],
+		int texture);
+
+	void rasterizeTriangle(
+		const struct software_hud_canvas_raster *r,
+		uint8_t *dst,
+		unsigned int dstStride,
+		bool bgra,
+		unsigned int yStart,
+		unsigned int yEnd,
+		uint8_t *alpha) const;
+
+	void reset(
+		void);
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+	float mTransform[16];
+	std::vector<struct software_hud_canvas_texture *> mTextures;
+	std::vector<struct software_hud_canvas_primitive> mPrimitives[3];
+	std::vector<struct software_hud_canvas_mesh *> mMeshes;
+	int mRecordingMesh;
+	std::vector<struct software_hud_canvas_mesh_draw> mMeshDraws;
+	std::vector<struct software_hud_canvas_raster> mRaster;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_HUD_CANVAS_SOFTWARE_HPP_ */
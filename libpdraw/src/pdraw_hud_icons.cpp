@@ -27,8 +27,6 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifdef USE_GLES2
-
 namespace Pdraw {
 
 static const int hudIconsWidth = 212;
@@ -20855,5 +20853,3 @@ static const uint8_t hudLogo[] =
 };
 
 } /* namespace Pdraw */
-
-#endif /* USE_GLES2 */
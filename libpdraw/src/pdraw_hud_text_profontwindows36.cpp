@@ -32,8 +32,6 @@
  * http://tobiasjung.name/profont/
  */
 
-#ifdef USE_GLES2
-
 namespace Pdraw {
 
 namespace font_36 {
@@ -5059,5 +5057,3 @@ static unsigned char image[] = { //gray-scale image
 } /* namespace font_36 */
 
 } /* namespace Pdraw */
-
-#endif /* USE_GLES2 */
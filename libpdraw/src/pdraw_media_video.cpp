@@ -29,7 +29,11 @@
 
 #include "pdraw_media_video.hpp"
 #include "pdraw_avcdecoder.hpp"
+#include "pdraw_frame_batch.hpp"
+#include "pdraw_frame_export.hpp"
+#include "pdraw_session.hpp"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #define ULOG_TAG pdraw_mediavideo
 #include <ulog.h>
@@ -70,6 +74,8 @@ VideoMedia::VideoMedia(
 	mDemux = demux;
 	mDemuxEsIndex = demuxEsIndex;
 	mDecoder = NULL;
+	mMetadataSubscriberCount[PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER] = 0;
+	mMetadataSubscriberCount[PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER] = 0;
 
 	res = pthread_mutexattr_init(&attr);
 	if (res < 0) {
@@ -91,6 +97,12 @@ VideoMedia::VideoMedia(
 	}
 	mutex_created = true;
 
+	res = pthread_mutex_init(&mMetadataMutex, NULL);
+	if (res < 0) {
+		ULOG_ERRNO("pthread_mutex_init", -res);
+		goto error;
+	}
+
 	pthread_mutexattr_destroy(&attr);
 	return;
 
@@ -108,6 +120,16 @@ VideoMedia::~VideoMedia(
 	if (mDecoder)
 		disableDecoder();
 
+	/* No batch can be delivered with a dangling filter context */
+	std::vector<VideoFrameBatcher *>::iterator b =
+		mVideoFrameBatchers.begin();
+	while (b != mVideoFrameBatchers.end()) {
+		int ret = (*b)->stop();
+		if (ret < 0)
+			ULOG_ERRNO("videoFrameBatcher->stop", -ret);
+		b++;
+	}
+
 	std::vector<VideoFrameFilter *>::iterator p =
 		mVideoFrameFilters.begin();
 	while (p != mVideoFrameFilters.end()) {
@@ -115,6 +137,41 @@ VideoMedia::~VideoMedia(
 		p++;
 	}
 
+	struct pomp_loop *loop = (mSession != NULL) ? mSession->getLoop() : NULL;
+	if ((loop != NULL) && (!mRetiredFilters.empty())) {
+		int ret = pomp_loop_idle_remove(loop,
+			&retiredFiltersIdleCb, this);
+		if (ret < 0)
+			ULOG_ERRNO("pomp_loop_idle_remove", -ret);
+	}
+	p = mRetiredFilters.begin();
+	while (p != mRetiredFilters.end()) {
+		delete *p;
+		p++;
+	}
+
+	/* The exporter and batcher filters are gone, no callback can
+	 * run anymore */
+	std::vector<VideoFrameExporter *>::iterator e =
+		mVideoFrameExporters.begin();
+	while (e != mVideoFrameExporters.end()) {
+		delete *e;
+		e++;
+	}
+	b = mVideoFrameBatchers.begin();
+	while (b != mVideoFrameBatchers.end()) {
+		delete *b;
+		b++;
+	}
+
+	std::vector<struct videomedia_metadata_subscriber *>::iterator s =
+		mMetadataSubscribers.begin();
+	while (s != mMetadataSubscribers.end()) {
+		free(*s);
+		s++;
+	}
+
+	pthread_mutex_destroy(&mMetadataMutex);
 	pthread_mutex_destroy(&mMutex);
 }
 
@@ -254,6 +311,8 @@ int VideoMedia::enableDecoder(
 		return -EPROTO;
 	}
 
+	/* A decoder instance from the session warm pool is reused on
+	 * the first configuration if one matches the SPS */
 	mDecoder = new AvcDecoder(this);
 	if (mDecoder == NULL) {
 		pthread_mutex_unlock(&mMutex);
@@ -302,6 +361,17 @@ int VideoMedia::disableDecoder(
 }
 
 
+Decoder *VideoMedia::detachDecoder(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	Decoder *ret = mDecoder;
+	mDecoder = NULL;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+
 Session *VideoMedia::getSession(
 	void) {
 	pthread_mutex_lock(&mMutex);
@@ -321,7 +391,8 @@ Decoder *VideoMedia::getDecoder(
 
 
 VideoFrameFilter *VideoMedia::addVideoFrameFilter(
-	bool frameByFrame)
+	bool frameByFrame,
+	bool copy)
 {
 	int ret;
 	pthread_mutex_lock(&mMutex);
@@ -333,7 +404,7 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 	}
 
 	VideoFrameFilter *p = new VideoFrameFilter(
-		this, frameByFrame);
+		this, frameByFrame, copy);
 	if (p == NULL) {
 		pthread_mutex_unlock(&mMutex);
 		ULOG_ERRNO("video frame filter creation failed", ENOMEM);
@@ -347,7 +418,8 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 		delete p;
 		return NULL;
 	}
-	ret = ((AvcDecoder *)mDecoder)->addOutputSink(this, queue);
+	ret = ((AvcDecoder *)mDecoder)->addOutputSink(this, queue,
+		&VideoFrameFilter::queueNotifyCb, p);
 	if (ret < 0) {
 		pthread_mutex_unlock(&mMutex);
 		ULOG_ERRNO("decoder->addOutputSink", -ret);
@@ -364,7 +436,8 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 	pdraw_video_frame_filter_callback_t cb,
 	void *userPtr,
-	bool frameByFrame)
+	bool frameByFrame,
+	bool parallel)
 {
 	int ret;
 	pthread_mutex_lock(&mMutex);
@@ -381,7 +454,7 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 	}
 
 	VideoFrameFilter *p = new VideoFrameFilter(
-		this, cb, userPtr, frameByFrame);
+		this, cb, userPtr, frameByFrame, false, parallel);
 	if (p == NULL) {
 		pthread_mutex_unlock(&mMutex);
 		ULOG_ERRNO("video frame filter creation failed", ENOMEM);
@@ -395,7 +468,8 @@ VideoFrameFilter *VideoMedia::addVideoFrameFilter(
 		delete p;
 		return NULL;
 	}
-	ret = ((AvcDecoder *)mDecoder)->addOutputSink(this, queue);
+	ret = ((AvcDecoder *)mDecoder)->addOutputSink(this, queue,
+		&VideoFrameFilter::queueNotifyCb, p);
 	if (ret < 0) {
 		pthread_mutex_unlock(&mMutex);
 		ULOG_ERRNO("decoder->addOutputSink", -ret);
@@ -426,21 +500,25 @@ int VideoMedia::removeVideoFrameFilter(
 
 	while (p != mVideoFrameFilters.end()) {
 		if (*p == filter) {
-			mVideoFrameFilters.erase(p);
 			struct vbuf_queue *queue = NULL;
-			ret = (*p)->getInputSourceQueue(this, &queue);
+			ret = filter->getInputSourceQueue(this, &queue);
 			if (ret < 0) {
-				ULOG_ERRNO("renderer->getInputSourceQueue",
+				pthread_mutex_unlock(&mMutex);
+				ULOG_ERRNO("videoFrameFilter->getInputSourceQueue",
 					-ret);
 				return ret;
 			}
-			ret = ((AvcDecoder *)mDecoder)->removeOutputSink(
-				this, queue);
-			if (ret < 0) {
-				ULOG_ERRNO("decoder->removeOutputSink", -ret);
-				return ret;
+			if (mDecoder != NULL) {
+				ret = ((AvcDecoder *)mDecoder)->removeOutputSink(
+					this, queue);
+				if (ret < 0) {
+					pthread_mutex_unlock(&mMutex);
+					ULOG_ERRNO("decoder->removeOutputSink",
+						-ret);
+					return ret;
+				}
 			}
-			delete *p;
+			mVideoFrameFilters.erase(p);
 			found = true;
 			break;
 		}
@@ -448,10 +526,305 @@ int VideoMedia::removeVideoFrameFilter(
 	}
 
 	pthread_mutex_unlock(&mMutex);
+
+	if (!found)
+		return -ENOENT;
+
+	if (filter->isCallbackThread()) {
+		/* Removed from its own callback: the filter would wait
+		 * for the callback to return; delete it from the loop */
+		pthread_mutex_lock(&mMutex);
+		mRetiredFilters.push_back(filter);
+		pthread_mutex_unlock(&mMutex);
+		struct pomp_loop *loop =
+			(mSession != NULL) ? mSession->getLoop() : NULL;
+		ret = (loop != NULL) ? pomp_loop_idle_add(loop,
+			&retiredFiltersIdleCb, this) : -EPROTO;
+		if (ret < 0)
+			ULOG_ERRNO("pomp_loop_idle_add", -ret);
+		return 0;
+	}
+
+	/* The filter thread may need the media lock to release its
+	 * last frame; delete it after unlocking */
+	delete filter;
+
+	return 0;
+}
+
+
+void VideoMedia::retiredFiltersIdleCb(
+	void *userdata)
+{
+	VideoMedia *media = (VideoMedia *)userdata;
+	std::vector<VideoFrameFilter *> filters;
+
+	if (media == NULL)
+		return;
+
+	pthread_mutex_lock(&media->mMutex);
+	filters.swap(media->mRetiredFilters);
+	pthread_mutex_unlock(&media->mMutex);
+
+	std::vector<VideoFrameFilter *>::iterator p = filters.begin();
+	while (p != filters.end()) {
+		delete *p;
+		p++;
+	}
+}
+
+
+void *VideoMedia::addMetadataCallback(
+	pdraw_video_frame_metadata_callback_t cb,
+	void *userPtr,
+	enum pdraw_video_frame_metadata_source source)
+{
+	if (cb == NULL) {
+		ULOGE("invalid callback");
+		return NULL;
+	}
+	if ((source != PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER) &&
+		(source != PDRAW_VIDEO_FRAME_METADATA_SOURCE_DEMUXER)) {
+		ULOGE("invalid metadata source");
+		return NULL;
+	}
+
+	struct videomedia_metadata_subscriber *sub =
+		(struct videomedia_metadata_subscriber *)calloc(
+		1, sizeof(*sub));
+	if (sub == NULL) {
+		ULOGE("allocation failed");
+		return NULL;
+	}
+	sub->cb = cb;
+	sub->userPtr = userPtr;
+	sub->source = source;
+
+	pthread_mutex_lock(&mMetadataMutex);
+	mMetadataSubscribers.push_back(sub);
+	mMetadataSubscriberCount[source]++;
+	pthread_mutex_unlock(&mMetadataMutex);
+
+	return sub;
+}
+
+
+int VideoMedia::removeMetadataCallback(
+	void *metadataCtx)
+{
+	if (metadataCtx == NULL) {
+		ULOGE("invalid metadata context pointer");
+		return -EINVAL;
+	}
+
+	bool found = false;
+	pthread_mutex_lock(&mMetadataMutex);
+	std::vector<struct videomedia_metadata_subscriber *>::iterator p =
+		mMetadataSubscribers.begin();
+	while (p != mMetadataSubscribers.end()) {
+		if (*p == metadataCtx) {
+			mMetadataSubscriberCount[(*p)->source]--;
+			mMetadataSubscribers.erase(p);
+			found = true;
+			break;
+		}
+		p++;
+	}
+	pthread_mutex_unlock(&mMetadataMutex);
+
+	/* Callbacks are called with the lock held: once removed, the
+	 * subscriber can no longer be in use */
+	if (found)
+		free(metadataCtx);
+
 	return (found) ? 0 : -ENOENT;
 }
 
 
+void VideoMedia::notifyFrameMetadata(
+	enum pdraw_video_frame_metadata_source source,
+	struct pdraw_video_frame_metadata *meta)
+{
+	if ((meta == NULL) || (!hasMetadataSubscribers(source)))
+		return;
+
+	pthread_mutex_lock(&mMetadataMutex);
+	std::vector<struct videomedia_metadata_subscriber *>::iterator p =
+		mMetadataSubscribers.begin();
+	while (p != mMetadataSubscribers.end()) {
+		struct videomedia_metadata_subscriber *sub = *p;
+		if (sub->source == source) {
+			meta->sequenceNumber = sub->sequenceNumber++;
+			sub->cb(sub, meta, sub->userPtr);
+		}
+		p++;
+	}
+	pthread_mutex_unlock(&mMetadataMutex);
+}
+
+
+void VideoMedia::getFrameMetadata(
+	const struct avcdecoder_input_buffer *data,
+	struct pdraw_video_frame_metadata *meta)
+{
+	memset(meta, 0, sizeof(*meta));
+	meta->isComplete = (data->isComplete) ? 1 : 0;
+	meta->hasErrors = (data->hasErrors) ? 1 : 0;
+	meta->isRef = (data->isRef) ? 1 : 0;
+	meta->isIdr = (data->isIdr) ? 1 : 0;
+	meta->auNtpTimestamp = data->auNtpTimestamp;
+	meta->auNtpTimestampRaw = data->auNtpTimestampRaw;
+	meta->auNtpTimestampLocal = data->auNtpTimestampLocal;
+	meta->demuxOutputTimestamp = data->demuxOutputTimestamp;
+	if (data->hasMetadata) {
+		memcpy(&meta->metadata, &data->metadata,
+			sizeof(struct vmeta_frame_v2));
+		meta->hasMetadata = 1;
+	}
+}
+
+
+void *VideoMedia::getVideoFrameFilterUserPtr(
+	VideoFrameFilter *filter,
+	pdraw_video_frame_filter_callback_t cb)
+{
+	void *userPtr = NULL;
+	pthread_mutex_lock(&mMutex);
+
+	std::vector<VideoFrameFilter*>::iterator p = mVideoFrameFilters.begin();
+
+	while (p != mVideoFrameFilters.end()) {
+		if (*p == filter) {
+			if (filter->getCallback() == cb)
+				userPtr = filter->getUserPtr();
+			break;
+		}
+		p++;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+	return userPtr;
+}
+
+
+VideoFrameFilter *VideoMedia::addVideoFrameExport(
+	VideoFrameExporter *exporter)
+{
+	if (exporter == NULL) {
+		ULOG_ERRNO("invalid exporter", EINVAL);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	VideoFrameFilter *filter = addVideoFrameFilter(
+		&VideoFrameExporter::frameCb, exporter, false, false);
+	if (filter != NULL)
+		mVideoFrameExporters.push_back(exporter);
+
+	pthread_mutex_unlock(&mMutex);
+	return filter;
+}
+
+
+int VideoMedia::removeVideoFrameExport(
+	VideoFrameFilter *filter)
+{
+	VideoFrameExporter *exporter = (VideoFrameExporter *)
+		getVideoFrameFilterUserPtr(filter,
+		&VideoFrameExporter::frameCb);
+	if (exporter == NULL)
+		return -ENOENT;
+
+	/* The filter waits for its running callbacks; it must be
+	 * removed without the media lock held */
+	int ret = removeVideoFrameFilter(filter);
+	if (ret < 0)
+		return ret;
+
+	pthread_mutex_lock(&mMutex);
+
+	std::vector<VideoFrameExporter *>::iterator e =
+		mVideoFrameExporters.begin();
+	while (e != mVideoFrameExporters.end()) {
+		if (*e == exporter) {
+			mVideoFrameExporters.erase(e);
+			break;
+		}
+		e++;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+
+	delete exporter;
+	return 0;
+}
+
+
+VideoFrameFilter *VideoMedia::addVideoFrameBatch(
+	VideoFrameBatcher *batcher)
+{
+	if (batcher == NULL) {
+		ULOG_ERRNO("invalid batcher", EINVAL);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	VideoFrameFilter *filter = addVideoFrameFilter(
+		&VideoFrameBatcher::frameCb, batcher, false, false);
+	if (filter != NULL) {
+		batcher->setContext(filter);
+		mVideoFrameBatchers.push_back(batcher);
+	}
+
+	pthread_mutex_unlock(&mMutex);
+	return filter;
+}
+
+
+int VideoMedia::removeVideoFrameBatch(
+	VideoFrameFilter *filter)
+{
+	VideoFrameBatcher *batcher = (VideoFrameBatcher *)
+		getVideoFrameFilterUserPtr(filter,
+		&VideoFrameBatcher::frameCb);
+	if (batcher == NULL)
+		return -ENOENT;
+
+	/* Stop delivering batches before the filter context is gone;
+	 * pending frames are discarded */
+	int ret = batcher->stop();
+	if (ret < 0) {
+		ULOG_ERRNO("videoFrameBatcher->stop", -ret);
+		return ret;
+	}
+
+	/* The filter waits for its running callbacks; it must be
+	 * removed without the media lock held */
+	ret = removeVideoFrameFilter(filter);
+	if (ret < 0)
+		return ret;
+
+	pthread_mutex_lock(&mMutex);
+
+	std::vector<VideoFrameBatcher *>::iterator b =
+		mVideoFrameBatchers.begin();
+	while (b != mVideoFrameBatchers.end()) {
+		if (*b == batcher) {
+			mVideoFrameBatchers.erase(b);
+			break;
+		}
+		b++;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+
+	delete batcher;
+	return 0;
+}
+
+
 bool VideoMedia::isVideoFrameFilterValid(
 	VideoFrameFilter *filter)
 {
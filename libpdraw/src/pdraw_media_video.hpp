@@ -41,6 +41,18 @@
 namespace Pdraw {
 
 
+struct videomedia_metadata_subscriber {
+	pdraw_video_frame_metadata_callback_t cb;
+	void *userPtr;
+	enum pdraw_video_frame_metadata_source source;
+	uint64_t sequenceNumber;
+};
+
+
+class VideoFrameExporter;
+class VideoFrameBatcher;
+
+
 class VideoMedia : public Media {
 public:
 	VideoMedia(
@@ -114,6 +126,9 @@ public:
 	int disableDecoder(
 		void);
 
+	Decoder *detachDecoder(
+		void);
+
 	Session *getSession(
 		void);
 
@@ -121,20 +136,71 @@ public:
 		void);
 
 	VideoFrameFilter *addVideoFrameFilter(
-		bool frameByFrame = false);
+		bool frameByFrame = false,
+		bool copy = false);
 
 	VideoFrameFilter *addVideoFrameFilter(
 		pdraw_video_frame_filter_callback_t cb,
 		void *userPtr,
-		bool frameByFrame = false);
+		bool frameByFrame = false,
+		bool parallel = false);
 
 	int removeVideoFrameFilter(
 		VideoFrameFilter *filter);
 
+	/* Returns the user pointer of a filter of this media running
+	 * the given callback, or NULL */
+	void *getVideoFrameFilterUserPtr(
+		VideoFrameFilter *filter,
+		pdraw_video_frame_filter_callback_t cb);
+
+	/* On success the media owns the exporter */
+	VideoFrameFilter *addVideoFrameExport(
+		VideoFrameExporter *exporter);
+
+	int removeVideoFrameExport(
+		VideoFrameFilter *filter);
+
+	/* On success the media owns the batcher */
+	VideoFrameFilter *addVideoFrameBatch(
+		VideoFrameBatcher *batcher);
+
+	int removeVideoFrameBatch(
+		VideoFrameFilter *filter);
+
+	/**
+	 * The callback is called synchronously from the decoder or the
+	 * demuxer thread and must return quickly; it must not call
+	 * metadata subscription functions
+	 */
+	void *addMetadataCallback(
+		pdraw_video_frame_metadata_callback_t cb,
+		void *userPtr,
+		enum pdraw_video_frame_metadata_source source);
+
+	int removeMetadataCallback(
+		void *metadataCtx);
+
+	bool hasMetadataSubscribers(
+		enum pdraw_video_frame_metadata_source source) {
+		return mMetadataSubscriberCount[source] > 0;
+	}
+
+	void notifyFrameMetadata(
+		enum pdraw_video_frame_metadata_source source,
+		struct pdraw_video_frame_metadata *meta);
+
+	static void getFrameMetadata(
+		const struct avcdecoder_input_buffer *data,
+		struct pdraw_video_frame_metadata *meta);
+
 private:
 	bool isVideoFrameFilterValid(
 		VideoFrameFilter *filter);
 
+	static void retiredFiltersIdleCb(
+		void *userdata);
+
 	enum elementary_stream_type mEsType;
 	enum pdraw_video_type mVideoType;
 	unsigned int mWidth;
@@ -151,6 +217,15 @@ private:
 	int mDemuxEsIndex;
 	Decoder *mDecoder;
 	std::vector<VideoFrameFilter *> mVideoFrameFilters;
+	/* Filters removed from their own callback, deleted from the
+	 * loop thread */
+	std::vector<VideoFrameFilter *> mRetiredFilters;
+	std::vector<VideoFrameExporter *> mVideoFrameExporters;
+	std::vector<VideoFrameBatcher *> mVideoFrameBatchers;
+	pthread_mutex_t mMetadataMutex;
+	std::vector<struct videomedia_metadata_subscriber *>
+		mMetadataSubscribers;
+	volatile unsigned int mMetadataSubscriberCount[2];
 };
 
 } /* namespace Pdraw */
@@ -67,6 +67,7 @@ SessionSelfMetadata::SessionSelfMetadata(
 	mLastControllerQuatTimestamp = 0;
 	mPrevControllerQuatTimestamp = 0;
 	mTracking = false;
+	mChangeCount = 0;
 
 	res = pthread_mutexattr_init(&attr);
 	if (res < 0) {
@@ -216,10 +217,21 @@ void SessionSelfMetadata::setLocation(
 
 	pthread_mutex_lock(&mMutex);
 	memcpy(&mLocation, loc, sizeof(*loc));
+	mChangeCount++;
 	pthread_mutex_unlock(&mMutex);
 }
 
 
+unsigned int SessionSelfMetadata::getChangeCount(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	unsigned int ret = mChangeCount;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+
 int SessionSelfMetadata::getControllerBatteryLevel(
 	void)
 {
@@ -235,6 +247,7 @@ void SessionSelfMetadata::setControllerBatteryLevel(
 {
 	pthread_mutex_lock(&mMutex);
 	mControllerBatteryLevel = batteryLevel;
+	mChangeCount++;
 	pthread_mutex_unlock(&mMutex);
 }
 
@@ -295,6 +308,7 @@ void SessionSelfMetadata::setControllerOrientation(
 	} else {
 		mLastControllerQuatTimestamp = timestamp;
 	}
+	mChangeCount++;
 
 	pthread_mutex_unlock(&mMutex);
 }
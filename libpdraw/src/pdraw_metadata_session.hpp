@@ -134,6 +134,12 @@ public:
 	void resetHeadRefOrientation(
 		void);
 
+	/* Incremented on every location, controller battery level
+	 * and controller orientation change (used by the renderer
+	 * to detect HUD updates) */
+	unsigned int getChangeCount(
+		void);
+
 private:
 	void setControllerOrientation(
 		Eigen::Quaternionf &quat);
@@ -161,6 +167,7 @@ private:
 	uint64_t mLastControllerQuatTimestamp;
 	uint64_t mPrevControllerQuatTimestamp;
 	bool mTracking;
+	unsigned int mChangeCount;
 };
 
 
@@ -30,11 +30,15 @@
 #include "pdraw_renderer.hpp"
 #include "pdraw_renderer_gles2.hpp"
 #include "pdraw_renderer_videocoreegl.hpp"
+#include "pdraw_renderer_software.hpp"
 
 namespace Pdraw {
 
 Renderer *Renderer::create(
-	Session *session) {
+	Session *session,
+	bool software) {
+	if (software)
+		return new SoftwareRenderer(session);
 #if defined(USE_VIDEOCOREEGL)
 	return new VideoCoreEglRenderer(session);
 #elif defined(USE_GLES2)
@@ -30,6 +30,7 @@
 #ifndef _PDRAW_RENDERER_HPP_
 #define _PDRAW_RENDERER_HPP_
 
+#include <errno.h>
 #include "pdraw_avcdecoder.hpp"
 
 namespace Pdraw {
@@ -60,12 +61,37 @@ public:
 	virtual int close(
 		void) = 0;
 
+	/* Buffer rendered into by the next render() calls, for the
+	 * renderers which do not draw into a window */
+	virtual int setOutputBuffer(
+		uint8_t * /* data */,
+		size_t /* size */,
+		unsigned int /* stride */,
+		enum pdraw_color_format /* format */) {
+		return -ENOSYS;
+	}
+
+	/* Render into an offscreen target of the window size and deliver
+	 * the frames to a callback instead of drawing into the window */
+	virtual int setOffscreenTarget(
+		enum pdraw_color_format /* format */,
+		pdraw_offscreen_frame_callback_t /* cb */,
+		void * /* userPtr */) {
+		return -ENOSYS;
+	}
+
+	/**
+	 * Returns 1 if the frame was rendered, 0 if rendering was
+	 * skipped because nothing changed since the last rendered
+	 * frame and forceRedraw is false, or a negative errno
+	 */
 	virtual int render(
 		int renderX,
 		int renderY,
 		unsigned int renderWidth,
 		unsigned int renderHeight,
-		uint64_t timestamp) = 0;
+		uint64_t timestamp,
+		bool forceRedraw) = 0;
 
 	virtual int addInputSource(
 		Media *media) = 0;
@@ -77,6 +103,13 @@ public:
 		Media *media,
 		struct vbuf_queue **queue) = 0;
 
+	/* Frame pacing statistics of an input media */
+	virtual int getStats(
+		Media * /* media */,
+		struct pdraw_video_renderer_stats * /* stats */) {
+		return -ENOSYS;
+	}
+
 	virtual Session *getSession(
 		void) = 0;
 
@@ -87,7 +120,8 @@ public:
 		void) = 0;
 
 	static Renderer *create(
-		Session *session);
+		Session *session,
+		bool software);
 
 protected:
 	Session *mSession;
@@ -34,6 +34,8 @@
 
 #ifdef USE_GLES2
 
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
@@ -53,20 +55,56 @@ Gles2Renderer::Gles2Renderer(
 	mMedia = NULL;
 	mWindowWidth = 0;
 	mWindowHeight = 0;
-	mQueue = NULL;
-	mCurrentBuffer = NULL;
-	mGles2Video = NULL;
-	mGles2Hud = NULL;
+	mHudOverlay = NULL;
+	mGles2HudBatch = NULL;
 	mGles2HmdFirstTexUnit = 0;
 	mGles2VideoFirstTexUnit =
 		mGles2HmdFirstTexUnit + Gles2Hmd::getTexUnitCount();
-	mGles2HudFirstTexUnit =
+	mHudFirstTexUnit =
 		mGles2VideoFirstTexUnit + Gles2Video::getTexUnitCount();
+	mGles2Readback = NULL;
+	mGles2ReadbackFirstTexUnit =
+		mHudFirstTexUnit + Hud::getTexUnitCount();
 	mHmdDistorsionCorrection = false;
 	mGles2Hmd = NULL;
 	mFbo = 0;
 	mFboTexture = 0;
 	mFboRenderBuffer = 0;
+	mRedrawNeeded = true;
+	mLastRenderX = 0;
+	mLastRenderY = 0;
+	mLastRenderWidth = 0;
+	mLastRenderHeight = 0;
+	mLayout = SETTINGS_RENDERER_LAYOUT;
+	mLastHeadQuat.w = 1.;
+	mLastHeadQuat.x = 0.;
+	mLastHeadQuat.y = 0.;
+	mLastHeadQuat.z = 0.;
+	mEyeBufferHeadQuat = mLastHeadQuat;
+	mEyeBufferValid = false;
+	mLastSelfMetaChangeCount = 0;
+	mLastRenderTimestamp = 0;
+	mDisplayPeriod = 0;
+	mRenderTime = 0;
+	mLastRenderDrawn = false;
+	mHmdResolutionScale = SETTINGS_HMD_RESOLUTION_MAX_SCALE;
+	mHmdResolutionRenderCount = 0;
+	mHmdResolutionMissedCount = 0;
+	mHmdResolutionCleanPeriods = 0;
+	mTimerQuery = false;
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	mGlGenQueries = NULL;
+	mGlDeleteQueries = NULL;
+	mGlBeginQuery = NULL;
+	mGlEndQuery = NULL;
+	mGlGetQueryObjectuiv = NULL;
+	memset(mTimerQueries, 0, sizeof(mTimerQueries));
+	mTimerQueryHead = 0;
+	mTimerQueryCount = 0;
+	mTimerQueryActive = false;
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+	mEyeBufferWidth = 0;
+	mEyeBufferHeight = 0;
 
 	ret = pthread_mutex_init(&mMutex, NULL);
 	if (ret < 0)
@@ -77,10 +115,12 @@ Gles2Renderer::Gles2Renderer(
 Gles2Renderer::~Gles2Renderer(
 	void)
 {
-	if (mMedia != NULL) {
-		int ret = removeInputSource(mMedia);
-		if (ret < 0)
+	while (!mSources.empty()) {
+		int ret = removeInputSource(mSources.back()->media);
+		if (ret < 0) {
 			ULOG_ERRNO("removeInputSource", -ret);
+			break;
+		}
 	}
 
 	close();
@@ -118,18 +158,16 @@ int Gles2Renderer::open(
 
 	GLCHK();
 
-	mGles2Video = new Gles2Video(mSession, (VideoMedia*)mMedia,
-		mGles2VideoFirstTexUnit);
-	if (mGles2Video == NULL) {
-		ULOG_ERRNO("failed to create Gles2Video", ENOMEM);
-		goto err;
-	}
-
 	if (mHud) {
-		mGles2Hud = new Gles2Hud(mSession, (VideoMedia*)mMedia,
-			mGles2HudFirstTexUnit);
-		if (mGles2Hud == NULL) {
-			ULOG_ERRNO("failed to create Gles2Hud", ENOMEM);
+		mGles2HudBatch = new Gles2HudBatch();
+		if (mGles2HudBatch == NULL) {
+			ULOG_ERRNO("failed to create Gles2HudBatch", ENOMEM);
+			goto err;
+		}
+		mHudOverlay = new Hud(mSession, (VideoMedia*)mMedia,
+			mGles2HudBatch, mHudFirstTexUnit);
+		if (mHudOverlay == NULL) {
+			ULOG_ERRNO("failed to create HUD", ENOMEM);
 			goto err;
 		}
 	}
@@ -218,7 +256,12 @@ int Gles2Renderer::open(
 		}
 	}
 
+	createTimerQueries();
+
 	mRunning = true;
+	mRedrawNeeded = true;
+	mEyeBufferValid = false;
+	mLastRenderDrawn = false;
 	return 0;
 
 err:
@@ -230,17 +273,47 @@ err:
 int Gles2Renderer::close(
 	void)
 {
-	if ((mGles2Video != NULL) ||
-		(mGles2Hud != NULL) || (mGles2Hmd != NULL))
+	std::vector<struct gles2_renderer_source *>::iterator s;
+	std::vector<Gles2Video *>::iterator v;
+	bool video = !mRetiredVideos.empty();
+
+	if (mGles2Readback != NULL) {
+		/* Deliver the frames still in flight */
+		int ret = mGles2Readback->flush();
+		if (ret < 0)
+			ULOG_ERRNO("gles2Readback->flush", -ret);
+		delete mGles2Readback;
+		mGles2Readback = NULL;
+	}
+
+	pthread_mutex_lock(&mMutex);
+	for (s = mSources.begin(); s < mSources.end(); s++) {
+		if ((*s)->video != NULL)
+			video = true;
+	}
+
+	if ((video) || (mHudOverlay != NULL) || (mGles2Hmd != NULL))
 		GLCHK(glClear(GL_COLOR_BUFFER_BIT));
 
-	if (mGles2Video != NULL) {
-		delete mGles2Video;
-		mGles2Video = NULL;
+	for (s = mSources.begin(); s < mSources.end(); s++) {
+		if ((*s)->video == NULL)
+			continue;
+		delete (*s)->video;
+		(*s)->video = NULL;
+		(*s)->load = ((*s)->currentBuffer != NULL);
+	}
+	for (v = mRetiredVideos.begin(); v < mRetiredVideos.end(); v++)
+		delete *v;
+	mRetiredVideos.clear();
+	pthread_mutex_unlock(&mMutex);
+
+	if (mHudOverlay != NULL) {
+		delete mHudOverlay;
+		mHudOverlay = NULL;
 	}
-	if (mGles2Hud != NULL) {
-		delete mGles2Hud;
-		mGles2Hud = NULL;
+	if (mGles2HudBatch != NULL) {
+		delete mGles2HudBatch;
+		mGles2HudBatch = NULL;
 	}
 	if (mGles2Hmd != NULL) {
 		delete mGles2Hmd;
@@ -258,37 +331,122 @@ int Gles2Renderer::close(
 		GLCHK(glDeleteFramebuffers(1, &mFbo));
 		mFbo = 0;
 	}
+	destroyTimerQueries();
+
+	return 0;
+}
+
+
+int Gles2Renderer::setOffscreenTarget(
+	enum pdraw_color_format format,
+	pdraw_offscreen_frame_callback_t cb,
+	void *userPtr)
+{
+	if (cb == NULL)
+		return -EINVAL;
+	if (!mRunning) {
+		ULOGE("renderer is not opened");
+		return -EPROTO;
+	}
+	if (mHmdDistorsionCorrection) {
+		ULOGE("offscreen rendering is not supported with "
+			"HMD distortion correction");
+		return -ENOSYS;
+	}
+	if (mGles2Readback != NULL) {
+		ULOGE("offscreen target already set");
+		return -EBUSY;
+	}
+
+	mGles2Readback = new Gles2Readback(mWindowWidth, mWindowHeight,
+		format, mGles2ReadbackFirstTexUnit, cb, userPtr);
+	if (mGles2Readback == NULL) {
+		ULOG_ERRNO("failed to create Gles2Readback", ENOMEM);
+		return -ENOMEM;
+	}
+	if (mGles2Readback->getFramebuffer() == 0) {
+		ULOGE("failed to create the offscreen target");
+		delete mGles2Readback;
+		mGles2Readback = NULL;
+		return -EPROTO;
+	}
+	mRedrawNeeded = true;
 
 	return 0;
 }
 
 
+struct gles2_renderer_source *Gles2Renderer::getSource(
+	Media *media)
+{
+	std::vector<struct gles2_renderer_source *>::iterator s;
+
+	for (s = mSources.begin(); s < mSources.end(); s++) {
+		if ((*s)->media == media)
+			return *s;
+	}
+
+	return NULL;
+}
+
+
 int Gles2Renderer::addInputSource(
 	Media *media)
 {
+	struct gles2_renderer_source *source;
+
 	if (media == NULL)
 		return -EINVAL;
-	if (mMedia != NULL) {
-		ULOGE("multiple input media are not supported");
-		return -ENOSYS;
-	}
 	VideoMedia *vmedia = dynamic_cast<VideoMedia *>(media);
 	if (vmedia == NULL) {
 		ULOGE("media is not a video media");
 		return -EPROTO;
 	}
 
-	mQueue = vbuf_queue_new(0, 0);
-	if (mQueue == NULL) {
+	pthread_mutex_lock(&mMutex);
+
+	if (getSource(media) != NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("media is already an input source");
+		return -EEXIST;
+	}
+
+	source = (struct gles2_renderer_source *)calloc(1, sizeof(*source));
+	if (source == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("calloc", ENOMEM);
+		return -ENOMEM;
+	}
+
+	/* Each media has its own queue so that a slow or stalled stream
+	 * does not hold back the others */
+	source->queue = vbuf_queue_new(0, 0);
+	if (source->queue == NULL) {
+		pthread_mutex_unlock(&mMutex);
 		ULOGE("failed to create queue");
+		free(source);
 		return -ENOMEM;
 	}
+	source->scheduler = new FrameScheduler();
+	if (source->scheduler == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("failed to create FrameScheduler", ENOMEM);
+		vbuf_queue_destroy(source->queue);
+		free(source);
+		return -ENOMEM;
+	}
+	source->media = media;
+
+	/* The video is created on the rendering thread */
+	mSources.push_back(source);
+	if (mSources.size() == 1) {
+		mMedia = media;
+		if (mHudOverlay)
+			mHudOverlay->setVideoMedia(vmedia);
+	}
+	mRedrawNeeded = true;
 
-	mMedia = media;
-	if (mGles2Video)
-		mGles2Video->setVideoMedia(vmedia);
-	if (mGles2Hud)
-		mGles2Hud->setVideoMedia(vmedia);
+	pthread_mutex_unlock(&mMutex);
 
 	return 0;
 }
@@ -298,59 +456,531 @@ int Gles2Renderer::removeInputSource(
 	Media *media)
 {
 	int ret;
+	struct gles2_renderer_source *source;
+	struct vbuf_buffer *buffer;
+	std::vector<struct gles2_renderer_source *>::iterator s;
 
 	if (media == NULL)
 		return -EINVAL;
-	if (media != mMedia) {
+
+	/* Stop the decoder output to this source first so that it drops
+	 * the frames it accounts as held by the source (not under the
+	 * renderer lock: the decoder notifies its sinks with its own
+	 * lock held) */
+	AvcDecoder *decoder = (AvcDecoder *)media->getDecoder();
+	struct vbuf_queue *queue = NULL;
+	if ((decoder != NULL) && (getInputSourceQueue(media, &queue) == 0)) {
+		ret = decoder->removeOutputSink(media, queue);
+		if ((ret < 0) && (ret != -ENOENT))
+			ULOG_ERRNO("decoder->removeOutputSink", -ret);
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	for (s = mSources.begin(); s < mSources.end(); s++) {
+		if ((*s)->media == media)
+			break;
+	}
+	if (s == mSources.end()) {
+		pthread_mutex_unlock(&mMutex);
 		ULOGE("invalid media");
 		return -ENOENT;
 	}
+	source = *s;
+	mSources.erase(s);
+
+	if (source->currentBuffer != NULL) {
+		ret = releaseBuffer(source, &source->currentBuffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+	}
 
-	if (mCurrentBuffer != NULL) {
-		ret = vbuf_unref(&mCurrentBuffer);
+	while ((buffer = source->scheduler->flush()) != NULL) {
+		ret = releaseBuffer(source, &buffer);
 		if (ret < 0)
-			ULOG_ERRNO("vbuf_unref", -ret);
+			ULOG_ERRNO("releaseBuffer", -ret);
 	}
+	delete source->scheduler;
 
-	if (mQueue != NULL) {
-		ret = vbuf_queue_destroy(mQueue);
+	if (source->queue != NULL) {
+		ret = vbuf_queue_destroy(source->queue);
 		if (ret < 0)
 			ULOG_ERRNO("vbuf_queue_destroy", -ret);
-		mQueue = NULL;
 	}
 
-	mMedia = NULL;
+	/* This may not be the rendering thread */
+	if (source->video != NULL)
+		mRetiredVideos.push_back(source->video);
+	free(source);
+
+	mMedia = (mSources.empty()) ? NULL : mSources.front()->media;
+	if ((mHudOverlay) && (mMedia != NULL))
+		mHudOverlay->setVideoMedia((VideoMedia *)mMedia);
+	mRedrawNeeded = true;
+
+	pthread_mutex_unlock(&mMutex);
 
 	return 0;
 }
 
 
+int Gles2Renderer::releaseBuffer(
+	struct gles2_renderer_source *source,
+	struct vbuf_buffer **buffer)
+{
+	AvcDecoder *decoder = (AvcDecoder *)source->media->getDecoder();
+
+	/* Let the decoder account for the hold time */
+	if (decoder != NULL)
+		return decoder->releaseOutputBuffer(source->queue, buffer);
+	else
+		return vbuf_unref(buffer);
+}
+
+
+bool Gles2Renderer::isRedrawNeeded(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight)
+{
+	bool redraw = mRedrawNeeded;
+
+	if ((renderX != mLastRenderX) || (renderY != mLastRenderY) ||
+		(renderWidth != mLastRenderWidth) ||
+		(renderHeight != mLastRenderHeight)) {
+		mLastRenderX = renderX;
+		mLastRenderY = renderY;
+		mLastRenderWidth = renderWidth;
+		mLastRenderHeight = renderHeight;
+		redraw = true;
+	}
+
+	if (mSession == NULL)
+		return redraw;
+
+	/* The layout is latched here for the whole frame */
+	enum pdraw_video_renderer_layout layout =
+		mSession->getSettings()->getRendererLayout();
+	if (layout != mLayout) {
+		mLayout = layout;
+		redraw = true;
+	}
+
+	SessionSelfMetadata *selfMeta = mSession->getSelfMetadata();
+
+	if (mHud) {
+		/* Controller location, battery and orientation are
+		 * displayed by the HUD */
+		unsigned int changeCount = selfMeta->getChangeCount();
+		if (changeCount != mLastSelfMetaChangeCount) {
+			mLastSelfMetaChangeCount = changeCount;
+			redraw = true;
+		}
+	}
+
+	return redraw;
+}
+
+
+bool Gles2Renderer::isHeadMoved(
+	void)
+{
+	if ((!mHeadtracking) || (mSession == NULL))
+		return false;
+
+	Eigen::Quaternionf headQuat =
+		mSession->getSelfMetadata()->getDebiasedHeadOrientation();
+	Eigen::Quaternionf lastHeadQuat = Eigen::Quaternionf(
+		mLastHeadQuat.w, mLastHeadQuat.x,
+		mLastHeadQuat.y, mLastHeadQuat.z);
+	if (headQuat.angularDistance(lastHeadQuat) <=
+		GLES2_RENDERER_HEADTRACKING_THRESHOLD)
+		return false;
+
+	mLastHeadQuat.w = headQuat.w();
+	mLastHeadQuat.x = headQuat.x();
+	mLastHeadQuat.y = headQuat.y();
+	mLastHeadQuat.z = headQuat.z();
+	return true;
+}
+
+
+int Gles2Renderer::renderHmd(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight)
+{
+	int ret;
+	GLfloat reprojection[9];
+	bool reproject = false;
+
+	if (mGles2Hmd == NULL)
+		return 0;
+
+	if ((mHeadtracking) && (mSession != NULL)) {
+		/* Late-latch the head orientation and rotate the view rays
+		 * from the current orientation to the one the eye buffer
+		 * was rendered with; the camera orientation cancels out */
+		Eigen::Quaternionf headQuat =
+			mSession->getSelfMetadata()->getDebiasedHeadOrientation();
+		Eigen::Quaternionf eyeQuat = Eigen::Quaternionf(
+			mEyeBufferHeadQuat.w, mEyeBufferHeadQuat.x,
+			mEyeBufferHeadQuat.y, mEyeBufferHeadQuat.z);
+		Eigen::Matrix3f ned;
+		ned <<  1,  0,  0,
+			0, -1,  0,
+			0,  0, -1;
+		Eigen::Matrix3f rot;
+		rot <<  0,  0, -1,
+			1,  0,  0,
+			0, -1,  0;
+		Eigen::Map<Eigen::Matrix3f> mat(reprojection);
+		mat = rot.transpose() * ned *
+			eyeQuat.toRotationMatrix().transpose() *
+			headQuat.toRotationMatrix() * ned * rot;
+		reproject = true;
+	}
+
+	GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLCHK(glViewport(renderX, renderY, renderWidth, renderHeight));
+
+	ret = mGles2Hmd->renderHmd(mFboTexture, mWindowWidth / 2, mWindowHeight,
+		mEyeBufferWidth, mEyeBufferHeight,
+		(reproject) ? reprojection : NULL);
+	if (ret < 0)
+		ULOG_ERRNO("gles2Hmd->renderHmd", -ret);
+
+	return ret;
+}
+
+
+void Gles2Renderer::createTimerQueries(
+	void)
+{
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+	if ((mTimerQuery) || (extensions == NULL) ||
+		(strstr(extensions, "GL_EXT_disjoint_timer_query") == NULL))
+		return;
+
+	mGlGenQueries = (PFNGLGENQUERIESEXTPROC)
+		eglGetProcAddress("glGenQueriesEXT");
+	mGlDeleteQueries = (PFNGLDELETEQUERIESEXTPROC)
+		eglGetProcAddress("glDeleteQueriesEXT");
+	mGlBeginQuery = (PFNGLBEGINQUERYEXTPROC)
+		eglGetProcAddress("glBeginQueryEXT");
+	mGlEndQuery = (PFNGLENDQUERYEXTPROC)
+		eglGetProcAddress("glEndQueryEXT");
+	mGlGetQueryObjectuiv = (PFNGLGETQUERYOBJECTUIVEXTPROC)
+		eglGetProcAddress("glGetQueryObjectuivEXT");
+	if ((mGlGenQueries == NULL) || (mGlDeleteQueries == NULL) ||
+		(mGlBeginQuery == NULL) || (mGlEndQuery == NULL) ||
+		(mGlGetQueryObjectuiv == NULL)) {
+		ULOGW("GL_EXT_disjoint_timer_query functions not found");
+		return;
+	}
+
+	GLCHK(mGlGenQueries(GLES2_RENDERER_TIMER_QUERY_COUNT,
+		mTimerQueries));
+	mTimerQueryHead = 0;
+	mTimerQueryCount = 0;
+	mTimerQueryActive = false;
+	mTimerQuery = true;
+	ULOGI("GPU render time measurement enabled");
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+}
+
+
+void Gles2Renderer::destroyTimerQueries(
+	void)
+{
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	if (!mTimerQuery)
+		return;
+
+	if (mTimerQueryActive)
+		GLCHK(mGlEndQuery(GL_TIME_ELAPSED_EXT));
+	GLCHK(mGlDeleteQueries(GLES2_RENDERER_TIMER_QUERY_COUNT,
+		mTimerQueries));
+	memset(mTimerQueries, 0, sizeof(mTimerQueries));
+	mTimerQueryHead = 0;
+	mTimerQueryCount = 0;
+	mTimerQueryActive = false;
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+	mTimerQuery = false;
+}
+
+
+void Gles2Renderer::beginTimerQuery(
+	void)
+{
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	/* When all the queries are pending this frame is not measured */
+	if ((!mTimerQuery) ||
+		(mTimerQueryCount == GLES2_RENDERER_TIMER_QUERY_COUNT))
+		return;
+
+	GLCHK(mGlBeginQuery(GL_TIME_ELAPSED_EXT, mTimerQueries[
+		(mTimerQueryHead + mTimerQueryCount) %
+		GLES2_RENDERER_TIMER_QUERY_COUNT]));
+	mTimerQueryActive = true;
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+}
+
+
+void Gles2Renderer::endTimerQuery(
+	void)
+{
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	if (!mTimerQueryActive)
+		return;
+
+	GLCHK(mGlEndQuery(GL_TIME_ELAPSED_EXT));
+	mTimerQueryActive = false;
+	mTimerQueryCount++;
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+}
+
+
+void Gles2Renderer::readTimerQueries(
+	void)
+{
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	unsigned int i, count = 0;
+	GLuint available, elapsed;
+	GLint disjoint = 0;
+	GLuint query;
+
+	if (!mTimerQuery)
+		return;
+
+	/* The queries complete in order; never wait for a result */
+	for (i = 0; i < mTimerQueryCount; i++) {
+		query = mTimerQueries[(mTimerQueryHead + i) %
+			GLES2_RENDERER_TIMER_QUERY_COUNT];
+		available = GL_FALSE;
+		GLCHK(mGlGetQueryObjectuiv(query,
+			GL_QUERY_RESULT_AVAILABLE_EXT, &available));
+		if (!available)
+			break;
+		count++;
+	}
+	if (count == 0)
+		return;
+
+	/* The results are not valid when a disjoint operation (e.g. a
+	 * GPU frequency change) occurred while they were measured */
+	GLCHK(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+	for (i = 0; i < count; i++) {
+		query = mTimerQueries[mTimerQueryHead];
+		mTimerQueryHead = (mTimerQueryHead + 1) %
+			GLES2_RENDERER_TIMER_QUERY_COUNT;
+		mTimerQueryCount--;
+		if (disjoint)
+			continue;
+		elapsed = 0;
+		GLCHK(mGlGetQueryObjectuiv(query,
+			GL_QUERY_RESULT_EXT, &elapsed));
+		updateHmdResolution((uint64_t)elapsed / 1000);
+	}
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+}
+
+
+void Gles2Renderer::updateRenderTime(
+	uint64_t renderTime)
+{
+	if (mRenderTime == 0) {
+		mRenderTime = renderTime;
+	} else {
+		mRenderTime = (uint64_t)((int64_t)mRenderTime +
+			((int64_t)renderTime - (int64_t)mRenderTime) /
+			GLES2_RENDERER_RENDER_TIME_SMOOTHING);
+	}
+}
+
+
+void Gles2Renderer::updateHmdResolution(
+	uint64_t renderTime)
+{
+	unsigned int targetFrameTime = SETTINGS_HMD_RESOLUTION_TARGET_TIME;
+	float target, scale;
+
+	updateRenderTime(renderTime);
+
+	if (!mHmdDistorsionCorrection)
+		return;
+
+	mHmdResolutionRenderCount++;
+	if (mHmdResolutionRenderCount < GLES2_RENDERER_HMD_RESOLUTION_PERIOD)
+		return;
+	mHmdResolutionRenderCount = 0;
+
+	if (mSession != NULL) {
+		mSession->getSettings()->getHmdResolutionSettings(
+			NULL, NULL, &targetFrameTime);
+	}
+	if (targetFrameTime > 0)
+		target = (float)targetFrameTime;
+	else if (mDisplayPeriod > 0)
+		target = (float)mDisplayPeriod;
+	else
+		target = (float)GLES2_RENDERER_DEFAULT_FRAME_TIME;
+
+	scale = mHmdResolutionScale;
+	if (mRenderTime > target * GLES2_RENDERER_HMD_RESOLUTION_HIGH) {
+		/* The render time is mostly proportional to the
+		 * pixel count; aim between the thresholds */
+		scale *= sqrtf(target *
+			(GLES2_RENDERER_HMD_RESOLUTION_HIGH +
+			GLES2_RENDERER_HMD_RESOLUTION_LOW) / 2.f /
+			(float)mRenderTime);
+	} else if (mRenderTime < target * GLES2_RENDERER_HMD_RESOLUTION_LOW) {
+		scale += GLES2_RENDERER_HMD_RESOLUTION_STEP;
+	}
+	setHmdResolutionScale(scale);
+}
+
+
+/* Without a GPU timer the CPU time of the render calls does not tell
+ * how long the GPU takes; a render that misses display refreshes
+ * delays the next render call by whole refresh periods instead */
+void Gles2Renderer::countMissedRefreshes(
+	uint64_t interval)
+{
+	unsigned int renders = GLES2_RENDERER_HMD_RESOLUTION_PERIOD;
+	float scale;
+
+	if ((!mHmdDistorsionCorrection) || (mDisplayPeriod == 0) ||
+		(interval > FRAME_SCHEDULER_MAX_PERIOD))
+		return;
+
+	if (interval >= mDisplayPeriod * 3 / 2) {
+		mHmdResolutionMissedCount += (unsigned int)
+			((interval + mDisplayPeriod / 2) / mDisplayPeriod) - 1;
+	}
+	mHmdResolutionRenderCount++;
+	if (mHmdResolutionRenderCount < renders)
+		return;
+
+	scale = mHmdResolutionScale;
+	if (mHmdResolutionMissedCount > 0) {
+		/* The renders took (renders + missed) / renders refresh
+		 * periods; aim between the thresholds */
+		scale *= sqrtf((float)renders /
+			(float)(renders + mHmdResolutionMissedCount) *
+			(GLES2_RENDERER_HMD_RESOLUTION_HIGH +
+			GLES2_RENDERER_HMD_RESOLUTION_LOW) / 2.f);
+		mHmdResolutionCleanPeriods = 0;
+	} else {
+		/* There is no headroom measurement, only raise the scale
+		 * after a while without any missed refresh */
+		mHmdResolutionCleanPeriods++;
+		if (mHmdResolutionCleanPeriods >=
+			GLES2_RENDERER_HMD_RESOLUTION_RAISE_PERIODS) {
+			scale += GLES2_RENDERER_HMD_RESOLUTION_STEP;
+			mHmdResolutionCleanPeriods = 0;
+		}
+	}
+	mHmdResolutionRenderCount = 0;
+	mHmdResolutionMissedCount = 0;
+	setHmdResolutionScale(scale);
+}
+
+
+void Gles2Renderer::setHmdResolutionScale(
+	float scale)
+{
+	float minScale = SETTINGS_HMD_RESOLUTION_MIN_SCALE;
+	float maxScale = SETTINGS_HMD_RESOLUTION_MAX_SCALE;
+
+	if (mSession != NULL) {
+		mSession->getSettings()->getHmdResolutionSettings(
+			&minScale, &maxScale, NULL);
+	}
+	if (scale < minScale)
+		scale = minScale;
+	if (scale > maxScale)
+		scale = maxScale;
+	if (scale == mHmdResolutionScale)
+		return;
+
+	ULOGD("HMD resolution scale: %.2f (render time: %.1fms)",
+		scale, (float)mRenderTime / 1000.f);
+
+	/* Expect the render time of the new resolution until
+	 * it is measured */
+	mRenderTime = (uint64_t)((float)mRenderTime *
+		(scale * scale) / (mHmdResolutionScale * mHmdResolutionScale));
+	mHmdResolutionScale = scale;
+}
+
+
 int Gles2Renderer::getInputSourceQueue(
 	Media *media,
 	struct vbuf_queue **queue)
 {
+	struct gles2_renderer_source *source;
+
 	if (media == NULL)
 		return -EINVAL;
 	if (queue == NULL)
 		return -EINVAL;
-	if (media != mMedia) {
+
+	pthread_mutex_lock(&mMutex);
+	source = getSource(media);
+	if (source == NULL) {
+		pthread_mutex_unlock(&mMutex);
 		ULOGE("invalid media");
 		return -ENOENT;
 	}
+	*queue = source->queue;
+	pthread_mutex_unlock(&mMutex);
+
+	return 0;
+}
+
 
-	*queue = mQueue;
+int Gles2Renderer::getStats(
+	Media *media,
+	struct pdraw_video_renderer_stats *stats)
+{
+	struct gles2_renderer_source *source;
+
+	if (media == NULL)
+		return -EINVAL;
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+	source = getSource(media);
+	if (source == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media");
+		return -ENOENT;
+	}
+	source->scheduler->getStats(stats);
+	stats->displayPeriod = mDisplayPeriod;
+	stats->renderTime = mRenderTime;
+	stats->hmdResolutionScale =
+		(mHmdDistorsionCorrection) ? mHmdResolutionScale : 1.f;
+	pthread_mutex_unlock(&mMutex);
 
 	return 0;
 }
 
 
 int Gles2Renderer::loadVideoFrame(
+	Gles2Video *video,
 	const uint8_t *data,
 	struct avcdecoder_output_buffer *frame,
 	enum gles2_video_color_conversion colorConversion)
 {
 	int ret;
-	ret = mGles2Video->loadFrame(data, frame->plane_offset, frame->stride,
+	ret = video->loadFrame(data, frame->plane_offset, frame->stride,
 		frame->width, frame->height, colorConversion);
 	if (ret < 0)
 		ULOG_ERRNO("gles2Video->loadFrame", -ret);
@@ -358,18 +988,326 @@ int Gles2Renderer::loadVideoFrame(
 }
 
 
+/* Move the decoded frames of the source to its scheduler and select
+ * the frame to display at vsync; returns true if a new frame was
+ * selected */
+bool Gles2Renderer::dequeueFrames(
+	struct gles2_renderer_source *source,
+	uint64_t curTime,
+	uint64_t vsync)
+{
+	int ret, releaseRet;
+	struct vbuf_buffer *buffer = NULL, *dropped;
+	struct avcdecoder_output_buffer *data;
+	uint64_t timestamp, availableTime;
+
+	ret = vbuf_queue_pop(source->queue, 0, &buffer);
+	while ((ret == 0) && (buffer != NULL)) {
+		data = (struct avcdecoder_output_buffer *)vbuf_metadata_get(
+			buffer, source->media, NULL, NULL);
+		timestamp = (data != NULL) ? data->auNtpTimestamp : 0;
+		availableTime = (data != NULL) ?
+			data->decoderOutputTimestamp : 0;
+		if ((availableTime == 0) && (data != NULL))
+			availableTime = data->demuxOutputTimestamp;
+		if (availableTime == 0)
+			availableTime = curTime;
+		dropped = source->scheduler->push(buffer,
+			timestamp, availableTime);
+		if (dropped != NULL) {
+			releaseRet = releaseBuffer(source, &dropped);
+			if (releaseRet < 0)
+				ULOG_ERRNO("releaseBuffer", -releaseRet);
+		}
+		buffer = NULL;
+		ret = vbuf_queue_pop(source->queue, 0, &buffer);
+	}
+	if ((ret < 0) && (ret != -EAGAIN))
+		ULOG_ERRNO("vbuf_queue_pop", -ret);
+
+	while ((dropped = source->scheduler->popDropped(
+		vsync, mDisplayPeriod)) != NULL) {
+		releaseRet = releaseBuffer(source, &dropped);
+		if (releaseRet < 0)
+			ULOG_ERRNO("releaseBuffer", -releaseRet);
+	}
+
+	buffer = source->scheduler->pop(vsync, mDisplayPeriod,
+		(source->currentBuffer != NULL));
+	if (buffer == NULL)
+		return false;
+
+	if (source->currentBuffer != NULL) {
+		releaseRet = releaseBuffer(source, &source->currentBuffer);
+		if (releaseRet < 0)
+			ULOG_ERRNO("releaseBuffer", -releaseRet);
+	}
+	source->currentBuffer = buffer;
+	source->load = true;
+
+	return true;
+}
+
+
+/* Tile of a media in the render area, in GL window coordinates
+ * (origin at the bottom left) */
+void Gles2Renderer::getTile(
+	enum pdraw_video_renderer_layout layout,
+	unsigned int index,
+	unsigned int count,
+	const struct gles2_renderer_tile *area,
+	struct gles2_renderer_tile *tile)
+{
+	unsigned int cols, rows, col, row, margin, perRow, top, bottom;
+
+	switch (layout) {
+	case PDRAW_VIDEO_RENDERER_LAYOUT_PIP:
+		if (index == 0) {
+			*tile = *area;
+			break;
+		}
+		tile->width = area->width * GLES2_RENDERER_PIP_SCALE;
+		tile->height = area->height * GLES2_RENDERER_PIP_SCALE;
+		margin = area->height * GLES2_RENDERER_PIP_MARGIN;
+		perRow = (area->width - margin) / (tile->width + margin);
+		if (perRow == 0)
+			perRow = 1;
+		/* Right to left along the bottom edge, then upwards */
+		col = (index - 1) % perRow;
+		row = (index - 1) / perRow;
+		tile->x = area->x + (int)area->width -
+			(int)((col + 1) * (tile->width + margin));
+		tile->y = area->y + (int)margin +
+			(int)(row * (tile->height + margin));
+		break;
+	case PDRAW_VIDEO_RENDERER_LAYOUT_GRID:
+	default:
+		cols = 1;
+		while (cols * cols < count)
+			cols++;
+		rows = (count + cols - 1) / cols;
+		col = index % cols;
+		row = index / cols;
+		/* Rows are filled from the top */
+		top = area->height - row * area->height / rows;
+		bottom = area->height - (row + 1) * area->height / rows;
+		tile->x = area->x + (int)(col * area->width / cols);
+		tile->width = (col + 1) * area->width / cols -
+			col * area->width / cols;
+		tile->y = area->y + (int)bottom;
+		tile->height = top - bottom;
+		break;
+	}
+}
+
+
+int Gles2Renderer::renderSource(
+	struct gles2_renderer_source *source,
+	const struct gles2_renderer_tile *tile,
+	GLuint fbo,
+	struct avcdecoder_output_buffer **frame)
+{
+	int ret;
+	const uint8_t *cdata;
+	struct avcdecoder_output_buffer *data;
+	enum gles2_video_color_conversion colorConversion;
+
+	*frame = NULL;
+	if (source->currentBuffer == NULL)
+		return 0;
+
+	cdata = vbuf_get_cdata(source->currentBuffer);
+	data = (struct avcdecoder_output_buffer *)vbuf_metadata_get(
+		source->currentBuffer, source->media, NULL, NULL);
+	if ((cdata == NULL) || (data == NULL)) {
+		ULOGE("invalid buffer data");
+		return -EPROTO;
+	}
+
+	if (source->video == NULL) {
+		source->video = new Gles2Video(mSession,
+			(VideoMedia *)source->media, mGles2VideoFirstTexUnit);
+		if (source->video == NULL) {
+			ULOG_ERRNO("failed to create Gles2Video", ENOMEM);
+			return -ENOMEM;
+		}
+		source->load = true;
+		/* The creation unbinds the target framebuffer */
+		GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+	}
+
+	switch (data->colorFormat) {
+	default:
+	case AVCDECODER_COLOR_FORMAT_YUV420PLANAR:
+		colorConversion =
+			GLES2_VIDEO_COLOR_CONVERSION_YUV420PLANAR_TO_RGB;
+		break;
+	case AVCDECODER_COLOR_FORMAT_YUV420SEMIPLANAR:
+		colorConversion =
+			GLES2_VIDEO_COLOR_CONVERSION_YUV420SEMIPLANAR_TO_RGB;
+		break;
+	case AVCDECODER_COLOR_FORMAT_MMAL_OPAQUE:
+		colorConversion =
+			GLES2_VIDEO_COLOR_CONVERSION_NONE;
+		break;
+	}
+
+	*frame = data;
+
+	if (source->load) {
+		source->load = false;
+		ret = loadVideoFrame(source->video, cdata, data,
+			colorConversion);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = source->video->renderFrame(data->stride,
+		data->height, data->cropLeft, data->cropTop,
+		data->cropWidth, data->cropHeight,
+		data->sarWidth, data->sarHeight,
+		tile->x, tile->y, tile->width, tile->height,
+		colorConversion, &data->metadata, mHeadtracking,
+		&mEyeBufferHeadQuat, fbo);
+	if (ret < 0)
+		ULOG_ERRNO("gles2Video->renderFrame", -ret);
+
+	return ret;
+}
+
+
+/* Nothing is rendered: deliver the frames left in the readback ring
+ * now rather than when the next frame is rendered; must be called
+ * with mMutex held */
+void Gles2Renderer::flushReadback(
+	void)
+{
+	if (mGles2Readback == NULL)
+		return;
+
+	int ret = mGles2Readback->flush();
+	if (ret < 0)
+		ULOG_ERRNO("gles2Readback->flush", -ret);
+}
+
+
+/* Draw the sources in the eye buffer (HMD) or the target framebuffer;
+ * the first source frame is returned in data; must be called with
+ * mMutex held */
+void Gles2Renderer::renderEyeBuffer(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	GLuint fbo,
+	struct avcdecoder_output_buffer **data)
+{
+	int ret;
+	struct avcdecoder_output_buffer *frame;
+	struct gles2_renderer_tile area, tile;
+	unsigned int i, count;
+
+	*data = NULL;
+
+	if ((mHeadtracking) && (mSession != NULL)) {
+		/* Latch the head orientation once for all the passes
+		 * rendering the eye buffer */
+		Eigen::Quaternionf headQuat =
+			mSession->getSelfMetadata()->getDebiasedHeadOrientation();
+		mEyeBufferHeadQuat.w = headQuat.w();
+		mEyeBufferHeadQuat.x = headQuat.x();
+		mEyeBufferHeadQuat.y = headQuat.y();
+		mEyeBufferHeadQuat.z = headQuat.z();
+	}
+
+	if (mHmdDistorsionCorrection) {
+		/* The eye buffer fits in the framebuffer texture */
+		area.x = 0;
+		area.y = 0;
+		area.width = (renderWidth < mWindowWidth) ?
+			renderWidth / 2 : mWindowWidth / 2;
+		area.height = (renderHeight < mWindowHeight) ?
+			renderHeight : mWindowHeight;
+		area.width = (unsigned int)(mHmdResolutionScale *
+			area.width + 0.5f);
+		area.height = (unsigned int)(mHmdResolutionScale *
+			area.height + 0.5f);
+		if (area.width == 0)
+			area.width = 1;
+		if (area.height == 0)
+			area.height = 1;
+		mEyeBufferWidth = area.width;
+		mEyeBufferHeight = area.height;
+	} else {
+		area.x = renderX;
+		area.y = renderY;
+		area.width = renderWidth;
+		area.height = renderHeight;
+	}
+
+	if ((mHmdDistorsionCorrection) || (mGles2Readback))
+		GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+	GLCHK(glViewport(area.x, area.y, area.width, area.height));
+	GLCHK(glClear(GL_COLOR_BUFFER_BIT));
+	GLCHK(glDisable(GL_DITHER));
+
+	/* Only the first media is displayed in the HMD */
+	count = (mHmdDistorsionCorrection) ? 1 : mSources.size();
+	for (i = 0; i < count; i++) {
+		getTile(mLayout, i, count, &area, &tile);
+		if ((tile.width == 0) || (tile.height == 0))
+			continue;
+
+		if ((mLayout == PDRAW_VIDEO_RENDERER_LAYOUT_PIP) && (i > 0)) {
+			/* Hide the main video behind the letterboxing */
+			GLCHK(glEnable(GL_SCISSOR_TEST));
+			GLCHK(glScissor(tile.x, tile.y,
+				tile.width, tile.height));
+			GLCHK(glClear(GL_COLOR_BUFFER_BIT));
+			GLCHK(glDisable(GL_SCISSOR_TEST));
+		}
+
+		GLCHK(glViewport(tile.x, tile.y, tile.width, tile.height));
+		ret = renderSource(mSources[i], &tile, fbo, &frame);
+		if (ret < 0)
+			ULOG_ERRNO("renderSource", -ret);
+		if (i > 0)
+			continue;
+
+		*data = frame;
+		if ((mHudOverlay) && (frame != NULL)) {
+			ret = mHudOverlay->renderHud(
+				frame->width * frame->sarWidth,
+				frame->height * frame->sarHeight,
+				tile.width, tile.height, &frame->metadata,
+				mHmdDistorsionCorrection, mHeadtracking,
+				&mEyeBufferHeadQuat);
+			if (ret < 0)
+				ULOG_ERRNO("hud->renderHud", -ret);
+		}
+	}
+
+	mEyeBufferValid = mHmdDistorsionCorrection;
+}
+
+
 int Gles2Renderer::render(
 	int renderX,
 	int renderY,
 	unsigned int renderWidth,
 	unsigned int renderHeight,
-	uint64_t timestamp)
+	uint64_t timestamp,
+	bool forceRedraw)
 {
 	int ret = 0;
-	struct vbuf_buffer *buffer = NULL;
-	const uint8_t *cdata;
-	int dequeueRet = 0;
-	bool load = false;
+	std::vector<struct gles2_renderer_source *>::iterator s;
+	std::vector<Gles2Video *>::iterator v;
+	struct timespec ts;
+	uint64_t curTime, startTime, endTime, vsync, interval = 0;
+	struct avcdecoder_output_buffer *data = NULL;
+	struct gles2_renderer_source *source;
+	bool load = false, hasFrame = false, redraw, headMoved, reproject;
+	GLuint targetFbo, fbo;
 
 	if (!mRunning)
 		return 0;
@@ -381,108 +1319,156 @@ int Gles2Renderer::render(
 	if ((renderWidth == 0) || (renderHeight == 0))
 		return 0;
 
-	if (mQueue == NULL) {
-		GLCHK(glClear(GL_COLOR_BUFFER_BIT));
-		return 0;
-	}
+	targetFbo = (mGles2Readback) ? mGles2Readback->getFramebuffer() : 0;
+	fbo = (mHmdDistorsionCorrection) ? mFbo : targetFbo;
 
-	dequeueRet = vbuf_queue_pop(mQueue, 0, &buffer);
-	while ((dequeueRet == 0) && (buffer != NULL)) {
-		if (mCurrentBuffer != NULL) {
-			int releaseRet = vbuf_unref(&mCurrentBuffer);
-			if (releaseRet < 0)
-				ULOG_ERRNO("vbuf_unref", -releaseRet);
+	pthread_mutex_lock(&mMutex);
+
+	for (v = mRetiredVideos.begin(); v < mRetiredVideos.end(); v++)
+		delete *v;
+	mRetiredVideos.clear();
+
+	if (mSources.empty()) {
+		redraw = isRedrawNeeded(renderX, renderY,
+			renderWidth, renderHeight);
+		if ((isHeadMoved()) || (forceRedraw))
+			redraw = true;
+		if (!redraw) {
+			flushReadback();
+			pthread_mutex_unlock(&mMutex);
+			return 0;
+		}
+		if (mGles2Readback) {
+			GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, targetFbo));
+			GLCHK(glViewport(renderX, renderY,
+				renderWidth, renderHeight));
+		}
+		GLCHK(glClear(GL_COLOR_BUFFER_BIT));
+		if (mGles2Readback) {
+			ret = mGles2Readback->endFrame(NULL);
+			if (ret < 0)
+				ULOG_ERRNO("gles2Readback->endFrame", -ret);
 		}
-		mCurrentBuffer = buffer;
-		load = true;
-		dequeueRet = vbuf_queue_pop(mQueue, 0, &buffer);
+		mRedrawNeeded = false;
+		pthread_mutex_unlock(&mMutex);
+		return 1;
 	}
-	if ((dequeueRet < 0) && (dequeueRet != -EAGAIN)) {
-		ULOG_ERRNO("vbuf_queue_pop", -dequeueRet);
+
+	/* The timestamp is the time of the previous render; the frame
+	 * rendered now is displayed at the next refresh */
+	if ((timestamp > mLastRenderTimestamp) && (mLastRenderTimestamp != 0))
+		interval = timestamp - mLastRenderTimestamp;
+	FrameScheduler::updateDisplayPeriod(timestamp,
+		&mLastRenderTimestamp, &mDisplayPeriod);
+	if ((mLastRenderDrawn) && (!mTimerQuery) && (interval > 0))
+		countMissedRefreshes(interval);
+	mLastRenderDrawn = false;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	curTime = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+	vsync = curTime + mDisplayPeriod;
+
+	/* Drain every queue even when the source is not displayed so
+	 * that the decoders are never blocked by the renderer */
+	for (s = mSources.begin(); s < mSources.end(); s++) {
+		if (dequeueFrames(*s, curTime, vsync))
+			load = true;
+		if ((*s)->currentBuffer != NULL)
+			hasFrame = true;
 	}
 
-	if (mCurrentBuffer == NULL)
+	if (!hasFrame) {
+		flushReadback();
+		pthread_mutex_unlock(&mMutex);
 		return 0;
+	}
 
-	cdata = vbuf_get_cdata(mCurrentBuffer);
-	struct avcdecoder_output_buffer *data =
-		(struct avcdecoder_output_buffer *)
-		vbuf_metadata_get(mCurrentBuffer, mMedia, NULL, NULL);
-
-	if ((cdata == NULL) || (data == NULL)) {
-		ULOGE("invalid buffer data");
-		return -EPROTO;
+	/* Always evaluate the change sources so that the last
+	 * rendered state stays up to date */
+	redraw = isRedrawNeeded(renderX, renderY, renderWidth, renderHeight);
+	headMoved = isHeadMoved();
+	if ((load) || (forceRedraw))
+		redraw = true;
+	if ((!redraw) && (!headMoved)) {
+		flushReadback();
+		pthread_mutex_unlock(&mMutex);
+		return 0;
 	}
 
-	if (mHmdDistorsionCorrection) {
-		GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, mFbo));
-		GLCHK(glViewport(0, 0, renderWidth / 2, renderHeight));
-		GLCHK(glClear(GL_COLOR_BUFFER_BIT));
-		GLCHK(glDisable(GL_DITHER));
-	} else {
-		GLCHK(glViewport(renderX, renderY,
-			renderWidth, renderHeight));
-		GLCHK(glClear(GL_COLOR_BUFFER_BIT));
-		GLCHK(glDisable(GL_DITHER));
+	reproject = false;
+	if ((!redraw) && (mHmdDistorsionCorrection) && (mEyeBufferValid)) {
+		/* Only the head moved: reproject the last eye buffer as
+		 * long as its field of view covers the new orientation */
+		Eigen::Quaternionf eyeQuat = Eigen::Quaternionf(
+			mEyeBufferHeadQuat.w, mEyeBufferHeadQuat.x,
+			mEyeBufferHeadQuat.y, mEyeBufferHeadQuat.z);
+		Eigen::Quaternionf headQuat = Eigen::Quaternionf(
+			mLastHeadQuat.w, mLastHeadQuat.x,
+			mLastHeadQuat.y, mLastHeadQuat.z);
+		reproject = (headQuat.angularDistance(eyeQuat) <
+			GLES2_RENDERER_REPROJECTION_MAX_ANGLE);
 	}
 
-	if (mGles2Video) {
-		enum gles2_video_color_conversion colorConversion;
-		switch (data->colorFormat) {
-		default:
-		case AVCDECODER_COLOR_FORMAT_YUV420PLANAR:
-			colorConversion =
-				GLES2_VIDEO_COLOR_CONVERSION_YUV420PLANAR_TO_RGB;
-			break;
-		case AVCDECODER_COLOR_FORMAT_YUV420SEMIPLANAR:
-			colorConversion =
-				GLES2_VIDEO_COLOR_CONVERSION_YUV420SEMIPLANAR_TO_RGB;
-			break;
-		case AVCDECODER_COLOR_FORMAT_MMAL_OPAQUE:
-			colorConversion =
-				GLES2_VIDEO_COLOR_CONVERSION_NONE;
-			break;
+	if (reproject) {
+		/* The eye buffer still shows the first source frame; the
+		 * reprojection cost does not depend on the HMD resolution
+		 * and is not measured */
+		source = mSources.front();
+		if (source->currentBuffer != NULL) {
+			data = (struct avcdecoder_output_buffer *)
+				vbuf_metadata_get(source->currentBuffer,
+				source->media, NULL, NULL);
 		}
-
-		ret = (load) ? loadVideoFrame(cdata, data, colorConversion) : 0;
-		if (ret == 0) {
-			ret = mGles2Video->renderFrame(data->stride,
-				data->height, data->cropLeft, data->cropTop,
-				data->cropWidth, data->cropHeight,
-				data->sarWidth, data->sarHeight,
-				(mHmdDistorsionCorrection) ? 0 : renderX,
-				(mHmdDistorsionCorrection) ? 0 : renderY,
-				(mHmdDistorsionCorrection) ? renderWidth / 2 :
-				renderWidth, renderHeight,
-				colorConversion, &data->metadata, mHeadtracking,
-				(mHmdDistorsionCorrection) ? mFbo : 0);
-			if (ret < 0)
-				ULOG_ERRNO("gles2Video->renderFrame", -ret);
+		renderHmd(renderX, renderY, renderWidth, renderHeight);
+	} else {
+		mRedrawNeeded = false;
+
+		/* Only the drawing is measured: the frame dequeuing and
+		 * the readback do not depend on the HMD resolution */
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		startTime = (uint64_t)ts.tv_sec * 1000000 +
+			(uint64_t)ts.tv_nsec / 1000;
+		readTimerQueries();
+		beginTimerQuery();
+
+		renderEyeBuffer(renderX, renderY, renderWidth, renderHeight,
+			fbo, &data);
+
+		if (mHmdDistorsionCorrection)
+			renderHmd(renderX, renderY, renderWidth, renderHeight);
+
+		/* With a GPU timer the HMD resolution follows the measured
+		 * GPU time, otherwise the missed display refreshes */
+		endTimerQuery();
+		if (!mTimerQuery) {
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			endTime = (uint64_t)ts.tv_sec * 1000000 +
+				(uint64_t)ts.tv_nsec / 1000;
+			updateRenderTime((endTime > startTime) ?
+				endTime - startTime : 0);
 		}
 	}
-
-	if (mGles2Hud) {
-		ret = mGles2Hud->renderHud(data->width * data->sarWidth,
-			data->height * data->sarHeight,
-			(mHmdDistorsionCorrection) ? renderWidth / 2 :
-			renderWidth, renderHeight, &data->metadata,
-			mHmdDistorsionCorrection, mHeadtracking);
+	mLastRenderDrawn = true;
+
+	if (mGles2Readback) {
+		struct pdraw_video_frame info;
+		memset(&info, 0, sizeof(info));
+		if (data != NULL) {
+			info.isComplete = (data->isComplete) ? 1 : 0;
+			info.hasErrors = (data->hasErrors) ? 1 : 0;
+			info.isRef = (data->isRef) ? 1 : 0;
+			info.auNtpTimestamp = data->auNtpTimestamp;
+			info.auNtpTimestampRaw = data->auNtpTimestampRaw;
+			info.auNtpTimestampLocal = data->auNtpTimestampLocal;
+			info.hasMetadata = (data->hasMetadata) ? 1 : 0;
+			memcpy(&info.metadata, &data->metadata,
+				sizeof(info.metadata));
+		}
+		ret = mGles2Readback->endFrame(&info);
 		if (ret < 0)
-			ULOG_ERRNO("gles2Hud->renderHud", -ret);
+			ULOG_ERRNO("gles2Readback->endFrame", -ret);
 	}
 
-	if (mHmdDistorsionCorrection) {
-		GLCHK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-		GLCHK(glViewport(renderX, renderY,
-			renderWidth, renderHeight));
-
-		if (mGles2Hmd) {
-			ret = mGles2Hmd->renderHmd(mFboTexture,
-				renderWidth / 2, renderHeight);
-			if (ret < 0)
-				ULOG_ERRNO("gles2Hmd->renderHmd", -ret);
-		}
-	}
+	pthread_mutex_unlock(&mMutex);
 
 #if 0
 	/* TODO: remove debug */
@@ -520,7 +1506,7 @@ int Gles2Renderer::render(
 			((float)(renderTimestamp - timestamp)) : 0.);
 #endif
 
-	return 0;
+	return 1;
 }
 
 } /* namespace Pdraw */
@@ -33,14 +33,88 @@
 #ifdef USE_GLES2
 
 #include <pthread.h>
+#include <vector>
 #include "pdraw_renderer.hpp"
 #include "pdraw_gles2_video.hpp"
-#include "pdraw_gles2_hud.hpp"
+#include "pdraw_hud.hpp"
+#include "pdraw_gles2_hud_batch.hpp"
 #include "pdraw_gles2_hmd.hpp"
+#include "pdraw_gles2_readback.hpp"
+#include "pdraw_frame_scheduler.hpp"
+#if defined(BCM_VIDEOCORE) || defined(ANDROID_NDK)
+#  include <GLES2/gl2ext.h>
+#  include <EGL/egl.h>
+#endif /* BCM_VIDEOCORE || ANDROID_NDK */
+
+/* GPU render time measurement (GL_EXT_disjoint_timer_query), the entry
+ * points are loaded through EGL */
+#if defined(GL_TIME_ELAPSED_EXT) && defined(EGL_VERSION_1_0)
+#  define GLES2_RENDERER_TIMER_QUERY
+#endif
 
 namespace Pdraw {
 
 
+/* Minimum head orientation change to trigger a redraw (rad) */
+#define GLES2_RENDERER_HEADTRACKING_THRESHOLD (0.001f)
+
+/* Maximum head rotation since the eye buffer rendering that is compensated
+ * by reprojection in the HMD pass instead of a full redraw (rad) */
+#define GLES2_RENDERER_REPROJECTION_MAX_ANGLE (0.2f)
+
+/* Render time smoothing factor (1/N of the difference) */
+#define GLES2_RENDERER_RENDER_TIME_SMOOTHING (8)
+
+/* Render time target when the display period is unknown (us) */
+#define GLES2_RENDERER_DEFAULT_FRAME_TIME (16667)
+
+/* Number of rendered frames between HMD resolution scale updates */
+#define GLES2_RENDERER_HMD_RESOLUTION_PERIOD (30)
+
+/* Render time relative to the target above which the HMD resolution
+ * scale is lowered, and below which it is raised */
+#define GLES2_RENDERER_HMD_RESOLUTION_HIGH (0.9f)
+#define GLES2_RENDERER_HMD_RESOLUTION_LOW (0.6f)
+
+/* HMD resolution scale increment when the render time is low */
+#define GLES2_RENDERER_HMD_RESOLUTION_STEP (0.05f)
+
+/* Consecutive HMD resolution update periods without a missed display
+ * refresh before the scale is raised when the GPU time is unknown */
+#define GLES2_RENDERER_HMD_RESOLUTION_RAISE_PERIODS (4)
+
+/* GPU timer queries in flight, read back a few frames later without
+ * stalling the pipeline */
+#define GLES2_RENDERER_TIMER_QUERY_COUNT (4)
+
+/* Picture-in-picture thumbnail size relative to the render area */
+#define GLES2_RENDERER_PIP_SCALE (0.25f)
+
+/* Picture-in-picture thumbnail spacing relative to the render area height */
+#define GLES2_RENDERER_PIP_MARGIN (0.02f)
+
+
+struct gles2_renderer_source {
+	Media *media;
+	struct vbuf_queue *queue;
+	struct vbuf_buffer *currentBuffer;
+	/* Frames waiting for their presentation time */
+	FrameScheduler *scheduler;
+	/* Created on the rendering thread on the first frame */
+	Gles2Video *video;
+	/* The current buffer is not uploaded yet */
+	bool load;
+};
+
+
+struct gles2_renderer_tile {
+	int x;
+	int y;
+	unsigned int width;
+	unsigned int height;
+};
+
+
 class Gles2Renderer : public Renderer {
 public:
 	Gles2Renderer(
@@ -64,12 +138,18 @@ public:
 	int close(
 		void);
 
+	int setOffscreenTarget(
+		enum pdraw_color_format format,
+		pdraw_offscreen_frame_callback_t cb,
+		void *userPtr);
+
 	int render(
 		int renderX,
 		int renderY,
 		unsigned int renderWidth,
 		unsigned int renderHeight,
-		uint64_t timestamp);
+		uint64_t timestamp,
+		bool forceRedraw);
 
 	int addInputSource(
 		Media *media);
@@ -81,6 +161,10 @@ public:
 		Media *media,
 		struct vbuf_queue **queue);
 
+	int getStats(
+		Media *media,
+		struct pdraw_video_renderer_stats *stats);
+
 	Session *getSession(
 		void) {
 		return mSession;
@@ -97,15 +181,96 @@ public:
 	}
 
 protected:
+	struct gles2_renderer_source *getSource(
+		Media *media);
+
+	int releaseBuffer(
+		struct gles2_renderer_source *source,
+		struct vbuf_buffer **buffer);
+
+	bool dequeueFrames(
+		struct gles2_renderer_source *source,
+		uint64_t curTime,
+		uint64_t vsync);
+
+	void getTile(
+		enum pdraw_video_renderer_layout layout,
+		unsigned int index,
+		unsigned int count,
+		const struct gles2_renderer_tile *area,
+		struct gles2_renderer_tile *tile);
+
+	int renderSource(
+		struct gles2_renderer_source *source,
+		const struct gles2_renderer_tile *tile,
+		GLuint fbo,
+		struct avcdecoder_output_buffer **frame);
+
+	bool isRedrawNeeded(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight);
+
+	bool isHeadMoved(
+		void);
+
+	void flushReadback(
+		void);
+
+	void renderEyeBuffer(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		GLuint fbo,
+		struct avcdecoder_output_buffer **data);
+
+	int renderHmd(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight);
+
+	void createTimerQueries(
+		void);
+
+	void destroyTimerQueries(
+		void);
+
+	void beginTimerQuery(
+		void);
+
+	void endTimerQuery(
+		void);
+
+	void readTimerQueries(
+		void);
+
+	void updateRenderTime(
+		uint64_t renderTime);
+
+	void updateHmdResolution(
+		uint64_t renderTime);
+
+	void countMissedRefreshes(
+		uint64_t interval);
+
+	void setHmdResolutionScale(
+		float scale);
+
 	virtual int loadVideoFrame(
+		Gles2Video *video,
 		const uint8_t *data,
 		struct avcdecoder_output_buffer *frame,
 		enum gles2_video_color_conversion colorConversion);
 
 	pthread_mutex_t mMutex;
 	bool mRunning;
-	struct vbuf_queue *mQueue;
-	struct vbuf_buffer *mCurrentBuffer;
+	/* Input medias in rendering order, the first one gets the HUD */
+	std::vector<struct gles2_renderer_source *> mSources;
+	/* Videos of the removed sources, deleted on the rendering thread */
+	std::vector<Gles2Video *> mRetiredVideos;
 	unsigned int mWindowWidth;
 	unsigned int mWindowHeight;
 	bool mHud;
@@ -113,13 +278,54 @@ protected:
 	bool mHeadtracking;
 	Gles2Hmd *mGles2Hmd;
 	unsigned int mGles2HmdFirstTexUnit;
-	Gles2Video *mGles2Video;
+	/* Shared by the source videos, which bind their textures on
+	 * every draw */
 	unsigned int mGles2VideoFirstTexUnit;
-	Gles2Hud *mGles2Hud;
-	unsigned int mGles2HudFirstTexUnit;
+	Hud *mHudOverlay;
+	Gles2HudBatch *mGles2HudBatch;
+	unsigned int mHudFirstTexUnit;
+	Gles2Readback *mGles2Readback;
+	unsigned int mGles2ReadbackFirstTexUnit;
 	GLuint mFbo;
 	GLuint mFboTexture;
 	GLuint mFboRenderBuffer;
+	bool mRedrawNeeded;
+	int mLastRenderX;
+	int mLastRenderY;
+	unsigned int mLastRenderWidth;
+	unsigned int mLastRenderHeight;
+	enum pdraw_video_renderer_layout mLayout;
+	struct vmeta_quaternion mLastHeadQuat;
+	/* Head orientation the HMD eye buffer was rendered with */
+	struct vmeta_quaternion mEyeBufferHeadQuat;
+	bool mEyeBufferValid;
+	unsigned int mLastSelfMetaChangeCount;
+	uint64_t mLastRenderTimestamp;
+	uint64_t mDisplayPeriod;
+	uint64_t mRenderTime;
+	/* The previous render drew the eye buffer; the following
+	 * render timestamp tells whether it missed display refreshes */
+	bool mLastRenderDrawn;
+	/* Dynamic resolution of the HMD eye buffer, which covers the
+	 * bottom-left part of the framebuffer texture */
+	float mHmdResolutionScale;
+	unsigned int mHmdResolutionRenderCount;
+	unsigned int mHmdResolutionMissedCount;
+	unsigned int mHmdResolutionCleanPeriods;
+	bool mTimerQuery;
+#ifdef GLES2_RENDERER_TIMER_QUERY
+	PFNGLGENQUERIESEXTPROC mGlGenQueries;
+	PFNGLDELETEQUERIESEXTPROC mGlDeleteQueries;
+	PFNGLBEGINQUERYEXTPROC mGlBeginQuery;
+	PFNGLENDQUERYEXTPROC mGlEndQuery;
+	PFNGLGETQUERYOBJECTUIVEXTPROC mGlGetQueryObjectuiv;
+	GLuint mTimerQueries[GLES2_RENDERER_TIMER_QUERY_COUNT];
+	unsigned int mTimerQueryHead;
+	unsigned int mTimerQueryCount;
+	bool mTimerQueryActive;
+#endif /* GLES2_RENDERER_TIMER_QUERY */
+	unsigned int mEyeBufferWidth;
+	unsigned int mEyeBufferHeight;
 };
 
 } /* namespace Pdraw */
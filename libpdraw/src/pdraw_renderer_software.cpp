@@ -0,0 +1,750 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Software video renderer
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_renderer_software.hpp"
+#include "pdraw_session.hpp"
+#include "pdraw_media_video.hpp"
+#include "pdraw_colorconv.hpp"
+#include "pdraw_scaler.hpp"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#define ULOG_TAG pdraw_rndvidsw
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_rndvidsw);
+
+namespace Pdraw {
+
+
+static void fillBlack(
+	uint8_t *dst,
+	unsigned int count)
+{
+	static const uint8_t black[4] = { 0, 0, 0, 255 };
+	unsigned int i;
+
+	for (i = 0; i < count; i++, dst += 4)
+		memcpy(dst, black, sizeof(black));
+}
+
+
+SoftwareRenderer::SoftwareRenderer(
+	Session *session)
+{
+	int ret;
+	mRunning = false;
+	mSession = session;
+	mMedia = NULL;
+	mQueue = NULL;
+	mCurrentBuffer = NULL;
+	mWindowWidth = 0;
+	mWindowHeight = 0;
+	mHud = false;
+	mHudOverlay = NULL;
+	mHudCanvas = NULL;
+	mOutput = NULL;
+	mOutputSize = 0;
+	mOutputStride = 0;
+	mOutputFormat = PDRAW_COLOR_FORMAT_UNKNOWN;
+	mRedrawNeeded = true;
+	mLastRenderX = 0;
+	mLastRenderY = 0;
+	mLastRenderWidth = 0;
+	mLastRenderHeight = 0;
+	mLastSelfMetaChangeCount = 0;
+	mRenderOrigin = NULL;
+	mRenderWidth = 0;
+	mRenderHeight = 0;
+	memset(&mSrcFrame, 0, sizeof(mSrcFrame));
+	mCropX = 0;
+	mCropY = 0;
+	mCropWidth = 0;
+	mCropHeight = 0;
+	mRescale = false;
+	mDrawHud = false;
+	mVideoX = 0;
+	mVideoY = 0;
+	mVideoWidth = 0;
+	mVideoHeight = 0;
+	mScaled = NULL;
+	mScaledSize = 0;
+	memset(&mScaledFrame, 0, sizeof(mScaledFrame));
+	mAcc = NULL;
+	mAccSize = 0;
+	mHudAlpha = NULL;
+	mHudAlphaSize = 0;
+	mTaskCount = 0;
+
+	ret = pthread_mutex_init(&mTaskMutex, NULL);
+	if (ret != 0)
+		ULOG_ERRNO("pthread_mutex_init", ret);
+	ret = pthread_cond_init(&mTaskCondition, NULL);
+	if (ret != 0)
+		ULOG_ERRNO("pthread_cond_init", ret);
+
+	mPool = WorkerPool::get();
+	if (mPool == NULL)
+		ULOGW("no worker pool, rendering on the calling thread");
+}
+
+
+SoftwareRenderer::~SoftwareRenderer(
+	void)
+{
+	if (mMedia != NULL) {
+		int ret = removeInputSource(mMedia);
+		if (ret < 0)
+			ULOG_ERRNO("removeInputSource", -ret);
+	}
+
+	close();
+
+	if (mPool != NULL)
+		WorkerPool::put(mPool);
+	free(mScaled);
+	free(mAcc);
+	free(mHudAlpha);
+	pthread_cond_destroy(&mTaskCondition);
+	pthread_mutex_destroy(&mTaskMutex);
+}
+
+
+int SoftwareRenderer::open(
+	unsigned int windowWidth,
+	unsigned int windowHeight,
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	bool hud,
+	bool hmdDistorsionCorrection,
+	bool headtracking,
+	struct egl_display *eglDisplay)
+{
+	if ((windowWidth == 0) || (windowHeight == 0))
+		return -EINVAL;
+	if (hmdDistorsionCorrection) {
+		ULOGE("HMD distortion correction is not supported");
+		return -ENOSYS;
+	}
+	if (headtracking)
+		ULOGW("headtracking is not supported, ignored");
+
+	mWindowWidth = windowWidth;
+	mWindowHeight = windowHeight;
+	mHud = hud;
+
+	if (mHud) {
+		mHudCanvas = new SoftwareHudCanvas();
+		if (mHudCanvas == NULL) {
+			ULOG_ERRNO("failed to create SoftwareHudCanvas",
+				ENOMEM);
+			goto err;
+		}
+		mHudOverlay = new Hud(mSession, (VideoMedia*)mMedia,
+			mHudCanvas, 0);
+		if (mHudOverlay == NULL) {
+			ULOG_ERRNO("failed to create HUD", ENOMEM);
+			goto err;
+		}
+	}
+
+	mRunning = true;
+	mRedrawNeeded = true;
+	return 0;
+
+err:
+	close();
+	return -ENOMEM;
+}
+
+
+int SoftwareRenderer::close(
+	void)
+{
+	mRunning = false;
+
+	if (mHudOverlay != NULL) {
+		delete mHudOverlay;
+		mHudOverlay = NULL;
+	}
+	if (mHudCanvas != NULL) {
+		delete mHudCanvas;
+		mHudCanvas = NULL;
+	}
+
+	return 0;
+}
+
+
+int SoftwareRenderer::setOutputBuffer(
+	uint8_t *data,
+	size_t size,
+	unsigned int stride,
+	enum pdraw_color_format format)
+{
+	if (data == NULL)
+		return -EINVAL;
+	if ((format != PDRAW_COLOR_FORMAT_RGBA) &&
+		(format != PDRAW_COLOR_FORMAT_BGRA)) {
+		ULOGE("unsupported output format");
+		return -ENOSYS;
+	}
+	if (stride == 0)
+		stride = mWindowWidth * 4;
+	if ((stride < mWindowWidth * 4) ||
+		(size < (size_t)stride * (mWindowHeight - 1) +
+		mWindowWidth * 4)) {
+		ULOGE("output buffer too small");
+		return -ENOBUFS;
+	}
+
+	/* The previous content is only valid in the same buffer */
+	if ((data != mOutput) || (stride != mOutputStride) ||
+		(format != mOutputFormat))
+		mRedrawNeeded = true;
+
+	mOutput = data;
+	mOutputSize = size;
+	mOutputStride = stride;
+	mOutputFormat = format;
+
+	return 0;
+}
+
+
+int SoftwareRenderer::addInputSource(
+	Media *media)
+{
+	if (media == NULL)
+		return -EINVAL;
+	if (mMedia != NULL) {
+		ULOGE("multiple input media are not supported");
+		return -ENOSYS;
+	}
+	VideoMedia *vmedia = dynamic_cast<VideoMedia *>(media);
+	if (vmedia == NULL) {
+		ULOGE("media is not a video media");
+		return -EPROTO;
+	}
+
+	mQueue = vbuf_queue_new(0, 0);
+	if (mQueue == NULL) {
+		ULOGE("failed to create queue");
+		return -ENOMEM;
+	}
+
+	mMedia = media;
+	if (mHudOverlay)
+		mHudOverlay->setVideoMedia(vmedia);
+	mRedrawNeeded = true;
+
+	return 0;
+}
+
+
+int SoftwareRenderer::removeInputSource(
+	Media *media)
+{
+	int ret;
+
+	if (media == NULL)
+		return -EINVAL;
+	if (media != mMedia) {
+		ULOGE("invalid media");
+		return -ENOENT;
+	}
+
+	/* Stop the decoder output to this source first so that it drops
+	 * the frames it accounts as held by the source */
+	AvcDecoder *decoder = (AvcDecoder *)media->getDecoder();
+	if ((decoder != NULL) && (mQueue != NULL)) {
+		ret = decoder->removeOutputSink(media, mQueue);
+		if ((ret < 0) && (ret != -ENOENT))
+			ULOG_ERRNO("decoder->removeOutputSink", -ret);
+	}
+
+	if (mCurrentBuffer != NULL) {
+		ret = releaseBuffer(&mCurrentBuffer);
+		if (ret < 0)
+			ULOG_ERRNO("releaseBuffer", -ret);
+	}
+
+	if (mQueue != NULL) {
+		ret = vbuf_queue_destroy(mQueue);
+		if (ret < 0)
+			ULOG_ERRNO("vbuf_queue_destroy", -ret);
+		mQueue = NULL;
+	}
+
+	mMedia = NULL;
+	mRedrawNeeded = true;
+
+	return 0;
+}
+
+
+int SoftwareRenderer::getInputSourceQueue(
+	Media *media,
+	struct vbuf_queue **queue)
+{
+	if (media == NULL)
+		return -EINVAL;
+	if (queue == NULL)
+		return -EINVAL;
+	if (media != mMedia) {
+		ULOGE("invalid media");
+		return -ENOENT;
+	}
+
+	*queue = mQueue;
+
+	return 0;
+}
+
+
+int SoftwareRenderer::releaseBuffer(
+	struct vbuf_buffer **buffer)
+{
+	AvcDecoder *decoder = (mMedia != NULL) ?
+		(AvcDecoder *)mMedia->getDecoder() : NULL;
+
+	/* Let the decoder account for the hold time */
+	if (decoder != NULL)
+		return decoder->releaseOutputBuffer(mQueue, buffer);
+	else
+		return vbuf_unref(buffer);
+}
+
+
+bool SoftwareRenderer::isRedrawNeeded(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight)
+{
+	bool redraw = mRedrawNeeded;
+
+	if ((renderX != mLastRenderX) || (renderY != mLastRenderY) ||
+		(renderWidth != mLastRenderWidth) ||
+		(renderHeight != mLastRenderHeight)) {
+		mLastRenderX = renderX;
+		mLastRenderY = renderY;
+		mLastRenderWidth = renderWidth;
+		mLastRenderHeight = renderHeight;
+		redraw = true;
+	}
+
+	if ((mSession != NULL) && (mHud)) {
+		/* Controller location, battery and orientation are
+		 * displayed by the HUD */
+		unsigned int changeCount =
+			mSession->getSelfMetadata()->getChangeCount();
+		if (changeCount != mLastSelfMetaChangeCount) {
+			mLastSelfMetaChangeCount = changeCount;
+			redraw = true;
+		}
+	}
+
+	return redraw;
+}
+
+
+int SoftwareRenderer::setVideoArea(
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	unsigned int sarWidth,
+	unsigned int sarHeight)
+{
+	unsigned int width, height;
+	size_t size;
+
+	/* Keep the video aspect ratio, same as Gles2Video */
+	float windowAR = (float)mRenderWidth / (float)mRenderHeight;
+	float sar = (float)sarWidth / (float)sarHeight;
+	float videoAR = (float)cropWidth / (float)cropHeight * sar;
+	float ratioW = 1.;
+	float ratioH = 1.;
+	if (videoAR >= windowAR)
+		ratioH = windowAR / videoAR;
+	else
+		ratioW = videoAR / windowAR;
+
+	/* Even sizes for the chroma planes of the scaled frame */
+	width = (unsigned int)(mRenderWidth * ratioW + 0.5) & ~1U;
+	height = (unsigned int)(mRenderHeight * ratioH + 0.5) & ~1U;
+	if (width < 2)
+		width = 2;
+	if (height < 2)
+		height = 2;
+	if (width > (mRenderWidth & ~1U))
+		width = mRenderWidth & ~1U;
+	if (height > (mRenderHeight & ~1U))
+		height = mRenderHeight & ~1U;
+	if ((width == 0) || (height == 0))
+		return -ERANGE;
+
+	mVideoX = (mRenderWidth - width) / 2;
+	mVideoY = (mRenderHeight - height) / 2;
+	if ((width == mVideoWidth) && (height == mVideoHeight))
+		return 0;
+
+	size = (size_t)width * height + 2 * (size_t)(width / 2) * (height / 2);
+	if (size > mScaledSize) {
+		uint8_t *scaled = (uint8_t *)realloc(mScaled, size);
+		if (scaled == NULL) {
+			mVideoWidth = 0;
+			mVideoHeight = 0;
+			return -ENOMEM;
+		}
+		mScaled = scaled;
+		mScaledSize = size;
+	}
+
+	mVideoWidth = width;
+	mVideoHeight = height;
+	memset(&mScaledFrame, 0, sizeof(mScaledFrame));
+	mScaledFrame.colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
+	mScaledFrame.plane[0] = mScaled;
+	mScaledFrame.plane[1] = mScaled + (size_t)width * height;
+	mScaledFrame.plane[2] = mScaledFrame.plane[1] +
+		(size_t)(width / 2) * (height / 2);
+	mScaledFrame.stride[0] = width;
+	mScaledFrame.stride[1] = width / 2;
+	mScaledFrame.stride[2] = width / 2;
+	mScaledFrame.width = width;
+	mScaledFrame.height = height;
+	mRescale = true;
+
+	return 0;
+}
+
+
+void SoftwareRenderer::renderBand(
+	struct software_renderer_band *band)
+{
+	unsigned int y, vy0 = 0, vy1 = 0;
+	uint8_t *line;
+	int ret;
+
+	/* Rows of the scaled frame within the band */
+	if (mVideoWidth > 0) {
+		vy0 = (band->yStart > mVideoY) ? band->yStart - mVideoY : 0;
+		vy1 = (band->yEnd > mVideoY) ? band->yEnd - mVideoY : 0;
+		if (vy1 > mVideoHeight)
+			vy1 = mVideoHeight;
+		if (vy0 > vy1)
+			vy0 = vy1;
+	}
+
+	if ((vy1 > vy0) && (mRescale)) {
+		ret = pdraw_scaleFrameRows(&mSrcFrame, mCropX, mCropY,
+			mCropWidth, mCropHeight,
+			((mCropWidth >= mVideoWidth) &&
+			(mCropHeight >= mVideoHeight)) ?
+			PDRAW_SCALING_METHOD_BOX :
+			PDRAW_SCALING_METHOD_BILINEAR,
+			&mScaledFrame, vy0, vy1 - vy0, band->acc);
+		if (ret < 0)
+			ULOG_ERRNO("pdraw_scaleFrameRows", -ret);
+	}
+
+	for (y = band->yStart; y < band->yEnd; y++) {
+		line = mRenderOrigin + (size_t)y * mOutputStride;
+		if ((y < mVideoY + vy0) || (y >= mVideoY + vy1)) {
+			fillBlack(line, mRenderWidth);
+			continue;
+		}
+		fillBlack(line, mVideoX);
+		fillBlack(line + 4 * (mVideoX + mVideoWidth),
+			mRenderWidth - mVideoX - mVideoWidth);
+	}
+
+	if (vy1 > vy0) {
+		ret = pdraw_colorConvRows(&mScaledFrame, vy0, vy1 - vy0,
+			mOutputFormat, mRenderOrigin +
+			(size_t)(mVideoY + vy0) * mOutputStride + 4 * mVideoX,
+			mOutputStride, pdraw_colorConvGetImpl());
+		if (ret < 0)
+			ULOG_ERRNO("pdraw_colorConvRows", -ret);
+	}
+
+	if (mDrawHud) {
+		mHudCanvas->rasterize(mRenderOrigin, mOutputStride,
+			(mOutputFormat == PDRAW_COLOR_FORMAT_BGRA),
+			band->yStart, band->yEnd, band->hudAlpha);
+	}
+}
+
+
+void SoftwareRenderer::bandTask(
+	void *userdata)
+{
+	struct software_renderer_band *band =
+		(struct software_renderer_band *)userdata;
+	SoftwareRenderer *renderer = band->renderer;
+
+	renderer->renderBand(band);
+
+	pthread_mutex_lock(&renderer->mTaskMutex);
+	renderer->mTaskCount--;
+	if (renderer->mTaskCount == 0)
+		pthread_cond_broadcast(&renderer->mTaskCondition);
+	pthread_mutex_unlock(&renderer->mTaskMutex);
+}
+
+
+void SoftwareRenderer::renderBands(
+	void)
+{
+	struct software_renderer_band band;
+	unsigned int y, next, i;
+	size_t accSize, hudAlphaSize;
+	int ret;
+
+	/* Band boundaries are aligned on the video area so that the
+	 * scaled rows of each band start on an even row */
+	mBands.clear();
+	band.renderer = this;
+	band.acc = NULL;
+	band.hudAlpha = NULL;
+	for (y = 0; y < mRenderHeight; y = next) {
+		next = y + SOFTWARE_RENDERER_BAND_HEIGHT;
+		if ((y < mVideoY) && (next > mVideoY))
+			next = mVideoY;
+		if (next > mRenderHeight)
+			next = mRenderHeight;
+		band.yStart = y;
+		band.yEnd = next;
+		mBands.push_back(band);
+	}
+
+	accSize = mBands.size() * (mCropWidth + 1) * sizeof(uint16_t);
+	if ((mRescale) && (accSize > mAccSize)) {
+		uint16_t *acc = (uint16_t *)realloc(mAcc, accSize);
+		if (acc == NULL) {
+			ULOG_ERRNO("realloc", ENOMEM);
+			mRescale = false;
+		} else {
+			mAcc = acc;
+			mAccSize = accSize;
+		}
+	}
+	for (i = 0; i < mBands.size(); i++) {
+		if (mRescale)
+			mBands[i].acc = mAcc + i * (mCropWidth + 1);
+	}
+
+	/* The HUD scratch rows are kept across frames */
+	hudAlphaSize = mBands.size() * mRenderWidth;
+	if ((mDrawHud) && (hudAlphaSize > mHudAlphaSize)) {
+		uint8_t *hudAlpha = (uint8_t *)realloc(mHudAlpha,
+			hudAlphaSize);
+		if (hudAlpha == NULL) {
+			ULOG_ERRNO("realloc", ENOMEM);
+		} else {
+			mHudAlpha = hudAlpha;
+			mHudAlphaSize = hudAlphaSize;
+		}
+	}
+	for (i = 0; i < mBands.size(); i++) {
+		if ((mDrawHud) && (hudAlphaSize <= mHudAlphaSize))
+			mBands[i].hudAlpha = mHudAlpha + i * mRenderWidth;
+	}
+
+	if ((mPool == NULL) || (mBands.size() < 2) ||
+		(mRenderWidth * mRenderHeight <
+		SOFTWARE_RENDERER_PARALLEL_MIN_PIXELS)) {
+		for (i = 0; i < mBands.size(); i++)
+			renderBand(&mBands[i]);
+		return;
+	}
+
+	pthread_mutex_lock(&mTaskMutex);
+	mTaskCount = mBands.size();
+	pthread_mutex_unlock(&mTaskMutex);
+
+	for (i = 0; i < mBands.size(); i++) {
+		ret = mPool->submit(&bandTask, (void *)&mBands[i]);
+		if (ret < 0) {
+			ULOG_ERRNO("workerPool->submit", -ret);
+			bandTask((void *)&mBands[i]);
+		}
+	}
+
+	pthread_mutex_lock(&mTaskMutex);
+	while (mTaskCount > 0)
+		pthread_cond_wait(&mTaskCondition, &mTaskMutex);
+	pthread_mutex_unlock(&mTaskMutex);
+}
+
+
+int SoftwareRenderer::render(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	uint64_t timestamp,
+	bool forceRedraw)
+{
+	int ret = 0;
+	struct vbuf_buffer *buffer = NULL;
+	const uint8_t *cdata;
+	int dequeueRet = 0, releaseRet;
+	bool load = false;
+
+	if (!mRunning)
+		return 0;
+	if (mOutput == NULL) {
+		ULOGE("no output buffer");
+		return -EPROTO;
+	}
+
+	/* The render area origin is the top-left corner of the buffer */
+	if ((renderX < 0) || (renderY < 0))
+		return -EINVAL;
+	if (renderWidth == 0)
+		renderWidth = mWindowWidth - renderX;
+	if (renderHeight == 0)
+		renderHeight = mWindowHeight - renderY;
+	if ((renderWidth == 0) || (renderHeight == 0))
+		return 0;
+	if ((renderX + renderWidth > mWindowWidth) ||
+		(renderY + renderHeight > mWindowHeight))
+		return -ERANGE;
+
+	mRenderOrigin = mOutput + (size_t)renderY * mOutputStride +
+		4 * renderX;
+	mRenderWidth = renderWidth;
+	mRenderHeight = renderHeight;
+	mDrawHud = false;
+
+	if (mQueue != NULL) {
+		dequeueRet = vbuf_queue_pop(mQueue, 0, &buffer);
+		while ((dequeueRet == 0) && (buffer != NULL)) {
+			if (mCurrentBuffer != NULL) {
+				releaseRet = releaseBuffer(&mCurrentBuffer);
+				if (releaseRet < 0) {
+					ULOG_ERRNO("releaseBuffer",
+						-releaseRet);
+				}
+			}
+			mCurrentBuffer = buffer;
+			load = true;
+			dequeueRet = vbuf_queue_pop(mQueue, 0, &buffer);
+		}
+		if ((dequeueRet < 0) && (dequeueRet != -EAGAIN))
+			ULOG_ERRNO("vbuf_queue_pop", -dequeueRet);
+		if (mCurrentBuffer == NULL)
+			return 0;
+	}
+
+	/* Always evaluate the change sources so that the last
+	 * rendered state stays up to date */
+	if ((!isRedrawNeeded(renderX, renderY,
+		renderWidth, renderHeight)) && (!load) && (!forceRedraw))
+		return 0;
+	mRedrawNeeded = false;
+
+	if (mCurrentBuffer == NULL) {
+		/* No video media: clear the render area */
+		mVideoWidth = 0;
+		mVideoHeight = 0;
+		mRescale = false;
+		renderBands();
+		return 1;
+	}
+
+	cdata = vbuf_get_cdata(mCurrentBuffer);
+	struct avcdecoder_output_buffer *data =
+		(struct avcdecoder_output_buffer *)
+		vbuf_metadata_get(mCurrentBuffer, mMedia, NULL, NULL);
+	if ((cdata == NULL) || (data == NULL)) {
+		ULOGE("invalid buffer data");
+		return -EPROTO;
+	}
+
+	memset(&mSrcFrame, 0, sizeof(mSrcFrame));
+	switch (data->colorFormat) {
+	case AVCDECODER_COLOR_FORMAT_YUV420PLANAR:
+		mSrcFrame.colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
+		break;
+	case AVCDECODER_COLOR_FORMAT_YUV420SEMIPLANAR:
+		mSrcFrame.colorFormat = PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR;
+		break;
+	default:
+		ULOGE("unsupported color format");
+		return -ENOSYS;
+	}
+	mSrcFrame.plane[0] = cdata + data->plane_offset[0];
+	mSrcFrame.plane[1] = cdata + data->plane_offset[1];
+	mSrcFrame.plane[2] = cdata + data->plane_offset[2];
+	mSrcFrame.stride[0] = data->stride[0];
+	mSrcFrame.stride[1] = data->stride[1];
+	mSrcFrame.stride[2] = data->stride[2];
+	mSrcFrame.width = data->width;
+	mSrcFrame.height = data->height;
+	mCropX = data->cropLeft;
+	mCropY = data->cropTop;
+	mCropWidth = data->cropWidth;
+	mCropHeight = data->cropHeight;
+	if ((mCropWidth == 0) || (mCropHeight == 0) ||
+		(data->sarWidth == 0) || (data->sarHeight == 0)) {
+		ULOGE("invalid frame dimensions");
+		return -EPROTO;
+	}
+
+	mRescale = load;
+	ret = setVideoArea(mCropWidth, mCropHeight,
+		data->sarWidth, data->sarHeight);
+	if (ret < 0) {
+		ULOG_ERRNO("setVideoArea", -ret);
+		mVideoWidth = 0;
+		mVideoHeight = 0;
+		mRescale = false;
+	}
+
+	if (mHudOverlay) {
+		mHudCanvas->setViewport(renderWidth, renderHeight);
+		ret = mHudOverlay->renderHud(data->width * data->sarWidth,
+			data->height * data->sarHeight,
+			renderWidth, renderHeight, &data->metadata,
+			false, false, NULL);
+		if (ret < 0)
+			ULOG_ERRNO("hud->renderHud", -ret);
+		mDrawHud = (ret == 0);
+	}
+
+	renderBands();
+
+	return 1;
+}
+
+} /* namespace Pdraw */
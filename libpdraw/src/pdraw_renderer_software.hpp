@@ -0,0 +1,211 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Software video renderer
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_RENDERER_SOFTWARE_HPP_
+#define _PDRAW_RENDERER_SOFTWARE_HPP_
+
+#include <pthread.h>
+#include <vector>
+#include "pdraw_renderer.hpp"
+#include "pdraw_hud.hpp"
+#include "pdraw_hud_canvas_software.hpp"
+#include "pdraw_worker_pool.hpp"
+
+namespace Pdraw {
+
+
+/* Height of the row bands rendered by a task (even) */
+#define SOFTWARE_RENDERER_BAND_HEIGHT (64)
+
+/* Smaller outputs are rendered on the calling thread */
+#define SOFTWARE_RENDERER_PARALLEL_MIN_PIXELS (640 * 360)
+
+
+class SoftwareRenderer;
+
+
+struct software_renderer_band {
+	SoftwareRenderer *renderer;
+	/* Output rows [yStart, yEnd) of the render area */
+	unsigned int yStart;
+	unsigned int yEnd;
+	uint16_t *acc;
+	/* HUD scratch row of the render width */
+	uint8_t *hudAlpha;
+};
+
+
+/**
+ * Renders the video and the HUD into a caller-provided packed RGBA or
+ * BGRA buffer without any GPU: the decoded frame is scaled to the
+ * letterboxed video area, converted to RGB and the HUD is blended on
+ * top, band by band on the worker pool for large outputs. HMD
+ * distortion correction and headtracking are not supported.
+ */
+class SoftwareRenderer : public Renderer {
+public:
+	SoftwareRenderer(
+		Session *session);
+
+	~SoftwareRenderer(
+		void);
+
+	int open(
+		unsigned int windowWidth,
+		unsigned int windowHeight,
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		bool hud,
+		bool hmdDistorsionCorrection,
+		bool headtracking,
+		struct egl_display *eglDisplay);
+
+	int close(
+		void);
+
+	int setOutputBuffer(
+		uint8_t *data,
+		size_t size,
+		unsigned int stride,
+		enum pdraw_color_format format);
+
+	int render(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		uint64_t timestamp,
+		bool forceRedraw);
+
+	int addInputSource(
+		Media *media);
+
+	int removeInputSource(
+		Media *media);
+
+	int getInputSourceQueue(
+		Media *media,
+		struct vbuf_queue **queue);
+
+	Session *getSession(
+		void) {
+		return mSession;
+	}
+
+	Media *getMedia(
+		void) {
+		return mMedia;
+	}
+
+	VideoMedia *getVideoMedia(
+		void) {
+		return (VideoMedia *)mMedia;
+	}
+
+private:
+	int releaseBuffer(
+		struct vbuf_buffer **buffer);
+
+	bool isRedrawNeeded(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight);
+
+	int setVideoArea(
+		unsigned int cropWidth,
+		unsigned int cropHeight,
+		unsigned int sarWidth,
+		unsigned int sarHeight);
+
+	void renderBand(
+		struct software_renderer_band *band);
+
+	void renderBands(
+		void);
+
+	static void bandTask(
+		void *userdata);
+
+	bool mRunning;
+	struct vbuf_queue *mQueue;
+	struct vbuf_buffer *mCurrentBuffer;
+	unsigned int mWindowWidth;
+	unsigned int mWindowHeight;
+	bool mHud;
+	Hud *mHudOverlay;
+	SoftwareHudCanvas *mHudCanvas;
+	uint8_t *mOutput;
+	size_t mOutputSize;
+	unsigned int mOutputStride;
+	enum pdraw_color_format mOutputFormat;
+	bool mRedrawNeeded;
+	int mLastRenderX;
+	int mLastRenderY;
+	unsigned int mLastRenderWidth;
+	unsigned int mLastRenderHeight;
+	unsigned int mLastSelfMetaChangeCount;
+
+	/* State of the frame being rendered, read by the band tasks */
+	uint8_t *mRenderOrigin;
+	unsigned int mRenderWidth;
+	unsigned int mRenderHeight;
+	struct pdraw_video_frame mSrcFrame;
+	unsigned int mCropX;
+	unsigned int mCropY;
+	unsigned int mCropWidth;
+	unsigned int mCropHeight;
+	bool mRescale;
+	bool mDrawHud;
+
+	/* Letterboxed video area and the frame scaled to its size */
+	unsigned int mVideoX;
+	unsigned int mVideoY;
+	unsigned int mVideoWidth;
+	unsigned int mVideoHeight;
+	uint8_t *mScaled;
+	size_t mScaledSize;
+	struct pdraw_video_frame mScaledFrame;
+	uint16_t *mAcc;
+	size_t mAccSize;
+	uint8_t *mHudAlpha;
+	size_t mHudAlphaSize;
+
+	WorkerPool *mPool;
+	std::vector<struct software_renderer_band> mBands;
+	pthread_mutex_t mTaskMutex;
+	pthread_cond_t mTaskCondition;
+	unsigned int mTaskCount;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_RENDERER_SOFTWARE_HPP_ */
@@ -84,12 +84,13 @@ int VideoCoreEglRenderer::open(
 
 
 int VideoCoreEglRenderer::loadVideoFrame(
+	Gles2Video *video,
 	const uint8_t *data,
 	struct avcdecoder_output_buffer *frame,
 	enum gles2_video_color_conversion colorConversion)
 {
 	int ret;
-	ret = mGles2Video->loadFrame(data, frame->plane_offset, frame->stride,
+	ret = video->loadFrame(data, frame->plane_offset, frame->stride,
 		frame->width, frame->height, colorConversion,
 		(struct egl_display *)mDisplay);
 	if (ret < 0)
@@ -35,7 +35,7 @@
 #include <EGL/egl.h>
 #include "pdraw_renderer_gles2.hpp"
 #include "pdraw_gles2_video.hpp"
-#include "pdraw_gles2_hud.hpp"
+#include "pdraw_hud.hpp"
 #include "pdraw_gles2_hmd.hpp"
 
 namespace Pdraw {
@@ -63,6 +63,7 @@ public:
 
 private:
 	int loadVideoFrame(
+		Gles2Video *video,
 		const uint8_t *data,
 		struct avcdecoder_output_buffer *frame,
 		enum gles2_video_color_conversion colorConversion);
@@ -0,0 +1,409 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame scaling
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_scaler.hpp"
+#include <errno.h>
+#include <string.h>
+#if defined(__SSE2__)
+#  define PDRAW_SCALER_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PDRAW_SCALER_NEON
+#  include <arm_neon.h>
+#endif
+
+
+/* acc[i] (+)= src[i] */
+static void accumulateRow(
+	uint16_t *acc,
+	const uint8_t *src,
+	unsigned int count,
+	bool first)
+{
+	unsigned int i = 0;
+
+#if defined(PDRAW_SCALER_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_unpacklo_epi8(s, zero);
+		__m128i hi = _mm_unpackhi_epi8(s, zero);
+		if (!first) {
+			const __m128i *a = (const __m128i *)(acc + i);
+			lo = _mm_add_epi16(lo, _mm_loadu_si128(a));
+			hi = _mm_add_epi16(hi, _mm_loadu_si128(a + 1));
+		}
+		_mm_storeu_si128((__m128i *)(acc + i), lo);
+		_mm_storeu_si128((__m128i *)(acc + i + 8), hi);
+	}
+#elif defined(PDRAW_SCALER_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(s));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(s));
+		if (!first) {
+			lo = vaddq_u16(lo, vld1q_u16(acc + i));
+			hi = vaddq_u16(hi, vld1q_u16(acc + i + 8));
+		}
+		vst1q_u16(acc + i, lo);
+		vst1q_u16(acc + i + 8, hi);
+	}
+#endif
+	if (first) {
+		for (; i < count; i++)
+			acc[i] = src[i];
+	} else {
+		for (; i < count; i++)
+			acc[i] += src[i];
+	}
+}
+
+
+/* acc[i] = src0[i] * (256 - weight) + src1[i] * weight */
+static void blendRows(
+	uint16_t *acc,
+	const uint8_t *src0,
+	const uint8_t *src1,
+	unsigned int count,
+	unsigned int weight)
+{
+	unsigned int i = 0;
+
+#if defined(PDRAW_SCALER_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w0 = _mm_set1_epi16(256 - weight);
+	const __m128i w1 = _mm_set1_epi16(weight);
+	for (; i + 16 <= count; i += 16) {
+		__m128i s0 = _mm_loadu_si128((const __m128i *)(src0 + i));
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(src1 + i));
+		_mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(s0, zero), w0),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(s1, zero), w1)));
+		_mm_storeu_si128((__m128i *)(acc + i + 8), _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(s0, zero), w0),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(s1, zero), w1)));
+	}
+#elif defined(PDRAW_SCALER_NEON)
+	const uint8x8_t w0 = vdup_n_u8(256 - weight);
+	const uint8x8_t w1 = vdup_n_u8(weight);
+	if (weight == 0) {
+		for (; i + 8 <= count; i += 8)
+			vst1q_u16(acc + i, vshll_n_u8(vld1_u8(src0 + i), 8));
+	} else {
+		for (; i + 8 <= count; i += 8) {
+			vst1q_u16(acc + i, vmlal_u8(
+				vmull_u8(vld1_u8(src0 + i), w0),
+				vld1_u8(src1 + i), w1));
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		acc[i] = src0[i] * (256 - weight) + src1[i] * weight;
+	}
+}
+
+
+/* Scale the destination rows [yStart, yEnd) of a plane */
+static void scalePlaneBox(
+	const uint8_t *src,
+	unsigned int srcStride,
+	unsigned int srcStep,
+	unsigned int srcWidth,
+	unsigned int srcHeight,
+	uint8_t *dst,
+	unsigned int dstStride,
+	unsigned int dstWidth,
+	unsigned int dstHeight,
+	unsigned int yStart,
+	unsigned int yEnd,
+	uint16_t *acc)
+{
+	/* Do not read past the last sample of interleaved planes */
+	unsigned int count = (srcWidth - 1) * srcStep + 1;
+	unsigned int x, y, i;
+
+	dst += (size_t)yStart * dstStride;
+	for (y = yStart; y < yEnd; y++) {
+		unsigned int y0 = y * srcHeight / dstHeight;
+		unsigned int y1 = (y + 1) * srcHeight / dstHeight;
+		if (y1 <= y0)
+			y1 = y0 + 1;
+
+		/* Sum the source rows, interleaved samples included */
+		for (i = y0; i < y1; i++) {
+			accumulateRow(acc, src + (size_t)i * srcStride,
+				count, (i == y0));
+		}
+
+		for (x = 0; x < dstWidth; x++) {
+			unsigned int x0 = x * srcWidth / dstWidth;
+			unsigned int x1 = (x + 1) * srcWidth / dstWidth;
+			unsigned int n, sum = 0;
+			if (x1 <= x0)
+				x1 = x0 + 1;
+			for (i = x0; i < x1; i++)
+				sum += acc[i * srcStep];
+			n = (x1 - x0) * (y1 - y0);
+			dst[x] = (sum + n / 2) / n;
+		}
+		dst += dstStride;
+	}
+}
+
+
+/* Source position of a destination sample in 8-bit fixed point,
+ * pixel centers aligned */
+static inline unsigned int bilinearPos(
+	unsigned int d,
+	unsigned int srcSize,
+	unsigned int dstSize)
+{
+	uint64_t pos = ((uint64_t)(2 * d + 1) * srcSize * 256) /
+		(2 * dstSize);
+	return (pos > 128) ? (unsigned int)pos - 128 : 0;
+}
+
+
+static void scalePlaneBilinear(
+	const uint8_t *src,
+	unsigned int srcStride,
+	unsigned int srcStep,
+	unsigned int srcWidth,
+	unsigned int srcHeight,
+	uint8_t *dst,
+	unsigned int dstStride,
+	unsigned int dstWidth,
+	unsigned int dstHeight,
+	unsigned int yStart,
+	unsigned int yEnd,
+	uint16_t *acc)
+{
+	unsigned int count = (srcWidth - 1) * srcStep + 1;
+	unsigned int x, y;
+
+	dst += (size_t)yStart * dstStride;
+	for (y = yStart; y < yEnd; y++) {
+		unsigned int fy = bilinearPos(y, srcHeight, dstHeight);
+		unsigned int y0 = fy >> 8;
+		unsigned int y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+
+		blendRows(acc, src + (size_t)y0 * srcStride,
+			src + (size_t)y1 * srcStride, count, fy & 0xff);
+
+		for (x = 0; x < dstWidth; x++) {
+			unsigned int fx = bilinearPos(x, srcWidth, dstWidth);
+			unsigned int x0 = fx >> 8;
+			unsigned int x1 = (x0 + 1 < srcWidth) ? x0 + 1 : x0;
+			unsigned int wx = fx & 0xff;
+			dst[x] = ((uint32_t)acc[x0 * srcStep] * (256 - wx) +
+				(uint32_t)acc[x1 * srcStep] * wx + 32768) >> 16;
+		}
+		dst += dstStride;
+	}
+}
+
+
+size_t pdraw_scalerGetBufferSize(
+	unsigned int srcWidth,
+	unsigned int dstWidth,
+	unsigned int dstHeight)
+{
+	size_t size = (size_t)dstWidth * dstHeight +
+		2 * (size_t)((dstWidth + 1) / 2) * ((dstHeight + 1) / 2);
+
+	/* Align the accumulator */
+	size = (size + 15) & ~(size_t)15;
+	return size + (size_t)(srcWidth + 1) * sizeof(uint16_t);
+}
+
+
+/* Scale the luma rows [yStart, yEnd) and the matching chroma rows */
+static int scaleRows(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int cropX,
+	unsigned int cropY,
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	enum pdraw_scaling_method method,
+	unsigned int dstWidth,
+	unsigned int dstHeight,
+	uint8_t *const dstPlane[3],
+	const unsigned int dstStride[3],
+	unsigned int yStart,
+	unsigned int yEnd,
+	uint16_t *acc)
+{
+	unsigned int i, srcStep;
+	const uint8_t *srcPlane[3];
+	unsigned int srcStride[3];
+
+	if ((srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR) &&
+		(srcFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR))
+		return -ENOSYS;
+	if ((method != PDRAW_SCALING_METHOD_BOX) &&
+		(method != PDRAW_SCALING_METHOD_BILINEAR))
+		return -EINVAL;
+
+	cropX &= ~1;
+	cropY &= ~1;
+	if ((cropWidth < 2) || (cropHeight < 2) ||
+		(cropX + cropWidth > srcFrame->width) ||
+		(cropY + cropHeight > srcFrame->height))
+		return -ERANGE;
+	if ((dstWidth == 0) || (dstHeight == 0) ||
+		(cropWidth > dstWidth * PDRAW_SCALER_MAX_RATIO) ||
+		(cropHeight > dstHeight * PDRAW_SCALER_MAX_RATIO))
+		return -ERANGE;
+
+	srcStep = (srcFrame->colorFormat ==
+		PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR) ? 2 : 1;
+	srcStride[0] = srcFrame->stride[0];
+	srcStride[1] = srcFrame->stride[1];
+	srcStride[2] = (srcStep == 2) ?
+		srcFrame->stride[1] : srcFrame->stride[2];
+	srcPlane[0] = srcFrame->plane[0] + (size_t)cropY * srcStride[0] +
+		cropX;
+	srcPlane[1] = srcFrame->plane[1] + (size_t)(cropY / 2) * srcStride[1] +
+		(cropX / 2) * srcStep;
+	srcPlane[2] = (srcStep == 2) ? srcPlane[1] + 1 :
+		srcFrame->plane[2] + (size_t)(cropY / 2) * srcStride[2] +
+		cropX / 2;
+
+	for (i = 0; i < 3; i++) {
+		unsigned int step = (i == 0) ? 1 : srcStep;
+		unsigned int sw = (i == 0) ? cropWidth : (cropWidth + 1) / 2;
+		unsigned int sh = (i == 0) ? cropHeight : (cropHeight + 1) / 2;
+		unsigned int dw = (i == 0) ? dstWidth : (dstWidth + 1) / 2;
+		unsigned int dh = (i == 0) ? dstHeight : (dstHeight + 1) / 2;
+		unsigned int y0 = (i == 0) ? yStart : yStart / 2;
+		unsigned int y1 = (i == 0) ? yEnd : (yEnd + 1) / 2;
+		if (method == PDRAW_SCALING_METHOD_BOX) {
+			scalePlaneBox(srcPlane[i], srcStride[i], step, sw, sh,
+				dstPlane[i], dstStride[i], dw, dh,
+				y0, y1, acc);
+		} else {
+			scalePlaneBilinear(srcPlane[i], srcStride[i], step,
+				sw, sh, dstPlane[i], dstStride[i], dw, dh,
+				y0, y1, acc);
+		}
+	}
+
+	return 0;
+}
+
+
+int pdraw_scaleFrame(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int cropX,
+	unsigned int cropY,
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	enum pdraw_scaling_method method,
+	unsigned int dstWidth,
+	unsigned int dstHeight,
+	uint8_t *dst,
+	size_t dstSize,
+	struct pdraw_video_frame *dstFrame)
+{
+	unsigned int i, dstChromaWidth, dstChromaHeight;
+	size_t offset;
+	uint16_t *acc;
+	uint8_t *dstPlane[3];
+	unsigned int dstStride[3];
+	int ret;
+
+	if ((srcFrame == NULL) || (dst == NULL) || (dstFrame == NULL))
+		return -EINVAL;
+	if (dstSize < pdraw_scalerGetBufferSize(cropWidth, dstWidth, dstHeight))
+		return -ENOBUFS;
+
+	dstChromaWidth = (dstWidth + 1) / 2;
+	dstChromaHeight = (dstHeight + 1) / 2;
+	dstPlane[0] = dst;
+	dstPlane[1] = dstPlane[0] + (size_t)dstWidth * dstHeight;
+	dstPlane[2] = dstPlane[1] + (size_t)dstChromaWidth * dstChromaHeight;
+	dstStride[0] = dstWidth;
+	dstStride[1] = dstChromaWidth;
+	dstStride[2] = dstChromaWidth;
+	offset = (size_t)(dstPlane[2] - dst) +
+		(size_t)dstChromaWidth * dstChromaHeight;
+	offset = (offset + 15) & ~(size_t)15;
+	acc = (uint16_t *)(dst + offset);
+
+	ret = scaleRows(srcFrame, cropX, cropY, cropWidth, cropHeight, method,
+		dstWidth, dstHeight, dstPlane, dstStride, 0, dstHeight, acc);
+	if (ret < 0)
+		return ret;
+
+	if (dstFrame != srcFrame)
+		memcpy(dstFrame, srcFrame, sizeof(*dstFrame));
+	dstFrame->colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
+	dstFrame->width = dstWidth;
+	dstFrame->height = dstHeight;
+	for (i = 0; i < 3; i++) {
+		dstFrame->plane[i] = dstPlane[i];
+		dstFrame->stride[i] = dstStride[i];
+	}
+
+	return 0;
+}
+
+
+int pdraw_scaleFrameRows(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int cropX,
+	unsigned int cropY,
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	enum pdraw_scaling_method method,
+	const struct pdraw_video_frame *dstFrame,
+	unsigned int dstY,
+	unsigned int dstRows,
+	uint16_t *acc)
+{
+	uint8_t *dstPlane[3];
+	unsigned int dstStride[3];
+	unsigned int i;
+
+	if ((srcFrame == NULL) || (dstFrame == NULL) || (acc == NULL))
+		return -EINVAL;
+	if (dstFrame->colorFormat != PDRAW_COLOR_FORMAT_YUV420PLANAR)
+		return -ENOSYS;
+	if ((dstY & 1) || (dstY + dstRows > dstFrame->height))
+		return -ERANGE;
+
+	for (i = 0; i < 3; i++) {
+		dstPlane[i] = (uint8_t *)dstFrame->plane[i];
+		dstStride[i] = dstFrame->stride[i];
+	}
+
+	return scaleRows(srcFrame, cropX, cropY, cropWidth, cropHeight,
+		method, dstFrame->width, dstFrame->height, dstPlane,
+		dstStride, dstY, dstY + dstRows, acc);
+}
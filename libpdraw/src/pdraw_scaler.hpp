@@ -0,0 +1,90 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame scaling
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_SCALER_HPP_
+#define _PDRAW_SCALER_HPP_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <pdraw/pdraw_defs.h>
+
+
+/* Maximum downscaling ratio on each axis (box sums fit in 16 bits) */
+#define PDRAW_SCALER_MAX_RATIO (128)
+
+
+/**
+ * Size of the buffer needed by pdraw_scaleFrame(): the I420 output
+ * followed by a row accumulator for a crop of srcWidth pixels
+ */
+size_t pdraw_scalerGetBufferSize(
+	unsigned int srcWidth,
+	unsigned int dstWidth,
+	unsigned int dstHeight);
+
+
+/**
+ * Crop and scale a YUV420 planar or semi-planar frame to a tightly
+ * packed I420 frame; the source is read once; crop offsets are
+ * rounded down to even values
+ */
+int pdraw_scaleFrame(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int cropX,
+	unsigned int cropY,
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	enum pdraw_scaling_method method,
+	unsigned int dstWidth,
+	unsigned int dstHeight,
+	uint8_t *dst,
+	size_t dstSize,
+	struct pdraw_video_frame *dstFrame);
+
+
+/**
+ * Scale the rows [dstY, dstY + dstRows) of the output of pdraw_scaleFrame()
+ * into the planes of dstFrame, an I420 frame of the output size; dstY must
+ * be even. acc is a row accumulator of cropWidth + 1 values; bands of even
+ * height can be scaled concurrently with distinct accumulators.
+ */
+int pdraw_scaleFrameRows(
+	const struct pdraw_video_frame *srcFrame,
+	unsigned int cropX,
+	unsigned int cropY,
+	unsigned int cropWidth,
+	unsigned int cropHeight,
+	enum pdraw_scaling_method method,
+	const struct pdraw_video_frame *dstFrame,
+	unsigned int dstY,
+	unsigned int dstRows,
+	uint16_t *acc);
+
+
+#endif /* !_PDRAW_SCALER_HPP_ */
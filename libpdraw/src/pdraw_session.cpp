@@ -33,8 +33,11 @@
 #include "pdraw_demuxer_stream_mux.hpp"
 #include "pdraw_demuxer_record.hpp"
 #include "pdraw_utils.hpp"
+#include "pdraw_frame_export.hpp"
+#include "pdraw_frame_batch.hpp"
 #include <math.h>
 #include <string.h>
+#include <time.h>
 #define ULOG_TAG pdraw_session
 #include <ulog.h>
 ULOG_DECLARE_TAG(pdraw_session);
@@ -179,6 +182,7 @@ Session::Session(
 	int res;
 	pthread_mutexattr_t attr;
 	bool mutex_created = false, attr_created = false;
+	bool warm_pool_mutex_created = false;
 
 	mListener = listener;
 	mState = INVALID;
@@ -190,6 +194,7 @@ Session::Session(
 	mLoop = loop;
 	mThreadShouldStop = false;
 	mLoopThreadLaunched = false;
+	mOpenTime = 0;
 
 	res = pthread_mutexattr_init(&attr);
 	if (res < 0) {
@@ -204,13 +209,20 @@ Session::Session(
 		goto error;
 	}
 
-	res = pthread_mutex_init(&mMutex, NULL);
+	res = pthread_mutex_init(&mMutex, &attr);
 	if (res < 0) {
 		ULOG_ERRNO("pthread_mutex_init", -res);
 		goto error;
 	}
 	mutex_created = true;
 
+	res = pthread_mutex_init(&mWarmPoolMutex, NULL);
+	if (res < 0) {
+		ULOG_ERRNO("pthread_mutex_init", -res);
+		goto error;
+	}
+	warm_pool_mutex_created = true;
+
 	if (mLoop == NULL) {
 		mInternalLoop = true;
 		mLoop = pomp_loop_new();
@@ -270,6 +282,8 @@ error:
 	}
 	if (mutex_created)
 		pthread_mutex_destroy(&mMutex);
+	if (warm_pool_mutex_created)
+		pthread_mutex_destroy(&mWarmPoolMutex);
 	if (attr_created)
 		pthread_mutexattr_destroy(&attr);
 }
@@ -297,6 +311,8 @@ Session::~Session(
 		m++;
 	}
 
+	clearWarmPool();
+
 	if (mInternalLoop) {
 		if (mMbox != NULL) {
 			res = pomp_loop_remove(mLoop, mbox_get_read_fd(mMbox));
@@ -327,6 +343,7 @@ Session::~Session(
 	}
 
 	pthread_mutex_destroy(&mMutex);
+	pthread_mutex_destroy(&mWarmPoolMutex);
 }
 
 
@@ -749,6 +766,66 @@ int Session::startVideoRenderer(
 	bool enableHmdDistorsionCorrection,
 	bool enableHeadtracking,
 	struct egl_display *eglDisplay)
+{
+	return startRenderer(false, windowWidth, windowHeight,
+		renderX, renderY, renderWidth, renderHeight, enableHud,
+		enableHmdDistorsionCorrection, enableHeadtracking, eglDisplay);
+}
+
+
+/* Called on the rendering thread */
+int Session::startSoftwareVideoRenderer(
+	unsigned int width,
+	unsigned int height,
+	bool enableHud)
+{
+	return startRenderer(true, width, height, 0, 0, width, height,
+		enableHud, false, false, NULL);
+}
+
+
+/* Called on the rendering thread */
+int Session::startOffscreenVideoRenderer(
+	unsigned int width,
+	unsigned int height,
+	enum pdraw_color_format format,
+	bool enableHud,
+	pdraw_offscreen_frame_callback_t cb,
+	void *userPtr)
+{
+	int ret;
+
+	if (cb == NULL)
+		return -EINVAL;
+
+	ret = startRenderer(false, width, height, 0, 0, width, height,
+		enableHud, false, false, NULL);
+	if (ret < 0)
+		return ret;
+
+	ret = mRenderer->setOffscreenTarget(format, cb, userPtr);
+	if (ret < 0) {
+		ULOG_ERRNO("renderer->setOffscreenTarget", -ret);
+		stopVideoRenderer();
+	}
+
+	return ret;
+}
+
+
+/* Called on the rendering thread */
+int Session::startRenderer(
+	bool software,
+	unsigned int windowWidth,
+	unsigned int windowHeight,
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	bool enableHud,
+	bool enableHmdDistorsionCorrection,
+	bool enableHeadtracking,
+	struct egl_display *eglDisplay)
 {
 	int ret = 0;
 
@@ -757,7 +834,7 @@ int Session::startVideoRenderer(
 		return -EBUSY;
 	}
 
-	mRenderer = Renderer::create(this);
+	mRenderer = Renderer::create(this, software);
 	if (mRenderer == NULL) {
 		ULOGE("failed to create renderer");
 		return -EPROTO;
@@ -839,9 +916,11 @@ int Session::stopVideoRenderer(
 		pthread_mutex_lock(&mMutex);
 	}
 
-	pthread_mutex_unlock(&mMutex);
-	delete mRenderer;
+	/* The statistics getters use the renderer under the lock */
+	Renderer *renderer = mRenderer;
 	mRenderer = NULL;
+	pthread_mutex_unlock(&mMutex);
+	delete renderer;
 
 	return 0;
 }
@@ -854,10 +933,29 @@ int Session::renderVideo(
 	unsigned int renderWidth,
 	unsigned int renderHeight,
 	uint64_t timestamp)
+{
+	if (mRenderer != NULL) {
+		int ret = mRenderer->render(renderX, renderY,
+			renderWidth, renderHeight, timestamp, true);
+		return (ret < 0) ? ret : 0;
+	} else {
+		ULOGE("invalid renderer");
+		return -EPROTO;
+	}
+}
+
+
+int Session::renderVideoIfNeeded(
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	uint64_t timestamp,
+	bool forceRedraw)
 {
 	if (mRenderer != NULL) {
 		return mRenderer->render(renderX, renderY,
-			renderWidth, renderHeight, timestamp);
+			renderWidth, renderHeight, timestamp, forceRedraw);
 	} else {
 		ULOGE("invalid renderer");
 		return -EPROTO;
@@ -865,6 +963,32 @@ int Session::renderVideo(
 }
 
 
+/* Called on the rendering thread */
+int Session::renderVideoToBuffer(
+	uint8_t *buffer,
+	size_t size,
+	unsigned int stride,
+	enum pdraw_color_format format,
+	uint64_t timestamp,
+	bool forceRedraw)
+{
+	int ret;
+
+	if (mRenderer == NULL) {
+		ULOGE("invalid renderer");
+		return -EPROTO;
+	}
+
+	ret = mRenderer->setOutputBuffer(buffer, size, stride, format);
+	if (ret < 0) {
+		ULOG_ERRNO("renderer->setOutputBuffer", -ret);
+		return ret;
+	}
+
+	return mRenderer->render(0, 0, 0, 0, timestamp, forceRedraw);
+}
+
+
 enum pdraw_session_type Session::getSessionType(
 	void)
 {
@@ -1304,7 +1428,8 @@ int Session::getMediaInfo(
 void *Session::addVideoFrameFilterCallback(
 	unsigned int mediaId,
 	pdraw_video_frame_filter_callback_t cb,
-	void *userPtr)
+	void *userPtr,
+	bool parallel)
 {
 	pthread_mutex_lock(&mMutex);
 
@@ -1323,7 +1448,8 @@ void *Session::addVideoFrameFilterCallback(
 	}
 
 	VideoFrameFilter *filter =
-		((VideoMedia*)media)->addVideoFrameFilter(cb, userPtr);
+		((VideoMedia*)media)->addVideoFrameFilter(cb, userPtr,
+			false, parallel);
 	if (filter == NULL) {
 		pthread_mutex_unlock(&mMutex);
 		ULOGE("failed to create video frame filter");
@@ -1373,7 +1499,8 @@ int Session::removeVideoFrameFilterCallback(
 
 void *Session::addVideoFrameProducer(
 	unsigned int mediaId,
-	bool frameByFrame)
+	bool frameByFrame,
+	bool copy)
 {
 	pthread_mutex_lock(&mMutex);
 
@@ -1392,7 +1519,7 @@ void *Session::addVideoFrameProducer(
 	}
 
 	VideoFrameFilter *filter =
-		((VideoMedia*)media)->addVideoFrameFilter(frameByFrame);
+		((VideoMedia*)media)->addVideoFrameFilter(frameByFrame, copy);
 	if (filter == NULL) {
 		pthread_mutex_unlock(&mMutex);
 		ULOGE("failed to create video frame filter");
@@ -1446,185 +1573,978 @@ int Session::getProducerLastFrame(
 }
 
 
-float Session::getControllerRadarAngleSetting(
-	void)
+int Session::getProducerLastFrameRef(
+	void *producerCtx,
+	struct pdraw_video_frame *frame,
+	void **frameRef,
+	int timeout)
 {
-	return mSettings.getControllerRadarAngle();
-}
+	if (producerCtx == NULL)
+		return -EINVAL;
+	if (frame == NULL)
+		return -EINVAL;
+	if (frameRef == NULL)
+		return -EINVAL;
 
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
 
-void Session::setControllerRadarAngleSetting(
-	float angle)
-{
-	mSettings.setControllerRadarAngle(angle);
+	return filter->getLastFrameRef(frame, frameRef, timeout);
 }
 
 
-void Session::getDisplayScreenSettings(
-	float *xdpi,
-	float *ydpi,
-	float *deviceMargin)
+int Session::releaseProducerFrame(
+	void *producerCtx,
+	void *frameRef)
 {
-	mSettings.getDisplayScreenSettings(xdpi, ydpi, deviceMargin);
-}
+	if (producerCtx == NULL)
+		return -EINVAL;
+	if (frameRef == NULL)
+		return -EINVAL;
 
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
 
-void Session::setDisplayScreenSettings(
-	float xdpi,
-	float ydpi,
-	float deviceMargin)
-{
-	mSettings.setDisplayScreenSettings(xdpi, ydpi, deviceMargin);
+	return filter->releaseFrame(frameRef);
 }
 
 
-void Session::getHmdDistorsionCorrectionSettings(
-	enum pdraw_hmd_model *hmdModel,
-	float *ipd,
-	float *scale,
-	float *panH,
-	float *panV)
+int Session::getProducerEventFd(
+	void *producerCtx)
 {
-	mSettings.getHmdDistorsionCorrectionSettings(
-		hmdModel, ipd, scale, panH, panV);
-}
+	if (producerCtx == NULL)
+		return -EINVAL;
 
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
 
-void Session::setHmdDistorsionCorrectionSettings(
-	enum pdraw_hmd_model hmdModel,
-	float ipd,
-	float scale,
-	float panH,
-	float panV)
-{
-	mSettings.setHmdDistorsionCorrectionSettings(
-		hmdModel, ipd, scale, panH, panV);
+	return filter->getEventFd();
 }
 
 
-/*
- * Internal methods
- */
-
-int Session::internalOpen(
-	const std::string &url,
-	const std::string &ifaceAddr)
+void *Session::addVideoFrameExport(
+	unsigned int mediaId,
+	unsigned int slotCount,
+	size_t slotSize)
 {
-	int ret = 0;
+	pthread_mutex_lock(&mMutex);
 
-	std::string ext = url.substr(url.length() - 4, 4);
-	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-	if ((url.front() == '/') && (ext == ".mp4")) {
-		pthread_mutex_lock(&mMutex);
-		mSessionType = PDRAW_SESSION_TYPE_RECORD;
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
 		pthread_mutex_unlock(&mMutex);
-		mDemuxer = new RecordDemuxer(this);
-		if (mDemuxer == NULL) {
-			ULOGE("failed to alloc demuxer");
-			ret = -ENOMEM;
-			goto out;
-		}
-		ret = ((RecordDemuxer *)mDemuxer)->open(url);
-		if (ret < 0) {
-			ULOG_ERRNO("demuxer->open", -ret);
-			delete mDemuxer;
-			mDemuxer = NULL;
-			goto out;
-		}
-	} else if (((url.front() == '/') && (ext == ".sdp")) ||
-		((url.substr(0, 7) == "http://") && (ext == ".sdp")) ||
-		(url.substr(0, 7) == "rtsp://")) {
-		pthread_mutex_lock(&mMutex);
-		mSessionType = PDRAW_SESSION_TYPE_STREAM;
+		ULOG_ERRNO("invalid media id", ENOENT);
+		return NULL;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
 		pthread_mutex_unlock(&mMutex);
-		mDemuxer = new StreamDemuxerNet(this);
-		if (mDemuxer == NULL) {
-			ULOGE("failed to alloc demuxer");
-			ret = -ENOMEM;
-			goto out;
-		}
-		ret = ((StreamDemuxerNet *)mDemuxer)->open(
-			url, ifaceAddr);
-		if (ret < 0) {
-			ULOG_ERRNO("demuxer->open", -ret);
-			delete mDemuxer;
-			mDemuxer = NULL;
-			goto out;
+		ULOG_ERRNO("invalid media type", EPROTO);
+		return NULL;
+	}
+
+	if (slotSize == 0) {
+		unsigned int width = 0, height = 0;
+		((VideoMedia*)media)->getDimensions(&width, &height,
+			NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+		slotSize = (size_t)width * height +
+			2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+		if (slotSize == 0) {
+			pthread_mutex_unlock(&mMutex);
+			ULOGE("unknown media dimensions, a slot size is required");
+			return NULL;
 		}
-	} else {
-		ULOGE("unsupported URL");
-		ret = -ENOSYS;
-		goto out;
 	}
 
-	ret = addMediaFromDemuxer();
-	if (ret < 0) {
-		ULOG_ERRNO("addMediaFromDemuxer", -ret);
-		goto out;
+	VideoFrameExporter *exporter =
+		new VideoFrameExporter(slotCount, slotSize);
+	if ((exporter == NULL) || (exporter->getFd() < 0)) {
+		pthread_mutex_unlock(&mMutex);
+		delete exporter;
+		ULOGE("failed to create video frame exporter");
+		return NULL;
 	}
 
-	setState(OPENED);
+	VideoFrameFilter *filter =
+		((VideoMedia*)media)->addVideoFrameExport(exporter);
+	if (filter == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		delete exporter;
+		ULOGE("failed to create video frame filter");
+		return NULL;
+	}
 
-out:
-	if (mListener)
-		mListener->openResponse(this, ret);
-	return ret;
+	pthread_mutex_unlock(&mMutex);
+
+	return (void *)filter;
 }
 
 
-int Session::internalOpen(
-	const std::string &localAddr,
-	uint16_t localStreamPort,
-	uint16_t localControlPort,
-	const std::string &remoteAddr,
-	uint16_t remoteStreamPort,
-	uint16_t remoteControlPort,
-	const std::string &ifaceAddr)
+int Session::removeVideoFrameExport(
+	void *exportCtx)
 {
-	int ret = 0;
+	VideoMedia *media = NULL;
 
 	pthread_mutex_lock(&mMutex);
-	mSessionType = PDRAW_SESSION_TYPE_STREAM;
-	pthread_mutex_unlock(&mMutex);
-	mDemuxer = new StreamDemuxerNet(this);
-	if (mDemuxer == NULL) {
-		ULOGE("failed to alloc demuxer");
-		ret = -ENOMEM;
-		goto out;
-	}
 
-	ret = ((StreamDemuxerNet *)mDemuxer)->open(localAddr,
-		localStreamPort, localControlPort, remoteAddr,
-		remoteStreamPort, remoteControlPort, ifaceAddr);
-	if (ret < 0) {
-		ULOG_ERRNO("demuxer->open", -ret);
-		delete mDemuxer;
-		mDemuxer = NULL;
-		goto out;
+	if (getVideoFrameFilterUserPtr(exportCtx,
+		&VideoFrameExporter::frameCb, &media) == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		return -EINVAL;
 	}
 
-	ret = addMediaFromDemuxer();
-	if (ret < 0) {
-		ULOG_ERRNO("addMediaFromDemuxer", -ret);
-		goto out;
-	}
+	/* The media deletes the exporter once its filter is gone */
+	int ret = media->removeVideoFrameExport((VideoFrameFilter*)exportCtx);
 
-	setState(OPENED);
+	pthread_mutex_unlock(&mMutex);
 
-out:
-	if (mListener)
-		mListener->openResponse(this, ret);
 	return ret;
 }
 
 
-int Session::internalOpen(
-	const std::string &url,
-	struct mux_ctx *mux)
+int Session::getVideoFrameExportFd(
+	void *exportCtx)
 {
-#ifdef BUILD_LIBMUX
-	int ret = 0;
-
+	pthread_mutex_lock(&mMutex);
+
+	VideoFrameExporter *exporter = (VideoFrameExporter *)
+		getVideoFrameFilterUserPtr(exportCtx,
+		&VideoFrameExporter::frameCb, NULL);
+	int ret = (exporter != NULL) ? exporter->getFd() : -EINVAL;
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+int Session::sendVideoFrameExportFd(
+	void *exportCtx,
+	int sock)
+{
+	pthread_mutex_lock(&mMutex);
+
+	VideoFrameExporter *exporter = (VideoFrameExporter *)
+		getVideoFrameFilterUserPtr(exportCtx,
+		&VideoFrameExporter::frameCb, NULL);
+	int ret = (exporter != NULL) ? exporter->sendFd(sock) : -EINVAL;
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+void *Session::addVideoFrameMetadataCallback(
+	unsigned int mediaId,
+	pdraw_video_frame_metadata_callback_t cb,
+	void *userPtr,
+	enum pdraw_video_frame_metadata_source source)
+{
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media id", ENOENT);
+		return NULL;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media type", EPROTO);
+		return NULL;
+	}
+
+	void *ctx = ((VideoMedia*)media)->addMetadataCallback(
+		cb, userPtr, source);
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ctx;
+}
+
+
+int Session::removeVideoFrameMetadataCallback(
+	unsigned int mediaId,
+	void *metadataCtx)
+{
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media id", ENOENT);
+		return -ENOENT;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media type", EPROTO);
+		return -EPROTO;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+
+	/* Waits for a running callback; the callback may call into the
+	 * session, so the session lock must not be held meanwhile */
+	return ((VideoMedia*)media)->removeMetadataCallback(metadataCtx);
+}
+
+
+void *Session::addVideoFrameBatchProducer(
+	unsigned int mediaId,
+	const struct pdraw_video_frame_batch_settings *settings,
+	pdraw_video_frame_batch_callback_t cb,
+	void *userPtr)
+{
+	int ret;
+
+	if (cb == NULL) {
+		ULOG_ERRNO("invalid callback", EINVAL);
+		return NULL;
+	}
+	if ((settings != NULL) &&
+		((settings->batchSize > PDRAW_VIDEO_FRAME_BATCH_MAX_SIZE) ||
+		((settings->layout != PDRAW_VIDEO_FRAME_BATCH_LAYOUT_FRAMES) &&
+		(settings->layout != PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NHWC) &&
+		(settings->layout != PDRAW_VIDEO_FRAME_BATCH_LAYOUT_NCHW)))) {
+		ULOG_ERRNO("invalid batch settings", EINVAL);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media id", ENOENT);
+		return NULL;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+		pthread_mutex_unlock(&mMutex);
+		ULOG_ERRNO("invalid media type", EPROTO);
+		return NULL;
+	}
+
+	VideoFrameBatcher *batcher =
+		new VideoFrameBatcher(settings, cb, userPtr);
+	if ((batcher == NULL) || (!batcher->isRunning())) {
+		pthread_mutex_unlock(&mMutex);
+		delete batcher;
+		ULOGE("failed to create video frame batcher");
+		return NULL;
+	}
+
+	VideoFrameFilter *filter =
+		((VideoMedia*)media)->addVideoFrameBatch(batcher);
+	if (filter == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		delete batcher;
+		ULOGE("failed to create video frame filter");
+		return NULL;
+	}
+
+	enum pdraw_color_format format = batcher->getRequiredFormat();
+	if (format != PDRAW_COLOR_FORMAT_UNKNOWN) {
+		ret = filter->setOutputFormat(format);
+		if (ret < 0)
+			ULOG_ERRNO("videoFrameFilter->setOutputFormat", -ret);
+	}
+
+	pthread_mutex_unlock(&mMutex);
+
+	return (void *)filter;
+}
+
+
+int Session::removeVideoFrameBatchProducer(
+	void *batchCtx)
+{
+	VideoMedia *media = NULL;
+
+	pthread_mutex_lock(&mMutex);
+
+	if (getVideoFrameFilterUserPtr(batchCtx,
+		&VideoFrameBatcher::frameCb, &media) == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		return -EINVAL;
+	}
+
+	/* The media stops the batcher, removes its filter and then
+	 * deletes the batcher */
+	int ret = media->removeVideoFrameBatch((VideoFrameFilter*)batchCtx);
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+int Session::getVideoFrameBatchSettings(
+	void *batchCtx,
+	struct pdraw_video_frame_batch_settings *settings)
+{
+	pthread_mutex_lock(&mMutex);
+
+	VideoFrameBatcher *batcher = (VideoFrameBatcher *)
+		getVideoFrameFilterUserPtr(batchCtx,
+		&VideoFrameBatcher::frameCb, NULL);
+	int ret = (batcher != NULL) ? batcher->getSettings(settings) : -EINVAL;
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+int Session::getProducerRingSettings(
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy *policy,
+	unsigned int *depth)
+{
+	if (producerCtx == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+	return filter->getRingSettings(policy, depth);
+}
+
+
+int Session::setProducerRingSettings(
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy policy,
+	unsigned int depth)
+{
+	if (producerCtx == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+	return filter->setRingSettings(policy, depth);
+}
+
+
+int Session::getProducerStats(
+	void *producerCtx,
+	struct pdraw_video_frame_producer_stats *stats)
+{
+	if (producerCtx == NULL)
+		return -EINVAL;
+	if (stats == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)producerCtx;
+
+	return filter->getStats(stats);
+}
+
+
+int Session::getVideoFrameFilterStats(
+	void *filterCtx,
+	struct pdraw_video_frame_filter_stats *stats)
+{
+	if (filterCtx == NULL)
+		return -EINVAL;
+	if (stats == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)filterCtx;
+
+	return filter->getFilterStats(stats);
+}
+
+
+int Session::getVideoFrameFilterOutputFormat(
+	void *filterCtx,
+	enum pdraw_color_format *format)
+{
+	if (filterCtx == NULL)
+		return -EINVAL;
+	if (format == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)filterCtx;
+
+	return filter->getOutputFormat(format);
+}
+
+
+int Session::setVideoFrameFilterOutputFormat(
+	void *filterCtx,
+	enum pdraw_color_format format)
+{
+	if (filterCtx == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)filterCtx;
+
+	return filter->setOutputFormat(format);
+}
+
+
+int Session::getVideoFrameFilterScaling(
+	void *filterCtx,
+	struct pdraw_video_frame_filter_scaling *scaling)
+{
+	if (filterCtx == NULL)
+		return -EINVAL;
+	if (scaling == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)filterCtx;
+
+	return filter->getScaling(scaling);
+}
+
+
+int Session::setVideoFrameFilterScaling(
+	void *filterCtx,
+	const struct pdraw_video_frame_filter_scaling *scaling)
+{
+	if (filterCtx == NULL)
+		return -EINVAL;
+
+	VideoFrameFilter *filter = (VideoFrameFilter*)filterCtx;
+
+	return filter->setScaling(scaling);
+}
+
+
+int Session::getVideoDecoderStats(
+	unsigned int mediaId,
+	struct pdraw_video_decoder_stats *stats)
+{
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media id");
+		return -ENOENT;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media type");
+		return -EPROTO;
+	}
+
+	AvcDecoder *decoder = (AvcDecoder *)media->getDecoder();
+	if (decoder == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("decoder is not enabled");
+		return -EPROTO;
+	}
+
+	int ret = decoder->getStats(stats);
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+int Session::getVideoDecoderOutputStats(
+	unsigned int mediaId,
+	struct pdraw_video_decoder_output_stats *stats)
+{
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media id");
+		return -ENOENT;
+	}
+
+	if (media->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media type");
+		return -EPROTO;
+	}
+
+	AvcDecoder *decoder = (AvcDecoder *)media->getDecoder();
+	if (decoder == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("decoder is not enabled");
+		return -EPROTO;
+	}
+
+	int ret = decoder->getOutputStats(stats);
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+int Session::getVideoRendererStats(
+	unsigned int mediaId,
+	struct pdraw_video_renderer_stats *stats)
+{
+	if (stats == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&mMutex);
+
+	Media *media = getMediaById(mediaId);
+
+	if (media == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("invalid media id");
+		return -ENOENT;
+	}
+
+	if (mRenderer == NULL) {
+		pthread_mutex_unlock(&mMutex);
+		ULOGE("no renderer is enabled");
+		return -EPROTO;
+	}
+
+	int ret = mRenderer->getStats(media, stats);
+
+	pthread_mutex_unlock(&mMutex);
+
+	return ret;
+}
+
+
+float Session::getControllerRadarAngleSetting(
+	void)
+{
+	return mSettings.getControllerRadarAngle();
+}
+
+
+void Session::setControllerRadarAngleSetting(
+	float angle)
+{
+	mSettings.setControllerRadarAngle(angle);
+}
+
+
+void Session::getDisplayScreenSettings(
+	float *xdpi,
+	float *ydpi,
+	float *deviceMargin)
+{
+	mSettings.getDisplayScreenSettings(xdpi, ydpi, deviceMargin);
+}
+
+
+void Session::setDisplayScreenSettings(
+	float xdpi,
+	float ydpi,
+	float deviceMargin)
+{
+	mSettings.setDisplayScreenSettings(xdpi, ydpi, deviceMargin);
+}
+
+
+void Session::getHmdDistorsionCorrectionSettings(
+	enum pdraw_hmd_model *hmdModel,
+	float *ipd,
+	float *scale,
+	float *panH,
+	float *panV)
+{
+	mSettings.getHmdDistorsionCorrectionSettings(
+		hmdModel, ipd, scale, panH, panV);
+}
+
+
+void Session::setHmdDistorsionCorrectionSettings(
+	enum pdraw_hmd_model hmdModel,
+	float ipd,
+	float scale,
+	float panH,
+	float panV)
+{
+	mSettings.setHmdDistorsionCorrectionSettings(
+		hmdModel, ipd, scale, panH, panV);
+}
+
+
+void Session::getDecoderDropSettings(
+	enum pdraw_decoder_drop_policy *policy,
+	unsigned int *maxBacklog)
+{
+	mSettings.getDecoderDropSettings(policy, maxBacklog);
+}
+
+
+void Session::setDecoderDropSettings(
+	enum pdraw_decoder_drop_policy policy,
+	unsigned int maxBacklog)
+{
+	mSettings.setDecoderDropSettings(policy, maxBacklog);
+}
+
+
+bool Session::getWarmPoolSetting(
+	void)
+{
+	return mSettings.getWarmPool();
+}
+
+
+void Session::setWarmPoolSetting(
+	bool enable)
+{
+	mSettings.setWarmPool(enable);
+	if (!enable)
+		clearWarmPool();
+}
+
+
+void Session::getDecoderOutputSettings(
+	unsigned int *sinkMaxFrames,
+	unsigned int *leakTimeout)
+{
+	mSettings.getDecoderOutputSettings(sinkMaxFrames, leakTimeout);
+}
+
+
+void Session::setDecoderOutputSettings(
+	unsigned int sinkMaxFrames,
+	unsigned int leakTimeout)
+{
+	mSettings.setDecoderOutputSettings(sinkMaxFrames, leakTimeout);
+}
+
+
+enum pdraw_video_renderer_layout Session::getVideoRendererLayoutSetting(
+	void)
+{
+	return mSettings.getRendererLayout();
+}
+
+
+void Session::setVideoRendererLayoutSetting(
+	enum pdraw_video_renderer_layout layout)
+{
+	mSettings.setRendererLayout(layout);
+}
+
+
+int Session::getHmdResolutionSettings(
+	float *minScale,
+	float *maxScale,
+	unsigned int *targetFrameTime)
+{
+	mSettings.getHmdResolutionSettings(minScale, maxScale,
+		targetFrameTime);
+	return 0;
+}
+
+
+int Session::setHmdResolutionSettings(
+	float minScale,
+	float maxScale,
+	unsigned int targetFrameTime)
+{
+	if ((minScale <= 0.f) || (maxScale > 1.f) || (minScale > maxScale)) {
+		ULOGE("invalid HMD resolution scale bounds");
+		return -EINVAL;
+	}
+
+	mSettings.setHmdResolutionSettings(minScale, maxScale,
+		targetFrameTime);
+	return 0;
+}
+
+
+/*
+ * Internal methods
+ */
+
+uint64_t Session::getOpenTime(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	uint64_t ret = mOpenTime;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+
+/* Called by a decoder on its first configuration; the parked decoders
+ * are matched on their SPS, the codec being always H.264 */
+AvcDecoder *Session::takeWarmDecoder(
+	const uint8_t *sps,
+	unsigned int spsSize)
+{
+	AvcDecoder *decoder = NULL;
+
+	if ((sps == NULL) || (spsSize == 0))
+		return NULL;
+
+	pthread_mutex_lock(&mWarmPoolMutex);
+
+	std::vector<AvcDecoder *>::iterator d = mWarmDecoders.begin();
+	while (d != mWarmDecoders.end()) {
+		if ((*d)->matchSps(sps, spsSize)) {
+			decoder = *d;
+			mWarmDecoders.erase(d);
+			break;
+		}
+		d++;
+	}
+
+	pthread_mutex_unlock(&mWarmPoolMutex);
+
+	return decoder;
+}
+
+
+void Session::startOpen(
+	void)
+{
+	struct timespec ts;
+
+	int ret = releasePipeline();
+	if (ret < 0)
+		ULOG_ERRNO("releasePipeline", -ret);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	pthread_mutex_lock(&mMutex);
+	mOpenTime = (uint64_t)ts.tv_sec * 1000000 +
+		(uint64_t)ts.tv_nsec / 1000;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+/* Release the demuxer and medias of a previous open; with the warm
+ * pool enabled the decoders are kept for the next medias */
+int Session::releasePipeline(
+	void)
+{
+	int ret;
+	bool warmPool = mSettings.getWarmPool();
+
+	if (mDemuxer == NULL)
+		return 0;
+
+	if (mState != CLOSED) {
+		ret = mDemuxer->close();
+		if (ret < 0)
+			ULOG_ERRNO("demuxer->close", -ret);
+	}
+
+	/* The demuxer may still hold a decoder input buffer */
+	delete mDemuxer;
+	mDemuxer = NULL;
+
+	/* Release the medias without the session lock held: the renderer,
+	 * the decoders and the medias may call back into the session */
+	std::vector<Media *> medias;
+	pthread_mutex_lock(&mMutex);
+	medias.swap(mMedias);
+	pthread_mutex_unlock(&mMutex);
+
+	while (!medias.empty()) {
+		Media *m = medias.back();
+		medias.pop_back();
+
+		if (m->getType() != PDRAW_MEDIA_TYPE_VIDEO) {
+			delete m;
+			continue;
+		}
+
+		AvcDecoder *decoder = (AvcDecoder *)m->getDecoder();
+		if ((mRenderer != NULL) && (decoder != NULL)) {
+			struct vbuf_queue *queue = NULL;
+			ret = mRenderer->getInputSourceQueue(m, &queue);
+			if (ret == 0) {
+				ret = decoder->removeOutputSink(m, queue);
+				if (ret < 0) {
+					ULOG_ERRNO("decoder->removeOutputSink",
+						-ret);
+				}
+			}
+			ret = mRenderer->removeInputSource(m);
+			if (ret < 0)
+				ULOG_ERRNO("renderer->removeInputSource", -ret);
+		}
+
+		if ((warmPool) && (decoder != NULL) &&
+			(decoder->isConfigured())) {
+			((VideoMedia *)m)->detachDecoder();
+			ret = decoder->park();
+			if (ret < 0) {
+				ULOG_ERRNO("decoder->park", -ret);
+				delete decoder;
+			} else {
+				pthread_mutex_lock(&mWarmPoolMutex);
+				if (mWarmDecoders.size() <
+					SESSION_WARM_POOL_MAX_DECODERS) {
+					mWarmDecoders.push_back(decoder);
+					decoder = NULL;
+				}
+				pthread_mutex_unlock(&mWarmPoolMutex);
+				delete decoder;
+			}
+		}
+
+		delete m;
+	}
+
+	return 0;
+}
+
+
+void Session::clearWarmPool(
+	void)
+{
+	std::vector<AvcDecoder *> decoders;
+
+	pthread_mutex_lock(&mWarmPoolMutex);
+	decoders.swap(mWarmDecoders);
+	pthread_mutex_unlock(&mWarmPoolMutex);
+
+	std::vector<AvcDecoder *>::iterator d = decoders.begin();
+	while (d != decoders.end()) {
+		delete *d;
+		d++;
+	}
+}
+
+int Session::internalOpen(
+	const std::string &url,
+	const std::string &ifaceAddr)
+{
+	int ret = 0;
+
+	startOpen();
+
+	std::string ext = url.substr(url.length() - 4, 4);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	if ((url.front() == '/') && (ext == ".mp4")) {
+		pthread_mutex_lock(&mMutex);
+		mSessionType = PDRAW_SESSION_TYPE_RECORD;
+		pthread_mutex_unlock(&mMutex);
+		mDemuxer = new RecordDemuxer(this);
+		if (mDemuxer == NULL) {
+			ULOGE("failed to alloc demuxer");
+			ret = -ENOMEM;
+			goto out;
+		}
+		ret = ((RecordDemuxer *)mDemuxer)->open(url);
+		if (ret < 0) {
+			ULOG_ERRNO("demuxer->open", -ret);
+			delete mDemuxer;
+			mDemuxer = NULL;
+			goto out;
+		}
+	} else if (((url.front() == '/') && (ext == ".sdp")) ||
+		((url.substr(0, 7) == "http://") && (ext == ".sdp")) ||
+		(url.substr(0, 7) == "rtsp://")) {
+		pthread_mutex_lock(&mMutex);
+		mSessionType = PDRAW_SESSION_TYPE_STREAM;
+		pthread_mutex_unlock(&mMutex);
+		mDemuxer = new StreamDemuxerNet(this);
+		if (mDemuxer == NULL) {
+			ULOGE("failed to alloc demuxer");
+			ret = -ENOMEM;
+			goto out;
+		}
+		ret = ((StreamDemuxerNet *)mDemuxer)->open(
+			url, ifaceAddr);
+		if (ret < 0) {
+			ULOG_ERRNO("demuxer->open", -ret);
+			delete mDemuxer;
+			mDemuxer = NULL;
+			goto out;
+		}
+	} else {
+		ULOGE("unsupported URL");
+		ret = -ENOSYS;
+		goto out;
+	}
+
+	ret = addMediaFromDemuxer();
+	if (ret < 0) {
+		ULOG_ERRNO("addMediaFromDemuxer", -ret);
+		goto out;
+	}
+
+	setState(OPENED);
+
+out:
+	if (mListener)
+		mListener->openResponse(this, ret);
+	return ret;
+}
+
+
+int Session::internalOpen(
+	const std::string &localAddr,
+	uint16_t localStreamPort,
+	uint16_t localControlPort,
+	const std::string &remoteAddr,
+	uint16_t remoteStreamPort,
+	uint16_t remoteControlPort,
+	const std::string &ifaceAddr)
+{
+	int ret = 0;
+
+	startOpen();
+
+	pthread_mutex_lock(&mMutex);
+	mSessionType = PDRAW_SESSION_TYPE_STREAM;
+	pthread_mutex_unlock(&mMutex);
+	mDemuxer = new StreamDemuxerNet(this);
+	if (mDemuxer == NULL) {
+		ULOGE("failed to alloc demuxer");
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = ((StreamDemuxerNet *)mDemuxer)->open(localAddr,
+		localStreamPort, localControlPort, remoteAddr,
+		remoteStreamPort, remoteControlPort, ifaceAddr);
+	if (ret < 0) {
+		ULOG_ERRNO("demuxer->open", -ret);
+		delete mDemuxer;
+		mDemuxer = NULL;
+		goto out;
+	}
+
+	ret = addMediaFromDemuxer();
+	if (ret < 0) {
+		ULOG_ERRNO("addMediaFromDemuxer", -ret);
+		goto out;
+	}
+
+	setState(OPENED);
+
+out:
+	if (mListener)
+		mListener->openResponse(this, ret);
+	return ret;
+}
+
+
+int Session::internalOpen(
+	const std::string &url,
+	struct mux_ctx *mux)
+{
+#ifdef BUILD_LIBMUX
+	int ret = 0;
+
+	startOpen();
+
 	pthread_mutex_lock(&mMutex);
 	mSessionType = PDRAW_SESSION_TYPE_STREAM;
 	pthread_mutex_unlock(&mMutex);
@@ -1669,6 +2589,8 @@ int Session::internalOpenSdp(
 {
 	int ret = 0;
 
+	startOpen();
+
 	pthread_mutex_lock(&mMutex);
 	mSessionType = PDRAW_SESSION_TYPE_STREAM;
 	pthread_mutex_unlock(&mMutex);
@@ -1709,6 +2631,8 @@ int Session::internalOpenSdp(
 #ifdef BUILD_LIBMUX
 	int ret = 0;
 
+	startOpen();
+
 	pthread_mutex_lock(&mMutex);
 	mSessionType = PDRAW_SESSION_TYPE_STREAM;
 	pthread_mutex_unlock(&mMutex);
@@ -2122,6 +3046,39 @@ Media *Session::getMediaById(
 }
 
 
+/* Looks the filter up in the video medias, the returned pointer
+ * is valid while mMutex is held */
+void *Session::getVideoFrameFilterUserPtr(
+	void *filterCtx,
+	pdraw_video_frame_filter_callback_t cb,
+	VideoMedia **media)
+{
+	void *userPtr = NULL;
+
+	if (filterCtx == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&mMutex);
+	std::vector<Media*>::iterator m = mMedias.begin();
+
+	while (m != mMedias.end()) {
+		if ((*m)->getType() == PDRAW_MEDIA_TYPE_VIDEO) {
+			userPtr = ((VideoMedia*)*m)->getVideoFrameFilterUserPtr(
+				(VideoFrameFilter*)filterCtx, cb);
+			if (userPtr != NULL) {
+				if (media != NULL)
+					*media = (VideoMedia*)*m;
+				break;
+			}
+		}
+		m++;
+	}
+
+	pthread_mutex_unlock(&mMutex);
+	return userPtr;
+}
+
+
 void Session::setState(
 	enum State state)
 {
@@ -45,7 +45,12 @@
 namespace Pdraw {
 
 
+#define SESSION_WARM_POOL_MAX_DECODERS (2)
+
+
 class Settings;
+class AvcDecoder;
+class VideoMedia;
 
 
 class Session : public IPdraw {
@@ -149,6 +154,21 @@ public:
 		bool enableHeadtracking,
 		struct egl_display *eglDisplay = NULL);
 
+	/* Called on the rendering thread */
+	int startSoftwareVideoRenderer(
+		unsigned int width,
+		unsigned int height,
+		bool enableHud);
+
+	/* Called on the rendering thread */
+	int startOffscreenVideoRenderer(
+		unsigned int width,
+		unsigned int height,
+		enum pdraw_color_format format,
+		bool enableHud,
+		pdraw_offscreen_frame_callback_t cb,
+		void *userPtr);
+
 	/* Called on the rendering thread */
 	int stopVideoRenderer(
 		void);
@@ -161,6 +181,24 @@ public:
 		unsigned int renderHeight,
 		uint64_t timestamp);
 
+	/* Called on the rendering thread */
+	int renderVideoIfNeeded(
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		uint64_t timestamp,
+		bool forceRedraw = false);
+
+	/* Called on the rendering thread */
+	int renderVideoToBuffer(
+		uint8_t *buffer,
+		size_t size,
+		unsigned int stride,
+		enum pdraw_color_format format,
+		uint64_t timestamp,
+		bool forceRedraw = false);
+
 	enum pdraw_session_type getSessionType(
 		void);
 
@@ -319,7 +357,8 @@ public:
 	void *addVideoFrameFilterCallback(
 		unsigned int mediaId,
 		pdraw_video_frame_filter_callback_t cb,
-		void *userPtr);
+		void *userPtr,
+		bool parallel = false);
 
 	int removeVideoFrameFilterCallback(
 		unsigned int mediaId,
@@ -327,7 +366,8 @@ public:
 
 	void *addVideoFrameProducer(
 		unsigned int mediaId,
-		bool frameByFrame = false);
+		bool frameByFrame = false,
+		bool copy = false);
 
 	int removeVideoFrameProducer(
 		void *producerCtx);
@@ -345,6 +385,107 @@ public:
 		struct pdraw_video_frame *frame,
 		int timeout = 0);
 
+	/**
+	 * get last frame reference (zero-copy producers only)
+	 */
+	int getProducerLastFrameRef(
+		void *producerCtx,
+		struct pdraw_video_frame *frame,
+		void **frameRef,
+		int timeout = 0);
+
+	int releaseProducerFrame(
+		void *producerCtx,
+		void *frameRef);
+
+	int getProducerEventFd(
+		void *producerCtx);
+
+	void *addVideoFrameExport(
+		unsigned int mediaId,
+		unsigned int slotCount = 0,
+		size_t slotSize = 0);
+
+	int removeVideoFrameExport(
+		void *exportCtx);
+
+	int getVideoFrameExportFd(
+		void *exportCtx);
+
+	int sendVideoFrameExportFd(
+		void *exportCtx,
+		int sock);
+
+	void *addVideoFrameMetadataCallback(
+		unsigned int mediaId,
+		pdraw_video_frame_metadata_callback_t cb,
+		void *userPtr,
+		enum pdraw_video_frame_metadata_source source =
+			PDRAW_VIDEO_FRAME_METADATA_SOURCE_DECODER);
+
+	int removeVideoFrameMetadataCallback(
+		unsigned int mediaId,
+		void *metadataCtx);
+
+	void *addVideoFrameBatchProducer(
+		unsigned int mediaId,
+		const struct pdraw_video_frame_batch_settings *settings,
+		pdraw_video_frame_batch_callback_t cb,
+		void *userPtr);
+
+	int removeVideoFrameBatchProducer(
+		void *batchCtx);
+
+	int getVideoFrameBatchSettings(
+		void *batchCtx,
+		struct pdraw_video_frame_batch_settings *settings);
+
+	int getProducerRingSettings(
+		void *producerCtx,
+		enum pdraw_video_frame_producer_policy *policy,
+		unsigned int *depth);
+
+	int setProducerRingSettings(
+		void *producerCtx,
+		enum pdraw_video_frame_producer_policy policy,
+		unsigned int depth);
+
+	int getProducerStats(
+		void *producerCtx,
+		struct pdraw_video_frame_producer_stats *stats);
+
+	int getVideoFrameFilterStats(
+		void *filterCtx,
+		struct pdraw_video_frame_filter_stats *stats);
+
+	int getVideoFrameFilterOutputFormat(
+		void *filterCtx,
+		enum pdraw_color_format *format);
+
+	int setVideoFrameFilterOutputFormat(
+		void *filterCtx,
+		enum pdraw_color_format format);
+
+	int getVideoFrameFilterScaling(
+		void *filterCtx,
+		struct pdraw_video_frame_filter_scaling *scaling);
+
+	int setVideoFrameFilterScaling(
+		void *filterCtx,
+		const struct pdraw_video_frame_filter_scaling *scaling);
+
+	int getVideoDecoderStats(
+		unsigned int mediaId,
+		struct pdraw_video_decoder_stats *stats);
+
+	int getVideoDecoderOutputStats(
+		unsigned int mediaId,
+		struct pdraw_video_decoder_output_stats *stats);
+
+	int getVideoRendererStats(
+		unsigned int mediaId,
+		struct pdraw_video_renderer_stats *stats);
+
 	float getControllerRadarAngleSetting(
 		void);
 
@@ -375,6 +516,44 @@ public:
 		float panH,
 		float panV);
 
+	void getDecoderDropSettings(
+		enum pdraw_decoder_drop_policy *policy,
+		unsigned int *maxBacklog);
+
+	void setDecoderDropSettings(
+		enum pdraw_decoder_drop_policy policy,
+		unsigned int maxBacklog);
+
+	bool getWarmPoolSetting(
+		void);
+
+	void setWarmPoolSetting(
+		bool enable);
+
+	void getDecoderOutputSettings(
+		unsigned int *sinkMaxFrames,
+		unsigned int *leakTimeout);
+
+	void setDecoderOutputSettings(
+		unsigned int sinkMaxFrames,
+		unsigned int leakTimeout);
+
+	enum pdraw_video_renderer_layout getVideoRendererLayoutSetting(
+		void);
+
+	void setVideoRendererLayoutSetting(
+		enum pdraw_video_renderer_layout layout);
+
+	int getHmdResolutionSettings(
+		float *minScale,
+		float *maxScale,
+		unsigned int *targetFrameTime);
+
+	int setHmdResolutionSettings(
+		float minScale,
+		float maxScale,
+		unsigned int targetFrameTime);
+
 	void *getJniEnv(
 		void) {
 		return mJniEnv;
@@ -422,7 +601,36 @@ public:
 	void socketCreated(
 		int fd);
 
+	uint64_t getOpenTime(
+		void);
+
+	AvcDecoder *takeWarmDecoder(
+		const uint8_t *sps,
+		unsigned int spsSize);
+
 private:
+	void startOpen(
+		void);
+
+	int startRenderer(
+		bool software,
+		unsigned int windowWidth,
+		unsigned int windowHeight,
+		int renderX,
+		int renderY,
+		unsigned int renderWidth,
+		unsigned int renderHeight,
+		bool enableHud,
+		bool enableHmdDistorsionCorrection,
+		bool enableHeadtracking,
+		struct egl_display *eglDisplay);
+
+	int releasePipeline(
+		void);
+
+	void clearWarmPool(
+		void);
+
 	int internalOpen(
 		const std::string &url,
 		const std::string &ifaceAddr);
@@ -488,6 +696,11 @@ private:
 	Media *getMediaById(
 		unsigned int id);
 
+	void *getVideoFrameFilterUserPtr(
+		void *filterCtx,
+		pdraw_video_frame_filter_callback_t cb,
+		VideoMedia **media);
+
 	void setState(
 		enum State state);
 
@@ -520,6 +733,9 @@ private:
 	Renderer *mRenderer;
 	unsigned int mMediaIdCounter;
 	void *mJniEnv;
+	pthread_mutex_t mWarmPoolMutex;
+	std::vector<AvcDecoder *> mWarmDecoders;
+	uint64_t mOpenTime;
 };
 
 } /* namespace Pdraw */
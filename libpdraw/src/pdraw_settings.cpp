@@ -51,6 +51,15 @@ Settings::Settings(
 	mHmdScale = SETTINGS_HMD_SCALE;
 	mHmdPanH = SETTINGS_HMD_PAN_H;
 	mHmdPanV = SETTINGS_HMD_PAN_V;
+	mDecoderDropPolicy = SETTINGS_DECODER_DROP_POLICY;
+	mDecoderMaxBacklog = SETTINGS_DECODER_MAX_BACKLOG;
+	mWarmPool = SETTINGS_WARM_POOL;
+	mDecoderOutputSinkMaxFrames = SETTINGS_DECODER_OUTPUT_SINK_MAX_FRAMES;
+	mDecoderOutputLeakTimeout = SETTINGS_DECODER_OUTPUT_LEAK_TIMEOUT;
+	mRendererLayout = SETTINGS_RENDERER_LAYOUT;
+	mHmdResolutionMinScale = SETTINGS_HMD_RESOLUTION_MIN_SCALE;
+	mHmdResolutionMaxScale = SETTINGS_HMD_RESOLUTION_MAX_SCALE;
+	mHmdResolutionTargetFrameTime = SETTINGS_HMD_RESOLUTION_TARGET_TIME;
 
 	res = pthread_mutexattr_init(&attr);
 	if (res < 0) {
@@ -190,4 +199,119 @@ void Settings::setHmdDistorsionCorrectionSettings(
 	pthread_mutex_unlock(&mMutex);
 }
 
+
+void Settings::getDecoderDropSettings(
+	enum pdraw_decoder_drop_policy *policy,
+	unsigned int *maxBacklog)
+{
+	pthread_mutex_lock(&mMutex);
+	if (policy)
+		*policy = mDecoderDropPolicy;
+	if (maxBacklog)
+		*maxBacklog = mDecoderMaxBacklog;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void Settings::setDecoderDropSettings(
+	enum pdraw_decoder_drop_policy policy,
+	unsigned int maxBacklog)
+{
+	pthread_mutex_lock(&mMutex);
+	mDecoderDropPolicy = policy;
+	mDecoderMaxBacklog = maxBacklog;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+bool Settings::getWarmPool(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	bool ret = mWarmPool;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+
+void Settings::setWarmPool(
+	bool enable)
+{
+	pthread_mutex_lock(&mMutex);
+	mWarmPool = enable;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void Settings::getDecoderOutputSettings(
+	unsigned int *sinkMaxFrames,
+	unsigned int *leakTimeout)
+{
+	pthread_mutex_lock(&mMutex);
+	if (sinkMaxFrames)
+		*sinkMaxFrames = mDecoderOutputSinkMaxFrames;
+	if (leakTimeout)
+		*leakTimeout = mDecoderOutputLeakTimeout;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void Settings::setDecoderOutputSettings(
+	unsigned int sinkMaxFrames,
+	unsigned int leakTimeout)
+{
+	pthread_mutex_lock(&mMutex);
+	mDecoderOutputSinkMaxFrames = sinkMaxFrames;
+	mDecoderOutputLeakTimeout = leakTimeout;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+enum pdraw_video_renderer_layout Settings::getRendererLayout(
+	void)
+{
+	pthread_mutex_lock(&mMutex);
+	enum pdraw_video_renderer_layout ret = mRendererLayout;
+	pthread_mutex_unlock(&mMutex);
+	return ret;
+}
+
+
+void Settings::setRendererLayout(
+	enum pdraw_video_renderer_layout layout)
+{
+	pthread_mutex_lock(&mMutex);
+	mRendererLayout = layout;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void Settings::getHmdResolutionSettings(
+	float *minScale,
+	float *maxScale,
+	unsigned int *targetFrameTime)
+{
+	pthread_mutex_lock(&mMutex);
+	if (minScale)
+		*minScale = mHmdResolutionMinScale;
+	if (maxScale)
+		*maxScale = mHmdResolutionMaxScale;
+	if (targetFrameTime)
+		*targetFrameTime = mHmdResolutionTargetFrameTime;
+	pthread_mutex_unlock(&mMutex);
+}
+
+
+void Settings::setHmdResolutionSettings(
+	float minScale,
+	float maxScale,
+	unsigned int targetFrameTime)
+{
+	pthread_mutex_lock(&mMutex);
+	mHmdResolutionMinScale = minScale;
+	mHmdResolutionMaxScale = maxScale;
+	mHmdResolutionTargetFrameTime = targetFrameTime;
+	pthread_mutex_unlock(&mMutex);
+}
+
 } /* namespace Pdraw */
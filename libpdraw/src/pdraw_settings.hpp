@@ -46,6 +46,15 @@ namespace Pdraw {
 #define SETTINGS_HMD_SCALE                      (0.75f)
 #define SETTINGS_HMD_PAN_H                      (0.0f)
 #define SETTINGS_HMD_PAN_V                      (0.0f)
+#define SETTINGS_DECODER_DROP_POLICY            PDRAW_DECODER_DROP_POLICY_NONE
+#define SETTINGS_DECODER_MAX_BACKLOG            (100000)
+#define SETTINGS_WARM_POOL                      (false)
+#define SETTINGS_DECODER_OUTPUT_SINK_MAX_FRAMES (0)
+#define SETTINGS_DECODER_OUTPUT_LEAK_TIMEOUT    (2000000)
+#define SETTINGS_RENDERER_LAYOUT                PDRAW_VIDEO_RENDERER_LAYOUT_GRID
+#define SETTINGS_HMD_RESOLUTION_MIN_SCALE       (0.5f)
+#define SETTINGS_HMD_RESOLUTION_MAX_SCALE       (1.0f)
+#define SETTINGS_HMD_RESOLUTION_TARGET_TIME     (0)
 
 
 class Settings {
@@ -92,6 +101,44 @@ public:
 		float panH,
 		float panV);
 
+	void getDecoderDropSettings(
+		enum pdraw_decoder_drop_policy *policy,
+		unsigned int *maxBacklog);
+
+	void setDecoderDropSettings(
+		enum pdraw_decoder_drop_policy policy,
+		unsigned int maxBacklog);
+
+	bool getWarmPool(
+		void);
+
+	void setWarmPool(
+		bool enable);
+
+	void getDecoderOutputSettings(
+		unsigned int *sinkMaxFrames,
+		unsigned int *leakTimeout);
+
+	void setDecoderOutputSettings(
+		unsigned int sinkMaxFrames,
+		unsigned int leakTimeout);
+
+	enum pdraw_video_renderer_layout getRendererLayout(
+		void);
+
+	void setRendererLayout(
+		enum pdraw_video_renderer_layout layout);
+
+	void getHmdResolutionSettings(
+		float *minScale,
+		float *maxScale,
+		unsigned int *targetFrameTime);
+
+	void setHmdResolutionSettings(
+		float minScale,
+		float maxScale,
+		unsigned int targetFrameTime);
+
 private:
 	pthread_mutex_t mMutex;
 	float mControllerRadarAngle;
@@ -103,6 +150,15 @@ private:
 	float mHmdScale;
 	float mHmdPanH;
 	float mHmdPanV;
+	enum pdraw_decoder_drop_policy mDecoderDropPolicy;
+	unsigned int mDecoderMaxBacklog;
+	bool mWarmPool;
+	unsigned int mDecoderOutputSinkMaxFrames;
+	unsigned int mDecoderOutputLeakTimeout;
+	enum pdraw_video_renderer_layout mRendererLayout;
+	float mHmdResolutionMinScale;
+	float mHmdResolutionMaxScale;
+	unsigned int mHmdResolutionTargetFrameTime;
 };
 
 } /* namespace Pdraw */
@@ -0,0 +1,394 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Shared memory frame ring reader
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pdraw/pdraw_shm.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#endif
+#define ULOG_TAG pdraw_shmrdr
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_shmrdr);
+
+
+struct pdraw_shm_reader {
+	int fd;
+	uint8_t *map;
+	size_t mapSize;
+	struct pdraw_shm_header *header;
+	uint64_t lastIndex;
+	/* Ring layout validated at creation; the header is writable by
+	 * the writer and is not trusted afterwards */
+	uint32_t slotCount;
+	uint64_t slotOffset;
+	uint64_t slotSize;
+	uint64_t slotDataOffset;
+	uint64_t slotDataSize;
+};
+
+
+static uint64_t get_time(
+	void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000 + (uint64_t)t.tv_nsec / 1000;
+}
+
+
+static struct pdraw_shm_slot *get_slot(
+	struct pdraw_shm_reader *reader,
+	uint32_t slot)
+{
+	return (struct pdraw_shm_slot *)(reader->map +
+		reader->slotOffset + (size_t)slot * reader->slotSize);
+}
+
+
+/* Check that [offset, offset + size) is inside the slot data */
+static int check_range(
+	struct pdraw_shm_reader *reader,
+	uint64_t offset,
+	uint64_t size)
+{
+	return (offset <= reader->slotDataSize) &&
+		(size <= reader->slotDataSize - offset);
+}
+
+
+int pdraw_shm_reader_recv_fd(
+	int sock,
+	int *fd)
+{
+	ssize_t res;
+	char data;
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	if ((sock < 0) || (fd == NULL))
+		return -EINVAL;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &data;
+	iov.iov_len = sizeof(data);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	do {
+		res = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	} while ((res < 0) && (errno == EINTR));
+	if (res < 0) {
+		res = -errno;
+		ULOG_ERRNO("recvmsg", (int)-res);
+		return (int)res;
+	}
+	if (res == 0)
+		return -EPIPE;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if ((cmsg == NULL) || (cmsg->cmsg_level != SOL_SOCKET) ||
+		(cmsg->cmsg_type != SCM_RIGHTS) ||
+		(cmsg->cmsg_len != CMSG_LEN(sizeof(int)))) {
+		ULOGE("no fd received");
+		return -EPROTO;
+	}
+	memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+
+	return 0;
+}
+
+
+int pdraw_shm_reader_new(
+	int fd,
+	struct pdraw_shm_reader **ret_obj)
+{
+	int ret;
+	struct stat st;
+	struct pdraw_shm_reader *reader;
+	struct pdraw_shm_header *header;
+
+	if ((fd < 0) || (ret_obj == NULL))
+		return -EINVAL;
+
+	if (fstat(fd, &st) < 0) {
+		ret = -errno;
+		ULOG_ERRNO("fstat", -ret);
+		return ret;
+	}
+	if ((size_t)st.st_size < sizeof(struct pdraw_shm_header)) {
+		ULOGE("invalid shared memory size (%lld)",
+			(long long)st.st_size);
+		return -EPROTO;
+	}
+
+	reader = (struct pdraw_shm_reader *)calloc(1, sizeof(*reader));
+	if (reader == NULL)
+		return -ENOMEM;
+	reader->fd = fd;
+	reader->mapSize = (size_t)st.st_size;
+
+	/* Read-only mapping, readers cannot corrupt the ring */
+	reader->map = (uint8_t *)mmap(NULL, reader->mapSize, PROT_READ,
+		MAP_SHARED, fd, 0);
+	if (reader->map == MAP_FAILED) {
+		ret = -errno;
+		ULOG_ERRNO("mmap", -ret);
+		free(reader);
+		return ret;
+	}
+	header = (struct pdraw_shm_header *)reader->map;
+	reader->header = header;
+
+	if ((header->magic != PDRAW_SHM_MAGIC) ||
+		(header->version != PDRAW_SHM_VERSION) ||
+		(header->frameStructSize != sizeof(struct pdraw_shm_frame))) {
+		ULOGE("incompatible shared memory ring");
+		ret = -EPROTO;
+		goto error;
+	}
+	reader->slotCount = header->slotCount;
+	reader->slotOffset = header->slotOffset;
+	reader->slotSize = header->slotSize;
+	reader->slotDataOffset = header->slotDataOffset;
+	reader->slotDataSize = header->slotDataSize;
+	if ((reader->slotCount == 0) ||
+		(reader->slotCount > PDRAW_SHM_MAX_SLOT_COUNT) ||
+		(reader->slotSize < sizeof(struct pdraw_shm_slot)) ||
+		(reader->slotSize > reader->mapSize) ||
+		(reader->slotDataOffset < sizeof(struct pdraw_shm_slot)) ||
+		(reader->slotDataOffset > reader->slotSize) ||
+		(reader->slotDataSize >
+			reader->slotSize - reader->slotDataOffset) ||
+		(reader->slotOffset > reader->mapSize) ||
+		(reader->slotCount > (reader->mapSize - reader->slotOffset) /
+			reader->slotSize)) {
+		ULOGE("invalid shared memory ring layout");
+		ret = -EPROTO;
+		goto error;
+	}
+
+	/* Only frames published from now on are waited for */
+	reader->lastIndex = __atomic_load_n(
+		&header->publishCount, __ATOMIC_ACQUIRE);
+
+	*ret_obj = reader;
+	return 0;
+
+error:
+	munmap(reader->map, reader->mapSize);
+	free(reader);
+	return ret;
+}
+
+
+int pdraw_shm_reader_destroy(
+	struct pdraw_shm_reader *reader)
+{
+	if (reader == NULL)
+		return 0;
+
+	munmap(reader->map, reader->mapSize);
+	close(reader->fd);
+	free(reader);
+
+	return 0;
+}
+
+
+int pdraw_shm_reader_wait(
+	struct pdraw_shm_reader *reader,
+	int timeout)
+{
+	uint64_t deadline = 0, now;
+	uint32_t futex;
+	struct pdraw_shm_header *header;
+
+	if (reader == NULL)
+		return -EINVAL;
+	header = reader->header;
+	if (timeout > 0)
+		deadline = get_time() + timeout;
+
+	while (1) {
+		/* Read the futex word first so that a publish between the
+		 * check and the wait is not missed */
+		futex = __atomic_load_n(&header->futex, __ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&header->publishCount, __ATOMIC_ACQUIRE) >
+			reader->lastIndex)
+			return 0;
+		if (__atomic_load_n(&header->writerClosed, __ATOMIC_ACQUIRE))
+			return -EPIPE;
+		if (timeout == 0)
+			return -ETIMEDOUT;
+
+#ifdef __linux__
+		struct timespec ts, *pts = NULL;
+		if (timeout > 0) {
+			now = get_time();
+			if (now >= deadline)
+				return -ETIMEDOUT;
+			ts.tv_sec = (deadline - now) / 1000000;
+			ts.tv_nsec = ((deadline - now) % 1000000) * 1000;
+			pts = &ts;
+		}
+		/* Shared mapping: no FUTEX_PRIVATE_FLAG */
+		if ((syscall(SYS_futex, &header->futex, FUTEX_WAIT, futex,
+			pts, NULL, 0) < 0) && (errno != EAGAIN) &&
+			(errno != EINTR) && (errno != ETIMEDOUT)) {
+			int ret = -errno;
+			ULOG_ERRNO("futex", -ret);
+			return ret;
+		}
+#else
+		(void)futex;
+		now = get_time();
+		if ((timeout > 0) && (now >= deadline))
+			return -ETIMEDOUT;
+		usleep(1000);
+#endif
+	}
+}
+
+
+int pdraw_shm_reader_get_frame(
+	struct pdraw_shm_reader *reader,
+	struct pdraw_video_frame *frame,
+	struct pdraw_shm_frame_ref *ref)
+{
+	unsigned int i, retry;
+	uint64_t count, seq;
+	uint32_t slotIndex;
+	struct pdraw_shm_slot *slot;
+	struct pdraw_shm_frame f;
+	const uint8_t *data;
+
+	if ((reader == NULL) || (frame == NULL) || (ref == NULL))
+		return -EINVAL;
+
+	/* The writer may lap the reader: retry on the new last frame */
+	for (retry = 0; retry < 3; retry++) {
+		count = __atomic_load_n(
+			&reader->header->publishCount, __ATOMIC_ACQUIRE);
+		if (count == 0)
+			return -ENOENT;
+		slotIndex = (uint32_t)((count - 1) % reader->slotCount);
+		slot = get_slot(reader, slotIndex);
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+		memcpy(&f, &slot->frame, sizeof(f));
+		reader->lastIndex = slot->index + 1;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+	if (retry == 3)
+		return -EAGAIN;
+
+	/* Reject offsets and sizes pointing outside of the slot data */
+	for (i = 0; i < 3; i++) {
+		uint64_t planeSize = (uint64_t)f.stride[i] * ((i == 0) ?
+			f.height : ((uint64_t)f.height + 1) / 2);
+		if ((f.stride[i] > 0) &&
+			(!check_range(reader, f.planeOffset[i], planeSize))) {
+			ULOGE("invalid plane %u in slot %u", i, slotIndex);
+			return -EPROTO;
+		}
+	}
+	if ((f.userDataSize > 0) &&
+		(!check_range(reader, f.userDataOffset, f.userDataSize))) {
+		ULOGE("invalid user data in slot %u", slotIndex);
+		return -EPROTO;
+	}
+
+	data = (const uint8_t *)slot + reader->slotDataOffset;
+	memset(frame, 0, sizeof(*frame));
+	frame->colorFormat = (enum pdraw_color_format)f.colorFormat;
+	for (i = 0; i < 3; i++) {
+		frame->plane[i] = (f.stride[i] > 0) ?
+			data + f.planeOffset[i] : NULL;
+		frame->stride[i] = f.stride[i];
+	}
+	frame->width = f.width;
+	frame->height = f.height;
+	frame->sarWidth = f.sarWidth;
+	frame->sarHeight = f.sarHeight;
+	frame->isComplete = f.isComplete;
+	frame->hasErrors = f.hasErrors;
+	frame->isRef = f.isRef;
+	frame->sequenceNumber = f.sequenceNumber;
+	frame->auNtpTimestamp = f.auNtpTimestamp;
+	frame->auNtpTimestampRaw = f.auNtpTimestampRaw;
+	frame->auNtpTimestampLocal = f.auNtpTimestampLocal;
+	frame->hasMetadata = f.hasMetadata;
+	memcpy(&frame->metadata, &f.metadata, sizeof(frame->metadata));
+	frame->userData = (f.userDataSize > 0) ?
+		data + f.userDataOffset : NULL;
+	frame->userDataSize = f.userDataSize;
+
+	ref->slot = slotIndex;
+	ref->seq = seq;
+
+	return 0;
+}
+
+
+int pdraw_shm_reader_release_frame(
+	struct pdraw_shm_reader *reader,
+	const struct pdraw_shm_frame_ref *ref)
+{
+	struct pdraw_shm_slot *slot;
+
+	if ((reader == NULL) || (ref == NULL) ||
+		(ref->slot >= reader->slotCount))
+		return -EINVAL;
+
+	slot = get_slot(reader, ref->slot);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != ref->seq)
+		return -EAGAIN;
+
+	return 0;
+}
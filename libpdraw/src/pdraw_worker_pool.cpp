@@ -0,0 +1,326 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Worker thread pool
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pdraw_worker_pool.hpp"
+#include <errno.h>
+#include <unistd.h>
+#define ULOG_TAG pdraw_wrkpool
+#include <ulog.h>
+ULOG_DECLARE_TAG(pdraw_wrkpool);
+
+namespace Pdraw {
+
+
+pthread_mutex_t WorkerPool::sMutex = PTHREAD_MUTEX_INITIALIZER;
+WorkerPool *WorkerPool::sPool = NULL;
+unsigned int WorkerPool::sRefCount = 0;
+
+
+WorkerPool *WorkerPool::get(
+	void)
+{
+	WorkerPool *pool;
+
+	pthread_mutex_lock(&sMutex);
+	if (sPool == NULL) {
+		long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+		unsigned int threadCount = (cpuCount > 0) ?
+			(unsigned int)cpuCount : 1;
+		if (threadCount > WORKER_POOL_MAX_THREADS)
+			threadCount = WORKER_POOL_MAX_THREADS;
+		sPool = new WorkerPool(threadCount);
+		if ((sPool != NULL) && (sPool->getThreadCount() == 0)) {
+			ULOGE("failed to start the worker pool");
+			delete sPool;
+			sPool = NULL;
+		}
+	}
+	if (sPool != NULL)
+		sRefCount++;
+	pool = sPool;
+	pthread_mutex_unlock(&sMutex);
+
+	return pool;
+}
+
+
+void WorkerPool::put(
+	WorkerPool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&sMutex);
+	if ((pool == sPool) && (sRefCount > 0)) {
+		sRefCount--;
+		if (sRefCount == 0) {
+			delete sPool;
+			sPool = NULL;
+		}
+	}
+	pthread_mutex_unlock(&sMutex);
+}
+
+
+WorkerPool::WorkerPool(
+	unsigned int threadCount)
+{
+	int ret;
+	unsigned int i;
+
+	mNextWorker = 0;
+	mThreadShouldStop = false;
+
+	ret = pthread_mutex_init(&mMutex, NULL);
+	if (ret != 0) {
+		ULOG_ERRNO("pthread_mutex_init", ret);
+		return;
+	}
+
+	for (i = 0; i < threadCount; i++) {
+		struct worker_pool_worker *worker =
+			new struct worker_pool_worker;
+		if (worker == NULL) {
+			ULOG_ERRNO("worker allocation failed", ENOMEM);
+			break;
+		}
+		worker->pool = this;
+		worker->index = i;
+		worker->threadLaunched = false;
+		worker->idle = false;
+		worker->wake = false;
+		worker->stop = false;
+		ret = pthread_mutex_init(&worker->mutex, NULL);
+		if (ret != 0) {
+			ULOG_ERRNO("pthread_mutex_init", ret);
+			delete worker;
+			break;
+		}
+		ret = pthread_cond_init(&worker->cond, NULL);
+		if (ret != 0) {
+			ULOG_ERRNO("pthread_cond_init", ret);
+			pthread_mutex_destroy(&worker->mutex);
+			delete worker;
+			break;
+		}
+		mWorkers.push_back(worker);
+	}
+
+	/* Launch the threads once all the task queues exist */
+	std::vector<struct worker_pool_worker *>::iterator w =
+		mWorkers.begin();
+	while (w != mWorkers.end()) {
+		ret = pthread_create(&(*w)->thread, NULL, runThread,
+			(void *)*w);
+		if (ret != 0)
+			ULOG_ERRNO("pthread_create", ret);
+		else
+			(*w)->threadLaunched = true;
+		w++;
+	}
+
+	ULOGI("worker pool started with %zu threads", mWorkers.size());
+}
+
+
+WorkerPool::~WorkerPool(
+	void)
+{
+	int ret;
+
+	pthread_mutex_lock(&mMutex);
+	mThreadShouldStop = true;
+	pthread_mutex_unlock(&mMutex);
+
+	std::vector<struct worker_pool_worker *>::iterator w =
+		mWorkers.begin();
+	while (w != mWorkers.end()) {
+		pthread_mutex_lock(&(*w)->mutex);
+		(*w)->stop = true;
+		pthread_cond_signal(&(*w)->cond);
+		pthread_mutex_unlock(&(*w)->mutex);
+		w++;
+	}
+
+	w = mWorkers.begin();
+	while (w != mWorkers.end()) {
+		if ((*w)->threadLaunched) {
+			ret = pthread_join((*w)->thread, NULL);
+			if (ret != 0)
+				ULOG_ERRNO("pthread_join", ret);
+		}
+		if (!(*w)->tasks.empty()) {
+			ULOGW("worker %u: %zu tasks not run",
+				(*w)->index, (*w)->tasks.size());
+		}
+		pthread_cond_destroy(&(*w)->cond);
+		pthread_mutex_destroy(&(*w)->mutex);
+		delete *w;
+		w++;
+	}
+	mWorkers.clear();
+
+	pthread_mutex_destroy(&mMutex);
+}
+
+
+int WorkerPool::submit(
+	worker_pool_task_func_t func,
+	void *userdata)
+{
+	struct worker_pool_task task;
+	struct worker_pool_worker *worker;
+	bool woken = false;
+	unsigned int i, count = mWorkers.size();
+
+	if (func == NULL)
+		return -EINVAL;
+	if (mWorkers.empty())
+		return -EPROTO;
+
+	task.func = func;
+	task.userdata = userdata;
+
+	pthread_mutex_lock(&mMutex);
+	if (mThreadShouldStop) {
+		pthread_mutex_unlock(&mMutex);
+		return -EPROTO;
+	}
+	worker = mWorkers[mNextWorker];
+	mNextWorker = (mNextWorker + 1) % count;
+	pthread_mutex_unlock(&mMutex);
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->tasks.push_back(task);
+	if (worker->idle) {
+		worker->wake = true;
+		pthread_cond_signal(&worker->cond);
+		woken = true;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+
+	/* The worker is busy: wake an idle worker to steal the task; a
+	 * worker marks itself idle before its last scan of the queues,
+	 * so it either sees the task or is woken here */
+	for (i = 1; (i < count) && (!woken); i++) {
+		struct worker_pool_worker *w =
+			mWorkers[(worker->index + i) % count];
+		pthread_mutex_lock(&w->mutex);
+		if ((w->idle) && (!w->wake)) {
+			w->wake = true;
+			pthread_cond_signal(&w->cond);
+			woken = true;
+		}
+		pthread_mutex_unlock(&w->mutex);
+	}
+
+	return 0;
+}
+
+
+bool WorkerPool::takeTask(
+	struct worker_pool_worker *worker,
+	struct worker_pool_task *task)
+{
+	unsigned int i, count = mWorkers.size();
+
+	/* Own queue first, then steal from the others */
+	for (i = 0; i < count; i++) {
+		struct worker_pool_worker *w =
+			mWorkers[(worker->index + i) % count];
+		pthread_mutex_lock(&w->mutex);
+		if (!w->tasks.empty()) {
+			*task = w->tasks.front();
+			w->tasks.pop_front();
+			pthread_mutex_unlock(&w->mutex);
+			return true;
+		}
+		pthread_mutex_unlock(&w->mutex);
+	}
+
+	return false;
+}
+
+
+/* Returns false when the pool is stopping */
+bool WorkerPool::waitTask(
+	struct worker_pool_worker *worker)
+{
+	struct worker_pool_task task;
+	bool stop;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->idle = true;
+	worker->wake = false;
+	pthread_mutex_unlock(&worker->mutex);
+
+	/* Last scan now that submitters can see this worker as idle */
+	if (takeTask(worker, &task)) {
+		pthread_mutex_lock(&worker->mutex);
+		worker->idle = false;
+		pthread_mutex_unlock(&worker->mutex);
+		task.func(task.userdata);
+		return true;
+	}
+
+	pthread_mutex_lock(&worker->mutex);
+	while ((!worker->wake) && (worker->tasks.empty()) &&
+		(!worker->stop))
+		pthread_cond_wait(&worker->cond, &worker->mutex);
+	worker->idle = false;
+	stop = worker->stop;
+	pthread_mutex_unlock(&worker->mutex);
+
+	return !stop;
+}
+
+
+void *WorkerPool::runThread(
+	void *ptr)
+{
+	struct worker_pool_worker *worker = (struct worker_pool_worker *)ptr;
+	WorkerPool *pool = worker->pool;
+	struct worker_pool_task task;
+	bool stopping = false;
+
+	while (1) {
+		if (pool->takeTask(worker, &task)) {
+			task.func(task.userdata);
+			continue;
+		}
+		/* Run the remaining tasks before stopping */
+		if (stopping)
+			break;
+		stopping = !pool->waitTask(worker);
+	}
+
+	return NULL;
+}
+
+} /* namespace Pdraw */
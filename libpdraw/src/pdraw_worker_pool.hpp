@@ -0,0 +1,125 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Worker thread pool
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PDRAW_WORKER_POOL_HPP_
+#define _PDRAW_WORKER_POOL_HPP_
+
+#include <pthread.h>
+#include <vector>
+#include <deque>
+
+namespace Pdraw {
+
+
+#define WORKER_POOL_MAX_THREADS (8)
+
+
+typedef void (*worker_pool_task_func_t)(
+	void *userdata);
+
+
+struct worker_pool_task {
+	worker_pool_task_func_t func;
+	void *userdata;
+};
+
+
+class WorkerPool;
+
+
+struct worker_pool_worker {
+	WorkerPool *pool;
+	unsigned int index;
+	pthread_t thread;
+	bool threadLaunched;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	std::deque<struct worker_pool_task> tasks;
+	/* Set when the worker found no task and is about to wait */
+	bool idle;
+	/* Set to make an idle worker scan the queues again */
+	bool wake;
+	bool stop;
+};
+
+
+/**
+ * Process-wide pool of worker threads shared by all sessions; each
+ * worker has its own task queue and idle workers steal tasks from the
+ * other queues before blocking on their own queue. Tasks submitted to
+ * the pool can run concurrently, the caller is responsible for
+ * serializing dependent tasks.
+ */
+class WorkerPool {
+public:
+	static WorkerPool *get(
+		void);
+
+	static void put(
+		WorkerPool *pool);
+
+	int submit(
+		worker_pool_task_func_t func,
+		void *userdata);
+
+	unsigned int getThreadCount(
+		void) {
+		return mWorkers.size();
+	}
+
+private:
+	WorkerPool(
+		unsigned int threadCount);
+
+	~WorkerPool(
+		void);
+
+	bool takeTask(
+		struct worker_pool_worker *worker,
+		struct worker_pool_task *task);
+
+	bool waitTask(
+		struct worker_pool_worker *worker);
+
+	static void *runThread(
+		void *ptr);
+
+	static pthread_mutex_t sMutex;
+	static WorkerPool *sPool;
+	static unsigned int sRefCount;
+
+	std::vector<struct worker_pool_worker *> mWorkers;
+	pthread_mutex_t mMutex;
+	unsigned int mNextWorker;
+	bool mThreadShouldStop;
+};
+
+} /* namespace Pdraw */
+
+#endif /* !_PDRAW_WORKER_POOL_HPP_ */
@@ -483,6 +483,37 @@ int pdraw_start_video_renderer_egl(
 }
 
 
+int pdraw_start_software_video_renderer(
+	struct pdraw *pdraw,
+	unsigned int width,
+	unsigned int height,
+	int enableHud)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->startSoftwareVideoRenderer(width, height,
+		(enableHud) ? true : false);
+}
+
+
+int pdraw_start_offscreen_video_renderer(
+	struct pdraw *pdraw,
+	unsigned int width,
+	unsigned int height,
+	enum pdraw_color_format format,
+	int enableHud,
+	pdraw_offscreen_frame_callback_t cb,
+	void *userPtr)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->startOffscreenVideoRenderer(width, height,
+		format, (enableHud) ? true : false, cb, userPtr);
+}
+
+
 int pdraw_stop_video_renderer(
 	struct pdraw *pdraw)
 {
@@ -509,6 +540,41 @@ int pdraw_render_video(
 }
 
 
+int pdraw_render_video_if_needed(
+	struct pdraw *pdraw,
+	int renderX,
+	int renderY,
+	unsigned int renderWidth,
+	unsigned int renderHeight,
+	uint64_t timestamp,
+	int forceRedraw)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->renderVideoIfNeeded(renderX, renderY,
+		renderWidth, renderHeight, timestamp,
+		(forceRedraw) ? true : false);
+}
+
+
+int pdraw_render_video_to_buffer(
+	struct pdraw *pdraw,
+	uint8_t *buffer,
+	size_t size,
+	unsigned int stride,
+	enum pdraw_color_format format,
+	uint64_t timestamp,
+	int forceRedraw)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->renderVideoToBuffer(buffer, size, stride,
+		format, timestamp, (forceRedraw) ? true : false);
+}
+
+
 enum pdraw_session_type pdraw_get_session_type(
 	struct pdraw *pdraw)
 {
@@ -1090,7 +1156,21 @@ void *pdraw_add_video_frame_filter_callback(
 		return NULL;
 
 	return pdraw->pdraw->addVideoFrameFilterCallback(
-		mediaId, cb, userPtr);
+		mediaId, cb, userPtr, false);
+}
+
+
+void *pdraw_add_parallel_video_frame_filter_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	pdraw_video_frame_filter_callback_t cb,
+	void *userPtr)
+{
+	if (pdraw == NULL)
+		return NULL;
+
+	return pdraw->pdraw->addVideoFrameFilterCallback(
+		mediaId, cb, userPtr, true);
 }
 
 
@@ -1116,7 +1196,20 @@ void *pdraw_add_video_frame_producer(
 		return NULL;
 
 	return pdraw->pdraw->addVideoFrameProducer(
-		mediaId, (frameByFrame) ? true : false);
+		mediaId, (frameByFrame) ? true : false, false);
+}
+
+
+void *pdraw_add_video_frame_copy_producer(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	int frameByFrame)
+{
+	if (pdraw == NULL)
+		return NULL;
+
+	return pdraw->pdraw->addVideoFrameProducer(
+		mediaId, (frameByFrame) ? true : false, true);
 }
 
 
@@ -1145,6 +1238,296 @@ int pdraw_get_producer_last_frame(
 }
 
 
+int pdraw_get_producer_last_frame_ref(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	struct pdraw_video_frame *frame,
+	void **frameRef,
+	int timeout)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getProducerLastFrameRef(
+		producerCtx, frame, frameRef, timeout);
+}
+
+
+int pdraw_release_producer_frame(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	void *frameRef)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->releaseProducerFrame(
+		producerCtx, frameRef);
+}
+
+
+int pdraw_get_producer_event_fd(
+	struct pdraw *pdraw,
+	void *producerCtx)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getProducerEventFd(producerCtx);
+}
+
+
+void *pdraw_add_video_frame_export(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	unsigned int slotCount,
+	size_t slotSize)
+{
+	if (pdraw == NULL)
+		return NULL;
+
+	return pdraw->pdraw->addVideoFrameExport(mediaId, slotCount, slotSize);
+}
+
+
+int pdraw_remove_video_frame_export(
+	struct pdraw *pdraw,
+	void *exportCtx)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->removeVideoFrameExport(exportCtx);
+}
+
+
+int pdraw_get_video_frame_export_fd(
+	struct pdraw *pdraw,
+	void *exportCtx)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoFrameExportFd(exportCtx);
+}
+
+
+int pdraw_send_video_frame_export_fd(
+	struct pdraw *pdraw,
+	void *exportCtx,
+	int sock)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->sendVideoFrameExportFd(exportCtx, sock);
+}
+
+
+void *pdraw_add_video_frame_metadata_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	pdraw_video_frame_metadata_callback_t cb,
+	void *userPtr,
+	enum pdraw_video_frame_metadata_source source)
+{
+	if (pdraw == NULL)
+		return NULL;
+
+	return pdraw->pdraw->addVideoFrameMetadataCallback(
+		mediaId, cb, userPtr, source);
+}
+
+
+int pdraw_remove_video_frame_metadata_callback(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	void *metadataCtx)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->removeVideoFrameMetadataCallback(
+		mediaId, metadataCtx);
+}
+
+
+void *pdraw_add_video_frame_batch_producer(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	const struct pdraw_video_frame_batch_settings *settings,
+	pdraw_video_frame_batch_callback_t cb,
+	void *userPtr)
+{
+	if (pdraw == NULL)
+		return NULL;
+
+	return pdraw->pdraw->addVideoFrameBatchProducer(
+		mediaId, settings, cb, userPtr);
+}
+
+
+int pdraw_remove_video_frame_batch_producer(
+	struct pdraw *pdraw,
+	void *batchCtx)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->removeVideoFrameBatchProducer(batchCtx);
+}
+
+
+int pdraw_get_video_frame_batch_settings(
+	struct pdraw *pdraw,
+	void *batchCtx,
+	struct pdraw_video_frame_batch_settings *settings)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoFrameBatchSettings(batchCtx, settings);
+}
+
+
+int pdraw_get_producer_ring_settings(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy *policy,
+	unsigned int *depth)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getProducerRingSettings(
+		producerCtx, policy, depth);
+}
+
+
+int pdraw_set_producer_ring_settings(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	enum pdraw_video_frame_producer_policy policy,
+	unsigned int depth)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->setProducerRingSettings(
+		producerCtx, policy, depth);
+}
+
+
+int pdraw_get_producer_stats(
+	struct pdraw *pdraw,
+	void *producerCtx,
+	struct pdraw_video_frame_producer_stats *stats)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getProducerStats(producerCtx, stats);
+}
+
+
+int pdraw_get_video_frame_filter_stats(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	struct pdraw_video_frame_filter_stats *stats)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoFrameFilterStats(filterCtx, stats);
+}
+
+
+int pdraw_get_video_frame_filter_output_format(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	enum pdraw_color_format *format)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoFrameFilterOutputFormat(
+		filterCtx, format);
+}
+
+
+int pdraw_set_video_frame_filter_output_format(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	enum pdraw_color_format format)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->setVideoFrameFilterOutputFormat(
+		filterCtx, format);
+}
+
+
+int pdraw_get_video_frame_filter_scaling(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	struct pdraw_video_frame_filter_scaling *scaling)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoFrameFilterScaling(filterCtx, scaling);
+}
+
+
+int pdraw_set_video_frame_filter_scaling(
+	struct pdraw *pdraw,
+	void *filterCtx,
+	const struct pdraw_video_frame_filter_scaling *scaling)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->setVideoFrameFilterScaling(filterCtx, scaling);
+}
+
+
+int pdraw_get_video_decoder_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_decoder_stats *stats)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoDecoderStats(mediaId, stats);
+}
+
+
+int pdraw_get_video_decoder_output_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_decoder_output_stats *stats)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoDecoderOutputStats(mediaId, stats);
+}
+
+
+int pdraw_get_video_renderer_stats(
+	struct pdraw *pdraw,
+	unsigned int mediaId,
+	struct pdraw_video_renderer_stats *stats)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getVideoRendererStats(mediaId, stats);
+}
+
+
 float pdraw_get_controller_radar_angle_setting(
 	struct pdraw *pdraw)
 {
@@ -1229,6 +1612,130 @@ int pdraw_set_hmd_distorsion_correction_settings(
 }
 
 
+int pdraw_get_decoder_drop_settings(
+	struct pdraw *pdraw,
+	enum pdraw_decoder_drop_policy *policy,
+	unsigned int *maxBacklog)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->getDecoderDropSettings(policy, maxBacklog);
+	return 0;
+}
+
+
+int pdraw_set_decoder_drop_settings(
+	struct pdraw *pdraw,
+	enum pdraw_decoder_drop_policy policy,
+	unsigned int maxBacklog)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->setDecoderDropSettings(policy, maxBacklog);
+	return 0;
+}
+
+
+int pdraw_get_warm_pool_setting(
+	struct pdraw *pdraw)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return (pdraw->pdraw->getWarmPoolSetting()) ? 1 : 0;
+}
+
+
+int pdraw_set_warm_pool_setting(
+	struct pdraw *pdraw,
+	int enable)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->setWarmPoolSetting((enable) ? true : false);
+	return 0;
+}
+
+
+int pdraw_get_decoder_output_settings(
+	struct pdraw *pdraw,
+	unsigned int *sinkMaxFrames,
+	unsigned int *leakTimeout)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->getDecoderOutputSettings(sinkMaxFrames, leakTimeout);
+	return 0;
+}
+
+
+int pdraw_set_decoder_output_settings(
+	struct pdraw *pdraw,
+	unsigned int sinkMaxFrames,
+	unsigned int leakTimeout)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->setDecoderOutputSettings(sinkMaxFrames, leakTimeout);
+	return 0;
+}
+
+
+enum pdraw_video_renderer_layout pdraw_get_video_renderer_layout_setting(
+	struct pdraw *pdraw)
+{
+	if (pdraw == NULL)
+		return (enum pdraw_video_renderer_layout)-EINVAL;
+
+	return pdraw->pdraw->getVideoRendererLayoutSetting();
+}
+
+
+int pdraw_set_video_renderer_layout_setting(
+	struct pdraw *pdraw,
+	enum pdraw_video_renderer_layout layout)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	pdraw->pdraw->setVideoRendererLayoutSetting(layout);
+	return 0;
+}
+
+
+int pdraw_get_hmd_resolution_settings(
+	struct pdraw *pdraw,
+	float *minScale,
+	float *maxScale,
+	unsigned int *targetFrameTime)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->getHmdResolutionSettings(minScale, maxScale,
+		targetFrameTime);
+}
+
+
+int pdraw_set_hmd_resolution_settings(
+	struct pdraw *pdraw,
+	float minScale,
+	float maxScale,
+	unsigned int targetFrameTime)
+{
+	if (pdraw == NULL)
+		return -EINVAL;
+
+	return pdraw->pdraw->setHmdResolutionSettings(minScale, maxScale,
+		targetFrameTime);
+}
+
+
 int pdraw_set_jni_env(
 	struct pdraw *pdraw,
 	void *jniEnv)
@@ -0,0 +1,365 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Producer frame reference accounting test
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <pdraw/pdraw.h>
+
+
+#define TEST_SINK_MAX_FRAMES (3)
+#define TEST_LEAK_TIMEOUT (200000)
+#define TEST_RESPONSE_TIMEOUT (5000000)
+#define TEST_FRAME_TIMEOUT (1000000)
+
+
+#define TEST_CHECK(_cond) \
+	do { \
+		if (!(_cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", \
+				__func__, __LINE__, #_cond); \
+			return -EPROTO; \
+		} \
+	} while (0)
+
+
+struct test_ctx {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool openDone;
+	bool closeDone;
+	int status;
+	struct pdraw *pdraw;
+	unsigned int mediaId;
+	void *producer;
+	void *frameRefs[TEST_SINK_MAX_FRAMES];
+	unsigned int frameRefCount;
+};
+
+
+static void openResp(
+	struct pdraw * /* pdraw */,
+	int status,
+	void *userdata)
+{
+	struct test_ctx *ctx = (struct test_ctx *)userdata;
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->openDone = true;
+	ctx->status = status;
+	pthread_cond_signal(&ctx->cond);
+	pthread_mutex_unlock(&ctx->mutex);
+}
+
+
+static void closeResp(
+	struct pdraw * /* pdraw */,
+	int status,
+	void *userdata)
+{
+	struct test_ctx *ctx = (struct test_ctx *)userdata;
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->closeDone = true;
+	ctx->status = status;
+	pthread_cond_signal(&ctx->cond);
+	pthread_mutex_unlock(&ctx->mutex);
+}
+
+
+static int waitResponse(
+	struct test_ctx *ctx,
+	bool *done)
+{
+	int ret = 0;
+	struct timespec ts;
+	uint64_t deadline;
+
+	/* The condition variable uses the realtime clock */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	deadline = (uint64_t)ts.tv_sec * 1000000 +
+		(uint64_t)ts.tv_nsec / 1000 + TEST_RESPONSE_TIMEOUT;
+	ts.tv_sec = deadline / 1000000;
+	ts.tv_nsec = (deadline % 1000000) * 1000;
+
+	pthread_mutex_lock(&ctx->mutex);
+	while ((!*done) && (ret == 0))
+		ret = -pthread_cond_timedwait(&ctx->cond, &ctx->mutex, &ts);
+	if (ret == 0)
+		ret = ctx->status;
+	*done = false;
+	pthread_mutex_unlock(&ctx->mutex);
+
+	return ret;
+}
+
+
+static int getSinkStats(
+	struct test_ctx *ctx,
+	struct pdraw_video_decoder_sink_stats *stats)
+{
+	int ret;
+	struct pdraw_video_decoder_output_stats output;
+
+	ret = pdraw_get_video_decoder_output_stats(ctx->pdraw,
+		ctx->mediaId, &output);
+	if (ret < 0)
+		return ret;
+
+	/* No renderer: the producer is the only sink */
+	TEST_CHECK(output.sinkCount == 1);
+	TEST_CHECK(output.sinkMaxFrames == TEST_SINK_MAX_FRAMES);
+	*stats = output.sink[0];
+	return 0;
+}
+
+
+static int startProducer(
+	struct test_ctx *ctx,
+	const char *url)
+{
+	int ret, count, i;
+	struct pdraw_media_info info;
+	bool found = false;
+
+	ret = pdraw_open_url(ctx->pdraw, url);
+	if (ret < 0)
+		return ret;
+	ret = waitResponse(ctx, &ctx->openDone);
+	if (ret < 0)
+		return ret;
+
+	count = pdraw_get_media_count(ctx->pdraw);
+	for (i = 0; (i < count) && (!found); i++) {
+		ret = pdraw_get_media_info(ctx->pdraw, i, &info);
+		if ((ret == 0) && (info.type == PDRAW_MEDIA_TYPE_VIDEO)) {
+			ctx->mediaId = info.id;
+			found = true;
+		}
+	}
+	TEST_CHECK(found);
+
+	/* Zero-copy producer: the frame references point into the
+	 * decoder output buffers */
+	ctx->producer = pdraw_add_video_frame_producer(ctx->pdraw,
+		ctx->mediaId, 0);
+	TEST_CHECK(ctx->producer != NULL);
+
+	return pdraw_play(ctx->pdraw);
+}
+
+
+static int testSinkCap(
+	struct test_ctx *ctx)
+{
+	int ret;
+	struct pdraw_video_frame frame;
+	struct pdraw_video_decoder_sink_stats stats;
+
+	/* Hold the frames in the application until the decoder stops
+	 * pushing new frames to the producer */
+	while (ctx->frameRefCount < TEST_SINK_MAX_FRAMES) {
+		ret = pdraw_get_producer_last_frame_ref(ctx->pdraw,
+			ctx->producer, &frame,
+			&ctx->frameRefs[ctx->frameRefCount],
+			TEST_FRAME_TIMEOUT);
+		if (ret == -ENOENT)
+			break;
+		TEST_CHECK(ret == 0);
+		ctx->frameRefCount++;
+	}
+	TEST_CHECK(ctx->frameRefCount == TEST_SINK_MAX_FRAMES);
+
+	/* The frames held by the application count against the cap */
+	usleep(TEST_FRAME_TIMEOUT / 2);
+	ret = getSinkStats(ctx, &stats);
+	if (ret < 0)
+		return ret;
+	TEST_CHECK(stats.heldFrameCount == TEST_SINK_MAX_FRAMES);
+	TEST_CHECK(stats.droppedFrameCount > 0);
+
+	return 0;
+}
+
+
+static int testLeakWarning(
+	struct test_ctx *ctx)
+{
+	int ret;
+	struct pdraw_video_decoder_sink_stats stats;
+
+	/* The decoder keeps outputting frames (dropped for this sink),
+	 * each output checks the hold time of the frames held */
+	usleep(2 * TEST_LEAK_TIMEOUT);
+	ret = getSinkStats(ctx, &stats);
+	if (ret < 0)
+		return ret;
+	TEST_CHECK(stats.leakCount >= ctx->frameRefCount);
+
+	return 0;
+}
+
+
+static int testRelease(
+	struct test_ctx *ctx)
+{
+	int ret;
+	unsigned int i;
+	struct pdraw_video_decoder_sink_stats before, after;
+
+	ret = getSinkStats(ctx, &before);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < ctx->frameRefCount; i++) {
+		ret = pdraw_release_producer_frame(ctx->pdraw,
+			ctx->producer, ctx->frameRefs[i]);
+		TEST_CHECK(ret == 0);
+	}
+
+	/* Releasing a frame twice is rejected */
+	if (ctx->frameRefCount > 0) {
+		ret = pdraw_release_producer_frame(ctx->pdraw,
+			ctx->producer, ctx->frameRefs[0]);
+		TEST_CHECK(ret == -ENOENT);
+	}
+
+	ret = getSinkStats(ctx, &after);
+	if (ret < 0)
+		return ret;
+	TEST_CHECK(after.releasedFrameCount >=
+		before.releasedFrameCount + ctx->frameRefCount);
+	TEST_CHECK(after.maxHoldTime >= TEST_LEAK_TIMEOUT);
+	ctx->frameRefCount = 0;
+
+	/* Frames are pushed to the producer again */
+	usleep(TEST_FRAME_TIMEOUT / 2);
+	ret = getSinkStats(ctx, &after);
+	if (ret < 0)
+		return ret;
+	TEST_CHECK(after.pushedFrameCount > before.pushedFrameCount);
+
+	return 0;
+}
+
+
+static void stopProducer(
+	struct test_ctx *ctx)
+{
+	int ret;
+	unsigned int i;
+
+	for (i = 0; i < ctx->frameRefCount; i++) {
+		pdraw_release_producer_frame(ctx->pdraw, ctx->producer,
+			ctx->frameRefs[i]);
+	}
+	ctx->frameRefCount = 0;
+	if (ctx->producer != NULL) {
+		pdraw_remove_video_frame_producer(ctx->pdraw, ctx->producer);
+		ctx->producer = NULL;
+	}
+	ret = pdraw_close(ctx->pdraw);
+	if (ret == 0)
+		waitResponse(ctx, &ctx->closeDone);
+}
+
+
+int main(
+	int argc,
+	char **argv)
+{
+	int ret, status = EXIT_SUCCESS;
+	unsigned int i;
+	struct test_ctx ctx;
+	struct pdraw_cbs cbs;
+	const struct {
+		const char *name;
+		int (*func)(struct test_ctx *ctx);
+	} tests[] = {
+		{"sink cap", &testSinkCap},
+		{"leak warning", &testLeakWarning},
+		{"release", &testRelease},
+	};
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <url>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	pthread_mutex_init(&ctx.mutex, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.open_resp = &openResp;
+	cbs.close_resp = &closeResp;
+
+	ret = pdraw_new(NULL, &cbs, &ctx, &ctx.pdraw);
+	if (ret < 0) {
+		fprintf(stderr, "pdraw_new: %s\n", strerror(-ret));
+		status = EXIT_FAILURE;
+		goto out;
+	}
+	ret = pdraw_set_decoder_output_settings(ctx.pdraw,
+		TEST_SINK_MAX_FRAMES, TEST_LEAK_TIMEOUT);
+	if (ret < 0) {
+		status = EXIT_FAILURE;
+		goto out;
+	}
+
+	ret = startProducer(&ctx, argv[1]);
+	if (ret < 0) {
+		fprintf(stderr, "failed to start: %s\n", strerror(-ret));
+		status = EXIT_FAILURE;
+		goto out;
+	}
+
+	/* The tests run in sequence on the same producer */
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (tests[i].func(&ctx) == 0) {
+			printf("%-20s OK\n", tests[i].name);
+		} else {
+			printf("%-20s FAILED\n", tests[i].name);
+			status = EXIT_FAILURE;
+			break;
+		}
+	}
+
+out:
+	if (ctx.pdraw != NULL) {
+		stopProducer(&ctx);
+		pdraw_destroy(ctx.pdraw);
+	}
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.mutex);
+	return status;
+}
@@ -0,0 +1,293 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Frame scheduler unit test
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "pdraw_frame_scheduler.hpp"
+
+using namespace Pdraw;
+
+
+#define TEST_FRAME_PERIOD (33333)
+#define TEST_DISPLAY_PERIOD (16667)
+#define TEST_TRANSIT (50000)
+#define TEST_BUFFER_COUNT (4)
+
+
+#define TEST_CHECK(_cond) \
+	do { \
+		if (!(_cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", \
+				__func__, __LINE__, #_cond); \
+			return -EPROTO; \
+		} \
+	} while (0)
+
+
+/* The scheduler never dereferences the buffers */
+static char sBuffers[TEST_BUFFER_COUNT];
+
+
+static struct vbuf_buffer *testBuffer(
+	unsigned int index)
+{
+	return (struct vbuf_buffer *)&sBuffers[index % TEST_BUFFER_COUNT];
+}
+
+
+/* Push a frame and display it at the first vsync it is due at */
+static int pushAndDisplay(
+	FrameScheduler *scheduler,
+	uint64_t timestamp,
+	uint64_t availableTime,
+	uint64_t *vsync)
+{
+	struct vbuf_buffer *buffer;
+	unsigned int i;
+
+	buffer = scheduler->push(testBuffer(0), timestamp, availableTime);
+	if (buffer != NULL)
+		return -EPROTO;
+	while (*vsync < availableTime)
+		*vsync += TEST_DISPLAY_PERIOD;
+	for (i = 0; i < FRAME_SCHEDULER_MAX_DELAY / TEST_DISPLAY_PERIOD + 2;
+		i++) {
+		buffer = scheduler->pop(*vsync, TEST_DISPLAY_PERIOD, true);
+		*vsync += TEST_DISPLAY_PERIOD;
+		if (buffer != NULL)
+			return 0;
+	}
+	return -ETIMEDOUT;
+}
+
+
+static int testConstantTransit(
+	void)
+{
+	FrameScheduler scheduler;
+	struct pdraw_video_renderer_stats stats;
+	uint64_t ts, vsync = 0;
+	unsigned int i;
+
+	for (i = 1; i <= 100; i++) {
+		ts = (uint64_t)i * TEST_FRAME_PERIOD;
+		TEST_CHECK(pushAndDisplay(&scheduler, ts,
+			ts + TEST_TRANSIT, &vsync) == 0);
+	}
+	scheduler.getStats(&stats);
+	TEST_CHECK(stats.receivedFrameCount == 100);
+	TEST_CHECK(stats.displayedFrameCount == 100);
+	TEST_CHECK(stats.droppedFrameCount == 0);
+	TEST_CHECK(stats.lateFrameCount == 0);
+	TEST_CHECK(stats.playoutDelay == 0);
+	TEST_CHECK(scheduler.flush() == NULL);
+	return 0;
+}
+
+
+static int testJitter(
+	void)
+{
+	FrameScheduler scheduler;
+	struct pdraw_video_renderer_stats stats;
+	uint64_t ts, vsync = 0;
+	unsigned int i;
+
+	/* Every fourth frame is delayed by 20 ms */
+	for (i = 1; i <= 100; i++) {
+		ts = (uint64_t)i * TEST_FRAME_PERIOD;
+		TEST_CHECK(pushAndDisplay(&scheduler, ts, ts + TEST_TRANSIT +
+			((i % 4 == 0) ? 20000 : 0), &vsync) == 0);
+	}
+	scheduler.getStats(&stats);
+	TEST_CHECK(stats.playoutDelay > 15000);
+	TEST_CHECK(stats.playoutDelay <= 20000);
+	TEST_CHECK(stats.displayedFrameCount == 100);
+	/* Only the frames before the delay covered the jitter are late */
+	TEST_CHECK(stats.lateFrameCount <= 1);
+	return 0;
+}
+
+
+static int testTransitIncrease(
+	void)
+{
+	FrameScheduler scheduler;
+	struct pdraw_video_renderer_stats stats;
+	uint64_t ts, vsync = 0, lateCount;
+	unsigned int i;
+
+	for (i = 1; i <= 10; i++) {
+		ts = (uint64_t)i * TEST_FRAME_PERIOD;
+		TEST_CHECK(pushAndDisplay(&scheduler, ts,
+			ts + TEST_TRANSIT, &vsync) == 0);
+	}
+
+	/* A transit increase larger than the maximum playout delay but
+	 * under the resynchronization threshold must be absorbed by the
+	 * clock offset within two windows */
+	for (i = 11; i <= 10 + 2 * FRAME_SCHEDULER_OFFSET_WINDOW; i++) {
+		ts = (uint64_t)i * TEST_FRAME_PERIOD;
+		TEST_CHECK(pushAndDisplay(&scheduler, ts,
+			ts + TEST_TRANSIT + 300000, &vsync) == 0);
+	}
+	scheduler.getStats(&stats);
+	lateCount = stats.lateFrameCount;
+	TEST_CHECK(stats.playoutDelay < FRAME_SCHEDULER_MAX_DELAY);
+
+	for (i = 11 + 2 * FRAME_SCHEDULER_OFFSET_WINDOW;
+		i <= 10 + 3 * FRAME_SCHEDULER_OFFSET_WINDOW; i++) {
+		ts = (uint64_t)i * TEST_FRAME_PERIOD;
+		TEST_CHECK(pushAndDisplay(&scheduler, ts,
+			ts + TEST_TRANSIT + 300000, &vsync) == 0);
+	}
+	scheduler.getStats(&stats);
+	TEST_CHECK(stats.lateFrameCount == lateCount);
+	return 0;
+}
+
+
+static int testDropAndOverflow(
+	void)
+{
+	FrameScheduler scheduler;
+	struct pdraw_video_renderer_stats stats;
+	struct vbuf_buffer *buffer;
+	uint64_t ts;
+	unsigned int i;
+
+	/* Fill the scheduler past its capacity: the oldest frame is
+	 * returned to the caller */
+	for (i = 0; i < FRAME_SCHEDULER_MAX_FRAMES; i++) {
+		ts = (uint64_t)(i + 1) * TEST_FRAME_PERIOD;
+		buffer = scheduler.push(testBuffer(i), ts, ts + TEST_TRANSIT);
+		TEST_CHECK(buffer == NULL);
+	}
+	ts = (uint64_t)(i + 1) * TEST_FRAME_PERIOD;
+	buffer = scheduler.push(testBuffer(i), ts, ts + TEST_TRANSIT);
+	TEST_CHECK(buffer == testBuffer(0));
+
+	/* All the frames are due: only the most recent is displayed */
+	ts += TEST_TRANSIT + 2 * TEST_DISPLAY_PERIOD;
+	for (i = 1; i < FRAME_SCHEDULER_MAX_FRAMES; i++) {
+		buffer = scheduler.popDropped(ts, TEST_DISPLAY_PERIOD);
+		TEST_CHECK(buffer == testBuffer(i));
+	}
+	TEST_CHECK(scheduler.popDropped(ts, TEST_DISPLAY_PERIOD) == NULL);
+	buffer = scheduler.pop(ts, TEST_DISPLAY_PERIOD, true);
+	TEST_CHECK(buffer == testBuffer(FRAME_SCHEDULER_MAX_FRAMES));
+	TEST_CHECK(scheduler.pop(ts, TEST_DISPLAY_PERIOD, true) == NULL);
+
+	scheduler.getStats(&stats);
+	TEST_CHECK(stats.receivedFrameCount == FRAME_SCHEDULER_MAX_FRAMES + 1);
+	TEST_CHECK(stats.droppedFrameCount == FRAME_SCHEDULER_MAX_FRAMES);
+	TEST_CHECK(stats.displayedFrameCount == 1);
+	return 0;
+}
+
+
+static int testHold(
+	void)
+{
+	FrameScheduler scheduler;
+	struct vbuf_buffer *buffer;
+	uint64_t ts = TEST_FRAME_PERIOD;
+
+	scheduler.push(testBuffer(0), ts, ts + TEST_TRANSIT);
+
+	/* An early frame is held unless there is nothing displayed */
+	TEST_CHECK(scheduler.pop(ts + TEST_TRANSIT, TEST_DISPLAY_PERIOD,
+		true) == NULL);
+	buffer = scheduler.pop(ts + TEST_TRANSIT, TEST_DISPLAY_PERIOD, false);
+	TEST_CHECK(buffer == testBuffer(0));
+
+	/* The queued frames are flushed regardless of their time */
+	scheduler.push(testBuffer(1), 2 * ts, 2 * ts + TEST_TRANSIT);
+	scheduler.push(testBuffer(2), 3 * ts, 3 * ts + TEST_TRANSIT);
+	TEST_CHECK(scheduler.flush() == testBuffer(1));
+	TEST_CHECK(scheduler.flush() == testBuffer(2));
+	TEST_CHECK(scheduler.flush() == NULL);
+	return 0;
+}
+
+
+static int testDisplayPeriod(
+	void)
+{
+	uint64_t ts = 1000000, lastTs = 0, period = 0;
+	unsigned int i;
+
+	for (i = 0; i < 100; i++) {
+		/* Skipped refresh every tenth render */
+		ts += (i % 10 == 9) ? 2 * TEST_DISPLAY_PERIOD :
+			TEST_DISPLAY_PERIOD;
+		FrameScheduler::updateDisplayPeriod(ts, &lastTs, &period);
+	}
+	TEST_CHECK(period >= TEST_DISPLAY_PERIOD - 100);
+	TEST_CHECK(period <= TEST_DISPLAY_PERIOD + 100);
+
+	/* Stalls are ignored */
+	ts += 1000000;
+	FrameScheduler::updateDisplayPeriod(ts, &lastTs, &period);
+	TEST_CHECK(period >= TEST_DISPLAY_PERIOD - 100);
+	TEST_CHECK(period <= TEST_DISPLAY_PERIOD + 100);
+	return 0;
+}
+
+
+int main(
+	void)
+{
+	int status = EXIT_SUCCESS;
+	unsigned int i;
+	const struct {
+		const char *name;
+		int (*func)(void);
+	} tests[] = {
+		{"constant transit", &testConstantTransit},
+		{"jitter", &testJitter},
+		{"transit increase", &testTransitIncrease},
+		{"drop and overflow", &testDropAndOverflow},
+		{"hold", &testHold},
+		{"display period", &testDisplayPeriod},
+	};
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (tests[i].func() == 0) {
+			printf("%-20s OK\n", tests[i].name);
+		} else {
+			printf("%-20s FAILED\n", tests[i].name);
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return status;
+}
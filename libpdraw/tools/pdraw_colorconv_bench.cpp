@@ -0,0 +1,175 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Color conversion benchmark
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "pdraw_colorconv.hpp"
+
+
+#define BENCH_WIDTH (1920)
+#define BENCH_HEIGHT (1080)
+#define BENCH_ITERATIONS (50)
+
+
+static uint64_t getTime(
+	void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000 + (uint64_t)t.tv_nsec / 1000;
+}
+
+
+static int runFormat(
+	const struct pdraw_video_frame *src,
+	enum pdraw_color_format format,
+	const char *name,
+	enum pdraw_colorconv_impl impl)
+{
+	int ret = 0, i;
+	size_t size = pdraw_colorConvGetFrameSize(
+		format, src->width, src->height);
+	uint8_t *ref = (uint8_t *)malloc(size);
+	uint8_t *out = (uint8_t *)malloc(size);
+	struct pdraw_video_frame frame;
+	uint64_t start, scalarTime, implTime;
+
+	if ((ref == NULL) || (out == NULL)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	start = getTime();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		ret = pdraw_colorConvFrame(src, format, ref, size, &frame,
+			PDRAW_COLORCONV_IMPL_SCALAR);
+		if (ret < 0)
+			goto out;
+	}
+	scalarTime = (getTime() - start) / BENCH_ITERATIONS;
+
+	start = getTime();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		ret = pdraw_colorConvFrame(src, format, out, size, &frame,
+			impl);
+		if (ret < 0)
+			goto out;
+	}
+	implTime = (getTime() - start) / BENCH_ITERATIONS;
+
+	printf("%-6s %-6s scalar %6llu us, %-6s %6llu us (x%.2f)%s\n",
+		(src->colorFormat == PDRAW_COLOR_FORMAT_YUV420PLANAR) ?
+		"I420" : "NV12", name, (unsigned long long)scalarTime,
+		pdraw_colorConvImplStr(impl), (unsigned long long)implTime,
+		(implTime > 0) ? (double)scalarTime / implTime : 0.,
+		(memcmp(ref, out, size) == 0) ? "" : " MISMATCH");
+	if (memcmp(ref, out, size) != 0)
+		ret = -EPROTO;
+
+out:
+	free(ref);
+	free(out);
+	return ret;
+}
+
+
+int main(
+	int argc,
+	char **argv)
+{
+	int ret, status = EXIT_SUCCESS;
+	unsigned int width = BENCH_WIDTH, height = BENCH_HEIGHT;
+	unsigned int cw, ch, i;
+	enum pdraw_colorconv_impl impl = pdraw_colorConvGetImpl();
+	uint8_t *buf;
+	struct pdraw_video_frame src;
+
+	if (argc >= 3) {
+		width = atoi(argv[1]);
+		height = atoi(argv[2]);
+	}
+	if ((width == 0) || (height == 0)) {
+		fprintf(stderr, "usage: %s [<width> <height>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	cw = (width + 1) / 2;
+	ch = (height + 1) / 2;
+
+	/* Synthetic frame covering the full sample range */
+	buf = (uint8_t *)malloc((size_t)width * height + 2 * cw * ch);
+	if (buf == NULL)
+		return EXIT_FAILURE;
+	srand(42);
+	for (i = 0; i < width * height + 2 * cw * ch; i++)
+		buf[i] = rand() & 0xff;
+
+	memset(&src, 0, sizeof(src));
+	src.width = width;
+	src.height = height;
+	src.plane[0] = buf;
+	src.plane[1] = buf + width * height;
+	src.plane[2] = buf + width * height + cw * ch;
+	src.stride[0] = width;
+
+	for (i = 0; i < 2; i++) {
+		if (i == 0) {
+			src.colorFormat = PDRAW_COLOR_FORMAT_YUV420PLANAR;
+			src.stride[1] = cw;
+			src.stride[2] = cw;
+		} else {
+			src.colorFormat = PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR;
+			src.stride[1] = cw * 2;
+			src.stride[2] = 0;
+		}
+		ret = runFormat(&src, PDRAW_COLOR_FORMAT_RGB24, "RGB24", impl);
+		if (ret < 0)
+			status = EXIT_FAILURE;
+		ret = runFormat(&src, PDRAW_COLOR_FORMAT_BGRA, "BGRA", impl);
+		if (ret < 0)
+			status = EXIT_FAILURE;
+		ret = runFormat(&src, PDRAW_COLOR_FORMAT_RGBA, "RGBA", impl);
+		if (ret < 0)
+			status = EXIT_FAILURE;
+		ret = runFormat(&src, PDRAW_COLOR_FORMAT_GRAY8, "GRAY8", impl);
+		if (ret < 0)
+			status = EXIT_FAILURE;
+		ret = runFormat(&src, (i == 0) ?
+			PDRAW_COLOR_FORMAT_YUV420SEMIPLANAR :
+			PDRAW_COLOR_FORMAT_YUV420PLANAR,
+			(i == 0) ? "NV12" : "I420", impl);
+		if (ret < 0)
+			status = EXIT_FAILURE;
+	}
+
+	free(buf);
+	return status;
+}
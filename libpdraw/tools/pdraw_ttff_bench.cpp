@@ -0,0 +1,316 @@
+/**
+ * Parrot Drones Awesome Video Viewer Library
+ * Time to first frame benchmark
+ *
+ * Copyright (c) 2016 Aurelien Barre
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the copyright holder nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <pdraw/pdraw.h>
+
+
+#define BENCH_ITERATIONS (10)
+#define BENCH_RESPONSE_TIMEOUT (5000000)
+#define BENCH_FIRST_FRAME_TIMEOUT (5000000)
+#define BENCH_POLL_PERIOD (1000)
+
+
+struct bench_ctx {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool openDone;
+	bool closeDone;
+	int status;
+};
+
+
+struct bench_result {
+	uint64_t first;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+	unsigned int count;
+	unsigned int warmCount;
+};
+
+
+static uint64_t getTime(
+	void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000 + (uint64_t)t.tv_nsec / 1000;
+}
+
+
+static void openResp(
+	struct pdraw * /* pdraw */,
+	int status,
+	void *userdata)
+{
+	struct bench_ctx *ctx = (struct bench_ctx *)userdata;
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->openDone = true;
+	ctx->status = status;
+	pthread_cond_signal(&ctx->cond);
+	pthread_mutex_unlock(&ctx->mutex);
+}
+
+
+static void closeResp(
+	struct pdraw * /* pdraw */,
+	int status,
+	void *userdata)
+{
+	struct bench_ctx *ctx = (struct bench_ctx *)userdata;
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->closeDone = true;
+	ctx->status = status;
+	pthread_cond_signal(&ctx->cond);
+	pthread_mutex_unlock(&ctx->mutex);
+}
+
+
+static int waitResponse(
+	struct bench_ctx *ctx,
+	bool *done)
+{
+	int ret = 0;
+	struct timespec ts;
+	uint64_t deadline = 0;
+
+	/* The condition variable uses the realtime clock */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	deadline = (uint64_t)ts.tv_sec * 1000000 +
+		(uint64_t)ts.tv_nsec / 1000 + BENCH_RESPONSE_TIMEOUT;
+	ts.tv_sec = deadline / 1000000;
+	ts.tv_nsec = (deadline % 1000000) * 1000;
+
+	pthread_mutex_lock(&ctx->mutex);
+	while ((!*done) && (ret == 0))
+		ret = -pthread_cond_timedwait(&ctx->cond, &ctx->mutex, &ts);
+	if (ret == 0)
+		ret = ctx->status;
+	*done = false;
+	pthread_mutex_unlock(&ctx->mutex);
+
+	return ret;
+}
+
+
+static int getVideoMediaId(
+	struct pdraw *pdraw,
+	unsigned int *mediaId)
+{
+	int count, i, ret;
+	struct pdraw_media_info info;
+
+	count = pdraw_get_media_count(pdraw);
+	for (i = 0; i < count; i++) {
+		ret = pdraw_get_media_info(pdraw, i, &info);
+		if (ret < 0)
+			return ret;
+		if (info.type == PDRAW_MEDIA_TYPE_VIDEO) {
+			*mediaId = info.id;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+
+static int runOnce(
+	struct pdraw *pdraw,
+	struct bench_ctx *ctx,
+	const char *url,
+	uint64_t *ttff,
+	bool *warm)
+{
+	int ret, err;
+	unsigned int mediaId = 0;
+	struct pdraw_video_decoder_stats stats;
+	uint64_t start;
+
+	ret = pdraw_open_url(pdraw, url);
+	if (ret < 0)
+		return ret;
+	ret = waitResponse(ctx, &ctx->openDone);
+	if (ret < 0)
+		return ret;
+
+	ret = pdraw_play(pdraw);
+	if (ret < 0)
+		goto out;
+
+	/* The time to first frame is measured by the decoder from the
+	 * session open; poll until it is available */
+	memset(&stats, 0, sizeof(stats));
+	start = getTime();
+	while (stats.timeToFirstFrame == 0) {
+		if (getTime() - start > BENCH_FIRST_FRAME_TIMEOUT) {
+			ret = -ETIMEDOUT;
+			goto out;
+		}
+		usleep(BENCH_POLL_PERIOD);
+		if (getVideoMediaId(pdraw, &mediaId) < 0)
+			continue;
+		ret = pdraw_get_video_decoder_stats(pdraw, mediaId, &stats);
+		if (ret < 0)
+			memset(&stats, 0, sizeof(stats));
+	}
+	*ttff = stats.timeToFirstFrame;
+	*warm = (stats.warmStart != 0);
+	ret = 0;
+
+out:
+	err = pdraw_close(pdraw);
+	if (err == 0)
+		err = waitResponse(ctx, &ctx->closeDone);
+	return (ret < 0) ? ret : err;
+}
+
+
+static int runMode(
+	struct bench_ctx *ctx,
+	const char *url,
+	bool warmPool,
+	unsigned int iterations,
+	struct bench_result *result)
+{
+	int ret;
+	unsigned int i;
+	uint64_t ttff = 0;
+	bool warm = false;
+	struct pdraw *pdraw = NULL;
+	struct pdraw_cbs cbs;
+
+	memset(result, 0, sizeof(*result));
+	memset(&cbs, 0, sizeof(cbs));
+	cbs.open_resp = &openResp;
+	cbs.close_resp = &closeResp;
+
+	/* One session per mode so that the warm pool starts empty */
+	ret = pdraw_new(NULL, &cbs, ctx, &pdraw);
+	if (ret < 0)
+		return ret;
+	ret = pdraw_set_warm_pool_setting(pdraw, (warmPool) ? 1 : 0);
+	if (ret < 0)
+		goto out;
+
+	for (i = 0; i < iterations; i++) {
+		ret = runOnce(pdraw, ctx, url, &ttff, &warm);
+		if (ret < 0)
+			goto out;
+		if (i == 0) {
+			/* Always a cold start: the pool is filled on close */
+			result->first = ttff;
+			continue;
+		}
+		if ((result->count == 0) || (ttff < result->min))
+			result->min = ttff;
+		if (ttff > result->max)
+			result->max = ttff;
+		result->sum += ttff;
+		result->count++;
+		if (warm)
+			result->warmCount++;
+	}
+
+out:
+	pdraw_destroy(pdraw);
+	return ret;
+}
+
+
+static void printResult(
+	const char *name,
+	const struct bench_result *result)
+{
+	printf("%-4s first %7.2f ms, next %u: min %7.2f ms, "
+		"mean %7.2f ms, max %7.2f ms (%u warm starts)\n",
+		name, (float)result->first / 1000., result->count,
+		(float)result->min / 1000.,
+		(result->count > 0) ?
+		(float)result->sum / result->count / 1000. : 0.,
+		(float)result->max / 1000., result->warmCount);
+}
+
+
+int main(
+	int argc,
+	char **argv)
+{
+	int ret, status = EXIT_SUCCESS;
+	unsigned int iterations = BENCH_ITERATIONS;
+	struct bench_ctx ctx;
+	struct bench_result cold, warm;
+
+	if (argc >= 3)
+		iterations = atoi(argv[2]);
+	if ((argc < 2) || (iterations < 2)) {
+		fprintf(stderr, "usage: %s <url> [<iterations>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	pthread_mutex_init(&ctx.mutex, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+
+	/* Open/close loops on the same session, with and without
+	 * the warm decoder pool */
+	ret = runMode(&ctx, argv[1], false, iterations, &cold);
+	if (ret < 0) {
+		fprintf(stderr, "cold run failed: %s\n", strerror(-ret));
+		status = EXIT_FAILURE;
+		goto out;
+	}
+	ret = runMode(&ctx, argv[1], true, iterations, &warm);
+	if (ret < 0) {
+		fprintf(stderr, "warm run failed: %s\n", strerror(-ret));
+		status = EXIT_FAILURE;
+		goto out;
+	}
+
+	printResult("cold", &cold);
+	printResult("warm", &warm);
+	if (warm.count > 0) {
+		printf("warm/cold mean time to first frame: %.2f\n",
+			(cold.sum > 0) ? (double)warm.sum / cold.sum : 0.);
+	}
+
+out:
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.mutex);
+	return status;
+}